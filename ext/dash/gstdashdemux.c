@@ -390,6 +390,8 @@ static gboolean
 gst_dash_demux_stream_advance_subfragment (GstAdaptiveDemuxStream * stream);
 static gboolean gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
+static GArray *gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream);
 static gint64 gst_dash_demux_get_manifest_update_interval (GstAdaptiveDemux *
     demux);
 static GstFlowReturn gst_dash_demux_update_manifest_data (GstAdaptiveDemux *
@@ -473,7 +475,8 @@ gst_dash_demux_get_live_seek_range (GstAdaptiveDemux * demux, gint64 * start,
   GDateTime *now;
   GDateTime *mstart;
   GTimeSpan stream_now;
-  GstClockTime seg_duration;
+  GstClockTime seg_duration, ato;
+  GList *iter;
 
   if (self->client->mpd_node->availabilityStartTime == NULL)
     return FALSE;
@@ -507,9 +510,20 @@ gst_dash_demux_get_live_seek_range (GstAdaptiveDemux * demux, gint64 * start,
      * the MPD start time of the Media Segment, and
      * the MPD duration of the Media Segment.
      Therefore we need to subtract the media segment duration from the stop
-     time.
+     time. The SegmentTemplate@availabilityTimeOffset makes segments
+     available earlier, use the smallest one of all streams.
    */
-  *stop -= seg_duration;
+  ato = seg_duration;
+  for (iter = demux->streams; iter; iter = g_list_next (iter)) {
+    GstDashDemuxStream *dashstream = iter->data;
+
+    if (dashstream->active_stream)
+      ato = MIN (ato, dashstream->active_stream->availabilityTimeOffset);
+  }
+  if (demux->streams == NULL)
+    ato = 0;
+
+  *stop -= seg_duration - ato;
   return TRUE;
 }
 
@@ -635,6 +649,8 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
   gstadaptivedemux_class->stream_seek = gst_dash_demux_stream_seek;
   gstadaptivedemux_class->stream_select_bitrate =
       gst_dash_demux_stream_select_bitrate;
+  gstadaptivedemux_class->stream_get_bitrates =
+      gst_dash_demux_stream_get_bitrates;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
@@ -857,6 +873,7 @@ gst_dash_demux_setup_all_streams (GstDashDemux * demux)
     stream->sidx_position = GST_CLOCK_TIME_NONE;
     stream->actual_position = GST_CLOCK_TIME_NONE;
     stream->target_time = GST_CLOCK_TIME_NONE;
+    stream->mdat_end_offset = -1;
     /* Set a default average keyframe download time of a quarter of a second */
     stream->average_download_time = 250 * GST_MSECOND;
     if (active_stream->cur_adapt_set &&
@@ -1479,6 +1496,7 @@ gst_dash_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
   dashstream->isobmff_parser.current_fourcc = 0;
   dashstream->isobmff_parser.current_start_offset = 0;
   dashstream->isobmff_parser.current_size = 0;
+  dashstream->mdat_end_offset = -1;
 
   if (dashstream->moof)
     gst_isoff_moof_box_free (dashstream->moof);
@@ -2071,6 +2089,7 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
   dashstream->isobmff_parser.current_fourcc = 0;
   dashstream->isobmff_parser.current_start_offset = 0;
   dashstream->isobmff_parser.current_size = 0;
+  dashstream->mdat_end_offset = -1;
 
   if (dashstream->moof)
     gst_isoff_moof_box_free (dashstream->moof);
@@ -2157,6 +2176,56 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
   return ret;
 }
 
+static gint
+compare_bitrates (gconstpointer a, gconstpointer b)
+{
+  guint64 ba = *(const guint64 *) a, bb = *(const guint64 *) b;
+
+  return ba < bb ? -1 : (ba > bb ? 1 : 0);
+}
+
+static GArray *
+gst_dash_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream)
+{
+  GstDashDemux *demux = GST_DASH_DEMUX_CAST (stream->demux);
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstActiveStream *active_stream = dashstream->active_stream;
+  GArray *bitrates;
+  GList *l;
+  guint i;
+
+  if (active_stream == NULL || active_stream->cur_adapt_set == NULL
+      || GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (demux))
+    return NULL;
+
+  bitrates = g_array_new (FALSE, FALSE, sizeof (guint64));
+  for (l = active_stream->cur_adapt_set->Representations; l; l = l->next) {
+    GstRepresentationNode *rep = l->data;
+    guint64 bandwidth;
+
+    if (rep == NULL || rep->bandwidth == 0)
+      continue;
+    /* select_bitrate() won't go above max-bitrate either */
+    if (active_stream->mimeType == GST_STREAM_VIDEO && demux->max_bitrate
+        && rep->bandwidth > demux->max_bitrate)
+      continue;
+
+    bandwidth = rep->bandwidth;
+    g_array_append_val (bitrates, bandwidth);
+  }
+
+  g_array_sort (bitrates, compare_bitrates);
+  for (i = 1; i < bitrates->len;) {
+    if (g_array_index (bitrates, guint64, i) ==
+        g_array_index (bitrates, guint64, i - 1))
+      g_array_remove_index (bitrates, i);
+    else
+      i++;
+  }
+
+  return bitrates;
+}
+
 static gboolean
 gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
@@ -2258,6 +2327,7 @@ gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     dashstream->isobmff_parser.current_fourcc = 0;
     dashstream->isobmff_parser.current_start_offset = 0;
     dashstream->isobmff_parser.current_size = 0;
+    dashstream->mdat_end_offset = -1;
 
     dashstream->current_offset = -1;
     dashstream->current_index_header_or_data = 0;
@@ -2995,6 +3065,12 @@ gst_dash_demux_parse_isobmff (GstAdaptiveDemux * demux,
     pending = _gst_buffer_split (buffer, gst_byte_reader_get_pos (&reader), -1);
     gst_adapter_push (dash_stream->adapter, pending);
     dash_stream->current_offset += gst_byte_reader_get_pos (&reader);
+    if (dash_stream->isobmff_parser.current_size == -1)
+      dash_stream->mdat_end_offset = -1;
+    else
+      dash_stream->mdat_end_offset =
+          dash_stream->isobmff_parser.current_start_offset +
+          dash_stream->isobmff_parser.current_size;
     dash_stream->isobmff_parser.current_size = 0;
 
     GST_BUFFER_OFFSET (buffer) = buffer_offset;
@@ -3258,6 +3334,28 @@ gst_dash_demux_find_sync_samples (GstAdaptiveDemux * demux,
   return TRUE;
 }
 
+/* Low latency (CMAF) segments are made of several moof/mdat chunks. Once the
+ * mdat of a chunk is over, go back to parsing the boxes of the next one */
+static void
+gst_dash_demux_stream_end_isobmff_chunk (GstDashDemuxStream * dash_stream)
+{
+  GST_LOG_OBJECT (dash_stream->parent.pad, "mdat finished at offset %"
+      G_GUINT64_FORMAT, dash_stream->mdat_end_offset);
+
+  dash_stream->isobmff_parser.current_fourcc = 0;
+  dash_stream->isobmff_parser.current_start_offset =
+      dash_stream->mdat_end_offset;
+  dash_stream->isobmff_parser.current_size = 0;
+  dash_stream->mdat_end_offset = -1;
+
+  if (dash_stream->moof)
+    gst_isoff_moof_box_free (dash_stream->moof);
+  dash_stream->moof = NULL;
+  if (dash_stream->moof_sync_samples)
+    g_array_free (dash_stream->moof_sync_samples, TRUE);
+  dash_stream->moof_sync_samples = NULL;
+  dash_stream->current_sync_sample = -1;
+}
 
 static GstFlowReturn
 gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
@@ -3267,6 +3365,7 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
   GstFlowReturn ret = GST_FLOW_OK;
   GstBuffer *buffer;
   gboolean sidx_advance = FALSE;
+  gboolean chunk_end = FALSE;
 
   /* We parse all ISOBMFF boxes of a (sub)fragment until the mdat. This covers
    * at least moov, moof and sidx boxes. Once mdat is received we just output
@@ -3363,6 +3462,26 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
         }
       }
     }
+  } else if (dash_stream->mdat_end_offset != -1
+      && !GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (stream->demux)) {
+    gsize available = gst_adapter_available (dash_stream->adapter);
+    guint64 remaining = 0;
+
+    /* Only take what is left of this mdat, anything after it belongs to the
+     * next chunk. The payload is still pushed as soon as it arrives */
+    if (dash_stream->mdat_end_offset > dash_stream->current_offset)
+      remaining = dash_stream->mdat_end_offset - dash_stream->current_offset;
+
+    if (remaining == 0) {
+      gst_dash_demux_stream_end_isobmff_chunk (dash_stream);
+      if (available > 0)
+        return gst_dash_demux_handle_isobmff (demux, stream);
+      return ret;
+    }
+
+    chunk_end = available >= remaining;
+    buffer = gst_adapter_take_buffer (dash_stream->adapter,
+        MIN (available, remaining));
   } else {
     /* Take it all and handle it further below */
     buffer =
@@ -3422,6 +3541,11 @@ gst_dash_demux_handle_isobmff (GstAdaptiveDemux * demux,
       return ret;
 
     /* If we still have data available, recurse and use it up if possible */
+    if (gst_adapter_available (dash_stream->adapter) > 0)
+      return gst_dash_demux_handle_isobmff (demux, stream);
+  } else if (chunk_end) {
+    gst_dash_demux_stream_end_isobmff_chunk (dash_stream);
+
     if (gst_adapter_available (dash_stream->adapter) > 0)
       return gst_dash_demux_handle_isobmff (demux, stream);
   }
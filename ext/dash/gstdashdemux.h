@@ -89,6 +89,9 @@ struct _GstDashDemuxStream
     guint64 current_size;
   } isobmff_parser;
 
+  /* end offset of the current mdat, -1 if it lasts until the end */
+  guint64 mdat_end_offset;
+
   GstMoofBox *moof;
   guint64 moof_offset, moof_size;
   GArray *moof_sync_samples;
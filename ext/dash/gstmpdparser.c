@@ -27,6 +27,7 @@
 #include <string.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include "gstmpdparser.h"
 #include "gstdash_debug.h"
 
@@ -126,7 +127,7 @@ static void gst_mpdparser_parse_metrics_range_node (GList ** list,
     xmlNode * a_node);
 static void gst_mpdparser_parse_metrics_node (GList ** list, xmlNode * a_node);
 static gboolean gst_mpdparser_parse_root_node (GstMPDNode ** pointer,
-    xmlNode * a_node);
+    xmlTextReaderPtr reader);
 static void gst_mpdparser_parse_utctiming_node (GList ** list,
     xmlNode * a_node);
 
@@ -134,9 +135,8 @@ static void gst_mpdparser_parse_utctiming_node (GList ** list,
 static guint convert_to_millisecs (guint decimals, gint pos);
 static int strncmp_ext (const char *s1, const char *s2);
 static GstStreamPeriod *gst_mpdparser_get_stream_period (GstMpdClient * client);
-static GstSNode *gst_mpdparser_clone_s_node (GstSNode * pointer);
 static GstSegmentTimelineNode
-    * gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer);
+    * gst_mpdparser_ref_segment_timeline (GstSegmentTimelineNode * pointer);
 static GstRange *gst_mpdparser_clone_range (GstRange * range);
 static GstURLType *gst_mpdparser_clone_URL (GstURLType * url);
 static gchar *gst_mpdparser_parse_baseURL (GstMpdClient * client,
@@ -1484,6 +1484,7 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
   GstSegmentBaseType *seg_base_type;
   guint intval;
   guint64 int64val;
+  gdouble doubleval;
   gboolean boolval;
   GstRange *rangeval;
 
@@ -1498,6 +1499,7 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
   if (parent) {
     seg_base_type->timescale = parent->timescale;
     seg_base_type->presentationTimeOffset = parent->presentationTimeOffset;
+    seg_base_type->availabilityTimeOffset = parent->availabilityTimeOffset;
     seg_base_type->indexRange = gst_mpdparser_clone_range (parent->indexRange);
     seg_base_type->indexRangeExact = parent->indexRangeExact;
     seg_base_type->Initialization =
@@ -1517,6 +1519,11 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
           "presentationTimeOffset", 0, &int64val)) {
     seg_base_type->presentationTimeOffset = int64val;
   }
+  /* "INF" is parsed as infinity by sscanf() */
+  if (gst_mpdparser_get_xml_prop_double (a_node, "availabilityTimeOffset",
+          &doubleval) && doubleval >= 0) {
+    seg_base_type->availabilityTimeOffset = doubleval;
+  }
   if (gst_mpdparser_get_xml_prop_range (a_node, "indexRange", &rangeval)) {
     if (seg_base_type->indexRange) {
       g_slice_free (GstRange, seg_base_type->indexRange);
@@ -1546,21 +1553,6 @@ gst_mpdparser_parse_seg_base_type_ext (GstSegmentBaseType ** pointer,
   }
 }
 
-static GstSNode *
-gst_mpdparser_clone_s_node (GstSNode * pointer)
-{
-  GstSNode *clone = NULL;
-
-  if (pointer) {
-    clone = g_slice_new0 (GstSNode);
-    clone->t = pointer->t;
-    clone->d = pointer->d;
-    clone->r = pointer->r;
-  }
-
-  return clone;
-}
-
 static void
 gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
 {
@@ -1577,29 +1569,15 @@ gst_mpdparser_parse_s_node (GQueue * queue, xmlNode * a_node)
   gst_mpdparser_get_xml_prop_signed_integer (a_node, "r", 0, &new_s_node->r);
 }
 
+/* SegmentTimeline nodes are never modified after parsing, so an inherited
+ * timeline is shared with the parent instead of being copied */
 static GstSegmentTimelineNode *
-gst_mpdparser_clone_segment_timeline (GstSegmentTimelineNode * pointer)
-{
-  GstSegmentTimelineNode *clone = NULL;
-
-  if (pointer) {
-    clone = gst_mpdparser_segment_timeline_node_new ();
-    if (clone) {
-      GList *list;
-      for (list = g_queue_peek_head_link (&pointer->S); list;
-          list = g_list_next (list)) {
-        GstSNode *s_node;
-        s_node = (GstSNode *) list->data;
-        if (s_node) {
-          g_queue_push_tail (&clone->S, gst_mpdparser_clone_s_node (s_node));
-        }
-      }
-    } else {
-      GST_WARNING ("Allocation of SegmentTimeline node failed!");
-    }
-  }
+gst_mpdparser_ref_segment_timeline (GstSegmentTimelineNode * pointer)
+{
+  if (pointer)
+    g_atomic_int_inc (&pointer->ref_count);
 
-  return clone;
+  return pointer;
 }
 
 static void
@@ -1646,7 +1624,7 @@ gst_mpdparser_parse_mult_seg_base_type_ext (GstMultSegmentBaseType ** pointer,
     mult_seg_base_type->duration = parent->duration;
     mult_seg_base_type->startNumber = parent->startNumber;
     mult_seg_base_type->SegmentTimeline =
-        gst_mpdparser_clone_segment_timeline (parent->SegmentTimeline);
+        gst_mpdparser_ref_segment_timeline (parent->SegmentTimeline);
     mult_seg_base_type->BitstreamSwitching =
         gst_mpdparser_clone_URL (parent->BitstreamSwitching);
   }
@@ -2328,14 +2306,11 @@ gst_mpdparser_parse_utctiming_node (GList ** list, xmlNode * a_node)
   }
 }
 
-static gboolean
-gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
+static GstMPDNode *
+gst_mpdparser_parse_root_node_attributes (xmlNode * a_node)
 {
-  xmlNode *cur_node;
   GstMPDNode *new_mpd;
 
-  gst_mpdparser_free_mpd_node (*pointer);
-  *pointer = NULL;
   new_mpd = g_slice_new0 (GstMPDNode);
 
   GST_LOG ("namespaces of root MPD node:");
@@ -2369,27 +2344,89 @@ gst_mpdparser_parse_root_node (GstMPDNode ** pointer, xmlNode * a_node)
   gst_mpdparser_get_xml_prop_duration (a_node, "maxSubsegmentDuration",
       GST_MPD_DURATION_NONE, &new_mpd->maxSubsegmentDuration);
 
-  /* explore children Period nodes */
-  for (cur_node = a_node->children; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-      if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
-        if (!gst_mpdparser_parse_period_node (&new_mpd->Periods, cur_node))
-          goto error;
-      } else if (xmlStrcmp (cur_node->name,
-              (xmlChar *) "ProgramInformation") == 0) {
-        gst_mpdparser_parse_program_info_node (&new_mpd->ProgramInfo, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
-        gst_mpdparser_parse_baseURL_node (&new_mpd->BaseURLs, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
-        gst_mpdparser_parse_location_node (&new_mpd->Locations, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
-        gst_mpdparser_parse_metrics_node (&new_mpd->Metrics, cur_node);
-      } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
-        gst_mpdparser_parse_utctiming_node (&new_mpd->UTCTiming, cur_node);
+  return new_mpd;
+}
+
+static gboolean
+gst_mpdparser_parse_root_child_node (GstMPDNode * mpd, xmlNode * cur_node)
+{
+  if (xmlStrcmp (cur_node->name, (xmlChar *) "Period") == 0) {
+    if (!gst_mpdparser_parse_period_node (&mpd->Periods, cur_node))
+      return FALSE;
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "ProgramInformation") == 0) {
+    gst_mpdparser_parse_program_info_node (&mpd->ProgramInfo, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "BaseURL") == 0) {
+    gst_mpdparser_parse_baseURL_node (&mpd->BaseURLs, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Location") == 0) {
+    gst_mpdparser_parse_location_node (&mpd->Locations, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "Metrics") == 0) {
+    gst_mpdparser_parse_metrics_node (&mpd->Metrics, cur_node);
+  } else if (xmlStrcmp (cur_node->name, (xmlChar *) "UTCTiming") == 0) {
+    gst_mpdparser_parse_utctiming_node (&mpd->UTCTiming, cur_node);
+  }
+
+  return TRUE;
+}
+
+/* Reads the MPD from @reader one child of the root node at a time, so that
+ * only the subtree of the element being parsed (usually a Period) is kept
+ * in memory instead of the tree of the whole document */
+static gboolean
+gst_mpdparser_parse_root_node (GstMPDNode ** pointer,
+    xmlTextReaderPtr reader)
+{
+  xmlNode *a_node, *cur_node;
+  GstMPDNode *new_mpd = NULL;
+  gint ret;
+
+  gst_mpdparser_free_mpd_node (*pointer);
+  *pointer = NULL;
+
+  /* get the root element node */
+  do {
+    ret = xmlTextReaderRead (reader);
+  } while (ret == 1 && xmlTextReaderNodeType (reader) !=
+      XML_READER_TYPE_ELEMENT);
+
+  if (ret != 1)
+    goto error;
+
+  a_node = xmlTextReaderCurrentNode (reader);
+  if (xmlStrcmp (a_node->name, (xmlChar *) "MPD") != 0) {
+    GST_ERROR
+        ("can not find the root element MPD, failed to parse the MPD file");
+    goto error;
+  }
+
+  new_mpd = gst_mpdparser_parse_root_node_attributes (a_node);
+
+  /* explore children nodes */
+  if (!xmlTextReaderIsEmptyElement (reader)) {
+    ret = xmlTextReaderRead (reader);
+    while (ret == 1 && xmlTextReaderDepth (reader) > 0) {
+      if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT) {
+        ret = xmlTextReaderRead (reader);
+        continue;
       }
+
+      cur_node = xmlTextReaderExpand (reader);
+      if (cur_node == NULL
+          || !gst_mpdparser_parse_root_child_node (new_mpd, cur_node))
+        goto error;
+
+      /* skipping the subtree releases its nodes */
+      ret = xmlTextReaderNext (reader);
     }
   }
 
+  /* make sure the rest of the document is well-formed */
+  do {
+    ret = xmlTextReaderRead (reader);
+  } while (ret == 1);
+
+  if (ret != 0)
+    goto error;
+
   *pointer = new_mpd;
   return TRUE;
 
@@ -2998,6 +3035,7 @@ gst_mpdparser_segment_timeline_node_new (void)
   GstSegmentTimelineNode *node = g_slice_new0 (GstSegmentTimelineNode);
 
   g_queue_init (&node->S);
+  node->ref_count = 1;
 
   return node;
 }
@@ -3005,7 +3043,7 @@ gst_mpdparser_segment_timeline_node_new (void)
 static void
 gst_mpdparser_free_segment_timeline_node (GstSegmentTimelineNode * seg_timeline)
 {
-  if (seg_timeline) {
+  if (seg_timeline && g_atomic_int_dec_and_test (&seg_timeline->ref_count)) {
     g_queue_foreach (&seg_timeline->S, (GFunc) gst_mpdparser_free_s_node, NULL);
     g_queue_clear (&seg_timeline->S);
     g_slice_free (GstSegmentTimelineNode, seg_timeline);
@@ -3826,12 +3864,12 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
   gboolean ret = FALSE;
 
   if (data) {
-    xmlDocPtr doc;
-    xmlNode *root_element = NULL;
+    xmlTextReaderPtr reader;
 
     GST_DEBUG ("MPD file fully buffered, start parsing...");
 
-    /* parse the complete MPD file into a tree (using the libxml2 default parser API) */
+    /* parse the MPD file element by element (using the libxml2 xmlReader
+     * API), never building the tree of the complete document */
 
     /* this initialize the library and check potential ABI mismatches
      * between the version it was compiled for and the actual shared
@@ -3839,26 +3877,18 @@ gst_mpd_parse (GstMpdClient * client, const gchar * data, gint size)
      */
     LIBXML_TEST_VERSION;
 
-    /* parse "data" into a document (which is a libxml2 tree structure xmlDoc) */
-    doc = xmlReadMemory (data, size, "noname.xml", NULL, XML_PARSE_NONET);
-    if (doc == NULL) {
+    reader = xmlReaderForMemory (data, size, "noname.xml", NULL,
+        XML_PARSE_NONET);
+    if (reader == NULL) {
       GST_ERROR ("failed to parse the MPD file");
       ret = FALSE;
     } else {
-      /* get the root element node */
-      root_element = xmlDocGetRootElement (doc);
-
-      if (root_element->type != XML_ELEMENT_NODE
-          || xmlStrcmp (root_element->name, (xmlChar *) "MPD") != 0) {
-        GST_ERROR
-            ("can not find the root element MPD, failed to parse the MPD file");
-        ret = FALSE;            /* used to return TRUE before, but this seems wrong */
-      } else {
-        /* now we can parse the MPD root node and all children nodes, recursively */
-        ret = gst_mpdparser_parse_root_node (&client->mpd_node, root_element);
-      }
-      /* free the document */
-      xmlFreeDoc (doc);
+      /* now we can parse the MPD root node and all children nodes */
+      ret = gst_mpdparser_parse_root_node (&client->mpd_node, reader);
+      if (!ret)
+        GST_ERROR ("failed to parse the MPD file");
+      /* free the reader and the remaining nodes */
+      xmlFreeTextReader (reader);
     }
 
     if (ret) {
@@ -3953,12 +3983,22 @@ gst_mpd_client_stream_update_presentation_time_offset (GstMpdClient * client,
     stream->presentationTimeOffset =
         gst_util_uint64_scale (segbase->presentationTimeOffset, GST_SECOND,
         segbase->timescale);
+    /* Low latency streams can have segments available as soon as they
+     * start being produced */
+    if (segbase->availabilityTimeOffset >= G_MAXUINT64 / GST_SECOND)
+      stream->availabilityTimeOffset = G_MAXUINT64 - 1;
+    else
+      stream->availabilityTimeOffset =
+          segbase->availabilityTimeOffset * GST_SECOND;
   } else {
     stream->presentationTimeOffset = 0;
+    stream->availabilityTimeOffset = 0;
   }
 
-  GST_LOG ("Setting stream's presentation time offset to %" GST_TIME_FORMAT,
-      GST_TIME_ARGS (stream->presentationTimeOffset));
+  GST_LOG ("Setting stream's presentation time offset to %" GST_TIME_FORMAT
+      ", availability time offset %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (stream->presentationTimeOffset),
+      GST_TIME_ARGS (stream->availabilityTimeOffset));
 }
 
 gboolean
@@ -6013,6 +6053,13 @@ gst_mpd_client_get_next_segment_availability_start_time (GstMpdClient * client,
     segmentEndTime = (1 + seg_idx) * seg_duration;
   }
 
+  /* With availabilityTimeOffset the segment can be fetched before it's
+   * complete, the rest of it is then received while it's being produced */
+  if (stream->availabilityTimeOffset >= segmentEndTime)
+    segmentEndTime = 0;
+  else
+    segmentEndTime -= stream->availabilityTimeOffset;
+
   availability_start_time = gst_mpd_client_get_availability_start_time (client);
   if (availability_start_time == NULL) {
     GST_WARNING_OBJECT (client, "Failed to get availability_start_time");
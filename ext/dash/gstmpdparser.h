@@ -155,6 +155,8 @@ struct _GstSegmentTimelineNode
 {
   /* list of S nodes */
   GQueue S;
+  /* shared by all nodes inheriting the timeline */
+  gint ref_count;                  /* ATOMIC */
 };
 
 struct _GstURLType
@@ -167,6 +169,7 @@ struct _GstSegmentBaseType
 {
   guint timescale;
   guint64 presentationTimeOffset;
+  gdouble availabilityTimeOffset;    /* in seconds, can be infinite */
   GstRange *indexRange;
   gboolean indexRangeExact;
   /* Initialization node */
@@ -500,6 +503,7 @@ struct _GstActiveStream
   guint segment_repeat_index;                 /* index of the repeat count of a segment */
   GPtrArray *segments;                        /* array of GstMediaSegment */
   GstClockTime presentationTimeOffset;        /* presentation time offset of the current segment */
+  GstClockTime availabilityTimeOffset;        /* how much earlier than their end segments can be requested */
 };
 
 struct _GstMpdClient
@@ -107,8 +107,13 @@ static GstFlowReturn gst_hls_demux_advance_fragment (GstAdaptiveDemuxStream *
     stream);
 static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
+static gboolean gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream *
+    stream, guint index, gchar ** uri, gint64 * range_start,
+    gint64 * range_end);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
+static GArray *gst_hls_demux_stream_get_bitrates (GstAdaptiveDemuxStream *
+    stream);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
 static gboolean gst_hls_demux_get_live_seek_range (GstAdaptiveDemux * demux,
     gint64 * start, gint64 * stop);
@@ -174,7 +179,10 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_advance_fragment = gst_hls_demux_advance_fragment;
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
+  adaptivedemux_class->stream_peek_fragment =
+      gst_hls_demux_stream_peek_fragment;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
+  adaptivedemux_class->stream_get_bitrates = gst_hls_demux_stream_get_bitrates;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
   adaptivedemux_class->start_fragment = gst_hls_demux_start_fragment;
@@ -1124,6 +1132,31 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_stream_peek_fragment (GstAdaptiveDemuxStream * stream,
+    guint index, gchar ** uri, gint64 * range_start, gint64 * range_end)
+{
+  GstM3U8MediaFile *file;
+  GstM3U8 *m3u8;
+
+  m3u8 = gst_hls_demux_stream_get_m3u8 (GST_HLS_DEMUX_STREAM_CAST (stream));
+
+  file = gst_m3u8_peek_fragment (m3u8, index);
+  if (file == NULL)
+    return FALSE;
+
+  *uri = g_strdup (file->uri);
+  *range_start = file->offset;
+  if (file->size != -1)
+    *range_end = file->offset + file->size - 1;
+  else
+    *range_end = -1;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
@@ -1153,6 +1186,38 @@ gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
   return changed;
 }
 
+static GArray *
+gst_hls_demux_stream_get_bitrates (GstAdaptiveDemuxStream * stream)
+{
+  GstHLSDemux *hlsdemux = GST_HLS_DEMUX_CAST (stream->demux);
+  GstHLSDemuxStream *hls_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GArray *bitrates;
+  GList *l;
+
+  /* only the primary stream switches variants, see select_bitrate() */
+  if (hlsdemux->master == NULL || hlsdemux->master->is_simple
+      || !hls_stream->is_primary_playlist)
+    return NULL;
+
+  if (hlsdemux->current_variant && hlsdemux->current_variant->iframe)
+    l = hlsdemux->master->iframe_variants;
+  else
+    l = hlsdemux->master->variants;
+
+  /* the variants are sorted by bandwidth already */
+  bitrates = g_array_new (FALSE, FALSE, sizeof (guint64));
+  for (; l != NULL; l = l->next) {
+    GstHLSVariantStream *variant = l->data;
+    guint64 bandwidth = variant->bandwidth;
+
+    if (bitrates->len == 0
+        || bandwidth > g_array_index (bitrates, guint64, bitrates->len - 1))
+      g_array_append_val (bitrates, bandwidth);
+  }
+
+  return bitrates;
+}
+
 static void
 gst_hls_demux_reset (GstAdaptiveDemux * ademux)
 {
@@ -1492,22 +1557,23 @@ retry:
     gint64 last_sequence, first_sequence;
 
     GST_M3U8_CLIENT_LOCK (demux->client);
-    last_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_last (m3u8->files)->data)->sequence;
-    first_sequence =
-        GST_M3U8_MEDIA_FILE (g_list_first (m3u8->files)->data)->sequence;
-
-    GST_DEBUG_OBJECT (demux,
-        "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
-        " , last_sequence:%" G_GINT64_FORMAT, m3u8->sequence,
-        first_sequence, last_sequence);
-    if (m3u8->sequence > last_sequence - 3) {
-      //demux->need_segment = TRUE;
-      /* Make sure we never go below the minimum sequence number */
-      m3u8->sequence = MAX (first_sequence, last_sequence - 3);
+    if (!gst_m3u8_get_sequence_range (m3u8, &first_sequence, &last_sequence)) {
+      /* Nothing to clamp against until a refresh lists fragments */
+      GST_DEBUG_OBJECT (demux, "Live playlist is empty, keeping sequence %"
+          G_GINT64_FORMAT, m3u8->sequence);
+    } else {
       GST_DEBUG_OBJECT (demux,
-          "Sequence is beyond playlist. Moving back to %" G_GINT64_FORMAT,
-          m3u8->sequence);
+          "sequence:%" G_GINT64_FORMAT " , first_sequence:%" G_GINT64_FORMAT
+          " , last_sequence:%" G_GINT64_FORMAT, m3u8->sequence,
+          first_sequence, last_sequence);
+      if (m3u8->sequence > last_sequence - 3) {
+        //demux->need_segment = TRUE;
+        /* Make sure we never go below the minimum sequence number */
+        m3u8->sequence = MAX (first_sequence, last_sequence - 3);
+        GST_DEBUG_OBJECT (demux,
+            "Sequence is beyond playlist. Moving back to %" G_GINT64_FORMAT,
+            m3u8->sequence);
+      }
     }
     GST_M3U8_CLIENT_UNLOCK (demux->client);
   } else if (!gst_m3u8_is_live (m3u8)) {
@@ -48,6 +48,7 @@ gst_m3u8_new (void)
   m3u8->sequence_position = 0;
   m3u8->highest_sequence_number = -1;
   m3u8->duration = GST_CLOCK_TIME_NONE;
+  m3u8->files_index = g_ptr_array_new ();
 
   g_mutex_init (&m3u8->lock);
   m3u8->ref_count = 1;
@@ -106,6 +107,7 @@ gst_m3u8_unref (GstM3U8 * self)
 
     g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_unref, NULL);
     g_list_free (self->files);
+    g_ptr_array_free (self->files_index, TRUE);
 
     g_free (self->last_data);
     g_mutex_clear (&self->lock);
@@ -307,6 +309,98 @@ gst_hls_variant_stream_compare_by_bitrate (gconstpointer a, gconstpointer b)
   return vs_a->bandwidth - vs_b->bandwidth;
 }
 
+/* call with M3U8_LOCK held */
+static GList *
+gst_m3u8_find_file (GstM3U8 * self, gint64 sequence)
+{
+  gint64 first;
+
+  /* Sequence numbers are contiguous by construction, so the position of a
+   * fragment in the list is its distance to the first sequence number */
+  if (self->files == NULL)
+    return NULL;
+
+  first = GST_M3U8_MEDIA_FILE (self->files->data)->sequence;
+  if (sequence < first || sequence - first >= self->files_index->len)
+    return NULL;
+
+  return g_ptr_array_index (self->files_index, sequence - first);
+}
+
+/* call with M3U8_LOCK held */
+static GList *
+gst_m3u8_get_last_file (GstM3U8 * self)
+{
+  if (self->files_index->len == 0)
+    return NULL;
+
+  return g_ptr_array_index (self->files_index, self->files_index->len - 1);
+}
+
+/* call with M3U8_LOCK held */
+static void
+gst_m3u8_rebuild_files_index (GstM3U8 * self)
+{
+  GList *l;
+
+  g_ptr_array_set_size (self->files_index, 0);
+  for (l = self->files; l; l = l->next)
+    g_ptr_array_add (self->files_index, l);
+}
+
+/* Compares two absolute URIs after removing "." and ".." path segments
+ * and normalizing case where it does not matter */
+static gboolean
+uri_equal_normalized (const gchar * uri1, const gchar * uri2)
+{
+  GstUri *u1, *u2;
+  gboolean ret;
+
+  if (g_str_equal (uri1, uri2))
+    return TRUE;
+
+  u1 = gst_uri_from_string (uri1);
+  u2 = gst_uri_from_string (uri2);
+  if (u1 == NULL || u2 == NULL) {
+    ret = FALSE;
+  } else {
+    gst_uri_normalize (u1);
+    gst_uri_normalize (u2);
+    ret = gst_uri_equal (u1, u2);
+  }
+
+  if (u1)
+    gst_uri_unref (u1);
+  if (u2)
+    gst_uri_unref (u2);
+
+  return ret;
+}
+
+/* Checks if @uri as written in the playlist refers to the already resolved
+ * @resolved_uri. The exact match covers the common case of a playlist that
+ * is written the same way on every refresh; otherwise @uri is resolved
+ * against @base_uri and compared in normalized form */
+static gboolean
+uri_matches (const gchar * base_uri, const gchar * resolved_uri,
+    const gchar * uri)
+{
+  gchar *joined;
+  gboolean ret;
+
+  if (g_str_equal (resolved_uri, uri))
+    return TRUE;
+
+  joined = uri_join (base_uri, uri);
+  if (joined == NULL)
+    return FALSE;
+
+  ret = uri_equal_normalized (resolved_uri, joined);
+  g_free (joined);
+
+  return ret;
+}
+
 /* If we have MEDIA-SEQUENCE, ensure that it's consistent. If it is not,
  * the client SHOULD halt playback (6.3.4), which is what we do then. */
 static gboolean
@@ -356,7 +450,8 @@ check_media_seqnums (GstM3U8 * self, GList * previous_files)
     f1 = l->data;
     f2 = m->data;
 
-    if (f1->sequence == f2->sequence && !g_str_equal (f1->uri, f2->uri)) {
+    if (f1->sequence == f2->sequence
+        && !uri_equal_normalized (f1->uri, f2->uri)) {
       /* Same sequence, different URI. This is bad! */
       GST_ERROR ("Media URIs inconsistent (sequence %" G_GINT64_FORMAT
           "): had '%s', got '%s'", f1->sequence, f2->uri, f1->uri);
@@ -455,9 +550,13 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   gboolean have_iv = FALSE;
   guint8 iv[16] = { 0, };
   gint64 size = -1, offset = -1;
-  gint64 mediasequence;
-  GList *previous_files = NULL;
+  gint64 mediasequence, first_sequence = -1;
+  GList *previous_files = NULL, *new_files = NULL;
+  GstM3U8MediaFile *prev_file = NULL;
+  GstClockTime old_duration;
+  GList *old_current_file;
   gboolean have_mediasequence = FALSE;
+  gboolean merge = FALSE;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -490,9 +589,9 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   g_free (self->last_data);
   self->last_data = data;
 
+  old_current_file = self->current_file;
   self->current_file = NULL;
-  previous_files = self->files;
-  self->files = NULL;
+  old_duration = self->duration;
   self->duration = GST_CLOCK_TIME_NONE;
   mediasequence = 0;
 
@@ -519,6 +618,58 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         goto next_line;
       }
 
+      if (first_sequence == -1) {
+        /* The fragments we already know can be kept if the sequence numbers
+         * are given and the window didn't move backwards. Otherwise the
+         * list is rebuilt and checked against the previous one below */
+        first_sequence = mediasequence;
+        if (self->files != NULL) {
+          if (have_mediasequence && mediasequence >=
+              GST_M3U8_MEDIA_FILE (self->files->data)->sequence) {
+            merge = TRUE;
+          } else {
+            previous_files = self->files;
+            self->files = NULL;
+            g_ptr_array_set_size (self->files_index, 0);
+          }
+        }
+      }
+
+      if (merge) {
+        GList *link = gst_m3u8_find_file (self, mediasequence);
+
+        if (link != NULL) {
+          GstM3U8MediaFile *file = link->data;
+
+          if (!uri_matches (self->base_uri ? self->base_uri : self->uri,
+                  file->uri, data)) {
+            /* Same sequence, different URI. This is bad! */
+            GST_ERROR ("Media URIs inconsistent (sequence %" G_GINT64_FORMAT
+                "): had '%s', got '%s'", file->sequence, file->uri, data);
+            /* The known fragments were not touched yet, keep the state that
+             * refers to them */
+            self->duration = old_duration;
+            self->current_file = old_current_file;
+            g_free (title);
+            g_free (current_key);
+            g_list_free_full (new_files,
+                (GDestroyNotify) gst_m3u8_media_file_unref);
+            GST_M3U8_UNLOCK (self);
+            return FALSE;
+          }
+
+          mediasequence++;
+          prev_file = file;
+
+          duration = 0;
+          g_free (title);
+          title = NULL;
+          discontinuity = FALSE;
+          size = offset = -1;
+          goto next_line;
+        }
+      }
+
       data = uri_join (self->base_uri ? self->base_uri : self->uri, data);
       if (data != NULL) {
         GstM3U8MediaFile *file;
@@ -540,12 +691,10 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
           if (offset != -1) {
             file->offset = offset;
           } else {
-            GstM3U8MediaFile *prev = self->files ? self->files->data : NULL;
-
-            if (!prev) {
+            if (!prev_file) {
               offset = 0;
             } else {
-              offset = prev->offset + prev->size;
+              offset = prev_file->offset + prev_file->size;
             }
             file->offset = offset;
           }
@@ -560,7 +709,8 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
         title = NULL;
         discontinuity = FALSE;
         size = offset = -1;
-        self->files = g_list_prepend (self->files, file);
+        new_files = g_list_prepend (new_files, file);
+        prev_file = file;
       }
 
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
@@ -688,9 +838,56 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   g_free (current_key);
   current_key = NULL;
 
-  self->files = g_list_reverse (self->files);
+  new_files = g_list_reverse (new_files);
 
-  if (previous_files) {
+  if (merge) {
+    GList *link;
+    guint n_removed = 0;
+
+    /* Drop the fragments that fell out of the window at the start... */
+    while (self->files && GST_M3U8_MEDIA_FILE (self->files->data)->sequence <
+        first_sequence) {
+      if (GST_CLOCK_TIME_IS_VALID (old_duration))
+        old_duration -= GST_M3U8_MEDIA_FILE (self->files->data)->duration;
+      gst_m3u8_media_file_unref (self->files->data);
+      self->files = g_list_delete_link (self->files, self->files);
+      n_removed++;
+    }
+    g_ptr_array_remove_range (self->files_index, 0, n_removed);
+
+    /* ...and the ones that are not listed anymore at the end */
+    while ((link = gst_m3u8_get_last_file (self)) &&
+        GST_M3U8_MEDIA_FILE (link->data)->sequence >= mediasequence) {
+      if (GST_CLOCK_TIME_IS_VALID (old_duration))
+        old_duration -= GST_M3U8_MEDIA_FILE (link->data)->duration;
+      gst_m3u8_media_file_unref (link->data);
+      self->files = g_list_delete_link (self->files, link);
+      g_ptr_array_set_size (self->files_index, self->files_index->len - 1);
+    }
+
+    /* Append the new fragments */
+    if (new_files) {
+      link = gst_m3u8_get_last_file (self);
+      if (link) {
+        link->next = new_files;
+        new_files->prev = link;
+      } else {
+        self->files = new_files;
+      }
+      for (link = new_files; link; link = link->next)
+        g_ptr_array_add (self->files_index, link);
+    }
+  } else {
+    if (first_sequence == -1 && self->files) {
+      /* No fragments at all, drop the previous ones */
+      previous_files = self->files;
+    }
+    self->files = new_files;
+    gst_m3u8_rebuild_files_index (self);
+    old_duration = GST_CLOCK_TIME_NONE;
+  }
+
+  if (previous_files && self->files) {
     gboolean consistent = TRUE;
 
     if (have_mediasequence) {
@@ -699,32 +896,44 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
       generate_media_seqnums (self, previous_files);
     }
 
-    g_list_foreach (previous_files, (GFunc) gst_m3u8_media_file_unref, NULL);
-    g_list_free (previous_files);
-    previous_files = NULL;
-
     /* error was reported above already */
     if (!consistent) {
+      g_list_free_full (previous_files,
+          (GDestroyNotify) gst_m3u8_media_file_unref);
       GST_M3U8_UNLOCK (self);
       return FALSE;
     }
   }
 
+  if (previous_files) {
+    g_list_free_full (previous_files,
+        (GDestroyNotify) gst_m3u8_media_file_unref);
+    previous_files = NULL;
+  }
+
   if (self->files == NULL) {
     GST_ERROR ("Invalid media playlist, it does not contain any media files");
     GST_M3U8_UNLOCK (self);
     return FALSE;
   }
 
-  /* calculate the start and end times of this media playlist. */
+  /* calculate the start and end times of this media playlist. When merging,
+   * only the new fragments need to be looked at */
   {
     GList *walk;
     GstM3U8MediaFile *file;
     GstClockTime duration = 0;
 
+    if (GST_CLOCK_TIME_IS_VALID (old_duration)) {
+      walk = new_files;
+      duration = old_duration;
+    } else {
+      walk = self->files;
+    }
+
     mediasequence = -1;
 
-    for (walk = self->files; walk; walk = walk->next) {
+    for (; walk; walk = walk->next) {
       file = walk->data;
 
       if (mediasequence == -1) {
@@ -770,7 +979,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
       gint i;
       GstClockTime sequence_pos = 0;
 
-      file = g_list_last (self->files);
+      file = gst_m3u8_get_last_file (self);
 
       if (self->last_file_end >= GST_M3U8_MEDIA_FILE (file->data)->duration) {
         sequence_pos =
@@ -796,7 +1005,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
   }
 
   GST_LOG ("processed media playlist %s, %u fragments", self->name,
-      g_list_length (self->files));
+      self->files_index->len);
 
   GST_M3U8_UNLOCK (self);
 
@@ -807,32 +1016,25 @@ gst_m3u8_update (GstM3U8 * self, gchar * data)
 static GList *
 m3u8_find_next_fragment (GstM3U8 * m3u8, gboolean forward)
 {
-  GstM3U8MediaFile *file;
-  GList *l = m3u8->files;
-
-  if (forward) {
-    while (l) {
-      file = l->data;
+  GList *first, *last;
+  gint64 sequence;
 
-      if (file->sequence >= m3u8->sequence)
-        break;
+  first = m3u8->files;
+  last = gst_m3u8_get_last_file (m3u8);
+  if (first == NULL)
+    return NULL;
 
-      l = l->next;
-    }
+  if (forward) {
+    sequence = GST_M3U8_MEDIA_FILE (first->data)->sequence;
+    if (m3u8->sequence <= sequence)
+      return first;
   } else {
-    l = g_list_last (l);
-
-    while (l) {
-      file = l->data;
-
-      if (file->sequence <= m3u8->sequence)
-        break;
-
-      l = l->prev;
-    }
+    sequence = GST_M3U8_MEDIA_FILE (last->data)->sequence;
+    if (m3u8->sequence >= sequence)
+      return last;
   }
 
-  return l;
+  return gst_m3u8_find_file (m3u8, m3u8->sequence);
 }
 
 GstM3U8MediaFile *
@@ -902,13 +1104,36 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   return have_next;
 }
 
+/* Returns the fragment @index places after the current one (forward only)
+ * without advancing, or NULL if the playlist doesn't have it (yet) */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, guint index)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *cur;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  cur = m3u8->current_file;
+  while (cur != NULL && index-- > 0)
+    cur = cur->next;
+
+  if (cur != NULL)
+    file = gst_m3u8_media_file_ref (cur->data);
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 /* call with M3U8_LOCK held */
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
 {
   gint targetnum = m3u8->sequence;
   GList *tmp;
-  GstM3U8MediaFile *mf;
 
   /* figure out the target seqnum */
   if (forward)
@@ -916,11 +1141,7 @@ m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
   else
     targetnum -= 1;
 
-  for (tmp = m3u8->files; tmp; tmp = tmp->next) {
-    mf = (GstM3U8MediaFile *) tmp->data;
-    if (mf->sequence == targetnum)
-      break;
-  }
+  tmp = gst_m3u8_find_file (m3u8, targetnum);
   if (tmp == NULL) {
     GST_WARNING ("Can't find next fragment");
     return;
@@ -954,15 +1175,8 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
         GST_TIME_ARGS (m3u8->sequence_position));
   }
   if (!m3u8->current_file) {
-    GList *l;
-
     GST_DEBUG ("Looking for fragment %" G_GINT64_FORMAT, m3u8->sequence);
-    for (l = m3u8->files; l != NULL; l = l->next) {
-      if (GST_M3U8_MEDIA_FILE (l->data)->sequence == m3u8->sequence) {
-        m3u8->current_file = l;
-        break;
-      }
-    }
+    m3u8->current_file = gst_m3u8_find_file (m3u8, m3u8->sequence);
     if (m3u8->current_file == NULL) {
       GST_DEBUG
           ("Could not find current fragment, trying next fragment directly");
@@ -973,8 +1187,9 @@ gst_m3u8_advance_fragment (GstM3U8 * m3u8, gboolean forward)
         /* for live streams, start GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE from
            the end of the playlist. See section 6.3.3 of HLS draft */
         gint pos =
-            g_list_length (m3u8->files) - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
-        m3u8->current_file = g_list_nth (m3u8->files, pos >= 0 ? pos : 0);
+            m3u8->files_index->len - GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
+        m3u8->current_file =
+            g_ptr_array_index (m3u8->files_index, pos >= 0 ? pos : 0);
         m3u8->current_file_duration =
             GST_M3U8_MEDIA_FILE (m3u8->current_file->data)->duration;
 
@@ -1160,7 +1375,7 @@ gst_m3u8_get_seek_range (GstM3U8 * m3u8, gint64 * start, gint64 * stop)
        playlist - see 6.3.3. "Playing the Playlist file" of the HLS draft */
     min_distance = GST_M3U8_LIVE_MIN_FRAGMENT_DISTANCE;
   }
-  count = g_list_length (m3u8->files);
+  count = m3u8->files_index->len;
 
   for (walk = m3u8->files; walk && count > min_distance; walk = walk->next) {
     file = walk->data;
@@ -1180,6 +1395,28 @@ out:
   return (duration > 0);
 }
 
+gboolean
+gst_m3u8_get_sequence_range (GstM3U8 * m3u8, gint64 * first, gint64 * last)
+{
+  GList *last_file;
+
+  g_return_val_if_fail (m3u8 != NULL, FALSE);
+
+  GST_M3U8_LOCK (m3u8);
+
+  last_file = gst_m3u8_get_last_file (m3u8);
+  if (last_file != NULL) {
+    if (first)
+      *first = GST_M3U8_MEDIA_FILE (m3u8->files->data)->sequence;
+    if (last)
+      *last = GST_M3U8_MEDIA_FILE (last_file->data)->sequence;
+  }
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return last_file != NULL;
+}
+
 GstHLSMedia *
 gst_hls_media_ref (GstHLSMedia * media)
 {
@@ -1797,3 +2034,4 @@ gst_hls_master_playlist_get_matching_variant (GstHLSMasterPlaylist * playlist,
 
   return find_variant_stream_by_uri (playlist->variants, current_variant->uri);
 }
+
@@ -78,6 +78,7 @@ struct _GstM3U8
 
   /*< private > */
   gchar *last_data;
+  GPtrArray *files_index;       /* links of files, indexed by sequence - first sequence */
   GMutex lock;
 
   gint ref_count;               /* ATOMIC */
@@ -123,6 +124,9 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  guint     index);
+
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
@@ -138,6 +142,10 @@ gboolean           gst_m3u8_get_seek_range       (GstM3U8 * m3u8,
                                                   gint64  * start,
                                                   gint64  * stop);
 
+gboolean           gst_m3u8_get_sequence_range   (GstM3U8 * m3u8,
+                                                  gint64  * first,
+                                                  gint64  * last);
+
 typedef enum
 {
   GST_HLS_MEDIA_TYPE_INVALID = -1,
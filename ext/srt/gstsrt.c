@@ -314,6 +314,145 @@ failed:
   return SRT_INVALID_SOCK;
 }
 
+GstStructure *
+gst_srt_get_stats (GSocketAddress * sockaddr, SRTSOCKET sock)
+{
+  SRT_TRACEBSTATS stats;
+  int ret;
+  GValue v = G_VALUE_INIT;
+  GstStructure *s;
+
+  if (sock == SRT_INVALID_SOCK || sockaddr == NULL)
+    return gst_structure_new_empty ("application/x-srt-statistics");
+
+  s = gst_structure_new ("application/x-srt-statistics",
+      "sockaddr", G_TYPE_SOCKET_ADDRESS, sockaddr, NULL);
+
+  ret = srt_bstats (sock, &stats, 0);
+  if (ret >= 0) {
+    gst_structure_set (s,
+        /* number of sent data packets, including retransmissions */
+        "packets-sent", G_TYPE_INT64, stats.pktSent,
+        /* number of lost packets (sender side) */
+        "packets-sent-lost", G_TYPE_INT, stats.pktSndLoss,
+        /* number of retransmitted packets */
+        "packets-retransmitted", G_TYPE_INT, stats.pktRetrans,
+        /* number of received ACK packets */
+        "packet-ack-received", G_TYPE_INT, stats.pktRecvACK,
+        /* number of received NAK packets */
+        "packet-nack-received", G_TYPE_INT, stats.pktRecvNAK,
+        /* number of sent data bytes, including retransmissions */
+        "bytes-sent", G_TYPE_UINT64, stats.byteSent,
+        /* number of retransmitted bytes */
+        "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetrans,
+        /* number of too-late-to-send dropped bytes */
+        "bytes-sent-dropped", G_TYPE_UINT64, stats.byteSndDrop,
+        /* number of too-late-to-send dropped packets */
+        "packets-sent-dropped", G_TYPE_INT, stats.pktSndDrop,
+        /* sending rate in Mb/s */
+        "send-rate-mbps", G_TYPE_DOUBLE, stats.mbpsSendRate,
+        /* busy sending time (i.e., idle time exclusive) */
+        "send-duration-us", G_TYPE_UINT64, (guint64) stats.usSndDuration,
+        /* sender buffer fill, unacknowledged packets included */
+        "send-buffer-packets", G_TYPE_INT, stats.pktSndBuf,
+        "send-buffer-bytes", G_TYPE_INT, stats.byteSndBuf,
+        "send-buffer-ms", G_TYPE_INT, stats.msSndBuf,
+        /* number of received data packets */
+        "packets-received", G_TYPE_INT64, stats.pktRecv,
+        /* number of lost packets (receiver side) */
+        "packets-received-lost", G_TYPE_INT, stats.pktRcvLoss,
+        /* number of received retransmitted packets */
+        "packets-received-retransmitted", G_TYPE_INT, stats.pktRcvRetrans,
+        /* number of too-late-to-play dropped packets */
+        "packets-received-dropped", G_TYPE_INT, stats.pktRcvDrop,
+        /* number of sent ACK and NAK packets */
+        "packet-ack-sent", G_TYPE_INT, stats.pktSentACK,
+        "packet-nack-sent", G_TYPE_INT, stats.pktSentNAK,
+        /* number of received data bytes */
+        "bytes-received", G_TYPE_UINT64, stats.byteRecv,
+        /* number of lost and too-late-to-play dropped bytes */
+        "bytes-received-lost", G_TYPE_UINT64, stats.byteRcvLoss,
+        "bytes-received-dropped", G_TYPE_UINT64, stats.byteRcvDrop,
+        /* receiving rate in Mb/s */
+        "receive-rate-mbps", G_TYPE_DOUBLE, stats.mbpsRecvRate,
+        /* receiver buffer fill, not yet delivered packets */
+        "receive-buffer-packets", G_TYPE_INT, stats.pktRcvBuf,
+        "receive-buffer-bytes", G_TYPE_INT, stats.byteRcvBuf,
+        "receive-buffer-ms", G_TYPE_INT, stats.msRcvBuf,
+        /* packets sent but not acknowledged yet */
+        "packets-in-flight", G_TYPE_INT, stats.pktFlightSize,
+        "congestion-window", G_TYPE_INT, stats.pktCongestionWindow,
+        "flow-window", G_TYPE_INT, stats.pktFlowWindow,
+        /* estimated bandwidth, in Mb/s */
+        "bandwidth-mbps", G_TYPE_DOUBLE, stats.mbpsBandwidth,
+        "rtt-ms", G_TYPE_DOUBLE, stats.msRTT,
+        "negotiated-latency-ms", G_TYPE_INT, stats.msSndTsbPdDelay, NULL);
+  }
+
+  g_value_init (&v, G_TYPE_STRING);
+  g_value_take_string (&v,
+      g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (sockaddr)));
+  gst_structure_take_value (s, "sockaddr-str", &v);
+
+  return s;
+}
+
+/* Calls @func with @elem every @interval milliseconds from the system clock
+ * thread, whether data flows or not. Returns NULL if @interval is 0 */
+GstClockID
+gst_srt_stats_timer_start (GstElement * elem, guint interval,
+    GstClockCallback func)
+{
+  GstClock *clock;
+  GstClockID id;
+  GstClockTime period;
+
+  if (interval == 0)
+    return NULL;
+
+  period = interval * GST_MSECOND;
+  clock = gst_system_clock_obtain ();
+  id = gst_clock_new_periodic_id (clock, gst_clock_get_time (clock) + period,
+      period);
+  gst_object_unref (clock);
+
+  if (gst_clock_id_wait_async (id, func, gst_object_ref (elem),
+          (GDestroyNotify) gst_object_unref) != GST_CLOCK_OK) {
+    GST_WARNING_OBJECT (elem, "Could not schedule the statistics timer");
+    gst_clock_id_unref (id);
+    return NULL;
+  }
+
+  return id;
+}
+
+/* Stops and clears a timer started with gst_srt_stats_timer_start(). The
+ * callback may still be running when this returns */
+void
+gst_srt_stats_timer_stop (GstClockID * id)
+{
+  if (*id == NULL)
+    return;
+
+  gst_clock_id_unschedule (*id);
+  gst_clock_id_unref (*id);
+  *id = NULL;
+}
+
+/* Posts the stats of @sock as an element message named
+ * "application/x-srt-statistics" */
+void
+gst_srt_post_stats (GstElement * elem, GSocketAddress * sockaddr,
+    SRTSOCKET sock)
+{
+  if (sock == SRT_INVALID_SOCK || sockaddr == NULL)
+    return;
+
+  gst_element_post_message (elem,
+      gst_message_new_element (GST_OBJECT_CAST (elem),
+          gst_srt_get_stats (sockaddr, sock)));
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -33,6 +33,9 @@
 #define SRT_DEFAULT_URI SRT_URI_SCHEME"://"SRT_DEFAULT_HOST":"G_STRINGIFY(SRT_DEFAULT_PORT)
 #define SRT_DEFAULT_LATENCY 125
 #define SRT_DEFAULT_KEY_LENGTH 16
+/* largest message of the live mode, 7 MPEG-TS packets */
+#define SRT_DEFAULT_PAYLOAD_SIZE (7 * 188)
+#define SRT_DEFAULT_STATS_INTERVAL 0
 
 G_BEGIN_DECLS
 
@@ -48,6 +51,20 @@ gst_srt_server_listen (GstElement * elem, int sender,
     const gchar * host, guint16 port, gint latency, gint * poll_id,
     const gchar * passphrase, int key_length);
 
+GstStructure *
+gst_srt_get_stats (GSocketAddress * sockaddr, SRTSOCKET sock);
+
+GstClockID
+gst_srt_stats_timer_start (GstElement * elem, guint interval,
+    GstClockCallback func);
+
+void
+gst_srt_stats_timer_stop (GstClockID * id);
+
+void
+gst_srt_post_stats (GstElement * elem, GSocketAddress * sockaddr,
+    SRTSOCKET sock);
+
 G_END_DECLS
 
 
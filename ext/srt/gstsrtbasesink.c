@@ -37,6 +37,7 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_STATS_INTERVAL,
 
   /*< private > */
   PROP_LAST
@@ -49,6 +50,8 @@ static void gst_srt_base_sink_uri_handler_init (gpointer g_iface,
 static gchar *gst_srt_base_sink_uri_get_uri (GstURIHandler * handler);
 static gboolean gst_srt_base_sink_uri_set_uri (GstURIHandler * handler,
     const gchar * uri, GError ** error);
+static void gst_srt_base_sink_update_stats_timer (GstSRTBaseSink * self,
+    gboolean started);
 
 #define gst_srt_base_sink_parent_class parent_class
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GstSRTBaseSink, gst_srt_base_sink,
@@ -80,6 +83,9 @@ gst_srt_base_sink_get_property (GObject * object,
     case PROP_KEY_LENGTH:
       g_value_set_int (value, self->key_length);
       break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -112,6 +118,12 @@ gst_srt_base_sink_set_property (GObject * object,
       self->key_length = key_length;
       break;
     }
+    case PROP_STATS_INTERVAL:
+      g_rec_mutex_lock (&self->stats_lock);
+      self->stats_interval = g_value_get_uint (value);
+      gst_srt_base_sink_update_stats_timer (self, self->stats_started);
+      g_rec_mutex_unlock (&self->stats_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -126,10 +138,92 @@ gst_srt_base_sink_finalize (GObject * object)
   g_clear_pointer (&self->headers, gst_buffer_list_unref);
   g_clear_pointer (&self->uri, gst_uri_unref);
   g_clear_pointer (&self->passphrase, g_free);
+  g_rec_mutex_clear (&self->stats_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static gboolean
+gst_srt_base_sink_stats_timeout (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (user_data);
+  GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (self);
+
+  g_rec_mutex_lock (&self->stats_lock);
+  /* a stopped timer can still fire one last time */
+  if (id == self->stats_id && bclass->post_stats)
+    bclass->post_stats (self);
+  g_rec_mutex_unlock (&self->stats_lock);
+
+  return TRUE;
+}
+
+/* Restarts the statistics timer with the current interval, or only stops
+ * it if @started is FALSE. Once stopped, no callback is running anymore */
+static void
+gst_srt_base_sink_update_stats_timer (GstSRTBaseSink * self,
+    gboolean started)
+{
+  g_rec_mutex_lock (&self->stats_lock);
+  self->stats_started = started;
+  gst_srt_stats_timer_stop (&self->stats_id);
+  if (started)
+    self->stats_id = gst_srt_stats_timer_start (GST_ELEMENT (self),
+        self->stats_interval, gst_srt_base_sink_stats_timeout);
+  g_rec_mutex_unlock (&self->stats_lock);
+}
+
+static GstStateChangeReturn
+gst_srt_base_sink_change_state (GstElement * element, GstStateChange transition)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* before the subclass closes its sockets */
+      gst_srt_base_sink_update_stats_timer (self, FALSE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_srt_base_sink_update_stats_timer (self, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/* Splits @buffer into live mode sized packets that share its memory. The
+ * last packet may be smaller, nothing is held back waiting for more data */
+static void
+gst_srt_base_sink_packetize (GstBuffer * buffer, GstBufferList * packets)
+{
+  gsize size = gst_buffer_get_size (buffer);
+  gsize offset;
+
+  if (size <= SRT_DEFAULT_PAYLOAD_SIZE) {
+    gst_buffer_list_add (packets, gst_buffer_ref (buffer));
+    return;
+  }
+
+  for (offset = 0; offset < size; offset += SRT_DEFAULT_PAYLOAD_SIZE) {
+    gst_buffer_list_add (packets, gst_buffer_copy_region (buffer,
+            GST_BUFFER_COPY_MEMORY, offset,
+            MIN (size - offset, SRT_DEFAULT_PAYLOAD_SIZE)));
+  }
+}
+
 static gboolean
 gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
 {
@@ -148,8 +242,9 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
     GST_DEBUG_OBJECT (self, "'streamheader' field not present");
   } else if (GST_VALUE_HOLDS_BUFFER (streamheader)) {
     GST_DEBUG_OBJECT (self, "'streamheader' field holds buffer");
-    self->headers = gst_buffer_list_new_sized (1);
-    gst_buffer_list_add (self->headers, g_value_dup_boxed (streamheader));
+    self->headers = gst_buffer_list_new ();
+    gst_srt_base_sink_packetize (gst_value_get_buffer (streamheader),
+        self->headers);
   } else if (GST_VALUE_HOLDS_ARRAY (streamheader)) {
     guint i, size;
 
@@ -166,7 +261,7 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
         return FALSE;
       }
 
-      gst_buffer_list_add (self->headers, g_value_dup_boxed (v));
+      gst_srt_base_sink_packetize (gst_value_get_buffer (v), self->headers);
     }
   } else {
     GST_ERROR_OBJECT (self, "'streamheader' field has unexpected type '%s'",
@@ -174,7 +269,7 @@ gst_srt_base_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
     return FALSE;
   }
 
-  GST_DEBUG_OBJECT (self, "Collected streamheaders: %u buffers",
+  GST_DEBUG_OBJECT (self, "Collected streamheaders: %u packets",
       self->headers ? gst_buffer_list_length (self->headers) : 0);
 
   return TRUE;
@@ -191,19 +286,41 @@ gst_srt_base_sink_stop (GstBaseSink * sink)
 }
 
 static GstFlowReturn
-gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+gst_srt_base_sink_send_packets (GstSRTBaseSink * self, GstBufferList * packets)
 {
-  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
-  GstMapInfo info;
-  GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (sink);
-  GstFlowReturn ret = GST_FLOW_OK;
+  GstSRTBaseSinkClass *bclass = GST_SRT_BASE_SINK_GET_CLASS (self);
+
+  if (gst_buffer_list_length (packets) == 0)
+    return GST_FLOW_OK;
+
+  if (!bclass->send_packets (self, packets))
+    return GST_FLOW_ERROR;
+
+  return GST_FLOW_OK;
+}
 
+static gboolean
+gst_srt_base_sink_skip_header (GstSRTBaseSink * self, GstBuffer * buffer)
+{
   if (self->headers && GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER)) {
     GST_DEBUG_OBJECT (self, "Have streamheaders,"
         " ignoring header %" GST_PTR_FORMAT, buffer);
-    return GST_FLOW_OK;
+    return TRUE;
   }
 
+  return FALSE;
+}
+
+static GstFlowReturn
+gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
+  GstBufferList *packets;
+  GstFlowReturn ret;
+
+  if (gst_srt_base_sink_skip_header (self, buffer))
+    return GST_FLOW_OK;
+
   GST_TRACE_OBJECT (self, "sending buffer %p, offset %"
       G_GINT64_FORMAT ", offset_end %" G_GINT64_FORMAT
       ", timestamp %" GST_TIME_FORMAT ", duration %" GST_TIME_FORMAT
@@ -214,16 +331,38 @@ gst_srt_base_sink_render (GstBaseSink * sink, GstBuffer * buffer)
       GST_TIME_ARGS (GST_BUFFER_DURATION (buffer)),
       gst_buffer_get_size (buffer));
 
-  if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
-    GST_ELEMENT_ERROR (self, RESOURCE, READ,
-        ("Could not map the input stream"), (NULL));
-    return GST_FLOW_ERROR;
-  }
+  packets = gst_buffer_list_new ();
+  gst_srt_base_sink_packetize (buffer, packets);
+  ret = gst_srt_base_sink_send_packets (self, packets);
+  gst_buffer_list_unref (packets);
+
+  return ret;
+}
 
-  if (!bclass->send_buffer (self, &info))
-    ret = GST_FLOW_ERROR;
+static GstFlowReturn
+gst_srt_base_sink_render_list (GstBaseSink * sink, GstBufferList * list)
+{
+  GstSRTBaseSink *self = GST_SRT_BASE_SINK (sink);
+  GstBufferList *packets;
+  GstFlowReturn ret;
+  guint i, len;
 
-  gst_buffer_unmap (buffer, &info);
+  len = gst_buffer_list_length (list);
+
+  GST_TRACE_OBJECT (self, "sending buffer list of %u buffers", len);
+
+  /* Packetize the whole list up front so that subclasses can hand it to
+   * all their sockets in one go */
+  packets = gst_buffer_list_new_sized (len);
+  for (i = 0; i < len; i++) {
+    GstBuffer *buffer = gst_buffer_list_get (list, i);
+
+    if (!gst_srt_base_sink_skip_header (self, buffer))
+      gst_srt_base_sink_packetize (buffer, packets);
+  }
+
+  ret = gst_srt_base_sink_send_packets (self, packets);
+  gst_buffer_list_unref (packets);
 
   return ret;
 }
@@ -232,6 +371,7 @@ static void
 gst_srt_base_sink_class_init (GstSRTBaseSinkClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
 
   gobject_class->set_property = gst_srt_base_sink_set_property;
@@ -262,11 +402,35 @@ gst_srt_base_sink_class_init (GstSRTBaseSinkClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTBaseSink:stats-interval:
+   *
+   * Interval in milliseconds at which the sending statistics are posted as
+   * "application/x-srt-statistics" element messages, with the fields of
+   * the #GstSRTClientSink:stats property. srtserversink posts one message
+   * per connected client.
+   *
+   * The messages are posted from a timer while the element is at least
+   * PAUSED, so they keep coming when no data is sent. 0 disables them.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_STATS_INTERVAL] =
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+      "Interval in milliseconds between statistics messages (0 = disabled)",
+      0, G_MAXUINT, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_srt_base_sink_change_state);
+
   gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR (gst_srt_base_sink_set_caps);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_srt_base_sink_stop);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_srt_base_sink_render);
+  gstbasesink_class->render_list =
+      GST_DEBUG_FUNCPTR (gst_srt_base_sink_render_list);
 }
 
 static void
@@ -276,6 +440,8 @@ gst_srt_base_sink_init (GstSRTBaseSink * self)
   self->latency = SRT_DEFAULT_LATENCY;
   self->passphrase = NULL;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  g_rec_mutex_init (&self->stats_lock);
 }
 
 static GstURIType
@@ -345,97 +511,41 @@ gst_srt_base_sink_uri_handler_init (gpointer g_iface, gpointer iface_data)
   iface->set_uri = gst_srt_base_sink_uri_set_uri;
 }
 
+/**
+ * gst_srt_base_sink_send_packet:
+ * @sink: a #GstSRTBaseSink
+ * @sock: the socket to send on
+ * @packet: a packet of at most %SRT_DEFAULT_PAYLOAD_SIZE bytes
+ * @would_block: (out) (allow-none): set to %TRUE if @sock is non-blocking
+ *     and has no room left in its send buffer
+ *
+ * Returns: %TRUE if @packet was handed to SRT
+ */
 gboolean
-gst_srt_base_sink_send_headers (GstSRTBaseSink * self,
-    GstSRTBaseSinkSendCallback send_cb, gpointer user_data)
+gst_srt_base_sink_send_packet (GstSRTBaseSink * self, SRTSOCKET sock,
+    GstBuffer * packet, gboolean * would_block)
 {
-  guint size, i;
-
-  g_return_val_if_fail (GST_IS_SRT_BASE_SINK (self), FALSE);
-  g_return_val_if_fail (send_cb, FALSE);
-
-  if (!self->headers)
-    return TRUE;
-
-  size = gst_buffer_list_length (self->headers);
-
-  GST_DEBUG_OBJECT (self, "Sending %u stream headers", size);
-
-  for (i = 0; i < size; i++) {
-    GstBuffer *buffer = gst_buffer_list_get (self->headers, i);
-    GstMapInfo info;
-    gboolean ret;
-
-    GST_TRACE_OBJECT (self, "sending header %u %" GST_PTR_FORMAT, i, buffer);
-
-    if (!gst_buffer_map (buffer, &info, GST_MAP_READ)) {
-      GST_ELEMENT_ERROR (self, RESOURCE, READ,
-          ("Could not map the input stream"), (NULL));
-      return FALSE;
-    }
-
-    ret = send_cb (self, &info, user_data);
+  GstMapInfo info;
+  gint ret;
 
-    gst_buffer_unmap (buffer, &info);
+  if (would_block)
+    *would_block = FALSE;
 
-    if (!ret)
-      return FALSE;
+  if (!gst_buffer_map (packet, &info, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR (self, RESOURCE, READ,
+        ("Could not map the input stream"), (NULL));
+    return FALSE;
   }
 
-  return TRUE;
-}
+  ret = srt_sendmsg2 (sock, (char *) info.data, info.size, 0);
 
-GstStructure *
-gst_srt_base_sink_get_stats (GSocketAddress * sockaddr, SRTSOCKET sock)
-{
-  SRT_TRACEBSTATS stats;
-  int ret;
-  GValue v = G_VALUE_INIT;
-  GstStructure *s;
+  gst_buffer_unmap (packet, &info);
 
-  if (sock == SRT_INVALID_SOCK || sockaddr == NULL)
-    return gst_structure_new_empty ("application/x-srt-statistics");
-
-  s = gst_structure_new ("application/x-srt-statistics",
-      "sockaddr", G_TYPE_SOCKET_ADDRESS, sockaddr, NULL);
-
-  ret = srt_bstats (sock, &stats, 0);
-  if (ret >= 0) {
-    gst_structure_set (s,
-        /* number of sent data packets, including retransmissions */
-        "packets-sent", G_TYPE_INT64, stats.pktSent,
-        /* number of lost packets (sender side) */
-        "packets-sent-lost", G_TYPE_INT, stats.pktSndLoss,
-        /* number of retransmitted packets */
-        "packets-retransmitted", G_TYPE_INT, stats.pktRetrans,
-        /* number of received ACK packets */
-        "packet-ack-received", G_TYPE_INT, stats.pktRecvACK,
-        /* number of received NAK packets */
-        "packet-nack-received", G_TYPE_INT, stats.pktRecvNAK,
-        /* time duration when UDT is sending data (idle time exclusive) */
-        "send-duration-us", G_TYPE_INT64, stats.usSndDuration,
-        /* number of sent data bytes, including retransmissions */
-        "bytes-sent", G_TYPE_UINT64, stats.byteSent,
-        /* number of retransmitted bytes */
-        "bytes-retransmitted", G_TYPE_UINT64, stats.byteRetrans,
-        /* number of too-late-to-send dropped bytes */
-        "bytes-sent-dropped", G_TYPE_UINT64, stats.byteSndDrop,
-        /* number of too-late-to-send dropped packets */
-        "packets-sent-dropped", G_TYPE_INT, stats.pktSndDrop,
-        /* sending rate in Mb/s */
-        "send-rate-mbps", G_TYPE_DOUBLE, stats.msRTT,
-        /* estimated bandwidth, in Mb/s */
-        "bandwidth-mbps", G_TYPE_DOUBLE, stats.mbpsBandwidth,
-        /* busy sending time (i.e., idle time exclusive) */
-        "send-duration-us", G_TYPE_UINT64, stats.usSndDuration,
-        "rtt-ms", G_TYPE_DOUBLE, stats.msRTT,
-        "negotiated-latency-ms", G_TYPE_INT, stats.msSndTsbPdDelay, NULL);
+  if (ret == SRT_ERROR) {
+    if (would_block && srt_getlasterror (NULL) == SRT_EASYNCSND)
+      *would_block = TRUE;
+    return FALSE;
   }
 
-  g_value_init (&v, G_TYPE_STRING);
-  g_value_take_string (&v,
-      g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (sockaddr)));
-  gst_structure_take_value (s, "sockaddr-str", &v);
-
-  return s;
+  return TRUE;
 }
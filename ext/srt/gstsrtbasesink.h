@@ -45,10 +45,16 @@ struct _GstSRTBaseSink {
   GstBaseSink parent;
 
   GstUri *uri;
+  /* streamheaders, already split into packets */
   GstBufferList *headers;
   gint latency;
   gchar *passphrase;
   gint key_length;
+  guint stats_interval;
+  /* statistics timer, the lock is held while posting */
+  GRecMutex stats_lock;
+  GstClockID stats_id;
+  gboolean stats_started;
 
   /*< private >*/
   gpointer _gst_reserved[GST_PADDING];
@@ -57,8 +63,13 @@ struct _GstSRTBaseSink {
 struct _GstSRTBaseSinkClass {
   GstBaseSinkClass parent_class;
 
-  /* ask the subclass to send a buffer */
-  gboolean (*send_buffer)       (GstSRTBaseSink *self, const GstMapInfo *mapinfo);
+  /* ask the subclass to send a list of packets, each of them at most
+   * SRT_DEFAULT_PAYLOAD_SIZE bytes */
+  gboolean (*send_packets)      (GstSRTBaseSink *self, GstBufferList *packets);
+
+  /* post the statistics of every connected peer, called from the
+   * statistics timer between start and stop */
+  void     (*post_stats)        (GstSRTBaseSink *self);
 
   gpointer _gst_reserved[GST_PADDING_LARGE];
 };
@@ -66,14 +77,8 @@ struct _GstSRTBaseSinkClass {
 GST_EXPORT
 GType gst_srt_base_sink_get_type (void);
 
-typedef gboolean (*GstSRTBaseSinkSendCallback) (GstSRTBaseSink *sink,
-    const GstMapInfo *mapinfo, gpointer user_data);
-
-gboolean gst_srt_base_sink_send_headers (GstSRTBaseSink *sink,
-    GstSRTBaseSinkSendCallback send_cb, gpointer user_data);
-
-GstStructure * gst_srt_base_sink_get_stats (GSocketAddress *sockaddr,
-    SRTSOCKET sock);
+gboolean gst_srt_base_sink_send_packet (GstSRTBaseSink *sink,
+    SRTSOCKET sock, GstBuffer *packet, gboolean *would_block);
 
 
 G_END_DECLS
@@ -37,6 +37,7 @@ enum
   PROP_LATENCY,
   PROP_PASSPHRASE,
   PROP_KEY_LENGTH,
+  PROP_STATS_INTERVAL,
 
   /*< private > */
   PROP_LAST
@@ -49,6 +50,8 @@ static void gst_srt_base_src_uri_handler_init (gpointer g_iface,
 static gchar *gst_srt_base_src_uri_get_uri (GstURIHandler * handler);
 static gboolean gst_srt_base_src_uri_set_uri (GstURIHandler * handler,
     const gchar * uri, GError ** error);
+static void gst_srt_base_src_update_stats_timer (GstSRTBaseSrc * self,
+    gboolean started);
 
 #define gst_srt_base_src_parent_class parent_class
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GstSRTBaseSrc, gst_srt_base_src,
@@ -84,6 +87,9 @@ gst_srt_base_src_get_property (GObject * object,
     case PROP_KEY_LENGTH:
       g_value_set_int (value, self->key_length);
       break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -122,6 +128,12 @@ gst_srt_base_src_set_property (GObject * object,
       self->key_length = key_length;
       break;
     }
+    case PROP_STATS_INTERVAL:
+      g_rec_mutex_lock (&self->stats_lock);
+      self->stats_interval = g_value_get_uint (value);
+      gst_srt_base_src_update_stats_timer (self, self->stats_started);
+      g_rec_mutex_unlock (&self->stats_lock);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -136,10 +148,71 @@ gst_srt_base_src_finalize (GObject * object)
   g_clear_pointer (&self->uri, gst_uri_unref);
   g_clear_pointer (&self->caps, gst_caps_unref);
   g_clear_pointer (&self->passphrase, g_free);
+  g_rec_mutex_clear (&self->stats_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static gboolean
+gst_srt_base_src_stats_timeout (GstClock * clock, GstClockTime time,
+    GstClockID id, gpointer user_data)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (user_data);
+  GstSRTBaseSrcClass *bclass = GST_SRT_BASE_SRC_GET_CLASS (self);
+
+  g_rec_mutex_lock (&self->stats_lock);
+  /* a stopped timer can still fire one last time */
+  if (id == self->stats_id && bclass->post_stats)
+    bclass->post_stats (self);
+  g_rec_mutex_unlock (&self->stats_lock);
+
+  return TRUE;
+}
+
+/* Restarts the statistics timer with the current interval, or only stops
+ * it if @started is FALSE. Once stopped, no callback is running anymore */
+static void
+gst_srt_base_src_update_stats_timer (GstSRTBaseSrc * self, gboolean started)
+{
+  g_rec_mutex_lock (&self->stats_lock);
+  self->stats_started = started;
+  gst_srt_stats_timer_stop (&self->stats_id);
+  if (started)
+    self->stats_id = gst_srt_stats_timer_start (GST_ELEMENT (self),
+        self->stats_interval, gst_srt_base_src_stats_timeout);
+  g_rec_mutex_unlock (&self->stats_lock);
+}
+
+static GstStateChangeReturn
+gst_srt_base_src_change_state (GstElement * element, GstStateChange transition)
+{
+  GstSRTBaseSrc *self = GST_SRT_BASE_SRC (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* before the subclass closes its sockets */
+      gst_srt_base_src_update_stats_timer (self, FALSE);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+  if (ret == GST_STATE_CHANGE_FAILURE)
+    return ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_srt_base_src_update_stats_timer (self, TRUE);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
 static GstCaps *
 gst_srt_base_src_get_caps (GstBaseSrc * src, GstCaps * filter)
 {
@@ -171,6 +244,7 @@ static void
 gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_base_src_set_property;
@@ -210,8 +284,32 @@ gst_srt_base_src_class_init (GstSRTBaseSrcClass * klass)
       "Crypto key length in bytes{16,24,32}", 16,
       32, SRT_DEFAULT_KEY_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTBaseSrc:stats-interval:
+   *
+   * Interval in milliseconds at which the receiving statistics are posted
+   * as "application/x-srt-statistics" element messages, with the fields of
+   * the #GstSRTClientSrc:stats property. The packets-received-lost,
+   * receive-rate-mbps and receive-buffer-ms fields tell how the link is
+   * doing. srtserversrc only posts them while a client is connected.
+   *
+   * The messages are posted from a timer while the element is at least
+   * PAUSED, so a stalled connection that delivers no data is still
+   * reported. 0 disables them.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_STATS_INTERVAL] =
+      g_param_spec_uint ("stats-interval", "Statistics interval",
+      "Interval in milliseconds between statistics messages (0 = disabled)",
+      0, G_MAXUINT, SRT_DEFAULT_STATS_INTERVAL,
+      G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_srt_base_src_change_state);
+
   gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR (gst_srt_base_src_get_caps);
 }
 
@@ -225,6 +323,8 @@ gst_srt_base_src_init (GstSRTBaseSrc * self)
 
   self->latency = SRT_DEFAULT_LATENCY;
   self->key_length = SRT_DEFAULT_KEY_LENGTH;
+  self->stats_interval = SRT_DEFAULT_STATS_INTERVAL;
+  g_rec_mutex_init (&self->stats_lock);
 }
 
 static GstURIType
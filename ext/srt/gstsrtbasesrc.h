@@ -46,6 +46,11 @@ struct _GstSRTBaseSrc {
   gint latency;
   gchar *passphrase;
   gint key_length;
+  guint stats_interval;
+  /* statistics timer, the lock is held while posting */
+  GRecMutex stats_lock;
+  GstClockID stats_id;
+  gboolean stats_started;
 
 
   /*< private >*/
@@ -55,6 +60,10 @@ struct _GstSRTBaseSrc {
 struct _GstSRTBaseSrcClass {
   GstPushSrcClass parent_class;
 
+  /* post the statistics of the connected peer, called from the
+   * statistics timer between start and stop */
+  void     (*post_stats)        (GstSRTBaseSrc *self);
+
   gpointer _gst_reserved[GST_PADDING_LARGE];
 };
 
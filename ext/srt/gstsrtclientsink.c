@@ -115,7 +115,7 @@ gst_srt_client_sink_get_property (GObject * object,
       g_value_set_boolean (value, priv->rendez_vous);
       break;
     case PROP_STATS:
-      g_value_take_boxed (value, gst_srt_base_sink_get_stats (priv->sockaddr,
+      g_value_take_boxed (value, gst_srt_get_stats (priv->sockaddr,
               priv->sock));
       break;
     default:
@@ -181,37 +181,52 @@ gst_srt_client_sink_start (GstBaseSink * sink)
 }
 
 static gboolean
-send_buffer_internal (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo, gpointer user_data)
+send_packets_internal (GstSRTBaseSink * sink, SRTSOCKET sock,
+    GstBufferList * packets)
 {
-  SRTSOCKET sock = GPOINTER_TO_INT (user_data);
-
-  if (srt_sendmsg2 (sock, (char *) mapinfo->data, mapinfo->size,
-          0) == SRT_ERROR) {
-    GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, NULL,
-        ("%s", srt_getlasterror_str ()));
-    return FALSE;
+  guint i, len = gst_buffer_list_length (packets);
+
+  /* The socket is blocking, every packet goes out or it's an error */
+  for (i = 0; i < len; i++) {
+    if (!gst_srt_base_sink_send_packet (sink, sock,
+            gst_buffer_list_get (packets, i), NULL)) {
+      GST_ELEMENT_ERROR (sink, RESOURCE, WRITE, NULL,
+          ("%s", srt_getlasterror_str ()));
+      return FALSE;
+    }
   }
 
   return TRUE;
 }
 
 static gboolean
-gst_srt_client_sink_send_buffer (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo)
+gst_srt_client_sink_send_packets (GstSRTBaseSink * sink,
+    GstBufferList * packets)
 {
   GstSRTClientSink *self = GST_SRT_CLIENT_SINK (sink);
   GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
 
   if (!priv->sent_headers) {
-    if (!gst_srt_base_sink_send_headers (sink, send_buffer_internal,
-            GINT_TO_POINTER (priv->sock)))
+    if (sink->headers && !send_packets_internal (sink, priv->sock,
+            sink->headers))
       return FALSE;
 
     priv->sent_headers = TRUE;
   }
 
-  return send_buffer_internal (sink, mapinfo, GINT_TO_POINTER (priv->sock));
+  if (!send_packets_internal (sink, priv->sock, packets))
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+gst_srt_client_sink_post_stats (GstSRTBaseSink * sink)
+{
+  GstSRTClientSink *self = GST_SRT_CLIENT_SINK (sink);
+  GstSRTClientSinkPrivate *priv = GST_SRT_CLIENT_SINK_GET_PRIVATE (self);
+
+  gst_srt_post_stats (GST_ELEMENT (sink), priv->sockaddr, priv->sock);
 }
 
 static gboolean
@@ -289,8 +304,10 @@ gst_srt_client_sink_class_init (GstSRTClientSinkClass * klass)
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_srt_client_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_srt_client_sink_stop);
 
-  gstsrtbasesink_class->send_buffer =
-      GST_DEBUG_FUNCPTR (gst_srt_client_sink_send_buffer);
+  gstsrtbasesink_class->send_packets =
+      GST_DEBUG_FUNCPTR (gst_srt_client_sink_send_packets);
+  gstsrtbasesink_class->post_stats =
+      GST_DEBUG_FUNCPTR (gst_srt_client_sink_post_stats);
 }
 
 static void
@@ -60,6 +60,7 @@ GST_DEBUG_CATEGORY (GST_CAT_DEFAULT);
 struct _GstSRTClientSrcPrivate
 {
   SRTSOCKET sock;
+  GSocketAddress *sockaddr;
   gint poll_id;
   gint poll_timeout;
 
@@ -78,6 +79,7 @@ enum
   PROP_BIND_ADDRESS,
   PROP_BIND_PORT,
   PROP_RENDEZ_VOUS,
+  PROP_STATS,
 
   /*< private > */
   PROP_LAST
@@ -111,6 +113,10 @@ gst_srt_client_src_get_property (GObject * object,
     case PROP_RENDEZ_VOUS:
       g_value_set_boolean (value, priv->rendez_vous);
       break;
+    case PROP_STATS:
+      g_value_take_boxed (value, gst_srt_get_stats (priv->sockaddr,
+              priv->sock));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -160,6 +166,7 @@ gst_srt_client_src_finalize (GObject * object)
     priv->sock = SRT_INVALID_SOCK;
   }
 
+  g_clear_object (&priv->sockaddr);
   g_free (priv->bind_address);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -219,6 +226,15 @@ out:
   return ret;
 }
 
+static void
+gst_srt_client_src_post_stats (GstSRTBaseSrc * src)
+{
+  GstSRTClientSrc *self = GST_SRT_CLIENT_SRC (src);
+  GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
+
+  gst_srt_post_stats (GST_ELEMENT (src), priv->sockaddr, priv->sock);
+}
+
 static gboolean
 gst_srt_client_src_start (GstBaseSrc * src)
 {
@@ -226,14 +242,13 @@ gst_srt_client_src_start (GstBaseSrc * src)
   GstSRTClientSrcPrivate *priv = GST_SRT_CLIENT_SRC_GET_PRIVATE (self);
   GstSRTBaseSrc *base = GST_SRT_BASE_SRC (src);
   GstUri *uri = gst_uri_ref (base->uri);
-  GSocketAddress *socket_address = NULL;
 
+  g_clear_object (&priv->sockaddr);
   priv->sock = gst_srt_client_connect (GST_ELEMENT (src), FALSE,
       gst_uri_get_host (uri), gst_uri_get_port (uri), priv->rendez_vous,
       priv->bind_address, priv->bind_port, base->latency,
-      &socket_address, &priv->poll_id, base->passphrase, base->key_length);
+      &priv->sockaddr, &priv->poll_id, base->passphrase, base->key_length);
 
-  g_clear_object (&socket_address);
   g_clear_pointer (&uri, gst_uri_unref);
 
   return (priv->sock != SRT_INVALID_SOCK);
@@ -256,6 +271,7 @@ gst_srt_client_src_stop (GstBaseSrc * src)
   if (priv->sock != SRT_INVALID_SOCK)
     srt_close (priv->sock);
   priv->sock = SRT_INVALID_SOCK;
+  g_clear_object (&priv->sockaddr);
 
   return TRUE;
 }
@@ -267,6 +283,7 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_client_src_set_property;
   gobject_class->get_property = gst_srt_client_src_get_property;
@@ -299,6 +316,17 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
       "Work in Rendez-Vous mode instead of client/caller mode", FALSE,
       G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GstSRTClientSrc:stats:
+   *
+   * Statistics of the SRT connection.
+   *
+   * Since: 1.16
+   */
+  properties[PROP_STATS] = g_param_spec_boxed ("stats", "Statistics",
+      "SRT Statistics", GST_TYPE_STRUCTURE,
+      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (gobject_class, PROP_LAST, properties);
 
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
@@ -311,6 +339,9 @@ gst_srt_client_src_class_init (GstSRTClientSrcClass * klass)
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_srt_client_src_stop);
 
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_client_src_fill);
+
+  gstsrtbasesrc_class->post_stats =
+      GST_DEBUG_FUNCPTR (gst_srt_client_src_post_stats);
 }
 
 static void
@@ -26,6 +26,10 @@
  * packets to the network. Although SRT is an UDP-based protocol, srtserversink works like
  * a server socket of connection-oriented protocol.
  *
+ * Data a client can't take right away is queued for it and sent as soon as
+ * its socket is writable again. EOS is only posted once every client got
+ * its queued data.
+ *
  * <refsect2>
  * <title>Examples</title>
  * |[
@@ -46,6 +50,11 @@
 
 #define SRT_DEFAULT_POLL_TIMEOUT -1
 
+/* Clients that can't keep up are dropped once that much is queued */
+#define SRT_MAX_CLIENT_QUEUE_BYTES (4 * 1024 * 1024)
+/* Number of sockets handled per wakeup of the poll thread */
+#define SRT_MAX_POLL_SOCKETS 64
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -67,7 +76,10 @@ struct _GstSRTServerSinkPrivate
   GSource *server_source;
   GThread *thread;
 
+  /* protected by the object lock */
   GList *clients;
+  /* signalled when a client queue was drained or a client removed */
+  GCond drain_cond;
 };
 
 #define GST_SRT_SERVER_SINK_GET_PRIVATE(obj)  \
@@ -104,6 +116,12 @@ typedef struct
   int sock;
   GSocketAddress *sockaddr;
   gboolean sent_headers;
+
+  /* packets the socket had no room for yet */
+  GQueue queue;
+  gsize queued_bytes;
+  /* the socket is in the poll set, waiting to be writable */
+  gboolean waiting_out;
 } SRTClient;
 
 static SRTClient *
@@ -111,6 +129,7 @@ srt_client_new (void)
 {
   SRTClient *client = g_new0 (SRTClient, 1);
   client->sock = SRT_INVALID_SOCK;
+  g_queue_init (&client->queue);
   return client;
 }
 
@@ -121,6 +140,9 @@ srt_client_free (SRTClient * client)
 
   g_clear_object (&client->sockaddr);
 
+  g_queue_foreach (&client->queue, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&client->queue);
+
   if (client->sock != SRT_INVALID_SOCK) {
     srt_close (client->sock);
   }
@@ -159,7 +181,7 @@ gst_srt_server_sink_get_property (GObject * object,
         GValue tmp = G_VALUE_INIT;
 
         g_value_init (&tmp, GST_TYPE_STRUCTURE);
-        g_value_take_boxed (&tmp, gst_srt_base_sink_get_stats (client->sockaddr,
+        g_value_take_boxed (&tmp, gst_srt_get_stats (client->sockaddr,
                 client->sock));
         gst_value_array_append_and_take_value (value, &tmp);
       }
@@ -189,6 +211,106 @@ gst_srt_server_sink_set_property (GObject * object,
   }
 }
 
+/* Sends as much of the queue of @client as its socket takes and makes the
+ * poll thread wait for the socket to be writable if anything is left.
+ * Must be called with the object lock */
+static gboolean
+srt_client_flush (GstSRTServerSink * self, SRTClient * client)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GstBuffer *packet;
+  gboolean waiting;
+
+  while ((packet = g_queue_peek_head (&client->queue)) != NULL) {
+    gboolean would_block;
+
+    if (!gst_srt_base_sink_send_packet (GST_SRT_BASE_SINK (self),
+            client->sock, packet, &would_block)) {
+      if (would_block)
+        break;
+
+      GST_WARNING_OBJECT (self, "%s", srt_getlasterror_str ());
+      return FALSE;
+    }
+
+    g_queue_pop_head (&client->queue);
+    client->queued_bytes -= gst_buffer_get_size (packet);
+    gst_buffer_unref (packet);
+  }
+
+  waiting = !g_queue_is_empty (&client->queue);
+  if (waiting != client->waiting_out) {
+    if (waiting)
+      srt_epoll_add_usock (priv->poll_id, client->sock, &(int) {
+          SRT_EPOLL_OUT | SRT_EPOLL_ERR});
+    else
+      srt_epoll_remove_usock (priv->poll_id, client->sock);
+    client->waiting_out = waiting;
+  }
+
+  if (!waiting)
+    g_cond_broadcast (&priv->drain_cond);
+
+  return TRUE;
+}
+
+/* Must be called with the object lock */
+static gboolean
+srt_clients_drained (GstSRTServerSinkPrivate * priv)
+{
+  GList *item;
+
+  for (item = priv->clients; item; item = item->next) {
+    SRTClient *client = item->data;
+
+    if (!g_queue_is_empty (&client->queue))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Must be called without the object lock, srt_close() also takes the
+ * sockets out of the poll set */
+static void
+srt_free_removed_clients (GstSRTServerSink * self, GList * removed)
+{
+  g_list_foreach (removed, (GFunc) srt_emit_client_removed, self);
+  g_list_free_full (removed, (GDestroyNotify) srt_client_free);
+}
+
+static void
+srt_flush_writable_clients (GstSRTServerSink * self, SRTSOCKET * ready,
+    gint n_ready)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GList *removed = NULL;
+  gint i;
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; i < n_ready; i++) {
+    GList *item;
+
+    /* the client might have been removed in the meantime */
+    for (item = priv->clients; item; item = item->next) {
+      SRTClient *client = item->data;
+
+      if (client->sock != ready[i])
+        continue;
+
+      if (!srt_client_flush (self, client)) {
+        priv->clients = g_list_delete_link (priv->clients, item);
+        removed = g_list_prepend (removed, client);
+        g_cond_broadcast (&priv->drain_cond);
+      }
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  srt_free_removed_clients (self, removed);
+}
+
 static gboolean
 idle_listen_callback (gpointer data)
 {
@@ -197,12 +319,17 @@ idle_listen_callback (gpointer data)
   gboolean ret = TRUE;
 
   SRTClient *client;
-  SRTSOCKET ready[2];
+  SRTSOCKET rready[SRT_MAX_POLL_SOCKETS], wready[SRT_MAX_POLL_SOCKETS];
+  int rnum = SRT_MAX_POLL_SOCKETS, wnum = SRT_MAX_POLL_SOCKETS;
+  gboolean accept = FALSE;
   struct sockaddr sa;
   int sa_len;
+  gint i;
 
-  if (srt_epoll_wait (priv->poll_id, ready, &(int) {
-          2}, 0, 0, priv->poll_timeout, 0, 0, 0, 0) == -1) {
+  /* The listening socket wakes us up for new clients, the sockets of the
+   * clients with queued packets once they are writable again */
+  if (srt_epoll_wait (priv->poll_id, rready, &rnum, wready, &wnum,
+          priv->poll_timeout, 0, 0, 0, 0) == -1) {
     int srt_errno = srt_getlasterror (NULL);
 
     if (srt_errno != SRT_ETIMEOUT) {
@@ -218,9 +345,24 @@ idle_listen_callback (gpointer data)
       ret = FALSE;
       goto out;
     }
+
+    srt_clearlasterror ();
+    goto out;
   }
 
+  /* the counts are those of all ready sockets, the rest is handled on the
+   * next wakeup */
+  srt_flush_writable_clients (self, wready, MIN (wnum, SRT_MAX_POLL_SOCKETS));
+
+  for (i = 0; i < MIN (rnum, SRT_MAX_POLL_SOCKETS); i++) {
+    if (rready[i] == priv->sock)
+      accept = TRUE;
+  }
+  if (!accept)
+    goto out;
+
   client = srt_client_new ();
+  sa_len = sizeof (sa);
   client->sock = srt_accept (priv->sock, &sa, &sa_len);
 
   if (client->sock == SRT_INVALID_SOCK) {
@@ -322,15 +464,44 @@ failed:
   return FALSE;
 }
 
+static void
+srt_client_queue_packets (SRTClient * client, GstBufferList * packets)
+{
+  guint i, len = gst_buffer_list_length (packets);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *packet = gst_buffer_list_get (packets, i);
+
+    g_queue_push_tail (&client->queue, gst_buffer_ref (packet));
+    client->queued_bytes += gst_buffer_get_size (packet);
+  }
+}
+
+/* The packets are shared by all clients, each one only holds references in
+ * its queue. Client sockets are non-blocking: whatever doesn't fit in the
+ * send buffer stays queued, and is sent from the poll thread once
+ * acknowledgements from the peer made room. A slow client doesn't hold back
+ * the others this way. Must be called with the object lock */
 static gboolean
-send_buffer_internal (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo, gpointer user_data)
+srt_client_send_packets (GstSRTServerSink * self, SRTClient * client,
+    GstBufferList * packets)
 {
-  SRTClient *client = user_data;
+  GstSRTBaseSink *sink = GST_SRT_BASE_SINK (self);
 
-  if (srt_sendmsg2 (client->sock, (char *) mapinfo->data, mapinfo->size,
-          0) == SRT_ERROR) {
-    GST_WARNING_OBJECT (sink, "%s", srt_getlasterror_str ());
+  if (!client->sent_headers) {
+    if (sink->headers)
+      srt_client_queue_packets (client, sink->headers);
+    client->sent_headers = TRUE;
+  }
+
+  srt_client_queue_packets (client, packets);
+
+  if (!srt_client_flush (self, client))
+    return FALSE;
+
+  if (client->queued_bytes > SRT_MAX_CLIENT_QUEUE_BYTES) {
+    GST_WARNING_OBJECT (sink, "client too slow, %" G_GSIZE_FORMAT
+        " bytes queued", client->queued_bytes);
     return FALSE;
   }
 
@@ -338,41 +509,97 @@ send_buffer_internal (GstSRTBaseSink * sink,
 }
 
 static gboolean
-gst_srt_server_sink_send_buffer (GstSRTBaseSink * sink,
-    const GstMapInfo * mapinfo)
+gst_srt_server_sink_send_packets (GstSRTBaseSink * sink,
+    GstBufferList * packets)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
-  GList *clients = priv->clients;
+  GList *clients, *removed = NULL;
 
   GST_OBJECT_LOCK (sink);
+  clients = priv->clients;
   while (clients != NULL) {
     SRTClient *client = clients->data;
-    clients = clients->next;
+    GList *next = clients->next;
 
-    if (!client->sent_headers) {
-      if (!gst_srt_base_sink_send_headers (sink, send_buffer_internal, client))
-        goto err;
-
-      client->sent_headers = TRUE;
+    if (!srt_client_send_packets (self, client, packets)) {
+      priv->clients = g_list_delete_link (priv->clients, clients);
+      removed = g_list_prepend (removed, client);
+      g_cond_broadcast (&priv->drain_cond);
     }
+    clients = next;
+  }
+  GST_OBJECT_UNLOCK (sink);
 
-    if (!send_buffer_internal (sink, mapinfo, client))
-      goto err;
+  srt_free_removed_clients (self, removed);
 
-    continue;
+  return TRUE;
+}
 
-  err:
-    priv->clients = g_list_remove (priv->clients, client);
-    GST_OBJECT_UNLOCK (sink);
-    g_signal_emit (self, signals[SIG_CLIENT_REMOVED], 0, client->sock,
-        client->sockaddr);
-    srt_client_free (client);
-    GST_OBJECT_LOCK (sink);
+/* Waits until every client was handed all its queued packets, or it was
+ * removed. Returns %FALSE if @end_time (monotonic, -1 for none) passed or
+ * the wait was interrupted by unlock() if @cancellable */
+static gboolean
+gst_srt_server_sink_wait_drained (GstSRTServerSink * self, gint64 end_time,
+    gboolean cancellable)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  gboolean drained;
+
+  GST_OBJECT_LOCK (self);
+  while (!(drained = srt_clients_drained (priv))) {
+    if (cancellable && priv->cancelled)
+      break;
+
+    if (end_time == -1)
+      g_cond_wait (&priv->drain_cond, GST_OBJECT_GET_LOCK (self));
+    else if (!g_cond_wait_until (&priv->drain_cond,
+            GST_OBJECT_GET_LOCK (self), end_time))
+      break;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return drained;
+}
+
+static gboolean
+gst_srt_server_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
+
+  /* don't report EOS while clients still have data queued */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    GST_DEBUG_OBJECT (self, "waiting for the client queues to be drained");
+    if (!gst_srt_server_sink_wait_drained (self, -1, TRUE))
+      GST_DEBUG_OBJECT (self, "interrupted while draining");
+  }
+
+  return GST_BASE_SINK_CLASS (parent_class)->event (sink, event);
+}
+
+static void
+gst_srt_server_sink_post_stats (GstSRTBaseSink * sink)
+{
+  GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
+  GList *clients, *stats = NULL;
+
+  /* One message per client, posted without holding the lock */
+  GST_OBJECT_LOCK (sink);
+  for (clients = priv->clients; clients; clients = clients->next) {
+    SRTClient *client = clients->data;
+
+    stats = g_list_prepend (stats, gst_srt_get_stats (client->sockaddr,
+            client->sock));
   }
   GST_OBJECT_UNLOCK (sink);
 
-  return TRUE;
+  stats = g_list_reverse (stats);
+  for (clients = stats; clients; clients = clients->next) {
+    gst_element_post_message (GST_ELEMENT_CAST (self),
+        gst_message_new_element (GST_OBJECT_CAST (self), clients->data));
+  }
+  g_list_free (stats);
 }
 
 static gboolean
@@ -382,6 +609,12 @@ gst_srt_server_sink_stop (GstBaseSink * sink)
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   GList *clients;
 
+  /* Give the clients the time of the SRT latency to get what is still
+   * queued, it would be too late for them afterwards */
+  if (!gst_srt_server_sink_wait_drained (self, g_get_monotonic_time () +
+          GST_SRT_BASE_SINK (self)->latency * G_TIME_SPAN_MILLISECOND, FALSE))
+    GST_WARNING_OBJECT (self, "dropping packets still queued for clients");
+
   GST_DEBUG_OBJECT (self, "closing client sockets");
 
   GST_OBJECT_LOCK (sink);
@@ -389,8 +622,7 @@ gst_srt_server_sink_stop (GstBaseSink * sink)
   priv->clients = NULL;
   GST_OBJECT_UNLOCK (sink);
 
-  g_list_foreach (clients, (GFunc) srt_emit_client_removed, self);
-  g_list_free_full (clients, (GDestroyNotify) srt_client_free);
+  srt_free_removed_clients (self, clients);
 
   GST_DEBUG_OBJECT (self, "closing SRT connection");
   srt_epoll_remove_usock (priv->poll_id, priv->sock);
@@ -414,13 +646,26 @@ gst_srt_server_sink_stop (GstBaseSink * sink)
   return GST_BASE_SINK_CLASS (parent_class)->stop (sink);
 }
 
+static void
+gst_srt_server_sink_finalize (GObject * object)
+{
+  GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (object);
+
+  g_cond_clear (&priv->drain_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static gboolean
 gst_srt_server_sink_unlock (GstBaseSink * sink)
 {
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
 
+  GST_OBJECT_LOCK (self);
   priv->cancelled = TRUE;
+  g_cond_broadcast (&priv->drain_cond);
+  GST_OBJECT_UNLOCK (self);
 
   return TRUE;
 }
@@ -431,7 +676,9 @@ gst_srt_server_sink_unlock_stop (GstBaseSink * sink)
   GstSRTServerSink *self = GST_SRT_SERVER_SINK (sink);
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
 
+  GST_OBJECT_LOCK (self);
   priv->cancelled = FALSE;
+  GST_OBJECT_UNLOCK (self);
 
   return TRUE;
 }
@@ -446,6 +693,7 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
 
   gobject_class->set_property = gst_srt_server_sink_set_property;
   gobject_class->get_property = gst_srt_server_sink_get_property;
+  gobject_class->finalize = gst_srt_server_sink_finalize;
 
   properties[PROP_POLL_TIMEOUT] =
       g_param_spec_int ("poll-timeout", "Poll Timeout",
@@ -503,9 +751,12 @@ gst_srt_server_sink_class_init (GstSRTServerSinkClass * klass)
   gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_srt_server_sink_unlock);
   gstbasesink_class->unlock_stop =
       GST_DEBUG_FUNCPTR (gst_srt_server_sink_unlock_stop);
+  gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_srt_server_sink_event);
 
-  gstsrtbasesink_class->send_buffer =
-      GST_DEBUG_FUNCPTR (gst_srt_server_sink_send_buffer);
+  gstsrtbasesink_class->send_packets =
+      GST_DEBUG_FUNCPTR (gst_srt_server_sink_send_packets);
+  gstsrtbasesink_class->post_stats =
+      GST_DEBUG_FUNCPTR (gst_srt_server_sink_post_stats);
 }
 
 static void
@@ -513,4 +764,5 @@ gst_srt_server_sink_init (GstSRTServerSink * self)
 {
   GstSRTServerSinkPrivate *priv = GST_SRT_SERVER_SINK_GET_PRIVATE (self);
   priv->poll_timeout = SRT_DEFAULT_POLL_TIMEOUT;
+  g_cond_init (&priv->drain_cond);
 }
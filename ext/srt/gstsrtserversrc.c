@@ -195,9 +195,11 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
       srt_clearlasterror ();
     } else {
       priv->has_client = TRUE;
+      GST_OBJECT_LOCK (self);
       g_clear_object (&priv->client_sockaddr);
       priv->client_sockaddr = g_socket_address_new_from_native (&client_sa,
           client_sa_len);
+      GST_OBJECT_UNLOCK (self);
       g_signal_emit (self, signals[SIG_CLIENT_ADDED], 0,
           priv->client_sock, priv->client_sockaddr);
     }
@@ -224,8 +226,10 @@ gst_srt_server_src_fill (GstPushSrc * src, GstBuffer * outbuf)
         priv->client_sock, priv->client_sockaddr);
 
     srt_close (priv->client_sock);
+    GST_OBJECT_LOCK (self);
     priv->client_sock = SRT_INVALID_SOCK;
     g_clear_object (&priv->client_sockaddr);
+    GST_OBJECT_UNLOCK (self);
     priv->has_client = FALSE;
     gst_buffer_resize (outbuf, 0, 0);
     ret = GST_FLOW_OK;
@@ -244,6 +248,28 @@ out:
   return ret;
 }
 
+static void
+gst_srt_server_src_post_stats (GstSRTBaseSrc * src)
+{
+  GstSRTServerSrc *self = GST_SRT_SERVER_SRC (src);
+  GstSRTServerSrcPrivate *priv = GST_SRT_SERVER_SRC_GET_PRIVATE (self);
+  GSocketAddress *sockaddr = NULL;
+  SRTSOCKET sock = SRT_INVALID_SOCK;
+
+  /* the client comes and goes in the streaming thread */
+  GST_OBJECT_LOCK (self);
+  if (priv->client_sockaddr) {
+    sockaddr = g_object_ref (priv->client_sockaddr);
+    sock = priv->client_sock;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (sockaddr) {
+    gst_srt_post_stats (GST_ELEMENT (src), sockaddr, sock);
+    g_object_unref (sockaddr);
+  }
+}
+
 static gboolean
 gst_srt_server_src_start (GstBaseSrc * src)
 {
@@ -350,6 +376,7 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
   GstBaseSrcClass *gstbasesrc_class = GST_BASE_SRC_CLASS (klass);
   GstPushSrcClass *gstpushsrc_class = GST_PUSH_SRC_CLASS (klass);
+  GstSRTBaseSrcClass *gstsrtbasesrc_class = GST_SRT_BASE_SRC_CLASS (klass);
 
   gobject_class->set_property = gst_srt_server_src_set_property;
   gobject_class->get_property = gst_srt_server_src_get_property;
@@ -412,6 +439,9 @@ gst_srt_server_src_class_init (GstSRTServerSrcClass * klass)
       GST_DEBUG_FUNCPTR (gst_srt_server_src_unlock_stop);
 
   gstpushsrc_class->fill = GST_DEBUG_FUNCPTR (gst_srt_server_src_fill);
+
+  gstsrtbasesrc_class->post_stats =
+      GST_DEBUG_FUNCPTR (gst_srt_server_src_post_stats);
 }
 
 static void
@@ -284,6 +284,11 @@ gst_ttml_render_finalize (GObject * object)
     render->compositions = NULL;
   }
 
+  if (render->region_cache) {
+    g_hash_table_unref (render->region_cache);
+    render->region_cache = NULL;
+  }
+
   if (render->text_buffer) {
     gst_buffer_unref (render->text_buffer);
     render->text_buffer = NULL;
@@ -354,6 +359,7 @@ gst_ttml_render_init (GstTtmlRender * render, GstTtmlRenderClass * klass)
   render->text_linked = FALSE;
 
   render->compositions = NULL;
+  render->region_cache = NULL;
   render->layout =
       pango_layout_new (GST_TTML_RENDER_GET_CLASS (render)->pango_context);
 
@@ -511,6 +517,13 @@ gst_ttml_render_setcaps (GstTtmlRender * render, GstCaps * caps)
   ret = gst_ttml_render_negotiate (render, caps);
 
   GST_TTML_RENDER_LOCK (render);
+  /* Cached regions were rendered for the previous frame size */
+  if (render->region_cache) {
+    g_hash_table_unref (render->region_cache);
+    render->region_cache = NULL;
+  }
+  render->need_render = TRUE;
+
   g_mutex_lock (GST_TTML_RENDER_GET_CLASS (render)->pango_lock);
   if (!gst_ttml_render_can_handle_caps (caps)) {
     GST_DEBUG_OBJECT (render, "unsupported caps %" GST_PTR_FORMAT, caps);
@@ -2755,6 +2768,147 @@ gst_ttml_render_render_text_region (GstTtmlRender * render,
 }
 
 
+static void
+gst_ttml_render_composition_unref (GstVideoOverlayComposition * composition)
+{
+  if (composition)
+    gst_video_overlay_composition_unref (composition);
+}
+
+
+static void
+gst_ttml_render_append_style_set_key (GString * key,
+    const GstSubtitleStyleSet * style_set)
+{
+  g_string_append_printf (key,
+      "%d|%s|%.17g|%.17g|%d|%02x%02x%02x%02x|%02x%02x%02x%02x|%d|%d|%d|%d|%d"
+      "|%d|%.17g|%.17g|%.17g|%.17g|%.17g|%d|%.17g|%.17g|%.17g|%.17g|%d|%d|%d"
+      "|%d;", style_set->text_direction, GST_STR_NULL (style_set->font_family),
+      style_set->font_size, style_set->line_height, style_set->text_align,
+      style_set->color.r, style_set->color.g, style_set->color.b,
+      style_set->color.a, style_set->background_color.r,
+      style_set->background_color.g, style_set->background_color.b,
+      style_set->background_color.a, style_set->font_style,
+      style_set->font_weight, style_set->text_decoration,
+      style_set->unicode_bidi, style_set->wrap_option,
+      style_set->multi_row_align, style_set->line_padding, style_set->origin_x,
+      style_set->origin_y, style_set->extent_w, style_set->extent_h,
+      style_set->display_align, style_set->padding_start,
+      style_set->padding_end, style_set->padding_before,
+      style_set->padding_after, style_set->writing_mode,
+      style_set->show_background, style_set->overflow,
+      style_set->fill_line_gap);
+}
+
+
+/* Builds a string that uniquely identifies the rendered output of @region,
+ * i.e., its styling and that of all its blocks and elements, together with
+ * the text of each element. Regions that produce the same key render to the
+ * same image, so their composition can be reused across scenes. */
+static gchar *
+gst_ttml_render_get_region_key (GstSubtitleRegion * region,
+    GstBuffer * text_buf)
+{
+  GString *key = g_string_new (NULL);
+  guint i, j;
+
+  gst_ttml_render_append_style_set_key (key, region->style_set);
+
+  for (i = 0; i < gst_subtitle_region_get_block_count (region); ++i) {
+    const GstSubtitleBlock *block = gst_subtitle_region_get_block (region, i);
+
+    g_string_append_c (key, '[');
+    gst_ttml_render_append_style_set_key (key, block->style_set);
+
+    for (j = 0; j < gst_subtitle_block_get_element_count (block); ++j) {
+      const GstSubtitleElement *element =
+          gst_subtitle_block_get_element (block, j);
+      gchar *text;
+
+      text = gst_ttml_render_get_text_from_buffer (text_buf,
+          element->text_index);
+      if (!text) {
+        g_string_free (key, TRUE);
+        return NULL;
+      }
+
+      g_string_append_c (key, '(');
+      gst_ttml_render_append_style_set_key (key, element->style_set);
+      g_string_append_printf (key, "%d|%" G_GSIZE_FORMAT ":%s)",
+          element->suppress_whitespace, strlen (text), text);
+      g_free (text);
+    }
+    g_string_append_c (key, ']');
+  }
+
+  return g_string_free (key, FALSE);
+}
+
+
+/* Renders all regions of @text_buf into render->compositions. Regions whose
+ * key matches one of the previous scene are not rendered again; their
+ * composition is reused instead. */
+static void
+gst_ttml_render_render_scene (GstTtmlRender * render, GstBuffer * text_buf)
+{
+  GstSubtitleMeta *subtitle_meta;
+  GHashTable *region_cache;
+  guint i;
+
+  if (render->compositions) {
+    g_list_free_full (render->compositions,
+        (GDestroyNotify) gst_video_overlay_composition_unref);
+    render->compositions = NULL;
+  }
+
+  subtitle_meta = gst_buffer_get_subtitle_meta (text_buf);
+  if (!subtitle_meta) {
+    GST_CAT_WARNING (ttmlrender_debug, "Failed to get subtitle meta.");
+    return;
+  }
+
+  region_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) gst_ttml_render_composition_unref);
+
+  for (i = 0; i < subtitle_meta->regions->len; ++i) {
+    GstSubtitleRegion *region = g_ptr_array_index (subtitle_meta->regions, i);
+    GstVideoOverlayComposition *composition = NULL;
+    gpointer cached;
+    gchar *key;
+
+    key = gst_ttml_render_get_region_key (region, text_buf);
+
+    if (key
+        && g_hash_table_lookup_extended (region_cache, key, NULL, &cached)) {
+      /* Same region content twice in one scene */
+      composition = cached ? gst_video_overlay_composition_ref (cached) : NULL;
+    } else if (key && render->region_cache
+        && g_hash_table_lookup_extended (render->region_cache, key, NULL,
+            &cached)) {
+      GST_CAT_LOG (ttmlrender_debug, "Reusing rendered region %u", i);
+      composition = cached ? gst_video_overlay_composition_ref (cached) : NULL;
+    } else {
+      composition = gst_ttml_render_render_text_region (render, region,
+          text_buf);
+    }
+
+    if (key) {
+      g_hash_table_replace (region_cache, key,
+          composition ? gst_video_overlay_composition_ref (composition) : NULL);
+    }
+
+    if (composition)
+      render->compositions = g_list_append (render->compositions, composition);
+  }
+
+  /* Only keep the regions of this scene around so that the cache cannot
+   * grow without bounds */
+  if (render->region_cache)
+    g_hash_table_unref (render->region_cache);
+  render->region_cache = region_cache;
+}
+
+
 static GstFlowReturn
 gst_ttml_render_video_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer)
@@ -2895,31 +3049,7 @@ wait_for_text_buf:
       ret = gst_pad_push (render->srcpad, buffer);
     } else {
       if (render->need_render) {
-        GstSubtitleRegion *region = NULL;
-        GstSubtitleMeta *subtitle_meta = NULL;
-        guint i;
-
-        if (render->compositions) {
-          g_list_free_full (render->compositions,
-              (GDestroyNotify) gst_video_overlay_composition_unref);
-          render->compositions = NULL;
-        }
-
-        subtitle_meta = gst_buffer_get_subtitle_meta (render->text_buffer);
-        if (!subtitle_meta) {
-          GST_CAT_WARNING (ttmlrender_debug, "Failed to get subtitle meta.");
-        } else {
-          for (i = 0; i < subtitle_meta->regions->len; ++i) {
-            GstVideoOverlayComposition *composition;
-            region = g_ptr_array_index (subtitle_meta->regions, i);
-            composition = gst_ttml_render_render_text_region (render, region,
-                render->text_buffer);
-            if (composition) {
-              render->compositions = g_list_append (render->compositions,
-                  composition);
-            }
-          }
-        }
+        gst_ttml_render_render_scene (render, render->text_buffer);
         render->need_render = FALSE;
       }
 
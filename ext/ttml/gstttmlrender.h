@@ -93,6 +93,8 @@ struct _GstTtmlRender {
 
     PangoLayout             *layout;
     GList * compositions;
+    GHashTable              *region_cache;  /* region key -> composition of
+                                             * the last rendered scene */
 };
 
 struct _GstTtmlRenderClass {
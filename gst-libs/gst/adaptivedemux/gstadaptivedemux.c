@@ -130,8 +130,12 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_CONNECTION_SPEED 0
 #define DEFAULT_BITRATE_LIMIT 0.8f
+#define DEFAULT_PREFETCH_FRAGMENTS 0
+#define DEFAULT_ABR_ALGORITHM GST_ADAPTIVE_DEMUX_ABR_AVERAGE
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+/* throughput samples are taken every time that much data was received */
+#define THROUGHPUT_SAMPLE_BYTES (16 * 1024)
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -158,6 +162,8 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_FRAGMENTS,
+  PROP_ABR_ALGORITHM,
   PROP_LAST
 };
 
@@ -208,6 +214,23 @@ struct _GstAdaptiveDemuxPrivate
   GMutex segment_lock;
 };
 
+/* A fragment downloaded ahead of time by the prefetch_pool of a stream.
+ * All fields but the immutable uri and range are protected by the
+ * fragment_download_lock of the stream */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  volatile gint ref_count;
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+
+  GstUriDownloader *downloader; /* set while the download is running */
+  GstBuffer *buffer;
+  GstClockTime download_time;
+  gboolean done;
+  gboolean cancelled;
+} GstAdaptiveDemuxPrefetch;
+
 typedef struct _GstAdaptiveDemuxTimer
 {
   volatile gint ref_count;
@@ -297,6 +320,8 @@ gst_adaptive_demux_stream_finish_fragment_default (GstAdaptiveDemux * demux,
 static GstFlowReturn
 gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
     GstAdaptiveDemuxStream * stream, GstClockTime duration);
+static void gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream *
+    stream);
 static gboolean
 gst_adaptive_demux_wait_until (GstClock * clock, GCond * cond, GMutex * mutex,
     GstClockTime end_time);
@@ -362,6 +387,12 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      demux->prefetch_fragments = g_value_get_uint (value);
+      break;
+    case PROP_ABR_ALGORITHM:
+      demux->abr_algorithm = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -386,6 +417,12 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      g_value_set_uint (value, demux->prefetch_fragments);
+      break;
+    case PROP_ABR_ALGORITHM:
+      g_value_set_enum (value, demux->abr_algorithm);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -431,6 +468,36 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-fragments:
+   *
+   * Number of upcoming fragments of each stream that are downloaded in
+   * parallel with the current one. Only used by subclasses that implement
+   * #GstAdaptiveDemuxClass.stream_peek_fragment(), and only for forward
+   * playback.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_FRAGMENTS,
+      g_param_spec_uint ("prefetch-fragments", "Prefetch fragments",
+          "Number of upcoming fragments downloaded in parallel per stream "
+          "(0 = disabled)", 0, 16, DEFAULT_PREFETCH_FRAGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:abr-algorithm:
+   *
+   * Algorithm used to select the bitrate of the next fragment. Ignored if
+   * #GstAdaptiveDemux:connection-speed is set.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ABR_ALGORITHM,
+      g_param_spec_enum ("abr-algorithm", "ABR algorithm",
+          "Algorithm used to select the bitrate of the next fragment",
+          GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM, DEFAULT_ABR_ALGORITHM,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -523,6 +590,8 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->prefetch_fragments = DEFAULT_PREFETCH_FRAGMENTS;
+  demux->abr_algorithm = DEFAULT_ABR_ALGORITHM;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -1334,6 +1403,8 @@ gst_adaptive_demux_stream_new (GstAdaptiveDemux * demux, GstPad * pad)
   gst_segment_init (&stream->segment, GST_FORMAT_TIME);
   g_cond_init (&stream->fragment_download_cond);
   g_mutex_init (&stream->fragment_download_lock);
+  g_queue_init (&stream->prefetch_queue);
+  g_queue_init (&stream->prefetch_downloaders);
 
   demux->next_streams = g_list_append (demux->next_streams, stream);
 
@@ -1398,6 +1469,21 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  if (stream->prefetch_pool) {
+    gst_adaptive_demux_stream_clear_prefetch (stream);
+
+    /* the workers can block in the downloaders, don't hold the manifest
+     * lock while waiting for them */
+    GST_MANIFEST_UNLOCK (demux);
+    g_thread_pool_free (stream->prefetch_pool, FALSE, TRUE);
+    GST_MANIFEST_LOCK (demux);
+    stream->prefetch_pool = NULL;
+
+    g_queue_foreach (&stream->prefetch_downloaders, (GFunc) gst_object_unref,
+        NULL);
+    g_queue_clear (&stream->prefetch_downloaders);
+  }
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -2100,6 +2186,9 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      /* prefetched fragments are for the old position */
+      gst_adaptive_demux_stream_clear_prefetch (stream);
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2227,6 +2316,83 @@ _update_average_bitrate (GstAdaptiveDemux * demux,
   return stream->moving_bitrate / stream->moving_index;
 }
 
+/* must be called with manifest_lock taken.
+ * Returns how much media is queued downstream of @stream, or
+ * GST_CLOCK_TIME_NONE if it can't be known (e.g. not playing yet) */
+static GstClockTime
+gst_adaptive_demux_stream_get_buffer_level (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstClock *clock;
+  GstClockTime now, position;
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (demux));
+  if (clock == NULL)
+    return GST_CLOCK_TIME_NONE;
+  now = gst_clock_get_time (clock);
+  gst_object_unref (clock);
+  now -= MIN (now, gst_element_get_base_time (GST_ELEMENT_CAST (demux)));
+
+  GST_ADAPTIVE_DEMUX_SEGMENT_LOCK (demux);
+  position = gst_segment_to_running_time (&stream->segment, GST_FORMAT_TIME,
+      stream->segment.position);
+  GST_ADAPTIVE_DEMUX_SEGMENT_UNLOCK (demux);
+
+  if (!GST_CLOCK_TIME_IS_VALID (position))
+    return GST_CLOCK_TIME_NONE;
+
+  return position > now ? position - now : 0;
+}
+
+/* must be called with manifest_lock taken.
+ * Picks one of the bitrates of @stream from the buffer level, like BOLA-O:
+ * switching up is limited to what @throughput can sustain so that a full
+ * buffer doesn't make the selection oscillate. */
+static guint64
+gst_adaptive_demux_stream_select_bola_bitrate (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, guint64 throughput)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GArray *bitrates = NULL;
+  GstClockTime level;
+  const guint64 *rates;
+  guint quality, previous = 0, sustainable = 0, i;
+  guint64 ret = throughput;
+
+  level = gst_adaptive_demux_stream_get_buffer_level (demux, stream);
+  if (!GST_CLOCK_TIME_IS_VALID (level))
+    return ret;
+
+  if (klass->stream_get_bitrates)
+    bitrates = klass->stream_get_bitrates (stream);
+  if (bitrates == NULL || bitrates->len == 0 ||
+      g_array_index (bitrates, guint64, 0) == 0)
+    goto done;
+
+  rates = (const guint64 *) bitrates->data;
+  quality = gst_adaptive_demux_abr_bola_select (rates, bitrates->len, level);
+
+  for (i = 0; i < bitrates->len; i++) {
+    if (rates[i] <= stream->abr_last_bitrate)
+      previous = i;
+    if (rates[i] <= throughput)
+      sustainable = i;
+  }
+
+  if (quality > previous && rates[quality] > throughput)
+    quality = MAX (sustainable, previous);
+
+  GST_DEBUG_OBJECT (stream->pad, "Buffer level %" GST_TIME_FORMAT
+      ", BOLA picks bitrate %" G_GUINT64_FORMAT " (index %u)",
+      GST_TIME_ARGS (level), rates[quality], quality);
+  ret = rates[quality];
+
+done:
+  if (bitrates)
+    g_array_unref (bitrates);
+  return ret;
+}
+
 /* must be called with manifest_lock taken */
 static guint64
 gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
@@ -2254,13 +2420,31 @@ gst_adaptive_demux_stream_update_current_bitrate (GstAdaptiveDemux * demux,
       "Last %u fragments average bitrate is %" G_GUINT64_FORMAT,
       NUM_LOOKBACK_FRAGMENTS, average_bitrate);
 
-  /* Conservative approach, make sure we don't upgrade too fast */
-  stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  if (demux->abr_algorithm == GST_ADAPTIVE_DEMUX_ABR_AVERAGE) {
+    /* Conservative approach, make sure we don't upgrade too fast */
+    stream->current_download_rate = MIN (average_bitrate, fragment_bitrate);
+  } else {
+    g_mutex_lock (&stream->fragment_download_lock);
+    stream->current_download_rate =
+        gst_adaptive_demux_throughput_get_estimate (&stream->throughput);
+    g_mutex_unlock (&stream->fragment_download_lock);
+    GST_INFO_OBJECT (stream, "Estimated throughput is %" G_GUINT64_FORMAT,
+        stream->current_download_rate);
+    /* not enough data yet */
+    if (stream->current_download_rate == 0)
+      stream->current_download_rate = fragment_bitrate;
+  }
 
   stream->current_download_rate *= demux->bitrate_limit;
   GST_DEBUG_OBJECT (demux, "Bitrate after bitrate limit (%0.2f): %"
       G_GUINT64_FORMAT, demux->bitrate_limit, stream->current_download_rate);
 
+  if (demux->abr_algorithm == GST_ADAPTIVE_DEMUX_ABR_BOLA)
+    stream->current_download_rate =
+        gst_adaptive_demux_stream_select_bola_bitrate (demux, stream,
+        stream->current_download_rate);
+  stream->abr_last_bitrate = stream->current_download_rate;
+
 #if 0
   /* Debugging code, modulate the bitrate every few fragments */
   {
@@ -2532,18 +2716,16 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* Takes the manifest_lock, so must be called without it. Used for buffers
+ * coming from the source element and for prefetched fragments */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_handle_buffer (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
   GST_MANIFEST_LOCK (demux);
 
   /* do not make any changes if the stream is cancelled */
@@ -2694,6 +2876,14 @@ error:
   return ret;
 }
 
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstAdaptiveDemuxStream *stream = gst_pad_get_element_private (pad);
+
+  return gst_adaptive_demux_stream_handle_buffer (stream, buffer);
+}
+
 /* must be called with manifest_lock taken */
 static void
 gst_adaptive_demux_stream_fragment_download_finish (GstAdaptiveDemuxStream *
@@ -2792,15 +2982,28 @@ _uri_handler_probe (GstPad * pad, GstPadProbeInfo * info,
 
   if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
     GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    GstClockTime now = gst_adaptive_demux_get_monotonic_time (stream->demux);
+
     if (stream->fragment_bytes_downloaded == 0) {
-      stream->last_latency =
-          gst_adaptive_demux_get_monotonic_time (stream->demux) -
-          (stream->download_start_time * GST_USECOND);
+      stream->last_latency = now - (stream->download_start_time * GST_USECOND);
       GST_DEBUG_OBJECT (pad,
           "FIRST BYTE since download_start %" GST_TIME_FORMAT,
           GST_TIME_ARGS (stream->last_latency));
     }
     stream->fragment_bytes_downloaded += gst_buffer_get_size (buf);
+
+    stream->throughput_sample_bytes += gst_buffer_get_size (buf);
+    if (stream->throughput_sample_bytes >= THROUGHPUT_SAMPLE_BYTES) {
+      /* can't take the manifest lock here, it is held while the source
+       * is shut down */
+      g_mutex_lock (&stream->fragment_download_lock);
+      gst_adaptive_demux_throughput_add_sample (&stream->throughput,
+          stream->throughput_sample_bytes,
+          now - stream->throughput_sample_start);
+      g_mutex_unlock (&stream->fragment_download_lock);
+      stream->throughput_sample_bytes = 0;
+      stream->throughput_sample_start = now;
+    }
     GST_LOG_OBJECT (pad,
         "Received buffer, size %" G_GSIZE_FORMAT " total %" G_GUINT64_FORMAT,
         gst_buffer_get_size (buf), stream->fragment_bytes_downloaded);
@@ -2812,12 +3015,24 @@ _uri_handler_probe (GstPad * pad, GstPadProbeInfo * info,
     switch (GST_EVENT_TYPE (ev)) {
       case GST_EVENT_SEGMENT:
         stream->fragment_bytes_downloaded = 0;
+        stream->throughput_sample_bytes = 0;
+        stream->throughput_sample_start =
+            stream->download_start_time * GST_USECOND;
         break;
       case GST_EVENT_EOS:
       {
+        GstClockTime now =
+            gst_adaptive_demux_get_monotonic_time (stream->demux);
+
+        g_mutex_lock (&stream->fragment_download_lock);
+        gst_adaptive_demux_throughput_add_sample (&stream->throughput,
+            stream->throughput_sample_bytes,
+            now - stream->throughput_sample_start);
+        g_mutex_unlock (&stream->fragment_download_lock);
+        stream->throughput_sample_bytes = 0;
+
         stream->last_download_time =
-            gst_adaptive_demux_get_monotonic_time (stream->demux) -
-            (stream->download_start_time * GST_USECOND);
+            now - (stream->download_start_time * GST_USECOND);
         stream->last_bitrate =
             gst_util_uint64_scale (stream->fragment_bytes_downloaded,
             8 * GST_SECOND, stream->last_download_time);
@@ -3323,6 +3538,312 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_new (gchar * uri, gint64 range_start,
+    gint64 range_end)
+{
+  GstAdaptiveDemuxPrefetch *prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+
+  prefetch->ref_count = 1;
+  prefetch->uri = uri;
+  prefetch->range_start = range_start;
+  prefetch->range_end = range_end;
+  prefetch->download_time = GST_CLOCK_TIME_NONE;
+
+  return prefetch;
+}
+
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_ref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_atomic_int_inc (&prefetch->ref_count);
+  return prefetch;
+}
+
+static void
+gst_adaptive_demux_prefetch_unref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  if (g_atomic_int_dec_and_test (&prefetch->ref_count)) {
+    g_free (prefetch->uri);
+    if (prefetch->buffer)
+      gst_buffer_unref (prefetch->buffer);
+    g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+  }
+}
+
+static gboolean
+gst_adaptive_demux_prefetch_matches (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return prefetch->range_start == range_start &&
+      prefetch->range_end == range_end && g_strcmp0 (prefetch->uri, uri) == 0;
+}
+
+/* must be called with fragment_download_lock taken, consumes the reference
+ * held by the caller */
+static void
+gst_adaptive_demux_prefetch_cancel (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  GST_LOG ("Cancelling prefetch of %s", prefetch->uri);
+
+  prefetch->cancelled = TRUE;
+  if (prefetch->downloader)
+    gst_uri_downloader_cancel (prefetch->downloader);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+/* Runs in the prefetch_pool of the stream, without any demuxer lock */
+static void
+gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstUriDownloader *downloader;
+  GstFragment *download;
+  GstClockTime start_time;
+  GError *err = NULL;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (prefetch->cancelled) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    goto done;
+  }
+  /* reuse an idle downloader so its source keeps the connection alive */
+  downloader = g_queue_pop_head (&stream->prefetch_downloaders);
+  if (downloader == NULL) {
+    downloader = gst_uri_downloader_new ();
+    gst_uri_downloader_set_parent (downloader, GST_ELEMENT_CAST (demux));
+  }
+  prefetch->downloader = downloader;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  GST_DEBUG_OBJECT (stream->pad, "Prefetching %s range: %" G_GINT64_FORMAT
+      " - %" G_GINT64_FORMAT, prefetch->uri, prefetch->range_start,
+      prefetch->range_end);
+
+  start_time = gst_adaptive_demux_get_monotonic_time (demux);
+  /* HTTP ranges are inclusive, GStreamer segments are exclusive for the
+   * stop position */
+  download = gst_uri_downloader_fetch_uri_with_range (downloader,
+      prefetch->uri, NULL, FALSE, FALSE, TRUE, prefetch->range_start,
+      prefetch->range_end != -1 ? prefetch->range_end + 1 : -1, &err);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  prefetch->downloader = NULL;
+  if (download) {
+    prefetch->buffer = gst_fragment_get_buffer (download);
+    prefetch->download_time =
+        gst_adaptive_demux_get_monotonic_time (demux) - start_time;
+    g_object_unref (download);
+  } else if (!prefetch->cancelled) {
+    GST_DEBUG_OBJECT (stream->pad, "Failed to prefetch %s: %s", prefetch->uri,
+        err ? err->message : "unknown error");
+  }
+  prefetch->done = TRUE;
+  g_cond_broadcast (&stream->fragment_download_cond);
+
+  gst_uri_downloader_reset (downloader);
+  g_queue_push_tail (&stream->prefetch_downloaders, downloader);
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  g_clear_error (&err);
+
+done:
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+/* Cancels all the pending prefetches of @stream */
+static void
+gst_adaptive_demux_stream_clear_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  while ((prefetch = g_queue_pop_head (&stream->prefetch_queue)))
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+  g_mutex_unlock (&stream->fragment_download_lock);
+}
+
+/* must be called with manifest_lock taken.
+ *
+ * Makes sure the fragments following the current one are being downloaded
+ * in the background, and drops the ones that are not needed anymore (after
+ * a bitrate switch for example). The queue stays in playback order, starting
+ * with the current fragment if it was prefetched already.
+ */
+static void
+gst_adaptive_demux_stream_update_prefetch (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxPrefetch *prefetch;
+  GPtrArray *wanted;
+  GQueue queue = G_QUEUE_INIT;
+  guint depth = demux->prefetch_fragments;
+  guint i;
+
+  if (klass->stream_peek_fragment == NULL || depth == 0
+      || demux->segment.rate < 0) {
+    if (!g_queue_is_empty (&stream->prefetch_queue))
+      gst_adaptive_demux_stream_clear_prefetch (stream);
+    return;
+  }
+
+  wanted = g_ptr_array_new_full (depth + 1,
+      (GDestroyNotify) gst_adaptive_demux_prefetch_unref);
+  g_ptr_array_add (wanted,
+      gst_adaptive_demux_prefetch_new (g_strdup (stream->fragment.uri),
+          stream->fragment.range_start, stream->fragment.range_end));
+  for (i = 1; i <= depth; i++) {
+    gchar *uri = NULL;
+    gint64 range_start = 0, range_end = -1;
+
+    if (!klass->stream_peek_fragment (stream, i, &uri, &range_start,
+            &range_end))
+      break;
+    g_ptr_array_add (wanted, gst_adaptive_demux_prefetch_new (uri,
+            range_start, range_end));
+  }
+
+  if (stream->prefetch_pool == NULL) {
+    stream->prefetch_pool =
+        g_thread_pool_new ((GFunc) gst_adaptive_demux_prefetch_func, stream,
+        depth, FALSE, NULL);
+  } else if ((guint) g_thread_pool_get_max_threads (stream->prefetch_pool) !=
+      depth) {
+    g_thread_pool_set_max_threads (stream->prefetch_pool, depth, NULL);
+  }
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  for (i = 0; i < wanted->len; i++) {
+    GstAdaptiveDemuxPrefetch *want = g_ptr_array_index (wanted, i);
+    GList *l;
+
+    prefetch = NULL;
+    for (l = stream->prefetch_queue.head; l; l = l->next) {
+      if (gst_adaptive_demux_prefetch_matches (l->data, want->uri,
+              want->range_start, want->range_end)) {
+        prefetch = l->data;
+        g_queue_delete_link (&stream->prefetch_queue, l);
+        break;
+      }
+    }
+
+    /* the current fragment is downloaded by the stream itself if it was
+     * not prefetched yet */
+    if (prefetch == NULL && i > 0) {
+      prefetch = gst_adaptive_demux_prefetch_ref (want);
+      g_thread_pool_push (stream->prefetch_pool,
+          gst_adaptive_demux_prefetch_ref (prefetch), NULL);
+    }
+
+    if (prefetch)
+      g_queue_push_tail (&queue, prefetch);
+  }
+
+  while ((prefetch = g_queue_pop_head (&stream->prefetch_queue)))
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+  stream->prefetch_queue = queue;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  g_ptr_array_unref (wanted);
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Pushes the current fragment from the prefetch queue if it is there.
+ * Returns FALSE if it has to be downloaded normally instead.
+ */
+static gboolean
+gst_adaptive_demux_stream_download_prefetched (GstAdaptiveDemux * demux,
+    GstAdaptiveDemuxStream * stream, GstFlowReturn * ret)
+{
+  GstAdaptiveDemuxPrefetch *prefetch;
+  GstBuffer *buffer;
+  GstClockTime download_time;
+  gsize size;
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  prefetch = g_queue_peek_head (&stream->prefetch_queue);
+  if (prefetch == NULL || !gst_adaptive_demux_prefetch_matches (prefetch,
+          stream->fragment.uri, stream->fragment.range_start,
+          stream->fragment.range_end)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    return FALSE;
+  }
+  g_queue_pop_head (&stream->prefetch_queue);
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  GST_DEBUG_OBJECT (stream->pad, "Waiting for prefetched fragment %s",
+      prefetch->uri);
+
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (&stream->fragment_download_lock);
+  while (!stream->cancelled && !prefetch->done) {
+    g_cond_wait (&stream->fragment_download_cond,
+        &stream->fragment_download_lock);
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+    g_mutex_unlock (&stream->fragment_download_lock);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  buffer = prefetch->buffer;
+  prefetch->buffer = NULL;
+  download_time = prefetch->download_time;
+  g_mutex_unlock (&stream->fragment_download_lock);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+
+  if (buffer == NULL) {
+    GST_DEBUG_OBJECT (stream->pad, "Prefetch failed, downloading again");
+    return FALSE;
+  }
+
+  /* what the uri_handler probe measures for regular downloads */
+  size = gst_buffer_get_size (buffer);
+  stream->fragment_bytes_downloaded = size;
+  stream->last_download_time = MAX (download_time, 1);
+  stream->last_bitrate = gst_util_uint64_scale (size, 8 * GST_SECOND,
+      stream->last_download_time);
+  g_mutex_lock (&stream->fragment_download_lock);
+  gst_adaptive_demux_throughput_add_sample (&stream->throughput, size,
+      stream->last_download_time);
+  g_mutex_unlock (&stream->fragment_download_lock);
+  GST_DEBUG_OBJECT (stream->pad, "Prefetched fragment took %" GST_TIME_FORMAT
+      " bitrate %" G_GUINT64_FORMAT " bps",
+      GST_TIME_ARGS (stream->last_download_time), stream->last_bitrate);
+
+  /* there's no source element to ask for the size */
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0) {
+    stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+            8 * GST_SECOND, stream->fragment.duration));
+  }
+
+  stream->download_start_time =
+      GST_TIME_AS_USECONDS (gst_adaptive_demux_get_monotonic_time (demux));
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  GST_MANIFEST_UNLOCK (demux);
+  *ret = gst_adaptive_demux_stream_handle_buffer (stream, buffer);
+  GST_MANIFEST_LOCK (demux);
+
+  /* the buffer is the whole fragment, behave like on EOS from the source */
+  if (*ret == GST_FLOW_OK)
+    gst_adaptive_demux_eos_handling (stream);
+
+  *ret = stream->last_ret;
+  return TRUE;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3441,9 +3962,15 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    gst_adaptive_demux_stream_update_prefetch (demux, stream);
+
+    if (!gst_adaptive_demux_stream_download_prefetched (demux, stream, &ret)) {
+      stream->last_ret = GST_FLOW_OK;
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
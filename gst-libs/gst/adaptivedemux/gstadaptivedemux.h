@@ -26,6 +26,7 @@
 #include <gst/base/gstadapter.h>
 #include <gst/uridownloader/gsturidownloader.h>
 #include <gst/adaptivedemux/adaptive-demux-prelude.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
 
 G_BEGIN_DECLS
 
@@ -184,6 +185,14 @@ struct _GstAdaptiveDemuxStream
   guint moving_index;
   guint64 *fragment_bitrates;
 
+  /* throughput samples taken while downloading (pre-queue2), the
+   * estimator is protected by the fragment_download_lock */
+  GstAdaptiveDemuxThroughput throughput;
+  guint64 throughput_sample_bytes;
+  GstClockTime throughput_sample_start;
+  /* bitrate picked by the ABR algorithm for the previous fragment */
+  guint64 abr_last_bitrate;
+
   /* QoS data */
   GstClockTime qos_earliest_time;
 
@@ -195,6 +204,11 @@ struct _GstAdaptiveDemuxStream
   gboolean eos;
 
   gboolean do_block; /* TRUE if stream should block on preroll */
+
+  /* parallel download of upcoming fragments */
+  GThreadPool *prefetch_pool;
+  GQueue prefetch_queue;        /* protected by fragment_download_lock */
+  GQueue prefetch_downloaders;  /* protected by fragment_download_lock */
 };
 
 /**
@@ -228,6 +242,8 @@ struct _GstAdaptiveDemux
   /* Properties */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;
+  guint prefetch_fragments;     /* upcoming fragments downloaded in parallel */
+  GstAdaptiveDemuxAbrAlgorithm abr_algorithm;
 
   gboolean have_group_id;
   guint group_id;
@@ -482,6 +498,37 @@ struct _GstAdaptiveDemuxClass
    * Return: %TRUE if the playlist needs to be refreshed periodically by the demuxer.
    */
   gboolean (*requires_periodical_playlist_update) (GstAdaptiveDemux * demux);
+
+  /**
+   * stream_peek_fragment:
+   * @stream: #GstAdaptiveDemuxStream
+   * @index: position of the fragment after the current one, starting at 1
+   * @uri: (out) (transfer full): the URI of the fragment
+   * @range_start: (out): start of the byte range, or 0
+   * @range_end: (out): inclusive end of the byte range, or -1
+   *
+   * Optional. Describes an upcoming fragment of @stream without advancing
+   * to it, so that it can be downloaded ahead of time when the
+   * #GstAdaptiveDemux:prefetch-fragments property is set. Fragments that
+   * need a header, an index or chunked downloading should not be reported.
+   *
+   * Return: %TRUE if the fragment at @index is known.
+   */
+  gboolean (*stream_peek_fragment) (GstAdaptiveDemuxStream * stream, guint index, gchar ** uri, gint64 * range_start, gint64 * range_end);
+
+  /**
+   * stream_get_bitrates:
+   * @stream: #GstAdaptiveDemuxStream
+   *
+   * Optional. Lists the bitrates @stream can switch between, as passed to
+   * stream_select_bitrate(). Needed by buffer based ABR algorithms, which
+   * fall back to the throughput estimate without it.
+   *
+   * Return: (transfer full) (nullable): a #GArray of #guint64 bitrates in
+   * bits per second, sorted from lowest to highest, or %NULL if @stream
+   * can't switch bitrates.
+   */
+  GArray * (*stream_get_bitrates) (GstAdaptiveDemuxStream * stream);
 };
 
 GST_ADAPTIVE_DEMUX_API
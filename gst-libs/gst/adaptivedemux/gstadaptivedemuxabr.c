@@ -0,0 +1,185 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Bitrate adaptation helpers for GstAdaptiveDemux.
+ *
+ * The throughput estimator follows the dual EWMA used by Shaka player. The
+ * buffer based selection is BOLA-BASIC as described in "BOLA: Near-Optimal
+ * Bitrate Adaptation for Online Videos" (Spiteri, Urgaonkar, Sitaraman),
+ * with the parameters dash.js derives from the number of bitrates.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include "gstadaptivedemuxabr.h"
+
+/* half-lives of the two averages, in seconds */
+#define FAST_HALF_LIFE 2.0
+#define SLOW_HALF_LIFE 5.0
+/* don't trust the estimate before that much data was seen */
+#define MIN_TOTAL_BYTES (128 * 1024)
+
+/* BOLA keeps at least this much buffered, plus some room per bitrate */
+#define BOLA_MIN_BUFFER (10 * GST_SECOND)
+#define BOLA_BUFFER_PER_BITRATE (2 * GST_SECOND)
+
+GType
+gst_adaptive_demux_abr_algorithm_get_type (void)
+{
+  static volatile gsize type = 0;
+  static const GEnumValue values[] = {
+    {GST_ADAPTIVE_DEMUX_ABR_AVERAGE,
+        "Moving average of the last fragments", "average"},
+    {GST_ADAPTIVE_DEMUX_ABR_EWMA,
+        "Weighted moving averages of throughput samples", "ewma"},
+    {GST_ADAPTIVE_DEMUX_ABR_BOLA, "Buffer based (BOLA)", "bola"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType _type =
+        g_enum_register_static ("GstAdaptiveDemuxAbrAlgorithm", values);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+void
+gst_adaptive_demux_throughput_init (GstAdaptiveDemuxThroughput * throughput)
+{
+  memset (throughput, 0, sizeof (GstAdaptiveDemuxThroughput));
+}
+
+static void
+ewma_sample (gdouble * estimate, gdouble * total_weight, gdouble half_life,
+    gdouble weight, gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / half_life);
+
+  *estimate = value * (1.0 - alpha) + alpha * (*estimate);
+  *total_weight += weight;
+}
+
+static gdouble
+ewma_get (gdouble estimate, gdouble total_weight, gdouble half_life)
+{
+  /* the averages start at 0, correct for that bias */
+  gdouble zero_factor = 1.0 - pow (0.5, total_weight / half_life);
+
+  return zero_factor > 0 ? estimate / zero_factor : 0;
+}
+
+/**
+ * gst_adaptive_demux_throughput_add_sample:
+ * @throughput: a #GstAdaptiveDemuxThroughput
+ * @bytes: number of bytes received
+ * @duration: time it took to receive them
+ *
+ * Adds a measurement to @throughput. It can be a whole fragment or any part
+ * of it, samples are weighted by their duration.
+ */
+void
+gst_adaptive_demux_throughput_add_sample (GstAdaptiveDemuxThroughput *
+    throughput, guint64 bytes, GstClockTime duration)
+{
+  gdouble weight, value;
+
+  if (bytes == 0 || duration == 0 || !GST_CLOCK_TIME_IS_VALID (duration))
+    return;
+
+  weight = (gdouble) duration / GST_SECOND;
+  value = bytes * 8 / weight;
+
+  ewma_sample (&throughput->fast_estimate, &throughput->fast_weight,
+      FAST_HALF_LIFE, weight, value);
+  ewma_sample (&throughput->slow_estimate, &throughput->slow_weight,
+      SLOW_HALF_LIFE, weight, value);
+  throughput->total_bytes += bytes;
+}
+
+/**
+ * gst_adaptive_demux_throughput_get_estimate:
+ * @throughput: a #GstAdaptiveDemuxThroughput
+ *
+ * Returns: the estimated throughput in bits per second, or 0 if not enough
+ * data was measured yet.
+ */
+guint64
+gst_adaptive_demux_throughput_get_estimate (GstAdaptiveDemuxThroughput *
+    throughput)
+{
+  gdouble fast, slow;
+
+  if (throughput->total_bytes < MIN_TOTAL_BYTES)
+    return 0;
+
+  fast = ewma_get (throughput->fast_estimate, throughput->fast_weight,
+      FAST_HALF_LIFE);
+  slow = ewma_get (throughput->slow_estimate, throughput->slow_weight,
+      SLOW_HALF_LIFE);
+
+  return (guint64) MIN (fast, slow);
+}
+
+/**
+ * gst_adaptive_demux_abr_bola_select:
+ * @bitrates: (array length=n_bitrates): available bitrates, sorted from
+ *   lowest to highest, all non zero
+ * @n_bitrates: number of entries in @bitrates
+ * @buffer_level: amount of media buffered ahead of the playback position
+ *
+ * Returns: the index in @bitrates that BOLA picks for @buffer_level
+ */
+guint
+gst_adaptive_demux_abr_bola_select (const guint64 * bitrates, guint n_bitrates,
+    GstClockTime buffer_level)
+{
+  gdouble min_buffer, buffer_target, level;
+  gdouble max_utility, gp, vp, best_score = -G_MAXDOUBLE;
+  guint i, best = 0;
+
+  if (n_bitrates < 2 || bitrates[n_bitrates - 1] <= bitrates[0])
+    return 0;
+
+  min_buffer = (gdouble) BOLA_MIN_BUFFER / GST_SECOND;
+  buffer_target = min_buffer +
+      (gdouble) n_bitrates * BOLA_BUFFER_PER_BITRATE / GST_SECOND;
+  level = (gdouble) buffer_level / GST_SECOND;
+
+  /* utilities are ln (bitrate) shifted so that the lowest one is 1 */
+  max_utility = log ((gdouble) bitrates[n_bitrates - 1] / bitrates[0]) + 1.0;
+  gp = (max_utility - 1.0) / (buffer_target / min_buffer - 1.0);
+  vp = min_buffer / gp;
+
+  for (i = 0; i < n_bitrates; i++) {
+    gdouble utility = log ((gdouble) bitrates[i] / bitrates[0]) + 1.0;
+    gdouble score = (vp * (utility + gp) - level) / bitrates[i];
+
+    if (score >= best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+
+  return best;
+}
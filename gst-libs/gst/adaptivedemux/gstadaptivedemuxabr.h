@@ -0,0 +1,88 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_ADAPTIVE_DEMUX_ABR_H_
+#define _GST_ADAPTIVE_DEMUX_ABR_H_
+
+#include <gst/gst.h>
+#include <gst/adaptivedemux/adaptive-demux-prelude.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GstAdaptiveDemuxAbrAlgorithm:
+ * @GST_ADAPTIVE_DEMUX_ABR_AVERAGE: moving average of the download bitrate
+ *   of the last fragments
+ * @GST_ADAPTIVE_DEMUX_ABR_EWMA: exponentially weighted moving averages of
+ *   throughput samples taken while fragments are being downloaded
+ * @GST_ADAPTIVE_DEMUX_ABR_BOLA: buffer based selection (BOLA), falling back
+ *   to the EWMA estimate while the buffer level is unknown
+ *
+ * Algorithm used to pick the bitrate of the next fragment.
+ *
+ * Since: 1.16
+ */
+typedef enum
+{
+  GST_ADAPTIVE_DEMUX_ABR_AVERAGE,
+  GST_ADAPTIVE_DEMUX_ABR_EWMA,
+  GST_ADAPTIVE_DEMUX_ABR_BOLA
+} GstAdaptiveDemuxAbrAlgorithm;
+
+#define GST_TYPE_ADAPTIVE_DEMUX_ABR_ALGORITHM \
+  (gst_adaptive_demux_abr_algorithm_get_type ())
+
+GST_ADAPTIVE_DEMUX_API
+GType    gst_adaptive_demux_abr_algorithm_get_type (void);
+
+/**
+ * GstAdaptiveDemuxThroughput:
+ *
+ * Throughput estimator made of a fast and a slow exponentially weighted
+ * moving average. Samples are weighted by their duration and the estimate
+ * is the lowest of both averages, so that drops are followed quickly while
+ * short bursts don't cause upward switches.
+ */
+typedef struct _GstAdaptiveDemuxThroughput
+{
+  gdouble fast_estimate;
+  gdouble fast_weight;
+  gdouble slow_estimate;
+  gdouble slow_weight;
+  guint64 total_bytes;
+} GstAdaptiveDemuxThroughput;
+
+GST_ADAPTIVE_DEMUX_API
+void     gst_adaptive_demux_throughput_init (GstAdaptiveDemuxThroughput * throughput);
+
+GST_ADAPTIVE_DEMUX_API
+void     gst_adaptive_demux_throughput_add_sample (GstAdaptiveDemuxThroughput * throughput,
+                                                   guint64 bytes,
+                                                   GstClockTime duration);
+
+GST_ADAPTIVE_DEMUX_API
+guint64  gst_adaptive_demux_throughput_get_estimate (GstAdaptiveDemuxThroughput * throughput);
+
+GST_ADAPTIVE_DEMUX_API
+guint    gst_adaptive_demux_abr_bola_select (const guint64 * bitrates,
+                                             guint n_bitrates,
+                                             GstClockTime buffer_level);
+
+G_END_DECLS
+
+#endif /* _GST_ADAPTIVE_DEMUX_ABR_H_ */
@@ -297,13 +297,40 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
+/* Returns the offset of the first 00 00 01 start code followed by at least
+ * one byte, or -1. Same result as a masked scan for 0x000001xx, but i
+ * points at the byte where the 01 would be and skips ahead as far as the
+ * bytes seen allow: a byte > 1 there rules out the start codes ending at
+ * i, i + 1 and i + 2, and 8 bytes without any zero rule out all the start
+ * codes beginning within them */
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  guint i = 2;
 
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  while (i + 1 < size) {
+    if (i + 6 <= size) {
+      guint64 word;
+
+      memcpy (&word, data + i - 2, sizeof (word));
+      if (!((word - G_GUINT64_CONSTANT (0x0101010101010101)) & ~word &
+              G_GUINT64_CONSTANT (0x8080808080808080))) {
+        i += 8;
+        continue;
+      }
+    }
+
+    if (data[i] > 1) {
+      i += 3;
+    } else if (data[i] == 1) {
+      if (data[i - 1] == 0 && data[i - 2] == 0)
+        return i - 2;
+      i += 3;
+    } else {
+      i++;
+    }
+  }
+
+  return -1;
 }
@@ -331,10 +331,12 @@ gst_video_aggregator_pad_set_needs_alpha (GstVideoAggregatorPad * pad,
  * GstVideoAggregatorConvertPad implementation *
  ****************************************/
 
+#define DEFAULT_CONVERT_PAD_CONVERTER_THREADS 1
 enum
 {
   PROP_CONVERT_PAD_0,
   PROP_CONVERT_PAD_CONVERTER_CONFIG,
+  PROP_CONVERT_PAD_CONVERTER_THREADS,
 };
 
 struct _GstVideoAggregatorConvertPadPrivate
@@ -347,7 +349,11 @@ struct _GstVideoAggregatorConvertPadPrivate
   GstBuffer *converted_buffer;
 
   GstStructure *converter_config;
+  guint converter_threads;
   gboolean converter_config_changed;
+  /* the converter has to be re-created even if the conversion info
+   * did not change */
+  gboolean converter_options_changed;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GstVideoAggregatorConvertPad,
@@ -399,19 +405,34 @@ gst_video_aggregator_convert_pad_prepare_frame (GstVideoAggregatorPad * vpad,
     pad->priv->converter_config_changed = FALSE;
 
     if (!pad->priv->conversion_info.finfo
+        || pad->priv->converter_options_changed
         || !gst_video_info_is_equal (&conversion_info,
             &pad->priv->conversion_info)) {
       pad->priv->conversion_info = conversion_info;
+      pad->priv->converter_options_changed = FALSE;
 
       if (pad->priv->convert)
         gst_video_converter_free (pad->priv->convert);
       pad->priv->convert = NULL;
 
       if (!gst_video_info_is_equal (&vpad->info, &pad->priv->conversion_info)) {
+        GstStructure *config;
+
+        GST_OBJECT_LOCK (pad);
+        if (pad->priv->converter_config)
+          config = gst_structure_copy (pad->priv->converter_config);
+        else
+          config = gst_structure_new_empty ("GstVideoConverter");
+
+        /* An explicit thread count in the converter config wins */
+        if (!gst_structure_has_field (config, GST_VIDEO_CONVERTER_OPT_THREADS))
+          gst_structure_set (config, GST_VIDEO_CONVERTER_OPT_THREADS,
+              G_TYPE_UINT, pad->priv->converter_threads, NULL);
+        GST_OBJECT_UNLOCK (pad);
+
         pad->priv->convert =
             gst_video_converter_new (&vpad->info, &pad->priv->conversion_info,
-            pad->priv->converter_config ? gst_structure_copy (pad->
-                priv->converter_config) : NULL);
+            config);
         if (!pad->priv->convert) {
           GST_WARNING_OBJECT (pad, "No path found for conversion");
           return FALSE;
@@ -551,6 +572,11 @@ gst_video_aggregator_convert_pad_get_property (GObject * object, guint prop_id,
         g_value_set_boxed (value, pad->priv->converter_config);
       GST_OBJECT_UNLOCK (pad);
       break;
+    case PROP_CONVERT_PAD_CONVERTER_THREADS:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_uint (value, pad->priv->converter_threads);
+      GST_OBJECT_UNLOCK (pad);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -570,6 +596,14 @@ gst_video_aggregator_convert_pad_set_property (GObject * object, guint prop_id,
         gst_structure_free (pad->priv->converter_config);
       pad->priv->converter_config = g_value_dup_boxed (value);
       pad->priv->converter_config_changed = TRUE;
+      pad->priv->converter_options_changed = TRUE;
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    case PROP_CONVERT_PAD_CONVERTER_THREADS:
+      GST_OBJECT_LOCK (pad);
+      pad->priv->converter_threads = g_value_get_uint (value);
+      pad->priv->converter_config_changed = TRUE;
+      pad->priv->converter_options_changed = TRUE;
       GST_OBJECT_UNLOCK (pad);
       break;
     default:
@@ -599,6 +633,24 @@ gst_video_aggregator_convert_pad_class_init (GstVideoAggregatorConvertPadClass *
           "when scaling and converting this pad's video frames",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstVideoAggregatorConvertPad:converter-threads:
+   *
+   * Maximum number of threads the #GstVideoConverter of this pad uses to
+   * scale and convert a single frame, useful for wide inputs. Ignored if
+   * #GstVideoAggregatorConvertPad:converter-config contains
+   * %GST_VIDEO_CONVERTER_OPT_THREADS.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_CONVERT_PAD_CONVERTER_THREADS,
+      g_param_spec_uint ("converter-threads", "Converter threads",
+          "Maximum number of threads used to convert this pad's video frames "
+          "(0 = number of processors)", 0, G_MAXINT,
+          DEFAULT_CONVERT_PAD_CONVERTER_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   vaggpadclass->update_conversion_info =
       GST_DEBUG_FUNCPTR
       (gst_video_aggregator_convert_pad_update_conversion_info_internal);
@@ -620,7 +672,9 @@ gst_video_aggregator_convert_pad_init (GstVideoAggregatorConvertPad * vaggpad)
   vaggpad->priv->converted_buffer = NULL;
   vaggpad->priv->convert = NULL;
   vaggpad->priv->converter_config = NULL;
+  vaggpad->priv->converter_threads = DEFAULT_CONVERT_PAD_CONVERTER_THREADS;
   vaggpad->priv->converter_config_changed = FALSE;
+  vaggpad->priv->converter_options_changed = FALSE;
 }
 
 
@@ -681,6 +735,12 @@ struct _GstVideoAggregatorPrivate
   GstCaps *current_caps;
 
   gboolean live;
+
+  /* parallel prepare_frame() */
+  GThreadPool *prepare_pool;
+  GMutex prepare_lock;
+  GCond prepare_cond;
+  guint prepare_pending;
 };
 
 /* Can't use the G_DEFINE_TYPE macros because we need the
@@ -1633,22 +1693,195 @@ prepare_frames (GstElement * agg, GstPad * pad, gpointer user_data)
       vpad->priv->buffer, &vpad->priv->prepared_frame);
 }
 
-static gboolean
-clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
+typedef struct
+{
+  GstPad *pad;
+  gboolean ret;
+} PrepareFramesJob;
+
+static void
+prepare_frames_func (gpointer data, gpointer user_data)
+{
+  GstVideoAggregator *vagg = user_data;
+  PrepareFramesJob *job = data;
+
+  job->ret = prepare_frames (GST_ELEMENT_CAST (vagg), job->pad, NULL);
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  vagg->priv->prepare_pending--;
+  if (vagg->priv->prepare_pending == 0)
+    g_cond_signal (&vagg->priv->prepare_cond);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+}
+
+static void
+clean_frame (GstVideoAggregator * vagg, GstVideoAggregatorPad * vpad)
 {
-  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR_CAST (agg);
-  GstVideoAggregatorPad *vpad = GST_VIDEO_AGGREGATOR_PAD_CAST (pad);
   GstVideoAggregatorPadClass *vaggpad_class =
-      GST_VIDEO_AGGREGATOR_PAD_GET_CLASS (pad);
+      GST_VIDEO_AGGREGATOR_PAD_GET_CLASS (vpad);
 
   if (vaggpad_class->clean_frame)
     vaggpad_class->clean_frame (vpad, vagg, &vpad->priv->prepared_frame);
 
   memset (&vpad->priv->prepared_frame, 0, sizeof (GstVideoFrame));
+}
+
+/* Prepare the frames of all pads, concurrently if the subclass allows it
+ * through get_prepare_threads(). The pads are independent of each other, so
+ * the converters of different pads can run at the same time. Like with
+ * gst_element_foreach_sink_pad(), the pads after the first one that fails
+ * are left unprepared */
+static void
+gst_video_aggregator_prepare_frames (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorClass *vagg_klass = GST_VIDEO_AGGREGATOR_GET_CLASS (vagg);
+  PrepareFramesJob *jobs;
+  guint n_threads, n_jobs, i;
+  gboolean failed;
+  GList *l;
+
+  n_threads = 1;
+  if (vagg_klass->get_prepare_threads)
+    n_threads = vagg_klass->get_prepare_threads (vagg);
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  GST_OBJECT_LOCK (vagg);
+  if (n_threads <= 1 || GST_ELEMENT (vagg)->numsinkpads <= 1) {
+    GST_OBJECT_UNLOCK (vagg);
+    gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames,
+        NULL);
+    return;
+  }
+
+  jobs = g_new0 (PrepareFramesJob, GST_ELEMENT (vagg)->numsinkpads);
+  n_jobs = 0;
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    jobs[n_jobs].pad = gst_object_ref (l->data);
+    jobs[n_jobs].ret = TRUE;
+    n_jobs++;
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  n_threads = MIN (n_threads, n_jobs) - 1;
+  if (!vagg->priv->prepare_pool) {
+    vagg->priv->prepare_pool = g_thread_pool_new (prepare_frames_func, vagg,
+        n_threads, FALSE, NULL);
+  } else if (g_thread_pool_get_max_threads (vagg->priv->prepare_pool) !=
+      n_threads) {
+    g_thread_pool_set_max_threads (vagg->priv->prepare_pool, n_threads, NULL);
+  }
+
+  /* The last pad is prepared from the aggregator thread */
+  vagg->priv->prepare_pending = n_jobs - 1;
+  for (i = 0; i < n_jobs - 1; i++)
+    g_thread_pool_push (vagg->priv->prepare_pool, &jobs[i], NULL);
+
+  jobs[n_jobs - 1].ret = prepare_frames (GST_ELEMENT_CAST (vagg),
+      jobs[n_jobs - 1].pad, NULL);
+
+  g_mutex_lock (&vagg->priv->prepare_lock);
+  while (vagg->priv->prepare_pending > 0)
+    g_cond_wait (&vagg->priv->prepare_cond, &vagg->priv->prepare_lock);
+  g_mutex_unlock (&vagg->priv->prepare_lock);
+
+  /* Same outcome as the serial path: the pads after the first failure are
+   * not prepared */
+  failed = FALSE;
+  for (i = 0; i < n_jobs; i++) {
+    GstVideoAggregatorPad *vpad = GST_VIDEO_AGGREGATOR_PAD_CAST (jobs[i].pad);
+
+    if (failed)
+      clean_frame (vagg, vpad);
+    else if (!jobs[i].ret)
+      failed = TRUE;
+    gst_object_unref (vpad);
+  }
+
+  g_free (jobs);
+}
+
+static gboolean
+clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
+{
+  clean_frame (GST_VIDEO_AGGREGATOR_CAST (agg),
+      GST_VIDEO_AGGREGATOR_PAD_CAST (pad));
+
+  return TRUE;
+}
+
+/* Whether the current buffer of @pad can be pushed downstream as is */
+static gboolean
+gst_video_aggregator_pad_matches_output (GstVideoAggregator * vagg,
+    GstVideoAggregatorPad * pad)
+{
+  GstVideoInfo *in_info = &pad->info;
+  GstVideoInfo *out_info = &vagg->info;
+  GstVideoMeta *meta;
+  guint i;
+
+  if (!in_info->finfo
+      || GST_VIDEO_INFO_FORMAT (in_info) != GST_VIDEO_INFO_FORMAT (out_info)
+      || GST_VIDEO_INFO_WIDTH (in_info) != GST_VIDEO_INFO_WIDTH (out_info)
+      || GST_VIDEO_INFO_HEIGHT (in_info) != GST_VIDEO_INFO_HEIGHT (out_info)
+      || GST_VIDEO_INFO_PAR_N (in_info) != GST_VIDEO_INFO_PAR_N (out_info)
+      || GST_VIDEO_INFO_PAR_D (in_info) != GST_VIDEO_INFO_PAR_D (out_info)
+      || GST_VIDEO_INFO_INTERLACE_MODE (in_info) !=
+      GST_VIDEO_INFO_INTERLACE_MODE (out_info)
+      || GST_VIDEO_INFO_CHROMA_SITE (in_info) !=
+      GST_VIDEO_INFO_CHROMA_SITE (out_info)
+      || !gst_video_colorimetry_is_equal (&in_info->colorimetry,
+          &out_info->colorimetry))
+    return FALSE;
+
+  if (gst_buffer_get_size (pad->priv->buffer) < GST_VIDEO_INFO_SIZE (out_info))
+    return FALSE;
+
+  /* Downstream might not support custom strides and offsets */
+  meta = gst_buffer_get_video_meta (pad->priv->buffer);
+  if (meta) {
+    for (i = 0; i < meta->n_planes; i++) {
+      if (meta->offset[i] != GST_VIDEO_INFO_PLANE_OFFSET (out_info, i)
+          || meta->stride[i] != GST_VIDEO_INFO_PLANE_STRIDE (out_info, i))
+        return FALSE;
+    }
+  }
 
   return TRUE;
 }
 
+/* Returns a new reference to the current buffer of the pad whose content
+ * is going to be the output frame, if any */
+static GstBuffer *
+gst_video_aggregator_find_passthrough_buffer (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorClass *vagg_klass = GST_VIDEO_AGGREGATOR_GET_CLASS (vagg);
+  GstBuffer *buffer = NULL;
+  GList *l;
+
+  if (!vagg_klass->can_passthrough)
+    return NULL;
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+
+    if (pad->priv->buffer == NULL
+        || !gst_video_aggregator_pad_matches_output (vagg, pad))
+      continue;
+
+    if (vagg_klass->can_passthrough (vagg, pad)) {
+      GST_LOG_OBJECT (pad, "Forwarding buffer %" GST_PTR_FORMAT,
+          pad->priv->buffer);
+      buffer = gst_buffer_ref (pad->priv->buffer);
+      break;
+    }
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
     GstClockTime output_start_time, GstClockTime output_end_time,
@@ -1657,10 +1890,30 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GstFlowReturn ret = GST_FLOW_OK;
   GstElementClass *klass = GST_ELEMENT_GET_CLASS (vagg);
   GstVideoAggregatorClass *vagg_klass = (GstVideoAggregatorClass *) klass;
+  GstBuffer *passthrough_buf;
 
   g_assert (vagg_klass->aggregate_frames != NULL);
   g_assert (vagg_klass->create_output_buffer != NULL);
 
+  /* Sync pad properties to the stream time */
+  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
+
+  /* If a single pad makes up the whole output frame, push its buffer
+   * instead of mapping and copying it into a new one */
+  passthrough_buf = gst_video_aggregator_find_passthrough_buffer (vagg);
+  if (passthrough_buf) {
+    /* Shallow copy: only the metadata is copied, the memory is shared */
+    *outbuf = gst_buffer_copy (passthrough_buf);
+    gst_buffer_unref (passthrough_buf);
+
+    GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
+    GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
+    GST_BUFFER_OFFSET (*outbuf) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_OFFSET_END (*outbuf) = GST_BUFFER_OFFSET_NONE;
+
+    return GST_FLOW_OK;
+  }
+
   if ((ret = vagg_klass->create_output_buffer (vagg, outbuf)) != GST_FLOW_OK) {
     GST_WARNING_OBJECT (vagg, "Could not get an output buffer, reason: %s",
         gst_flow_get_name (ret));
@@ -1674,11 +1927,8 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
   GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
 
-  /* Sync pad properties to the stream time */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
-
   /* Convert all the frames the subclass has before aggregating */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
+  gst_video_aggregator_prepare_frames (vagg);
 
   ret = vagg_klass->aggregate_frames (vagg, *outbuf);
 
@@ -2478,6 +2728,12 @@ gst_video_aggregator_finalize (GObject * o)
 {
   GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (o);
 
+  if (vagg->priv->prepare_pool)
+    g_thread_pool_free (vagg->priv->prepare_pool, FALSE, TRUE);
+  vagg->priv->prepare_pool = NULL;
+
+  g_mutex_clear (&vagg->priv->prepare_lock);
+  g_cond_clear (&vagg->priv->prepare_cond);
   g_mutex_clear (&vagg->priv->lock);
 
   G_OBJECT_CLASS (gst_video_aggregator_parent_class)->finalize (o);
@@ -2576,6 +2832,8 @@ gst_video_aggregator_init (GstVideoAggregator * vagg,
   vagg->priv->current_caps = NULL;
 
   g_mutex_init (&vagg->priv->lock);
+  g_mutex_init (&vagg->priv->prepare_lock);
+  g_cond_init (&vagg->priv->prepare_cond);
 
   /* initialize variables */
   gst_video_aggregator_reset (vagg);
@@ -219,6 +219,18 @@ struct _GstVideoAggregator
  *                            the #aggregate_frames vmethod.
  * @find_best_format:         Optional.
  *                            Lets subclasses decide of the best common format to use.
+ * @can_passthrough:          Optional.
+ *                            Called with the OBJECT_LOCK held for a pad whose current
+ *                            buffer has the same format and geometry as the output.
+ *                            Return %TRUE if aggregating would produce an output frame
+ *                            identical to that buffer, in which case the buffer is
+ *                            forwarded downstream instead of aggregating. Since: 1.16
+ * @get_prepare_threads:      Optional.
+ *                            Returns the maximum number of threads used to prepare
+ *                            the frames of different pads concurrently, 0 meaning
+ *                            one per processor. Only implement this if the
+ *                            prepare_frame() of the pads is thread-safe. Frames are
+ *                            prepared serially if not set. Since: 1.16
  **/
 struct _GstVideoAggregatorClass
 {
@@ -236,9 +248,12 @@ struct _GstVideoAggregatorClass
                                                    GstCaps            *  downstream_caps,
                                                    GstVideoInfo       *  best_info,
                                                    gboolean           *  at_least_one_alpha);
+  gboolean           (*can_passthrough)           (GstVideoAggregator    *  videoaggregator,
+                                                   GstVideoAggregatorPad *  pad);
+  guint              (*get_prepare_threads)       (GstVideoAggregator *  videoaggregator);
 
   /* < private > */
-  gpointer            _gst_reserved[GST_PADDING_LARGE];
+  gpointer            _gst_reserved[GST_PADDING_LARGE - 2];
 };
 
 GST_VIDEO_BAD_API
@@ -227,6 +227,13 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->channel_mask = 0;
   self->s16_conv_matrix = NULL;
   self->s32_conv_matrix = NULL;
+  self->tap_offsets = NULL;
+  self->tap_in = NULL;
+  self->tap_f32 = NULL;
+  self->tap_f64 = NULL;
+  self->tap_s16 = NULL;
+  self->tap_s32 = NULL;
+  self->accumulator = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
 }
 
@@ -240,6 +247,8 @@ gst_audio_mix_matrix_dispose (GObject * object)
     self->matrix = NULL;
   }
 
+  gst_audio_mix_matrix_clear_taps (self);
+
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
@@ -279,6 +288,114 @@ gst_audio_mix_matrix_convert_s32_matrix (GstAudioMixMatrix * self)
   }
 }
 
+static void
+gst_audio_mix_matrix_clear_taps (GstAudioMixMatrix * self)
+{
+  g_free (self->tap_offsets);
+  self->tap_offsets = NULL;
+  g_free (self->tap_in);
+  self->tap_in = NULL;
+  g_free (self->tap_f32);
+  self->tap_f32 = NULL;
+  g_free (self->tap_f64);
+  self->tap_f64 = NULL;
+  g_free (self->tap_s16);
+  self->tap_s16 = NULL;
+  g_free (self->tap_s32);
+  self->tap_s32 = NULL;
+  g_free (self->accumulator);
+  self->accumulator = NULL;
+}
+
+/* Must be called with the object lock, after the integer matrices were
+ * converted */
+static void
+gst_audio_mix_matrix_update_taps (GstAudioMixMatrix * self)
+{
+  guint in, out, t, n_taps = 0, n_alloc;
+  guint inchannels = self->in_channels;
+  guint outchannels = self->out_channels;
+  guint n_coeffs = inchannels * outchannels;
+  gboolean routing = TRUE, identity = inchannels == outchannels;
+
+  gst_audio_mix_matrix_clear_taps (self);
+
+  if (self->matrix == NULL || n_coeffs == 0)
+    return;
+
+  for (out = 0; out < outchannels; out++) {
+    guint n_out_taps = 0;
+
+    for (in = 0; in < inchannels; in++) {
+      gdouble coefficient = self->matrix[out * inchannels + in];
+
+      if (coefficient != 0) {
+        n_out_taps++;
+        if (coefficient != 1.0)
+          routing = FALSE;
+        if (in != out)
+          identity = FALSE;
+      } else if (in == out) {
+        identity = FALSE;
+      }
+    }
+    if (n_out_taps > 1)
+      routing = FALSE;
+    n_taps += n_out_taps;
+  }
+
+  self->routing = routing;
+  self->identity = identity && routing;
+  /* walking a tap list costs more per coefficient than the contiguous
+   * loops, which the compiler can vectorize, so only use it when it saves
+   * enough multiplications */
+  self->dense = !routing && n_taps * 2 > n_coeffs;
+
+  self->tap_offsets = g_new (guint, outchannels + 1);
+  if (self->dense) {
+    n_alloc = n_coeffs;
+    self->accumulator = g_new (gint64, outchannels);
+  } else {
+    n_alloc = MAX (n_taps, 1);
+    self->tap_in = g_new (guint, n_alloc);
+  }
+  self->tap_f32 = g_new0 (gfloat, n_alloc);
+  self->tap_f64 = g_new0 (gdouble, n_alloc);
+  self->tap_s16 = g_new0 (gint32, n_alloc);
+  self->tap_s32 = g_new0 (gint64, n_alloc);
+
+  t = 0;
+  for (out = 0; out < outchannels; out++) {
+    self->tap_offsets[out] = t;
+    for (in = 0; in < inchannels; in++) {
+      guint i = out * inchannels + in;
+      guint idx;
+
+      if (self->dense) {
+        idx = in * outchannels + out;
+      } else if (self->matrix[i] != 0) {
+        idx = t++;
+        self->tap_in[idx] = in;
+      } else {
+        continue;
+      }
+
+      self->tap_f32[idx] = self->matrix[i];
+      self->tap_f64[idx] = self->matrix[i];
+      if (self->s16_conv_matrix)
+        self->tap_s16[idx] = self->s16_conv_matrix[i];
+      if (self->s32_conv_matrix)
+        self->tap_s32[idx] = self->s32_conv_matrix[i];
+    }
+  }
+  self->tap_offsets[outchannels] = t;
+
+  GST_DEBUG_OBJECT (self, "%u non-zero coefficients out of %u, %s%s",
+      n_taps, n_coeffs,
+      self->dense ? "dense" : "sparse",
+      self->identity ? ", identity" : self->routing ? ", routing" : "");
+}
+
 
 static void
 gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
@@ -288,42 +405,64 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_IN_CHANNELS:
+      GST_OBJECT_LOCK (self);
       self->in_channels = g_value_get_uint (value);
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
       }
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_OUT_CHANNELS:
+      GST_OBJECT_LOCK (self);
       self->out_channels = g_value_get_uint (value);
       if (self->matrix) {
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
       }
+      GST_OBJECT_UNLOCK (self);
       break;
     case PROP_MATRIX:{
       gint in, out;
+      gdouble *matrix;
 
-      if (self->matrix)
-        g_free (self->matrix);
-      self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
-
+      /* parse into a new array first, the streaming thread keeps using
+       * the current taps until they are swapped under the object lock */
       g_return_if_fail (gst_value_array_get_size (value) == self->out_channels);
+      matrix = g_new (gdouble, self->in_channels * self->out_channels);
       for (out = 0; out < self->out_channels; out++) {
         const GValue *row = gst_value_array_get_value (value, out);
-        g_return_if_fail (gst_value_array_get_size (row) == self->in_channels);
+
+        if (gst_value_array_get_size (row) != self->in_channels) {
+          g_free (matrix);
+          g_return_if_reached ();
+        }
         for (in = 0; in < self->in_channels; in++) {
           const GValue *itm;
-          gdouble coefficient;
 
           itm = gst_value_array_get_value (row, in);
-          g_return_if_fail (G_VALUE_HOLDS_DOUBLE (itm));
-          coefficient = g_value_get_double (itm);
-          self->matrix[out * self->in_channels + in] = coefficient;
+          if (!G_VALUE_HOLDS_DOUBLE (itm)) {
+            g_free (matrix);
+            g_return_if_reached ();
+          }
+          matrix[out * self->in_channels + in] = g_value_get_double (itm);
         }
       }
-      gst_audio_mix_matrix_convert_s16_matrix (self);
-      gst_audio_mix_matrix_convert_s32_matrix (self);
+      GST_OBJECT_LOCK (self);
+      g_free (self->matrix);
+      self->matrix = matrix;
+      /* both conversions set shift_bytes, keep the one of the format that
+       * is being processed */
+      if (self->format == GST_AUDIO_FORMAT_S16LE ||
+          self->format == GST_AUDIO_FORMAT_S16BE) {
+        gst_audio_mix_matrix_convert_s32_matrix (self);
+        gst_audio_mix_matrix_convert_s16_matrix (self);
+      } else {
+        gst_audio_mix_matrix_convert_s16_matrix (self);
+        gst_audio_mix_matrix_convert_s32_matrix (self);
+      }
+      gst_audio_mix_matrix_update_taps (self);
+      GST_OBJECT_UNLOCK (self);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -395,6 +534,7 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       (element, transition);
 
   if (transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    GST_OBJECT_LOCK (self);
     if (self->s16_conv_matrix) {
       g_free (self->s16_conv_matrix);
       self->s16_conv_matrix = NULL;
@@ -404,22 +544,121 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       g_free (self->s32_conv_matrix);
       self->s32_conv_matrix = NULL;
     }
+
+    gst_audio_mix_matrix_clear_taps (self);
+    GST_OBJECT_UNLOCK (self);
   }
 
   return s;
 }
 
 
+/* Mixing loops. The dense ones accumulate one input sample into all the
+ * outputs at a time, so that the innermost loop walks contiguous memory
+ * without any dependency between iterations and can be vectorized. The
+ * sparse ones only visit the non-zero coefficients of each output. Integer
+ * results are clipped to the range of the sample format. */
+#define MIX_DENSE(type, acctype, coeffs, n, min, max) G_STMT_START {  \
+  const type *src = (const type *) inmap.data;                         \
+  type *dst = (type *) outmap.data;                                    \
+  acctype *acc = (acctype *) self->accumulator;                        \
+                                                                       \
+  for (sample = 0; sample < n_samples; sample++) {                     \
+    for (out = 0; out < outchannels; out++)                            \
+      acc[out] = 0;                                                    \
+    for (in = 0; in < inchannels; in++) {                              \
+      const acctype x = src[in];                                       \
+      const acctype *c = &coeffs[in * outchannels];                    \
+                                                                       \
+      for (out = 0; out < outchannels; out++)                          \
+        acc[out] += x * c[out];                                        \
+    }                                                                  \
+    for (out = 0; out < outchannels; out++)                            \
+      dst[out] = (type) CLAMP (acc[out] >> (n), min, max);             \
+    src += inchannels;                                                 \
+    dst += outchannels;                                                \
+  }                                                                    \
+} G_STMT_END
+
+#define MIX_DENSE_FLOAT(type, coeffs) G_STMT_START {                   \
+  const type *src = (const type *) inmap.data;                         \
+  type *dst = (type *) outmap.data;                                    \
+                                                                       \
+  for (sample = 0; sample < n_samples; sample++) {                     \
+    for (out = 0; out < outchannels; out++)                            \
+      dst[out] = 0;                                                    \
+    for (in = 0; in < inchannels; in++) {                              \
+      const type x = src[in];                                          \
+      const type *c = &coeffs[in * outchannels];                       \
+                                                                       \
+      for (out = 0; out < outchannels; out++)                          \
+        dst[out] += x * c[out];                                        \
+    }                                                                  \
+    src += inchannels;                                                 \
+    dst += outchannels;                                                \
+  }                                                                    \
+} G_STMT_END
+
+#define MIX_SPARSE(type, acctype, coeffs, n, min, max) G_STMT_START { \
+  const type *src = (const type *) inmap.data;                         \
+  type *dst = (type *) outmap.data;                                    \
+                                                                       \
+  for (sample = 0; sample < n_samples; sample++) {                     \
+    for (out = 0; out < outchannels; out++) {                          \
+      acctype outval = 0;                                              \
+                                                                       \
+      for (t = offsets[out]; t < offsets[out + 1]; t++)                \
+        outval += (acctype) src[tap_in[t]] * coeffs[t];                \
+      dst[out] = (type) CLAMP (outval >> (n), min, max);               \
+    }                                                                  \
+    src += inchannels;                                                 \
+    dst += outchannels;                                                \
+  }                                                                    \
+} G_STMT_END
+
+#define MIX_SPARSE_FLOAT(type, coeffs) G_STMT_START {                  \
+  const type *src = (const type *) inmap.data;                         \
+  type *dst = (type *) outmap.data;                                    \
+                                                                       \
+  for (sample = 0; sample < n_samples; sample++) {                     \
+    for (out = 0; out < outchannels; out++) {                          \
+      type outval = 0;                                                 \
+                                                                       \
+      for (t = offsets[out]; t < offsets[out + 1]; t++)                \
+        outval += src[tap_in[t]] * coeffs[t];                          \
+      dst[out] = outval;                                               \
+    }                                                                  \
+    src += inchannels;                                                 \
+    dst += outchannels;                                                \
+  }                                                                    \
+} G_STMT_END
+
+/* Pure routing: every output is a copy of one input or silence, the
+ * samples are moved as integers of the same size */
+#define ROUTE(type) G_STMT_START {                                     \
+  const type *src = (const type *) inmap.data;                         \
+  type *dst = (type *) outmap.data;                                    \
+                                                                       \
+  for (sample = 0; sample < n_samples; sample++) {                     \
+    for (out = 0; out < outchannels; out++) {                          \
+      t = offsets[out];                                                \
+      dst[out] = t < offsets[out + 1] ? src[tap_in[t]] : 0;            \
+    }                                                                  \
+    src += inchannels;                                                 \
+    dst += outchannels;                                                \
+  }                                                                    \
+} G_STMT_END
+
 static GstFlowReturn
 gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     GstBuffer * inbuf, GstBuffer * outbuf)
 {
   GstMapInfo inmap, outmap;
   GstAudioMixMatrix *self = GST_AUDIO_MIX_MATRIX (vfilter);
-  gint in, out, sample;
-  guint inchannels = self->in_channels;
-  guint outchannels = self->out_channels;
-  gdouble *matrix = self->matrix;
+  guint in, out, t, sample, n_samples, bps;
+  guint inchannels, outchannels;
+  const guint *offsets, *tap_in;
+  GstFlowReturn ret = GST_FLOW_OK;
 
   if (!gst_buffer_map (inbuf, &inmap, GST_MAP_READ)) {
     return GST_FLOW_ERROR;
@@ -429,107 +668,119 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     return GST_FLOW_ERROR;
   }
 
+  GST_OBJECT_LOCK (self);
+
+  inchannels = self->in_channels;
+  outchannels = self->out_channels;
+  offsets = self->tap_offsets;
+  tap_in = self->tap_in;
+
+  if (offsets == NULL) {
+    GST_OBJECT_UNLOCK (self);
+    gst_buffer_unmap (inbuf, &inmap);
+    gst_buffer_unmap (outbuf, &outmap);
+    GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS,
+        ("Erroneous matrix detected"), ("No transformation matrix set"));
+    return GST_FLOW_ERROR;
+  }
+
+  switch (self->format) {
+    case GST_AUDIO_FORMAT_F32LE:
+    case GST_AUDIO_FORMAT_F32BE:
+    case GST_AUDIO_FORMAT_S32LE:
+    case GST_AUDIO_FORMAT_S32BE:
+      bps = 4;
+      break;
+    case GST_AUDIO_FORMAT_F64LE:
+    case GST_AUDIO_FORMAT_F64BE:
+      bps = 8;
+      break;
+    case GST_AUDIO_FORMAT_S16LE:
+    case GST_AUDIO_FORMAT_S16BE:
+      bps = 2;
+      break;
+    default:
+      ret = GST_FLOW_NOT_SUPPORTED;
+      goto done;
+  }
+
+  n_samples = outmap.size / (bps * outchannels);
+  n_samples = MIN (n_samples, inmap.size / (bps * inchannels));
+
+  if (self->identity) {
+    memcpy (outmap.data, inmap.data, n_samples * bps * outchannels);
+    goto done;
+  }
+
+  if (self->routing) {
+    switch (bps) {
+      case 2:
+        ROUTE (guint16);
+        break;
+      case 4:
+        ROUTE (guint32);
+        break;
+      case 8:
+        ROUTE (guint64);
+        break;
+    }
+    goto done;
+  }
+
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
     case GST_AUDIO_FORMAT_F32BE:{
-      const gfloat *inarray;
-      gfloat *outarray;
-      guint n_samples = outmap.size / (sizeof (gfloat) * outchannels);
-
-      inarray = (gfloat *) inmap.data;
-      outarray = (gfloat *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gfloat outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
+      const gfloat *coeffs = self->tap_f32;
+
+      if (self->dense)
+        MIX_DENSE_FLOAT (gfloat, coeffs);
+      else
+        MIX_SPARSE_FLOAT (gfloat, coeffs);
       break;
     }
     case GST_AUDIO_FORMAT_F64LE:
     case GST_AUDIO_FORMAT_F64BE:{
-      const gdouble *inarray;
-      gdouble *outarray;
-      guint n_samples = outmap.size / (sizeof (gdouble) * outchannels);
-
-      inarray = (gdouble *) inmap.data;
-      outarray = (gdouble *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gdouble outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval +=
-                inarray[sample * inchannels +
-                in] * matrix[out * inchannels + in];
-          }
-          outarray[sample * outchannels + out] = outval;
-        }
-      }
+      const gdouble *coeffs = self->tap_f64;
+
+      if (self->dense)
+        MIX_DENSE_FLOAT (gdouble, coeffs);
+      else
+        MIX_SPARSE_FLOAT (gdouble, coeffs);
       break;
     }
     case GST_AUDIO_FORMAT_S16LE:
     case GST_AUDIO_FORMAT_S16BE:{
-      const gint16 *inarray;
-      gint16 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint16) * outchannels);
+      const gint32 *coeffs = self->tap_s16;
       guint n = self->shift_bytes;
-      gint32 *conv_matrix = self->s16_conv_matrix;
-
-      inarray = (gint16 *) inmap.data;
-      outarray = (gint16 *) outmap.data;
 
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint32 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint32) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint16) (outval >> n);
-        }
-      }
+      if (self->dense)
+        MIX_DENSE (gint16, gint32, coeffs, n, G_MININT16, G_MAXINT16);
+      else
+        MIX_SPARSE (gint16, gint32, coeffs, n, G_MININT16, G_MAXINT16);
       break;
     }
     case GST_AUDIO_FORMAT_S32LE:
     case GST_AUDIO_FORMAT_S32BE:{
-      const gint32 *inarray;
-      gint32 *outarray;
-      guint n_samples = outmap.size / (sizeof (gint32) * outchannels);
+      const gint64 *coeffs = self->tap_s32;
       guint n = self->shift_bytes;
-      gint64 *conv_matrix = self->s32_conv_matrix;
 
-      inarray = (gint32 *) inmap.data;
-      outarray = (gint32 *) outmap.data;
-
-      for (sample = 0; sample < n_samples; sample++) {
-        for (out = 0; out < outchannels; out++) {
-          gint64 outval = 0;
-          for (in = 0; in < inchannels; in++) {
-            outval += (gint64) (inarray[sample * inchannels + in] *
-                conv_matrix[out * inchannels + in]);
-          }
-          outarray[sample * outchannels + out] = (gint32) (outval >> n);
-        }
-      }
+      if (self->dense)
+        MIX_DENSE (gint32, gint64, coeffs, n, G_MININT32, G_MAXINT32);
+      else
+        MIX_SPARSE (gint32, gint64, coeffs, n, G_MININT32, G_MAXINT32);
       break;
     }
     default:
-      gst_buffer_unmap (inbuf, &inmap);
-      gst_buffer_unmap (outbuf, &outmap);
-      return GST_FLOW_NOT_SUPPORTED;
-
+      g_assert_not_reached ();
+      break;
   }
 
+done:
+  GST_OBJECT_UNLOCK (self);
+
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
-  return GST_FLOW_OK;
+  return ret;
 }
 
 static gboolean
@@ -559,6 +810,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
   if (!gst_audio_info_from_caps (&out_info, outcaps))
     return FALSE;
 
+  GST_OBJECT_LOCK (self);
   self->format = info.finfo->format;
 
   if (self->mode == GST_AUDIO_MIX_MATRIX_MODE_FIRST_CHANNELS) {
@@ -567,6 +819,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     self->in_channels = info.channels;
     self->out_channels = out_info.channels;
 
+    g_free (self->matrix);
     self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
 
     for (out = 0; out < self->out_channels; out++) {
@@ -576,6 +829,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     }
   } else if (!self->matrix || info.channels != self->in_channels ||
       out_info.channels != self->out_channels) {
+    GST_OBJECT_UNLOCK (self);
     GST_ELEMENT_ERROR (self, LIBRARY, SETTINGS,
         ("Erroneous matrix detected"),
         ("Please enter a matrix with the correct input and output channels"));
@@ -596,6 +850,9 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     default:
       break;
   }
+  gst_audio_mix_matrix_update_taps (self);
+  GST_OBJECT_UNLOCK (self);
+
   return TRUE;
 }
 
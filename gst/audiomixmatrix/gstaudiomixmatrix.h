@@ -62,6 +62,23 @@ struct _GstAudioMixMatrix
   gint64 *s32_conv_matrix;
   gint shift_bytes;
 
+  /* Coefficients rearranged for the mixing loops. In sparse mode the taps
+   * of output o are the non-zero coefficients tap_offsets[o] to
+   * tap_offsets[o + 1] - 1, read from input channel tap_in[t]. In dense mode
+   * the tap_* arrays hold the whole matrix indexed by in * out_channels + out
+   * and tap_in is not used */
+  guint *tap_offsets;
+  guint *tap_in;
+  gfloat *tap_f32;
+  gdouble *tap_f64;
+  gint32 *tap_s16;
+  gint64 *tap_s32;
+  gpointer accumulator;
+  gboolean dense;
+  /* every output is either silent or a copy of a single input */
+  gboolean routing;
+  gboolean identity;
+
   GstAudioFormat format;
 };
 
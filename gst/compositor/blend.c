@@ -568,13 +568,13 @@ blend_##format_name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
   } \
   \
   /* adjust width/height if the src is bigger than dest */ \
-  if (xpos + src_width > dest_width) { \
+  if (xpos + b_src_width > dest_width) { \
     b_src_width = dest_width - xpos; \
   } \
-  if (ypos + src_height > dest_height) { \
+  if (ypos + b_src_height > dest_height) { \
     b_src_height = dest_height - ypos; \
   } \
-  if (b_src_width < 0 || b_src_height < 0) { \
+  if (b_src_width <= 0 || b_src_height <= 0) { \
     return; \
   } \
   \
@@ -734,6 +734,10 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_height = dest_height - ypos; \
   } \
   \
+  if (src_width <= 0 || src_height <= 0) { \
+    return; \
+  } \
+  \
   dest = dest + bpp * xpos + (ypos * dest_stride); \
   \
   /* in source mode we just have to copy over things */ \
@@ -909,6 +913,10 @@ blend_##name (GstVideoFrame * srcframe, gint xpos, gint ypos, \
     src_height = dest_height - ypos; \
   } \
   \
+  if (src_width <= 0 || src_height <= 0) { \
+    return; \
+  } \
+  \
   dest = dest + 2 * xpos + (ypos * dest_stride); \
   \
   /* in source mode we just have to copy over things */ \
@@ -309,6 +309,125 @@ clamp_rectangle (gint x, gint y, gint w, gint h, gint outer_width,
   return clamped;
 }
 
+/* The blend functions round the position up to the chroma subsampling of the
+ * output format, so this returns the area of the output that is actually
+ * written when blending a frame of the given size at xpos/ypos */
+static GstVideoRectangle
+blend_rectangle (GstVideoInfo * out_info, gint xpos, gint ypos, gint width,
+    gint height)
+{
+  const GstVideoFormatInfo *finfo = out_info->finfo;
+  gint x_align = 1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, 1);
+  gint y_align = 1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, 1);
+
+  return clamp_rectangle (GST_ROUND_UP_N (xpos, x_align),
+      GST_ROUND_UP_N (ypos, y_align), width, height,
+      GST_VIDEO_INFO_WIDTH (out_info), GST_VIDEO_INFO_HEIGHT (out_info));
+}
+
+static GstVideoRectangle
+intersect_rectangles (GstVideoRectangle rect1, GstVideoRectangle rect2)
+{
+  GstVideoRectangle ret;
+
+  ret.x = MAX (rect1.x, rect2.x);
+  ret.y = MAX (rect1.y, rect2.y);
+  ret.w = MAX (MIN (rect1.x + rect1.w, rect2.x + rect2.w) - ret.x, 0);
+  ret.h = MAX (MIN (rect1.y + rect1.h, rect2.y + rect2.h) - ret.y, 0);
+
+  return ret;
+}
+
+/* Test whether the union of the occluders contains rect (geometrically).
+ * The parts of rect that are not covered yet are kept as a list of disjoint
+ * rectangles, from which each occluder is subtracted in turn */
+static gboolean
+is_rectangle_covered (GstVideoRectangle rect,
+    const GstVideoRectangle * occluders, guint n_occluders)
+{
+  GArray *pieces, *remaining, *tmp;
+  gboolean covered;
+  guint i, j;
+
+  if (rect.w <= 0 || rect.h <= 0)
+    return TRUE;
+
+  pieces = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  remaining = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  g_array_append_val (pieces, rect);
+
+  for (i = 0; i < n_occluders && pieces->len > 0; i++) {
+    GstVideoRectangle occluder = occluders[i];
+
+    g_array_set_size (remaining, 0);
+    for (j = 0; j < pieces->len; j++) {
+      GstVideoRectangle piece = g_array_index (pieces, GstVideoRectangle, j);
+      GstVideoRectangle inter, part;
+
+      if (is_rectangle_contained (piece, occluder))
+        continue;
+
+      inter = intersect_rectangles (piece, occluder);
+      if (inter.w == 0 || inter.h == 0) {
+        g_array_append_val (remaining, piece);
+        continue;
+      }
+
+      /* Keep the parts above, below, left and right of the intersection */
+      if (inter.y > piece.y) {
+        part.x = piece.x;
+        part.y = piece.y;
+        part.w = piece.w;
+        part.h = inter.y - piece.y;
+        g_array_append_val (remaining, part);
+      }
+      if (inter.y + inter.h < piece.y + piece.h) {
+        part.x = piece.x;
+        part.y = inter.y + inter.h;
+        part.w = piece.w;
+        part.h = piece.y + piece.h - part.y;
+        g_array_append_val (remaining, part);
+      }
+      if (inter.x > piece.x) {
+        part.x = piece.x;
+        part.y = inter.y;
+        part.w = inter.x - piece.x;
+        part.h = inter.h;
+        g_array_append_val (remaining, part);
+      }
+      if (inter.x + inter.w < piece.x + piece.w) {
+        part.x = inter.x + inter.w;
+        part.y = inter.y;
+        part.w = piece.x + piece.w - part.x;
+        part.h = inter.h;
+        g_array_append_val (remaining, part);
+      }
+    }
+
+    tmp = pieces;
+    pieces = remaining;
+    remaining = tmp;
+  }
+
+  covered = (pieces->len == 0);
+
+  g_array_free (pieces, TRUE);
+  g_array_free (remaining, TRUE);
+
+  return covered;
+}
+
+/* Whether blending this pad replaces whatever is below it. Must be called
+ * with the OBJECT_LOCK of the aggregator held */
+static gboolean
+gst_compositor_pad_is_opaque (GstCompositorPad * cpad)
+{
+  GstVideoAggregatorPad *pad = GST_VIDEO_AGGREGATOR_PAD (cpad);
+
+  return cpad->alpha == 1.0 && cpad->op != COMPOSITOR_OPERATOR_ADD
+      && !GST_VIDEO_INFO_HAS_ALPHA (&pad->info);
+}
+
 static gboolean
 gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstVideoAggregator * vagg, GstBuffer * buffer,
@@ -318,6 +437,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
   gint width, height;
   gboolean frame_obscured = FALSE;
+  GstVideoRectangle *occluders;
+  guint n_occluders = 0;
   GList *l;
   /* The rectangle representing this frame, clamped to the video's boundaries.
    * Due to the clamping, this is different from the frame width/height above. */
@@ -343,8 +464,8 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     goto done;
   }
 
-  frame_rect = clamp_rectangle (cpad->xpos, cpad->ypos, width, height,
-      GST_VIDEO_INFO_WIDTH (&vagg->info), GST_VIDEO_INFO_HEIGHT (&vagg->info));
+  frame_rect = blend_rectangle (&vagg->info, cpad->xpos, cpad->ypos, width,
+      height);
 
   if (frame_rect.w == 0 || frame_rect.h == 0) {
     GST_DEBUG_OBJECT (pad, "Resulting frame is zero-width or zero-height "
@@ -353,9 +474,9 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
   }
 
   GST_OBJECT_LOCK (vagg);
-  /* Check if this frame is obscured by a higher-zorder frame
-   * TODO: Also skip a frame if it's obscured by a combination of
-   * higher-zorder frames */
+  /* Check if this frame is obscured by a higher-zorder frame or by a
+   * combination of them */
+  occluders = g_newa (GstVideoRectangle, GST_ELEMENT (vagg)->numsinkpads);
   l = g_list_find (GST_ELEMENT (vagg)->sinkpads, pad)->next;
   for (; l; l = l->next) {
     GstVideoRectangle frame2_rect;
@@ -363,22 +484,21 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
     GstCompositorPad *cpad2 = GST_COMPOSITOR_PAD (pad2);
     gint pad2_width, pad2_height;
 
+    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
+     * channel, then check opacity */
+    if (!gst_video_aggregator_pad_has_current_buffer (pad2)
+        || !gst_compositor_pad_is_opaque (cpad2))
+      continue;
+
     _mixer_pad_get_output_size (comp, cpad2, GST_VIDEO_INFO_PAR_N (&vagg->info),
         GST_VIDEO_INFO_PAR_D (&vagg->info), &pad2_width, &pad2_height);
 
-    /* We don't need to clamp the coords of the second rectangle */
-    frame2_rect.x = cpad2->xpos;
-    frame2_rect.y = cpad2->ypos;
     /* This is effectively what set_info and the above conversion
      * code do to calculate the desired width/height */
-    frame2_rect.w = pad2_width;
-    frame2_rect.h = pad2_height;
+    frame2_rect = blend_rectangle (&vagg->info, cpad2->xpos, cpad2->ypos,
+        pad2_width, pad2_height);
 
-    /* Check if there's a buffer to be aggregated, ensure it can't have an alpha
-     * channel, then check opacity and frame boundaries */
-    if (gst_video_aggregator_pad_has_current_buffer (pad2)
-        && cpad2->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad2->info)
-        && is_rectangle_contained (frame_rect, frame2_rect)) {
+    if (is_rectangle_contained (frame_rect, frame2_rect)) {
       frame_obscured = TRUE;
       GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %s %ix%i@(%i,%i) "
           "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
@@ -388,6 +508,18 @@ gst_compositor_pad_prepare_frame (GstVideoAggregatorPad * pad,
           GST_VIDEO_INFO_HEIGHT (&vagg->info));
       break;
     }
+
+    occluders[n_occluders++] = frame2_rect;
+  }
+
+  if (!frame_obscured && n_occluders > 1
+      && is_rectangle_covered (frame_rect, occluders, n_occluders)) {
+    frame_obscured = TRUE;
+    GST_DEBUG_OBJECT (pad, "%ix%i@(%i,%i) obscured by %u higher-zorder frames "
+        "in output of size %ix%i; skipping frame", frame_rect.w, frame_rect.h,
+        frame_rect.x, frame_rect.y, n_occluders,
+        GST_VIDEO_INFO_WIDTH (&vagg->info),
+        GST_VIDEO_INFO_HEIGHT (&vagg->info));
   }
   GST_OBJECT_UNLOCK (vagg);
 
@@ -447,6 +579,30 @@ gst_compositor_pad_create_conversion_info (GstVideoAggregatorConvertPad * pad,
   }
 }
 
+/* Any property change can modify the way the frames of this pad end up in
+ * the output, e.g. a new converter-config, so make sure the area covered by
+ * the pad is composited again */
+static void
+gst_compositor_pad_notify (GObject * object, GParamSpec * pspec)
+{
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (object);
+
+  cpad->needs_redraw = TRUE;
+
+  if (G_OBJECT_CLASS (gst_compositor_pad_parent_class)->notify)
+    G_OBJECT_CLASS (gst_compositor_pad_parent_class)->notify (object, pspec);
+}
+
+static void
+gst_compositor_pad_finalize (GObject * object)
+{
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (object);
+
+  gst_buffer_replace (&cpad->last_buffer, NULL);
+
+  G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -458,6 +614,8 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 
   gobject_class->set_property = gst_compositor_pad_set_property;
   gobject_class->get_property = gst_compositor_pad_get_property;
+  gobject_class->notify = gst_compositor_pad_notify;
+  gobject_class->finalize = gst_compositor_pad_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
       g_param_spec_int ("xpos", "X Position", "X Position of the picture",
@@ -499,17 +657,27 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
   compo_pad->ypos = DEFAULT_PAD_YPOS;
   compo_pad->alpha = DEFAULT_PAD_ALPHA;
   compo_pad->op = DEFAULT_PAD_OPERATOR;
+  compo_pad->last_buffer = NULL;
+  compo_pad->needs_redraw = TRUE;
 }
 
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_MAX_THREADS 1
+#define DEFAULT_MAX_PREPARE_THREADS 1
+#define DEFAULT_INCREMENTAL FALSE
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_MAX_THREADS,
+  PROP_MAX_PREPARE_THREADS,
+  PROP_INCREMENTAL,
 };
 
+static void gst_compositor_reset_damage (GstCompositor * self);
+
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
 static GType
 gst_compositor_background_get_type (void)
@@ -543,6 +711,21 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_PREPARE_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_prepare_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_INCREMENTAL:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->incremental);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -557,7 +740,25 @@ gst_compositor_set_property (GObject * object,
 
   switch (prop_id) {
     case PROP_BACKGROUND:
+      GST_OBJECT_LOCK (self);
       self->background = g_value_get_enum (value);
+      gst_compositor_reset_damage (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->max_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_PREPARE_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->max_prepare_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_INCREMENTAL:
+      GST_OBJECT_LOCK (self);
+      self->incremental = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -826,27 +1027,175 @@ _negotiated_caps (GstAggregator * agg, GstCaps * caps)
     return FALSE;
   }
 
+  GST_OBJECT_LOCK (agg);
+  gst_compositor_reset_damage (GST_COMPOSITOR (agg));
+  GST_OBJECT_UNLOCK (agg);
+
   return GST_AGGREGATOR_CLASS (parent_class)->negotiated_src_caps (agg, caps);
 }
 
-static GstFlowReturn
-gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+/* Output frames are split into horizontal stripes whose height is a multiple
+ * of this, so that the 16 line period of the checker pattern and the vertical
+ * chroma subsampling of all supported formats stay aligned with the
+ * full-frame case and the output is bit-exact with single-threaded blending */
+#define STRIPE_ALIGN 16
+
+typedef struct
 {
-  GList *l;
-  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gdouble alpha;
+  GstCompositorBlendMode blend_mode;
+
+  /* area of the output written by this input */
+  GstVideoRectangle rect;
+  gboolean opaque;
+} CompositorBlendInput;
+
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  /* if set, the stripe is unchanged and copied from this frame */
+  GstVideoFrame *prevframe;
   BlendFunction composite;
-  GstVideoFrame out_frame, *outframe;
+  CompositorBlendInput *inputs;
+  guint n_inputs;
+  gint y_start, y_end;
+} CompositorStripe;
 
-  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
-    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
-    return GST_FLOW_ERROR;
+/* Forget about the previous output frame so that the next one is composited
+ * completely. Must be called with the OBJECT_LOCK held */
+static void
+gst_compositor_reset_damage (GstCompositor * self)
+{
+  GList *l;
+
+  gst_buffer_replace (&self->last_outbuf, NULL);
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next) {
+    GstCompositorPad *cpad = l->data;
+
+    cpad->last_drawn = FALSE;
+    gst_buffer_replace (&cpad->last_buffer, NULL);
   }
+}
 
-  outframe = &out_frame;
-  /* default to blending */
-  composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
-   * don't bother drawing the background at all. */
+/* Whether both buffers share the same memory, in which case the frames
+ * prepared from them are the same too. This is the case for e.g. the
+ * repeated buffers of imagefreeze */
+static gboolean
+gst_compositor_buffer_content_equal (GstBuffer * buf1, GstBuffer * buf2)
+{
+  guint i, n;
+
+  if (buf1 == buf2)
+    return TRUE;
+  if (buf1 == NULL || buf2 == NULL)
+    return FALSE;
+
+  n = gst_buffer_n_memory (buf1);
+  if (n != gst_buffer_n_memory (buf2))
+    return FALSE;
+
+  for (i = 0; i < n; i++) {
+    if (gst_buffer_peek_memory (buf1, i) != gst_buffer_peek_memory (buf2, i))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+mark_damage (gboolean * dirty, guint n_blocks, GstVideoRectangle rect)
+{
+  guint i;
+
+  if (rect.w <= 0 || rect.h <= 0)
+    return;
+
+  for (i = rect.y / STRIPE_ALIGN;
+      i <= (rect.y + rect.h - 1) / STRIPE_ALIGN && i < n_blocks; i++)
+    dirty[i] = TRUE;
+}
+
+/* Compare the state of all pads with the one they had when the previous
+ * output frame was composited and mark the blocks of STRIPE_ALIGN lines of
+ * the output that have to be composited again in @dirty. If @dirty is NULL
+ * only the current state is remembered. Must be called with the OBJECT_LOCK
+ * held */
+static void
+gst_compositor_update_damage (GstCompositor * self, gboolean * dirty,
+    guint n_blocks)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (self);
+  gboolean full_redraw;
+  guint index = 0;
+  GList *l;
+
+  /* Pads added, removed or reordered */
+  full_redraw = GST_ELEMENT (self)->numsinkpads != self->last_n_pads;
+  self->last_n_pads = GST_ELEMENT (self)->numsinkpads;
+
+  for (l = GST_ELEMENT (self)->sinkpads; l; l = l->next, index++) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *cpad = l->data;
+    GstVideoFrame *frame = gst_video_aggregator_pad_get_prepared_frame (pad);
+    GstBuffer *buffer = NULL;
+    GstVideoRectangle rect = { 0, };
+    gint width = 0, height = 0;
+
+    if (frame) {
+      buffer = gst_video_aggregator_pad_get_current_buffer (pad);
+      width = GST_VIDEO_FRAME_WIDTH (frame);
+      height = GST_VIDEO_FRAME_HEIGHT (frame);
+      rect = blend_rectangle (&vagg->info, cpad->xpos, cpad->ypos, width,
+          height);
+    }
+
+    if (cpad->last_index != index)
+      full_redraw = TRUE;
+
+    if (dirty && !full_redraw && (frame || cpad->last_drawn)) {
+      if (!frame || !cpad->last_drawn || cpad->needs_redraw
+          || cpad->xpos != cpad->last_xpos || cpad->ypos != cpad->last_ypos
+          || width != cpad->last_width || height != cpad->last_height
+          || cpad->alpha != cpad->last_alpha || cpad->op != cpad->last_op
+          || !gst_compositor_buffer_content_equal (buffer,
+              cpad->last_buffer)) {
+        GST_LOG_OBJECT (cpad, "changed, damaging %ix%i@(%i,%i) and "
+            "%ix%i@(%i,%i)", cpad->last_rect.w, cpad->last_rect.h,
+            cpad->last_rect.x, cpad->last_rect.y, rect.w, rect.h, rect.x,
+            rect.y);
+        if (cpad->last_drawn)
+          mark_damage (dirty, n_blocks, cpad->last_rect);
+        mark_damage (dirty, n_blocks, rect);
+      }
+    }
+
+    cpad->last_drawn = frame != NULL;
+    cpad->last_index = index;
+    cpad->last_xpos = cpad->xpos;
+    cpad->last_ypos = cpad->ypos;
+    cpad->last_width = width;
+    cpad->last_height = height;
+    cpad->last_alpha = cpad->alpha;
+    cpad->last_op = cpad->op;
+    cpad->last_rect = rect;
+    cpad->needs_redraw = FALSE;
+    gst_buffer_replace (&cpad->last_buffer, buffer);
+  }
+
+  if (dirty && full_redraw) {
+    GST_DEBUG_OBJECT (self, "Pads changed, compositing the whole frame");
+    for (index = 0; index < n_blocks; index++)
+      dirty[index] = TRUE;
+  }
+}
+
+static void
+gst_compositor_fill_background (GstCompositor * self, GstVideoFrame * outframe)
+{
   switch (self->background) {
     case COMPOSITOR_BACKGROUND_CHECKER:
       self->fill_checker (outframe);
@@ -876,13 +1225,138 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
           pdata += plane_stride;
         }
       }
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
       break;
     }
   }
+}
+
+/* Make @stripe a view on the lines [y_start, y_end) of @frame. The blend and
+ * fill functions only look at the frame info and plane pointers, so this is
+ * enough for them to operate on the stripe as if it was a full frame */
+static void
+gst_compositor_stripe_frame (GstVideoFrame * frame, gint y_start, gint y_end,
+    GstVideoFrame * stripe)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint plane, comp;
+
+  *stripe = *frame;
+  GST_VIDEO_INFO_HEIGHT (&stripe->info) = y_end - y_start;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+    for (comp = 0; comp < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); comp++) {
+      if (GST_VIDEO_FORMAT_INFO_PLANE (finfo, comp) == plane)
+        break;
+    }
+
+    stripe->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, comp, y_start) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+  }
+}
+
+static void
+gst_compositor_blend_stripe (CompositorStripe * stripe)
+{
+  GstVideoFrame frame;
+  GstVideoRectangle stripe_rect;
+  GstVideoRectangle *occluders;
+  gboolean *visible;
+  guint n_occluders = 0;
+  guint i;
+
+  gst_compositor_stripe_frame (stripe->outframe, stripe->y_start,
+      stripe->y_end, &frame);
+
+  if (stripe->prevframe) {
+    GstVideoFrame prev;
+
+    gst_compositor_stripe_frame (stripe->prevframe, stripe->y_start,
+        stripe->y_end, &prev);
+    gst_video_frame_copy (&frame, &prev);
+    return;
+  }
+
+  stripe_rect.x = 0;
+  stripe_rect.y = stripe->y_start;
+  stripe_rect.w = GST_VIDEO_FRAME_WIDTH (&frame);
+  stripe_rect.h = stripe->y_end - stripe->y_start;
+
+  /* Visibility pass: walk the inputs from the highest zorder down and skip
+   * everything that is completely hidden behind opaque inputs above it,
+   * including the background */
+  occluders = g_newa (GstVideoRectangle, stripe->n_inputs);
+  visible = g_newa (gboolean, stripe->n_inputs);
+  for (i = stripe->n_inputs; i > 0; i--) {
+    CompositorBlendInput *input = &stripe->inputs[i - 1];
+    GstVideoRectangle rect = intersect_rectangles (input->rect, stripe_rect);
+
+    visible[i - 1] = rect.w > 0 && rect.h > 0
+        && !is_rectangle_covered (rect, occluders, n_occluders);
+    if (visible[i - 1] && input->opaque)
+      occluders[n_occluders++] = rect;
+  }
+
+  if (!is_rectangle_covered (stripe_rect, occluders, n_occluders))
+    gst_compositor_fill_background (stripe->self, &frame);
+  else
+    GST_LOG_OBJECT (stripe->self, "Background of lines %d-%d is obscured",
+        stripe->y_start, stripe->y_end);
+
+  for (i = 0; i < stripe->n_inputs; i++) {
+    CompositorBlendInput *input = &stripe->inputs[i];
+
+    if (!visible[i])
+      continue;
+
+    stripe->composite (input->frame, input->xpos,
+        input->ypos - stripe->y_start, input->alpha, &frame,
+        input->blend_mode);
+  }
+}
+
+static void
+gst_compositor_blend_stripe_func (gpointer data, gpointer user_data)
+{
+  GstCompositor *self = user_data;
+
+  gst_compositor_blend_stripe (data);
+
+  g_mutex_lock (&self->blend_lock);
+  self->blend_pending--;
+  if (self->blend_pending == 0)
+    g_cond_signal (&self->blend_cond);
+  g_mutex_unlock (&self->blend_lock);
+}
+
+static GstFlowReturn
+gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
+{
+  GList *l;
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  BlendFunction composite;
+  GstVideoFrame out_frame, *outframe;
+  GstVideoFrame prev_frame, *prevframe = NULL;
+  CompositorBlendInput *inputs;
+  CompositorStripe *stripes;
+  guint n_inputs = 0, n_threads, n_workers, n_stripes, n_blocks, i;
+  gint height, stripe_height;
+  gboolean *dirty;
+
+  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
+    GST_WARNING_OBJECT (vagg, "Could not map output buffer");
+    return GST_FLOW_ERROR;
+  }
+
+  outframe = &out_frame;
+  /* default to blending, use overlay to keep background transparent */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+  else
+    composite = self->blend;
 
   GST_OBJECT_LOCK (vagg);
+  inputs = g_newa (CompositorBlendInput, GST_ELEMENT (vagg)->numsinkpads);
   for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
     GstVideoAggregatorPad *pad = l->data;
     GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
@@ -906,11 +1380,103 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
     }
 
     if (prepared_frame != NULL) {
-      composite (prepared_frame,
-          compo_pad->xpos,
-          compo_pad->ypos, compo_pad->alpha, outframe, blend_mode);
+      inputs[n_inputs].frame = prepared_frame;
+      inputs[n_inputs].xpos = compo_pad->xpos;
+      inputs[n_inputs].ypos = compo_pad->ypos;
+      inputs[n_inputs].alpha = compo_pad->alpha;
+      inputs[n_inputs].blend_mode = blend_mode;
+      inputs[n_inputs].rect = blend_rectangle (&vagg->info, compo_pad->xpos,
+          compo_pad->ypos, GST_VIDEO_FRAME_WIDTH (prepared_frame),
+          GST_VIDEO_FRAME_HEIGHT (prepared_frame));
+      inputs[n_inputs].opaque = gst_compositor_pad_is_opaque (compo_pad);
+      n_inputs++;
     }
   }
+
+  n_threads = self->max_threads;
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  height = GST_VIDEO_FRAME_HEIGHT (outframe);
+  stripe_height = GST_ROUND_UP_N ((height + n_threads - 1) / n_threads,
+      STRIPE_ALIGN);
+
+  /* With incremental compositing, only the blocks of lines touched by pads
+   * that changed since the previous output frame are composited again, and
+   * everything else is copied over from the previous output frame */
+  n_blocks = (height + STRIPE_ALIGN - 1) / STRIPE_ALIGN;
+  dirty = g_newa (gboolean, n_blocks);
+  for (i = 0; i < n_blocks; i++)
+    dirty[i] = TRUE;
+
+  if (self->incremental) {
+    if (self->last_outbuf && gst_video_frame_map (&prev_frame, &vagg->info,
+            self->last_outbuf, GST_MAP_READ)) {
+      prevframe = &prev_frame;
+      memset (dirty, 0, n_blocks * sizeof (gboolean));
+    }
+    gst_compositor_update_damage (self, prevframe ? dirty : NULL, n_blocks);
+  } else if (self->last_outbuf) {
+    gst_compositor_reset_damage (self);
+  }
+
+  /* Split the frame into stripes of at most stripe_height lines that are
+   * either completely composited again or completely copied */
+  stripes = g_newa (CompositorStripe, n_blocks);
+  n_stripes = 0;
+  for (i = 0; i < n_blocks; i++) {
+    CompositorStripe *stripe = n_stripes > 0 ? &stripes[n_stripes - 1] : NULL;
+
+    if (stripe && dirty[i] == (stripe->prevframe == NULL)
+        && stripe->y_end - stripe->y_start < stripe_height) {
+      stripe->y_end = MIN ((i + 1) * STRIPE_ALIGN, height);
+      continue;
+    }
+
+    stripe = &stripes[n_stripes++];
+    stripe->self = self;
+    stripe->outframe = outframe;
+    stripe->prevframe = dirty[i] ? NULL : prevframe;
+    stripe->composite = composite;
+    stripe->inputs = inputs;
+    stripe->n_inputs = n_inputs;
+    stripe->y_start = i * STRIPE_ALIGN;
+    stripe->y_end = MIN ((i + 1) * STRIPE_ALIGN, height);
+  }
+
+  n_workers = MIN (n_threads, n_stripes);
+  n_workers = n_workers > 0 ? n_workers - 1 : 0;
+
+  if (n_workers > 0) {
+    if (!self->blend_pool) {
+      self->blend_pool = g_thread_pool_new (gst_compositor_blend_stripe_func,
+          self, n_workers, FALSE, NULL);
+    } else if (g_thread_pool_get_max_threads (self->blend_pool) != n_workers) {
+      g_thread_pool_set_max_threads (self->blend_pool, n_workers, NULL);
+    }
+
+    self->blend_pending = n_stripes - 1;
+    for (i = 1; i < n_stripes; i++)
+      g_thread_pool_push (self->blend_pool, &stripes[i], NULL);
+
+    /* Blend the first stripe from the aggregator thread and wait for the
+     * workers to finish the others */
+    gst_compositor_blend_stripe (&stripes[0]);
+
+    g_mutex_lock (&self->blend_lock);
+    while (self->blend_pending > 0)
+      g_cond_wait (&self->blend_cond, &self->blend_lock);
+    g_mutex_unlock (&self->blend_lock);
+  } else {
+    for (i = 0; i < n_stripes; i++)
+      gst_compositor_blend_stripe (&stripes[i]);
+  }
+
+  if (prevframe)
+    gst_video_frame_unmap (prevframe);
+
+  if (self->incremental)
+    gst_buffer_replace (&self->last_outbuf, outbuf);
   GST_OBJECT_UNLOCK (vagg);
 
   gst_video_frame_unmap (outframe);
@@ -918,6 +1484,69 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   return GST_FLOW_OK;
 }
 
+/* prepare_frame() of the compositor pads only reads the other pads with the
+ * OBJECT_LOCK held and converts into their own buffer, so different pads
+ * can be prepared concurrently */
+static guint
+gst_compositor_get_prepare_threads (GstVideoAggregator * vagg)
+{
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  guint n_threads;
+
+  GST_OBJECT_LOCK (self);
+  n_threads = self->max_prepare_threads;
+  GST_OBJECT_UNLOCK (self);
+
+  return n_threads;
+}
+
+/* Called with the OBJECT_LOCK held */
+static gboolean
+gst_compositor_can_passthrough (GstVideoAggregator * vagg,
+    GstVideoAggregatorPad * pad)
+{
+  GstCompositor *self = GST_COMPOSITOR (vagg);
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+  gint width, height;
+  GList *l;
+
+  /* The frame has to be copied as is and unscaled over the whole output */
+  if (cpad->xpos != 0 || cpad->ypos != 0 || cpad->alpha != 1.0)
+    return FALSE;
+
+  if (cpad->op != COMPOSITOR_OPERATOR_SOURCE
+      && !gst_compositor_pad_is_opaque (cpad))
+    return FALSE;
+
+  _mixer_pad_get_output_size (self, cpad, GST_VIDEO_INFO_PAR_N (&vagg->info),
+      GST_VIDEO_INFO_PAR_D (&vagg->info), &width, &height);
+  if (width != GST_VIDEO_INFO_WIDTH (&vagg->info)
+      || height != GST_VIDEO_INFO_HEIGHT (&vagg->info))
+    return FALSE;
+
+  /* and nothing may be drawn on top of it */
+  l = g_list_find (GST_ELEMENT (vagg)->sinkpads, pad)->next;
+  for (; l; l = l->next) {
+    GstVideoAggregatorPad *pad2 = l->data;
+    GstCompositorPad *cpad2 = GST_COMPOSITOR_PAD (pad2);
+    GstVideoRectangle rect;
+
+    if (!gst_video_aggregator_pad_has_current_buffer (pad2)
+        || cpad2->alpha == 0.0)
+      continue;
+
+    _mixer_pad_get_output_size (self, cpad2,
+        GST_VIDEO_INFO_PAR_N (&vagg->info), GST_VIDEO_INFO_PAR_D (&vagg->info),
+        &width, &height);
+    rect = blend_rectangle (&vagg->info, cpad2->xpos, cpad2->ypos, width,
+        height);
+    if (rect.w > 0 && rect.h > 0)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 static GstPad *
 gst_compositor_request_new_pad (GstElement * element, GstPadTemplate * templ,
     const gchar * req_name, const GstCaps * caps)
@@ -955,6 +1584,11 @@ gst_compositor_release_pad (GstElement * element, GstPad * pad)
   gst_child_proxy_child_removed (GST_CHILD_PROXY (compositor), G_OBJECT (pad),
       GST_OBJECT_NAME (pad));
 
+  /* The area that was covered by the pad has to be composited again */
+  GST_OBJECT_LOCK (compositor);
+  gst_compositor_reset_damage (compositor);
+  GST_OBJECT_UNLOCK (compositor);
+
   GST_ELEMENT_CLASS (parent_class)->release_pad (element, pad);
 }
 
@@ -1000,6 +1634,33 @@ _sink_query (GstAggregator * agg, GstAggregatorPad * bpad, GstQuery * query)
   }
 }
 
+static gboolean
+_stop (GstAggregator * agg)
+{
+  GST_OBJECT_LOCK (agg);
+  gst_compositor_reset_damage (GST_COMPOSITOR (agg));
+  GST_OBJECT_UNLOCK (agg);
+
+  return GST_AGGREGATOR_CLASS (parent_class)->stop (agg);
+}
+
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  gst_buffer_replace (&self->last_outbuf, NULL);
+
+  if (self->blend_pool)
+    g_thread_pool_free (self->blend_pool, FALSE, TRUE);
+  self->blend_pool = NULL;
+
+  g_mutex_clear (&self->blend_lock);
+  g_cond_clear (&self->blend_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 /* GObject boilerplate */
 static void
 gst_compositor_class_init (GstCompositorClass * klass)
@@ -1012,6 +1673,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_compositor_request_new_pad);
@@ -1020,13 +1682,69 @@ gst_compositor_class_init (GstCompositorClass * klass)
   agg_class->sink_query = _sink_query;
   agg_class->fixate_src_caps = _fixate_caps;
   agg_class->negotiated_src_caps = _negotiated_caps;
+  agg_class->stop = _stop;
   videoaggregator_class->aggregate_frames = gst_compositor_aggregate_frames;
+  videoaggregator_class->can_passthrough = gst_compositor_can_passthrough;
+  videoaggregator_class->get_prepare_threads =
+      gst_compositor_get_prepare_threads;
 
   g_object_class_install_property (gobject_class, PROP_BACKGROUND,
       g_param_spec_enum ("background", "Background", "Background type",
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:max-threads:
+   *
+   * Maximum number of threads used for blending. The output frame is split
+   * into horizontal stripes that are filled and blended in parallel.
+   * 0 means one thread per processor.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_uint ("max-threads", "Maximum Threads",
+          "Maximum number of blending threads (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:max-prepare-threads:
+   *
+   * Maximum number of threads used to convert and scale the frames of
+   * different pads concurrently before blending them. 0 means one thread
+   * per processor.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_PREPARE_THREADS,
+      g_param_spec_uint ("max-prepare-threads", "Maximum prepare threads",
+          "Maximum number of threads used to convert the pads' frames "
+          "(0 = number of processors)", 0, G_MAXINT,
+          DEFAULT_MAX_PREPARE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstCompositor:incremental:
+   *
+   * Only composite again the parts of the output frame that are affected by
+   * pads that changed since the previous output frame, i.e. pads that got a
+   * buffer with new memory, or were moved, resized, reordered or had their
+   * alpha or operator changed. Everything else is copied over from the
+   * previous output frame. This saves a lot of memory bandwidth for layouts
+   * with mostly static layers, e.g. logos from imagefreeze.
+   *
+   * The previous output frame is kept around for this, so the output buffer
+   * pool needs to have one buffer more available.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_INCREMENTAL,
+      g_param_spec_boolean ("incremental", "Incremental",
+          "Only composite the parts of the output that changed since the "
+          "previous frame", DEFAULT_INCREMENTAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &src_factory, GST_TYPE_AGGREGATOR_PAD);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
@@ -1043,6 +1761,12 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  self->max_threads = DEFAULT_MAX_THREADS;
+  self->max_prepare_threads = DEFAULT_MAX_PREPARE_THREADS;
+  self->incremental = DEFAULT_INCREMENTAL;
+
+  g_mutex_init (&self->blend_lock);
+  g_cond_init (&self->blend_cond);
 }
 
 /* GstChildProxy implementation */
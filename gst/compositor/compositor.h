@@ -107,6 +107,21 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* slice-parallel blending */
+  guint max_threads;
+  GThreadPool *blend_pool;
+  GMutex blend_lock;
+  GCond blend_cond;
+  guint blend_pending;
+
+  /* concurrent conversion of the pads */
+  guint max_prepare_threads;
+
+  /* incremental compositing */
+  gboolean incremental;
+  GstBuffer *last_outbuf;
+  guint last_n_pads;
 };
 
 struct _GstCompositorClass
@@ -129,6 +144,17 @@ struct _GstCompositorPad
   gdouble alpha;
 
   GstCompositorOperator op;
+
+  /* state of the pad when the previous output frame was composited */
+  gboolean last_drawn;
+  guint last_index;
+  gint last_xpos, last_ypos;
+  gint last_width, last_height;
+  gdouble last_alpha;
+  GstCompositorOperator last_op;
+  GstVideoRectangle last_rect;
+  GstBuffer *last_buffer;
+  gboolean needs_redraw;
 };
 
 struct _GstCompositorPadClass
@@ -269,6 +269,11 @@ gst_inter_audio_src_set_caps (GstBaseSrc * src, GstCaps * caps)
     return FALSE;
   }
 
+  if (interaudiosrc->silence) {
+    gst_memory_unref (interaudiosrc->silence);
+    interaudiosrc->silence = NULL;
+  }
+
   return TRUE;
 }
 
@@ -302,6 +307,11 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (interaudiosrc->surface);
   interaudiosrc->surface = NULL;
 
+  if (interaudiosrc->silence) {
+    gst_memory_unref (interaudiosrc->silence);
+    interaudiosrc->silence = NULL;
+  }
+
   return TRUE;
 }
 
@@ -371,7 +381,10 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
   if (n > period_samples)
     n = period_samples;
   if (n > 0) {
-    buffer = gst_adapter_take_buffer (interaudiosrc->surface->audio_adapter,
+    /* Hand out the queued memories as they are instead of merging them
+     * into a newly allocated period */
+    buffer =
+        gst_adapter_take_buffer_fast (interaudiosrc->surface->audio_adapter,
         n * bpf);
   } else {
     buffer = gst_buffer_new ();
@@ -394,19 +407,30 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
 
   bpf = interaudiosrc->info.bpf;
   if (n < period_samples) {
-    GstMapInfo map;
-    GstMemory *mem;
+    gsize silence_size = (period_samples - n) * bpf;
 
     GST_DEBUG_OBJECT (interaudiosrc,
         "creating %" G_GUINT64_FORMAT " samples of silence",
         period_samples - n);
-    mem = gst_allocator_alloc (NULL, (period_samples - n) * bpf, NULL);
-    if (gst_memory_map (mem, &map, GST_MAP_WRITE)) {
-      gst_audio_format_fill_silence (interaudiosrc->info.finfo, map.data,
-          map.size);
-      gst_memory_unmap (mem, &map);
+
+    /* The silence never changes for the negotiated format, so keep one
+     * period of it around and share it into every buffer that needs it */
+    if (interaudiosrc->silence == NULL ||
+        interaudiosrc->silence->size < silence_size) {
+      GstMapInfo map;
+
+      if (interaudiosrc->silence)
+        gst_memory_unref (interaudiosrc->silence);
+      interaudiosrc->silence =
+          gst_allocator_alloc (NULL, period_samples * bpf, NULL);
+      if (gst_memory_map (interaudiosrc->silence, &map, GST_MAP_WRITE)) {
+        gst_audio_format_fill_silence (interaudiosrc->info.finfo, map.data,
+            map.size);
+        gst_memory_unmap (interaudiosrc->silence, &map);
+      }
     }
-    gst_buffer_prepend_memory (buffer, mem);
+    gst_buffer_prepend_memory (buffer,
+        gst_memory_share (interaudiosrc->silence, 0, silence_size));
   }
   n = period_samples;
 
@@ -46,6 +46,9 @@ struct _GstInterAudioSrc
   GstClockTime timestamp_offset;
   GstAudioInfo info;
   guint64 buffer_time, latency_time, period_time;
+
+  /* silence shared into buffers when the sink underruns */
+  GstMemory *silence;
 };
 
 struct _GstInterAudioSrcClass
@@ -52,6 +52,8 @@ gst_inter_surface_get (const char *name)
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   surface->audio_period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  surface->video_queue_depth = DEFAULT_VIDEO_QUEUE_DEPTH;
+  g_queue_init (&surface->video_frames);
 
   list = g_list_append (list, surface);
   g_mutex_unlock (&mutex);
@@ -79,6 +81,7 @@ gst_inter_surface_unref (GstInterSurface * surface)
 
     g_mutex_clear (&surface->mutex);
     gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_surface_clear_video_frames (surface);
     gst_buffer_replace (&surface->sub_buffer, NULL);
     gst_object_unref (surface->audio_adapter);
     g_free (surface->name);
@@ -86,3 +89,37 @@ gst_inter_surface_unref (GstInterSurface * surface)
   }
   g_mutex_unlock (&mutex);
 }
+
+/* Must be called with the surface mutex held. Takes ownership of
+ * @buffer and drops the oldest queued frames so that at most
+ * video_queue_depth frames are kept. */
+void
+gst_inter_surface_push_video_frame (GstInterSurface * surface,
+    GstBuffer * buffer, GstClockTime clock_time)
+{
+  GstInterSurfaceFrame *frame;
+
+  frame = g_slice_new (GstInterSurfaceFrame);
+  frame->buffer = buffer;
+  frame->clock_time = clock_time;
+  g_queue_push_tail (&surface->video_frames, frame);
+
+  while (g_queue_get_length (&surface->video_frames) >
+      MAX (surface->video_queue_depth, 1)) {
+    frame = g_queue_pop_head (&surface->video_frames);
+    gst_buffer_unref (frame->buffer);
+    g_slice_free (GstInterSurfaceFrame, frame);
+  }
+}
+
+/* Must be called with the surface mutex held */
+void
+gst_inter_surface_clear_video_frames (GstInterSurface * surface)
+{
+  GstInterSurfaceFrame *frame;
+
+  while ((frame = g_queue_pop_head (&surface->video_frames))) {
+    gst_buffer_unref (frame->buffer);
+    g_slice_free (GstInterSurfaceFrame, frame);
+  }
+}
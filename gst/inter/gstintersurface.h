@@ -27,6 +27,14 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterSurfaceFrame GstInterSurfaceFrame;
+
+struct _GstInterSurfaceFrame
+{
+  GstBuffer *buffer;
+  /* clock time at which the sink rendered the frame */
+  GstClockTime clock_time;
+};
 
 struct _GstInterSurface
 {
@@ -38,6 +46,8 @@ struct _GstInterSurface
   /* video */
   GstVideoInfo video_info;
   int video_buffer_count;
+  guint video_queue_depth;
+  GQueue video_frames;
 
   /* audio */
   GstAudioInfo audio_info;
@@ -53,11 +63,16 @@ struct _GstInterSurface
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
 #define DEFAULT_AUDIO_LATENCY_TIME (100 * GST_MSECOND)
 #define DEFAULT_AUDIO_PERIOD_TIME  (25 * GST_MSECOND)
+#define DEFAULT_VIDEO_QUEUE_DEPTH  (1)
 
 
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+void gst_inter_surface_push_video_frame (GstInterSurface *surface,
+    GstBuffer *buffer, GstClockTime clock_time);
+void gst_inter_surface_clear_video_frames (GstInterSurface *surface);
+
 
 G_END_DECLS
 
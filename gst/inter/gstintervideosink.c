@@ -214,6 +214,7 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
     gst_buffer_unref (intervideosink->surface->video_buffer);
   }
   intervideosink->surface->video_buffer = NULL;
+  gst_inter_surface_clear_video_frames (intervideosink->surface);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
   g_mutex_unlock (&intervideosink->surface->mutex);
 
@@ -235,6 +236,11 @@ gst_inter_video_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   }
 
   g_mutex_lock (&intervideosink->surface->mutex);
+  /* the queued frames are in the previous format and would be sent with
+   * the new caps */
+  if (intervideosink->surface->video_info.finfo &&
+      !gst_video_info_is_equal (&intervideosink->surface->video_info, &info))
+    gst_inter_surface_clear_video_frames (intervideosink->surface);
   intervideosink->surface->video_info = info;
   intervideosink->info = info;
   g_mutex_unlock (&intervideosink->surface->mutex);
@@ -251,11 +257,26 @@ gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
   g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
+  if (intervideosink->surface->video_queue_depth > 1) {
+    GstClockTime clock_time;
+
+    /* Queue the frame with the clock time it is rendered at so that
+     * intervideosrc can pick frames by clock time instead of taking
+     * whatever happens to be in the slot */
+    clock_time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+        GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    if (GST_CLOCK_TIME_IS_VALID (clock_time))
+      clock_time += gst_element_get_base_time (GST_ELEMENT (sink));
+
+    gst_inter_surface_push_video_frame (intervideosink->surface,
+        gst_buffer_ref (buffer), clock_time);
+  } else {
+    if (intervideosink->surface->video_buffer) {
+      gst_buffer_unref (intervideosink->surface->video_buffer);
+    }
+    intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
+    intervideosink->surface->video_buffer_count = 0;
   }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return GST_FLOW_OK;
@@ -32,6 +32,15 @@
  * The intersubsrc element cannot be used effectively with gst-launch-1.0,
  * as it requires a second pipeline in the application to send subtitles.
  *
+ * By default only the most recent frame of the intervideosink is kept and
+ * intervideosrc repeats or skips it depending on when it wakes up. With
+ * #GstInterVideoSrc:queue-depth set to more than one, the sink keeps that
+ * many frames together with the clock time they were rendered at, and the
+ * source picks the newest frame that is at least (queue-depth - 1) frame
+ * durations old. This absorbs scheduling jitter between both pipelines at
+ * the cost of the added latency, which is reported in latency queries.
+ * Both pipelines need to use the same clock for this to work.
+ *
  */
 
 #ifdef HAVE_CONFIG_H
@@ -66,16 +75,19 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
 static GstFlowReturn
 gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf);
+static gboolean gst_inter_video_src_query (GstBaseSrc * src, GstQuery * query);
 
 enum
 {
   PROP_0,
   PROP_CHANNEL,
-  PROP_TIMEOUT
+  PROP_TIMEOUT,
+  PROP_QUEUE_DEPTH
 };
 
 #define DEFAULT_CHANNEL ("default")
 #define DEFAULT_TIMEOUT (GST_SECOND)
+#define DEFAULT_QUEUE_DEPTH (DEFAULT_VIDEO_QUEUE_DEPTH)
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_src_src_template =
@@ -119,6 +131,7 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
   base_src_class->stop = GST_DEBUG_FUNCPTR (gst_inter_video_src_stop);
   base_src_class->get_times = GST_DEBUG_FUNCPTR (gst_inter_video_src_get_times);
   base_src_class->create = GST_DEBUG_FUNCPTR (gst_inter_video_src_create);
+  base_src_class->query = GST_DEBUG_FUNCPTR (gst_inter_video_src_query);
 
   g_object_class_install_property (gobject_class, PROP_CHANNEL,
       g_param_spec_string ("channel", "Channel",
@@ -130,6 +143,23 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
           "Timeout after which to start outputting black frames",
           0, G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSrc:queue-depth:
+   *
+   * Number of frames the matching intervideosink keeps queued. With a
+   * depth of 1 only the latest frame is kept. Larger values make the source
+   * select frames by clock time and add (queue-depth - 1) frame durations
+   * of latency.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_QUEUE_DEPTH,
+      g_param_spec_uint ("queue-depth", "Queue Depth",
+          "Number of frames to queue between inter sink and src",
+          1, 64, DEFAULT_QUEUE_DEPTH,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 }
 
 static void
@@ -140,6 +170,7 @@ gst_inter_video_src_init (GstInterVideoSrc * intervideosrc)
 
   intervideosrc->channel = g_strdup (DEFAULT_CHANNEL);
   intervideosrc->timeout = DEFAULT_TIMEOUT;
+  intervideosrc->queue_depth = DEFAULT_QUEUE_DEPTH;
 }
 
 void
@@ -156,6 +187,9 @@ gst_inter_video_src_set_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       intervideosrc->timeout = g_value_get_uint64 (value);
       break;
+    case PROP_QUEUE_DEPTH:
+      intervideosrc->queue_depth = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -175,6 +209,9 @@ gst_inter_video_src_get_property (GObject * object, guint property_id,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, intervideosrc->timeout);
       break;
+    case PROP_QUEUE_DEPTH:
+      g_value_set_uint (value, intervideosrc->queue_depth);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -277,6 +314,10 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
 
+  g_mutex_lock (&intervideosrc->surface->mutex);
+  intervideosrc->surface->video_queue_depth = intervideosrc->queue_depth;
+  g_mutex_unlock (&intervideosrc->surface->mutex);
+
   return TRUE;
 }
 
@@ -287,6 +328,11 @@ gst_inter_video_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (intervideosrc, "stop");
 
+  g_mutex_lock (&intervideosrc->surface->mutex);
+  intervideosrc->surface->video_queue_depth = DEFAULT_VIDEO_QUEUE_DEPTH;
+  gst_inter_surface_clear_video_frames (intervideosrc->surface);
+  g_mutex_unlock (&intervideosrc->surface->mutex);
+
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
@@ -319,6 +365,51 @@ gst_inter_video_src_get_times (GstBaseSrc * src, GstBuffer * buffer,
   }
 }
 
+static GstClockTime
+gst_inter_video_src_get_queue_latency (GstInterVideoSrc * intervideosrc)
+{
+  if (intervideosrc->queue_depth <= 1 ||
+      GST_VIDEO_INFO_FPS_N (&intervideosrc->info) <= 0)
+    return 0;
+
+  return gst_util_uint64_scale (GST_SECOND * (intervideosrc->queue_depth - 1),
+      GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+      GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+}
+
+/* Must be called with the surface mutex held. Makes the newest queued frame
+ * that was rendered at or before @target the current video_buffer, dropping
+ * the older ones. If all queued frames are newer, the current frame is
+ * repeated. */
+static void
+gst_inter_video_src_select_frame (GstInterVideoSrc * intervideosrc,
+    GstClockTime target)
+{
+  GstInterSurface *surface = intervideosrc->surface;
+  GstInterSurfaceFrame *frame;
+  guint selected = 0;
+
+  while ((frame = g_queue_peek_head (&surface->video_frames))) {
+    if (GST_CLOCK_TIME_IS_VALID (target) &&
+        GST_CLOCK_TIME_IS_VALID (frame->clock_time) &&
+        frame->clock_time > target)
+      break;
+
+    g_queue_pop_head (&surface->video_frames);
+    gst_buffer_replace (&surface->video_buffer, NULL);
+    surface->video_buffer = frame->buffer;
+    surface->video_buffer_count = 0;
+    g_slice_free (GstInterSurfaceFrame, frame);
+    selected++;
+  }
+
+  if (selected > 1)
+    GST_LOG_OBJECT (intervideosrc, "dropped %u queued frames", selected - 1);
+  GST_LOG_OBJECT (intervideosrc, "target %" GST_TIME_FORMAT ", %u frames "
+      "left in queue", GST_TIME_ARGS (target),
+      g_queue_get_length (&surface->video_frames));
+}
+
 static GstFlowReturn
 gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     GstBuffer ** buf)
@@ -360,6 +451,26 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
+  if (intervideosrc->queue_depth > 1) {
+    GstClockTime target = GST_CLOCK_TIME_NONE;
+
+    if (GST_VIDEO_INFO_FPS_N (&intervideosrc->info) > 0) {
+      GstClockTime latency;
+
+      /* the clock time at which this frame will be pushed, delayed by the
+       * configured queue depth */
+      target = gst_element_get_base_time (GST_ELEMENT (src)) +
+          intervideosrc->timestamp_offset +
+          gst_util_uint64_scale (GST_SECOND * intervideosrc->n_frames,
+          GST_VIDEO_INFO_FPS_D (&intervideosrc->info),
+          GST_VIDEO_INFO_FPS_N (&intervideosrc->info));
+      latency = gst_inter_video_src_get_queue_latency (intervideosrc);
+      target = target > latency ? target - latency : 0;
+    }
+
+    gst_inter_video_src_select_frame (intervideosrc, target);
+  }
+
   if (intervideosrc->surface->video_buffer) {
     /* We have a buffer to push */
     buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
@@ -475,6 +586,48 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_inter_video_src_query (GstBaseSrc * src, GstQuery * query)
+{
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
+  gboolean ret;
+
+  GST_DEBUG_OBJECT (src, "query");
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_LATENCY:
+    {
+      GstClockTime min_latency, max_latency, latency;
+      gboolean live;
+
+      ret = GST_BASE_SRC_CLASS (parent_class)->query (src, query);
+      if (!ret)
+        break;
+
+      latency = gst_inter_video_src_get_queue_latency (intervideosrc);
+      if (latency == 0)
+        break;
+
+      gst_query_parse_latency (query, &live, &min_latency, &max_latency);
+      min_latency += latency;
+      if (GST_CLOCK_TIME_IS_VALID (max_latency))
+        max_latency += latency;
+
+      GST_DEBUG_OBJECT (src,
+          "report latency min %" GST_TIME_FORMAT " max %" GST_TIME_FORMAT,
+          GST_TIME_ARGS (min_latency), GST_TIME_ARGS (max_latency));
+
+      gst_query_set_latency (query, live, min_latency, max_latency);
+      break;
+    }
+    default:
+      ret = GST_BASE_SRC_CLASS (parent_class)->query (src, query);
+      break;
+  }
+
+  return ret;
+}
+
 static GstCaps *
 gst_inter_video_src_fixate (GstBaseSrc * src, GstCaps * caps)
 {
@@ -43,6 +43,7 @@ struct _GstInterVideoSrc
 
   char *channel;
   guint64 timeout;
+  guint queue_depth;
 
   GstVideoInfo info;
   GstBuffer *black_frame;
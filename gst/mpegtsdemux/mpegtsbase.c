@@ -1394,6 +1394,14 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 
   mpegts_packetizer_push (base->packetizer, buf);
 
+  /* Unless subclasses want to look at every packet, packets on PIDs that are
+   * neither known PES nor PSI are dropped by the packetizer unparsed */
+  if (klass->inspect_packet)
+    mpegts_packetizer_set_pid_filter (packetizer, NULL, NULL);
+  else
+    mpegts_packetizer_set_pid_filter (packetizer, base->is_pes,
+        base->known_psi);
+
   while (res == GST_FLOW_OK) {
     pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
 
@@ -1466,6 +1474,9 @@ mpegts_base_scan (MpegTSBase * base)
 
   GST_DEBUG ("Scanning for initial sync point");
 
+  /* The PCRs of all PIDs are needed here */
+  mpegts_packetizer_set_pid_filter (base->packetizer, NULL, NULL);
+
   /* Find initial sync point and at least 5 PCR values */
   for (i = 0; i < 20 && !done; i++) {
     GST_DEBUG ("Grabbing %d => %d", i * 65536, (i + 1) * 65536);
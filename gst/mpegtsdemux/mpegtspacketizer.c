@@ -739,9 +739,16 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   data = packetizer->map_data + packetizer->map_offset;
 
   for (i = 0; i + 3 * MPEGTS_MAX_PACKETSIZE < size; i++) {
-    /* find a sync byte */
-    if (data[i] != PACKET_SYNC_BYTE)
-      continue;
+    guint8 *sync;
+
+    /* find a sync byte, memchr() is vectorized in most C libraries */
+    sync = memchr (data + i, PACKET_SYNC_BYTE,
+        size - 3 * MPEGTS_MAX_PACKETSIZE - i);
+    if (!sync) {
+      i = size - 3 * MPEGTS_MAX_PACKETSIZE;
+      break;
+    }
+    i = sync - data;
 
     /* check for 4 consecutive sync bytes with each possible packet size */
     for (j = 0; j < G_N_ELEMENTS (psizes); j++) {
@@ -797,8 +804,16 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
     sync_offset = 0;
 
   for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+    guint8 *sync;
+
+    sync = memchr (data + i, PACKET_SYNC_BYTE, size - 2 * packet_size - i);
+    if (!sync) {
+      i = size - 2 * packet_size;
+      break;
+    }
+    i = sync - data;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -813,6 +828,45 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   return found;
 }
 
+/* Skip all consecutive packets of the mapped data that are on PIDs nobody
+ * is interested in, only looking at their sync byte and PID. Returns the
+ * number of bytes skipped */
+static gsize
+mpegts_packetizer_skip_filtered (MpegTSPacketizer2 * packetizer,
+    guint packet_size, gsize sync_offset)
+{
+  const guint8 *data;
+  gsize avail, skipped = 0;
+
+  data = packetizer->map_data + packetizer->map_offset + sync_offset;
+  avail = packetizer->map_size - packetizer->map_offset;
+
+  while (avail - skipped >= packet_size) {
+    const guint8 *p = data + skipped;
+    guint16 pid;
+
+    /* Lost sync is handled by the caller */
+    if (G_UNLIKELY (p[0] != PACKET_SYNC_BYTE))
+      break;
+
+    pid = GST_READ_UINT16_BE (p + 1) & 0x1FFF;
+    if (MPEGTS_BIT_IS_SET (packetizer->pes_pids, pid) ||
+        MPEGTS_BIT_IS_SET (packetizer->psi_pids, pid))
+      break;
+
+    skipped += packet_size;
+  }
+
+  if (skipped) {
+    GST_LOG ("skipped %" G_GSIZE_FORMAT " bytes of unwanted packets",
+        skipped);
+    packetizer->map_offset += skipped;
+    packetizer->offset += skipped;
+  }
+
+  return skipped;
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -844,6 +898,13 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     if (!mpegts_packetizer_map (packetizer, packet_size))
       return PACKET_NEED_MORE;
 
+    /* Drop unwanted packets before doing any parsing, and map again if the
+     * remaining data only contained those */
+    if (packetizer->pes_pids &&
+        mpegts_packetizer_skip_filtered (packetizer, packet_size,
+            sync_offset) > 0)
+      continue;
+
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
     /* Check sync byte */
@@ -879,6 +940,19 @@ mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
   return ret;
 }
 
+/* Make mpegts_packetizer_next_packet() skip all packets whose PID is set in
+ * neither of the bitmaps without parsing them. The bitmaps are not copied and
+ * can be updated at any time. Pass NULL to get all packets again. */
+void
+mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 * packetizer,
+    const guint8 * pes_pids, const guint8 * psi_pids)
+{
+  g_return_if_fail ((pes_pids == NULL) == (psi_pids == NULL));
+
+  packetizer->pes_pids = pes_pids;
+  packetizer->psi_pids = psi_pids;
+}
+
 void
 mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -283,6 +283,11 @@ struct _MpegTSPacketizer2 {
   MpegTSPCR *observations[MAX_PCR_OBS_CHANNELS];
   guint8 lastobsid;
   GstClockTime pcr_discont_threshold;
+
+  /* PID bitmaps, packets on PIDs set in neither are skipped unparsed.
+   * Not owned, NULL if all packets are wanted */
+  const guint8 *pes_pids;
+  const guint8 *psi_pids;
 };
 
 struct _MpegTSPacketizer2Class {
@@ -376,6 +381,9 @@ mpegts_packetizer_set_reference_offset (MpegTSPacketizer2 * packetizer,
 G_GNUC_INTERNAL void
 mpegts_packetizer_set_pcr_discont_threshold (MpegTSPacketizer2 * packetizer,
 					GstClockTime threshold);
+G_GNUC_INTERNAL void
+mpegts_packetizer_set_pid_filter (MpegTSPacketizer2 * packetizer,
+				  const guint8 * pes_pids, const guint8 * psi_pids);
 G_END_DECLS
 
 #endif /* GST_MPEGTS_PACKETIZER_H */
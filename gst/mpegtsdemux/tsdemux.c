@@ -58,6 +58,15 @@
  * tsdemux
  *
  * See TODO for explanations on improvements needed
+ *
+ * Threading: packets are read, PES packets reassembled and timestamps
+ * converted on the single streaming thread, as the conversion depends on
+ * the PCR state at the time each packet is read. To process the elementary
+ * streams in parallel downstream, put a queue (or multiqueue, as decodebin
+ * does) after each source pad: every stream then gets its own thread and the
+ * streaming thread only pays for the queue insertion. tsdemux outputs a
+ * single program, so several programs are demuxed in parallel with one
+ * tsdemux per program.
  */
 
 #define CONTINUITY_UNSET 255
@@ -70,6 +79,22 @@
  */
 #define SEEK_TIMESTAMP_OFFSET (2500 * GST_MSECOND)
 
+/* Seek index: minimum distance between two entries that are not random
+ * access points, and maximum distance between a seek target and the entry
+ * used to seek to it */
+#define INDEX_INTERVAL (500 * GST_MSECOND)
+#define INDEX_MAX_DISTANCE (10 * GST_SECOND)
+
+/* Index sidecar file header */
+#define INDEX_FILE_MAGIC GST_MAKE_FOURCC ('T', 'S', 'I', 'X')
+#define INDEX_FILE_VERSION 3
+#define INDEX_FILE_HEADER_SIZE 32
+#define INDEX_FILE_ENTRY_SIZE 20
+
+/* Number of bytes at the start of the file hashed to identify it */
+#define INDEX_FINGERPRINT_SIZE (64 * 1024)
+#define INDEX_FINGERPRINT_INIT G_GUINT64_CONSTANT (0xcbf29ce484222325)
+
 #define GST_FLOW_REWINDING GST_FLOW_CUSTOM_ERROR
 
 /* latency in nsecs */
@@ -210,6 +235,17 @@ struct _TSDemuxStream
   TSDemuxJP2KParsingInfos jp2kInfos;
 };
 
+/* Seek index entry, the index is sorted by ts */
+typedef struct
+{
+  GstClockTime ts;
+  guint64 offset;
+  guint32 flags;
+} TSDemuxIndexEntry;
+
+/* The entry points to the start of a PES with the random access indicator */
+#define INDEX_FLAG_RAP (1 << 0)
+
 #define VIDEO_CAPS \
   GST_STATIC_CAPS (\
     "video/mpeg, " \
@@ -282,6 +318,7 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_INDEX_LOCATION,
   /* FILL ME */
 };
 
@@ -324,6 +361,7 @@ static void gst_ts_demux_stream_flush (TSDemuxStream * stream,
 static gboolean push_event (MpegTSBase * base, GstEvent * event);
 static void gst_ts_demux_check_and_sync_streams (GstTSDemux * demux,
     GstClockTime time);
+static void gst_ts_demux_index_save (GstTSDemux * demux);
 
 static void
 _extra_init (void)
@@ -351,6 +389,17 @@ gst_ts_demux_dispose (GObject * object)
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
+static void
+gst_ts_demux_finalize (GObject * object)
+{
+  GstTSDemux *demux = GST_TS_DEMUX_CAST (object);
+
+  g_array_free (demux->index, TRUE);
+  g_free (demux->index_location);
+
+  GST_CALL_PARENT (G_OBJECT_CLASS, finalize, (object));
+}
+
 static void
 gst_ts_demux_class_init (GstTSDemuxClass * klass)
 {
@@ -362,6 +411,7 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
   gobject_class->set_property = gst_ts_demux_set_property;
   gobject_class->get_property = gst_ts_demux_get_property;
   gobject_class->dispose = gst_ts_demux_dispose;
+  gobject_class->finalize = gst_ts_demux_finalize;
 
   g_object_class_install_property (gobject_class, PROP_PROGRAM_NUMBER,
       g_param_spec_int ("program-number", "Program number",
@@ -373,6 +423,25 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:index-location:
+   *
+   * Sidecar file holding the seek index of the stream. tsdemux records the
+   * byte offset of timestamps and random access points of the main stream
+   * while demuxing, and seeks to those offsets directly instead of
+   * estimating them from the PCR. If set, the index is loaded from this
+   * file when the program starts, and written back when stopping. The file
+   * is only used for the stream it was written for: same program, same size
+   * and same first 64 KiB of data. Only used when tsdemux pulls its data
+   * from upstream.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "Location of the seek index sidecar file (NULL to disable)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -432,6 +501,18 @@ gst_ts_demux_reset (MpegTSBase * base)
 
   demux->last_seek_offset = -1;
   demux->program_generation = 0;
+
+  /* Also called from the MpegTSBase instance init */
+  if (demux->index) {
+    gst_ts_demux_index_save (demux);
+    g_array_set_size (demux->index, 0);
+  }
+  demux->index_dirty = FALSE;
+  demux->index_pid = -1;
+  demux->index_program = -1;
+  demux->index_upstream_size = 0;
+  demux->index_fingerprint = INDEX_FINGERPRINT_INIT;
+  demux->index_fingerprint_valid = FALSE;
 }
 
 static void
@@ -445,6 +526,7 @@ gst_ts_demux_init (GstTSDemux * demux)
   base->push_section = FALSE;
 
   demux->flowcombiner = gst_flow_combiner_new ();
+  demux->index = g_array_new (FALSE, FALSE, sizeof (TSDemuxIndexEntry));
   demux->requested_program_number = -1;
   demux->program_number = -1;
   gst_ts_demux_reset (base);
@@ -466,6 +548,12 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->index_location);
+      demux->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -484,11 +572,311 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
 }
 
+/* Returns the number of index entries with a timestamp <= ts */
+static guint
+gst_ts_demux_index_upper_bound (GstTSDemux * demux, GstClockTime ts)
+{
+  guint lo = 0, hi = demux->index->len;
+
+  while (lo < hi) {
+    guint mid = lo + (hi - lo) / 2;
+
+    if (g_array_index (demux->index, TSDemuxIndexEntry, mid).ts <= ts)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+static void
+gst_ts_demux_index_add (GstTSDemux * demux, GstClockTime ts, guint64 offset,
+    gboolean rap)
+{
+  TSDemuxIndexEntry entry;
+  guint pos;
+
+  pos = gst_ts_demux_index_upper_bound (demux, ts);
+
+  /* Keep random access points, but only one other entry per interval */
+  if (pos > 0) {
+    TSDemuxIndexEntry *prev =
+        &g_array_index (demux->index, TSDemuxIndexEntry, pos - 1);
+
+    if (prev->offset == offset)
+      return;
+    if (!rap && ts - prev->ts < INDEX_INTERVAL)
+      return;
+  }
+  if (pos < demux->index->len) {
+    TSDemuxIndexEntry *next =
+        &g_array_index (demux->index, TSDemuxIndexEntry, pos);
+
+    if (next->offset == offset)
+      return;
+    if (!rap && next->ts - ts < INDEX_INTERVAL)
+      return;
+  }
+
+  GST_LOG_OBJECT (demux, "Indexing %s%" GST_TIME_FORMAT " at offset %"
+      G_GUINT64_FORMAT, rap ? "random access point " : "", GST_TIME_ARGS (ts),
+      offset);
+
+  entry.ts = ts;
+  entry.offset = offset;
+  entry.flags = rap ? INDEX_FLAG_RAP : 0;
+  g_array_insert_val (demux->index, pos, entry);
+  demux->index_dirty = TRUE;
+}
+
+/* Returns the offset to seek to in order to reach ts, or -1 if the index
+ * doesn't cover that position */
+static guint64
+gst_ts_demux_index_lookup (GstTSDemux * demux, GstClockTime ts)
+{
+  TSDemuxIndexEntry *fallback = NULL;
+  guint pos;
+
+  pos = gst_ts_demux_index_upper_bound (demux, ts);
+
+  /* Only trust the index if it knows about data after the target */
+  if (pos == demux->index->len)
+    return -1;
+
+  /* Prefer the closest random access point, else a timestamp far enough
+   * before the target, like when estimating from the PCR */
+  while (pos > 0) {
+    TSDemuxIndexEntry *entry =
+        &g_array_index (demux->index, TSDemuxIndexEntry, --pos);
+
+    if (entry->ts + INDEX_MAX_DISTANCE < ts)
+      break;
+    if (entry->flags & INDEX_FLAG_RAP) {
+      GST_DEBUG_OBJECT (demux, "Using random access point at %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (entry->ts));
+      return entry->offset;
+    }
+    if (fallback == NULL && entry->ts + SEEK_TIMESTAMP_OFFSET <= ts)
+      fallback = entry;
+  }
+
+  if (fallback) {
+    GST_DEBUG_OBJECT (demux, "Using index entry at %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (fallback->ts));
+    return fallback->offset;
+  }
+
+  return -1;
+}
+
+static guint64
+gst_ts_demux_get_upstream_size (GstTSDemux * demux)
+{
+  gint64 size;
+
+  if (!gst_pad_peer_query_duration (((MpegTSBase *) demux)->sinkpad,
+          GST_FORMAT_BYTES, &size) || size < 0)
+    return 0;
+
+  return size;
+}
+
+static void
+gst_ts_demux_index_load (GstTSDemux * demux)
+{
+  gchar *location;
+  gchar *contents = NULL;
+  gsize length;
+  GError *err = NULL;
+  GstByteReader reader;
+  guint32 magic, version, program_number, n_entries, i;
+  guint64 upstream_size, fingerprint;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location == NULL)
+    return;
+
+  /* Without the upstream size there's no telling which file the index is
+   * about */
+  if (demux->index_upstream_size == 0)
+    goto done;
+
+  if (!g_file_get_contents (location, &contents, &length, &err)) {
+    GST_DEBUG_OBJECT (demux, "No index loaded from %s: %s", location,
+        err->message);
+    g_clear_error (&err);
+    goto done;
+  }
+
+  gst_byte_reader_init (&reader, (const guint8 *) contents, length);
+  if (!gst_byte_reader_get_uint32_le (&reader, &magic) ||
+      !gst_byte_reader_get_uint32_le (&reader, &version) ||
+      !gst_byte_reader_get_uint32_le (&reader, &program_number) ||
+      !gst_byte_reader_get_uint64_le (&reader, &upstream_size) ||
+      !gst_byte_reader_get_uint64_le (&reader, &fingerprint) ||
+      !gst_byte_reader_get_uint32_le (&reader, &n_entries))
+    goto invalid;
+
+  if (magic != INDEX_FILE_MAGIC || version != INDEX_FILE_VERSION)
+    goto invalid;
+
+  /* The index is only valid for the very same file and program. The size
+   * alone does not tell a file that was rewritten in place, so the start of
+   * the file must match too */
+  if ((gint) program_number != demux->index_program ||
+      upstream_size != demux->index_upstream_size ||
+      fingerprint != demux->index_fingerprint) {
+    GST_INFO_OBJECT (demux, "Index in %s is for another stream", location);
+    goto done;
+  }
+
+  if (gst_byte_reader_get_remaining (&reader) / INDEX_FILE_ENTRY_SIZE <
+      n_entries)
+    goto invalid;
+
+  for (i = 0; i < n_entries; i++) {
+    TSDemuxIndexEntry entry;
+
+    entry.ts = gst_byte_reader_get_uint64_le_unchecked (&reader);
+    entry.offset = gst_byte_reader_get_uint64_le_unchecked (&reader);
+    entry.flags = gst_byte_reader_get_uint32_le_unchecked (&reader);
+    gst_ts_demux_index_add (demux, entry.ts, entry.offset,
+        entry.flags & INDEX_FLAG_RAP);
+  }
+  demux->index_dirty = FALSE;
+
+  GST_INFO_OBJECT (demux, "Loaded %u index entries from %s", demux->index->len,
+      location);
+
+done:
+  g_free (contents);
+  g_free (location);
+  return;
+
+invalid:
+  GST_WARNING_OBJECT (demux, "Invalid index file %s", location);
+  goto done;
+}
+
+static void
+gst_ts_demux_index_save (GstTSDemux * demux)
+{
+  gchar *location;
+  GstByteWriter writer;
+  GError *err = NULL;
+  guint i, size;
+
+  if (!demux->index_dirty || demux->index_upstream_size == 0)
+    return;
+
+  /* Without the fingerprint, the index could not be told apart from the one
+   * of another stream of the same size */
+  if (!demux->index_fingerprint_valid)
+    return;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location == NULL)
+    return;
+
+  size = INDEX_FILE_HEADER_SIZE + demux->index->len * INDEX_FILE_ENTRY_SIZE;
+  gst_byte_writer_init_with_size (&writer, size, TRUE);
+  gst_byte_writer_put_uint32_le_unchecked (&writer, INDEX_FILE_MAGIC);
+  gst_byte_writer_put_uint32_le_unchecked (&writer, INDEX_FILE_VERSION);
+  gst_byte_writer_put_uint32_le_unchecked (&writer, demux->index_program);
+  gst_byte_writer_put_uint64_le_unchecked (&writer,
+      demux->index_upstream_size);
+  gst_byte_writer_put_uint64_le_unchecked (&writer, demux->index_fingerprint);
+  gst_byte_writer_put_uint32_le_unchecked (&writer, demux->index->len);
+  for (i = 0; i < demux->index->len; i++) {
+    TSDemuxIndexEntry *entry =
+        &g_array_index (demux->index, TSDemuxIndexEntry, i);
+
+    gst_byte_writer_put_uint64_le_unchecked (&writer, entry->ts);
+    gst_byte_writer_put_uint64_le_unchecked (&writer, entry->offset);
+    gst_byte_writer_put_uint32_le_unchecked (&writer, entry->flags);
+  }
+
+  if (!g_file_set_contents (location,
+          (const gchar *) gst_byte_writer_get_data (&writer), size, &err)) {
+    GST_WARNING_OBJECT (demux, "Could not write index to %s: %s", location,
+        err->message);
+    g_clear_error (&err);
+  } else {
+    GST_INFO_OBJECT (demux, "Wrote %u index entries to %s", demux->index->len,
+        location);
+    demux->index_dirty = FALSE;
+  }
+
+  gst_byte_writer_reset (&writer);
+  g_free (location);
+}
+
+/* Hashes the upstream size and the first INDEX_FINGERPRINT_SIZE bytes of
+ * the file. Unlike anything derived from the demuxed data, this doesn't
+ * depend on where playback started or which streams were output */
+static gboolean
+gst_ts_demux_index_compute_fingerprint (GstTSDemux * demux)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  GstBuffer *buf = NULL;
+  GstFlowReturn ret;
+  GstMapInfo map;
+  guint64 hash = INDEX_FINGERPRINT_INIT;
+  gsize i;
+
+  demux->index_fingerprint_valid = FALSE;
+
+  if (base->mode == BASE_MODE_PUSHING || demux->index_upstream_size == 0)
+    return FALSE;
+
+  ret = gst_pad_pull_range (base->sinkpad, 0,
+      MIN (INDEX_FINGERPRINT_SIZE, demux->index_upstream_size), &buf);
+  if (ret != GST_FLOW_OK) {
+    GST_DEBUG_OBJECT (demux, "Could not read the start of the file: %s",
+        gst_flow_get_name (ret));
+    return FALSE;
+  }
+
+  /* FNV-1a over the little endian bytes of the size, then over the data */
+  for (i = 0; i < 8; i++) {
+    hash ^= (demux->index_upstream_size >> (i * 8)) & 0xff;
+    hash *= G_GUINT64_CONSTANT (0x100000001b3);
+  }
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i++) {
+    hash ^= map.data[i];
+    hash *= G_GUINT64_CONSTANT (0x100000001b3);
+  }
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  GST_DEBUG_OBJECT (demux, "File fingerprint %016" G_GINT64_MODIFIER "x",
+      hash);
+
+  demux->index_fingerprint = hash;
+  demux->index_fingerprint_valid = TRUE;
+
+  return TRUE;
+}
+
 static gboolean
 gst_ts_demux_get_duration (GstTSDemux * demux, GstClockTime * dur)
 {
@@ -855,9 +1243,13 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GST_DEBUG_OBJECT (demux, "configuring seek");
 
   if (start_type != GST_SEEK_TYPE_NONE) {
-    start_offset =
-        mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
-            start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+    start_offset = -1;
+    if (base->packetizer->calculate_offset)
+      start_offset = gst_ts_demux_index_lookup (demux, MAX (0, start));
+    if (start_offset == -1)
+      start_offset =
+          mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
+              start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
 
     if (G_UNLIKELY (start_offset == -1)) {
       GST_WARNING ("Couldn't convert start position to an offset");
@@ -1946,6 +2338,46 @@ gst_ts_demux_update_program (MpegTSBase * base, MpegTSBaseProgram * program)
   }
 }
 
+/* Picks the stream to index (the first video stream if any) and loads the
+ * index of the program */
+static void
+gst_ts_demux_index_setup (GstTSDemux * demux, MpegTSBaseProgram * program)
+{
+  GList *tmp;
+
+  demux->index_pid = -1;
+  for (tmp = program->stream_list; tmp; tmp = tmp->next) {
+    TSDemuxStream *stream = (TSDemuxStream *) tmp->data;
+    MpegTSBaseStream *bstream = (MpegTSBaseStream *) stream;
+
+    if (stream->pad == NULL)
+      continue;
+
+    if (gst_stream_get_stream_type (bstream->stream_object) ==
+        GST_STREAM_TYPE_VIDEO) {
+      demux->index_pid = bstream->pid;
+      break;
+    }
+    if (demux->index_pid == -1)
+      demux->index_pid = bstream->pid;
+  }
+
+  if (demux->index_program == program->program_number)
+    return;
+
+  /* Switching program, the index of the previous one is of no use anymore */
+  gst_ts_demux_index_save (demux);
+  g_array_set_size (demux->index, 0);
+  demux->index_dirty = FALSE;
+
+  demux->index_program = program->program_number;
+  demux->index_upstream_size = gst_ts_demux_get_upstream_size (demux);
+  if (gst_ts_demux_index_compute_fingerprint (demux))
+    gst_ts_demux_index_load (demux);
+
+  GST_DEBUG_OBJECT (demux, "Indexing PID 0x%04x", demux->index_pid);
+}
+
 static void
 gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
 {
@@ -1999,6 +2431,8 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
         have_pads = TRUE;
     }
 
+    gst_ts_demux_index_setup (demux, program);
+
     /* If there was a previous program, now is the time to deactivate it
      * and remove old pads (including pushing EOS) */
     if (demux->previous_program) {
@@ -2379,6 +2813,18 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
 
       /* parse the header */
       gst_ts_demux_parse_pes_header (demux, stream, data, size, packet->offset);
+
+      if (stream->stream.pid == demux->index_pid &&
+          stream->state == PENDING_PACKET_BUFFER && !stream->pending_ts &&
+          MPEG_TS_BASE_PACKETIZER (demux)->calculate_offset) {
+        GstClockTime ts = GST_CLOCK_TIME_IS_VALID (stream->pts) ?
+            stream->pts : stream->dts;
+
+        if (GST_CLOCK_TIME_IS_VALID (ts))
+          gst_ts_demux_index_add (demux, ts, packet->offset,
+              FLAGS_HAS_AFC (packet->scram_afc_cc) &&
+              (packet->afc_flags & MPEGTS_AFC_RANDOM_ACCES_FLAGS));
+      }
       break;
     }
     case PENDING_PACKET_BUFFER:
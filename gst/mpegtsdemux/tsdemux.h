@@ -76,6 +76,7 @@ struct _GstTSDemux
   gint requested_program_number; /* Required program number (ignore:-1) */
   guint program_number;
   gboolean emit_statistics;
+  gchar *index_location;
 
   /*< private >*/
   gint program_generation; /* Incremented each time we switch program 0..15 */
@@ -101,6 +102,17 @@ struct _GstTSDemux
 
   /* Used when seeking for a keyframe to go backward in the stream */
   guint64 last_seek_offset;
+
+  /* Seek index (array of TSDemuxIndexEntry sorted by timestamp) */
+  GArray *index;
+  gboolean index_dirty;
+  gint index_pid;
+  gint index_program;
+  guint64 index_upstream_size;
+  /* Hash of the size and first bytes of the upstream file, tells whether a
+   * sidecar file is about this file */
+  guint64 index_fingerprint;
+  gboolean index_fingerprint_valid;
 };
 
 struct _GstTSDemuxClass
@@ -115,11 +115,13 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BATCH_PACKETS
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BATCH_PACKETS 0
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -305,6 +307,27 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * mpegtsmux:batch-packets:
+   *
+   * Write the packets in place into pooled buffers of this many packets
+   * instead of allocating a buffer for every single packet, and push these
+   * buffers as a whole. If #mpegtsmux:alignment is set, its value is used
+   * as batch size instead. Without alignment, a batch is also pushed when
+   * a key unit starts and whenever the muxer has written out all the
+   * packets for an input buffer, so this does not add latency.
+   *
+   * Not supported in M2TS mode.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BATCH_PACKETS,
+      g_param_spec_int ("batch-packets", "Batch packets",
+          "Number of packets written in place into each output buffer "
+          "(0 = one buffer per packet)", 0, G_MAXINT,
+          MPEGTSMUX_DEFAULT_BATCH_PACKETS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -338,6 +361,7 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
+  mux->batch_packets = MPEGTSMUX_DEFAULT_BATCH_PACKETS;
 
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
@@ -420,6 +444,16 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   gst_event_replace (&mux->force_key_unit_event, NULL);
   gst_buffer_replace (&mux->out_buffer, NULL);
 
+  if (mux->slab) {
+    gst_buffer_unmap (mux->slab, &mux->slab_map);
+    gst_buffer_replace (&mux->slab, NULL);
+  }
+  if (mux->slab_pool) {
+    gst_buffer_pool_set_active (mux->slab_pool, FALSE);
+    gst_object_unref (mux->slab_pool);
+    mux->slab_pool = NULL;
+  }
+
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
     for (walk = mux->collect->data; walk != NULL; walk = g_slist_next (walk))
@@ -511,6 +545,9 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BATCH_PACKETS:
+      mux->batch_packets = g_value_get_int (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -542,6 +579,9 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BATCH_PACKETS:
+      g_value_set_int (value, mux->batch_packets);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1600,7 +1640,8 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
         hbuf = gst_buffer_new_and_alloc (len);
         gst_buffer_fill (hbuf, 0, data, len);
       } else {
-        hbuf = gst_buffer_copy (buf);
+        /* the packet may only be a view on a slab that is reused later */
+        hbuf = gst_buffer_copy_deep (buf);
       }
       GST_LOG_OBJECT (mux,
           "Collecting packet with pid 0x%04x into streamheaders", pid);
@@ -1627,6 +1668,96 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
   }
 }
 
+static gint
+mpegtsmux_slab_packets (MpegTsMux * mux)
+{
+  if (mux->m2ts_mode)
+    return 0;
+
+  return mux->alignment > 0 ? mux->alignment : mux->batch_packets;
+}
+
+static gboolean
+mpegtsmux_slab_start (MpegTsMux * mux)
+{
+  guint n_packets = mpegtsmux_slab_packets (mux);
+
+  if (mux->slab_pool && mux->slab_packets != n_packets) {
+    gst_buffer_pool_set_active (mux->slab_pool, FALSE);
+    gst_object_unref (mux->slab_pool);
+    mux->slab_pool = NULL;
+  }
+
+  if (!mux->slab_pool) {
+    GstStructure *config;
+
+    mux->slab_pool = gst_buffer_pool_new ();
+    mux->slab_packets = n_packets;
+
+    config = gst_buffer_pool_get_config (mux->slab_pool);
+    gst_buffer_pool_config_set_params (config, NULL,
+        n_packets * NORMAL_TS_PACKET_LENGTH, 0, 0);
+    if (!gst_buffer_pool_set_config (mux->slab_pool, config)
+        || !gst_buffer_pool_set_active (mux->slab_pool, TRUE)) {
+      GST_ERROR_OBJECT (mux, "Failed to set up slab pool");
+      gst_object_unref (mux->slab_pool);
+      mux->slab_pool = NULL;
+      return FALSE;
+    }
+  }
+
+  if (gst_buffer_pool_acquire_buffer (mux->slab_pool, &mux->slab,
+          NULL) != GST_FLOW_OK)
+    return FALSE;
+
+  if (!gst_buffer_map (mux->slab, &mux->slab_map, GST_MAP_WRITE)) {
+    gst_buffer_replace (&mux->slab, NULL);
+    return FALSE;
+  }
+  mux->slab_fill = 0;
+
+  return TRUE;
+}
+
+/* Hand the packets written into the current slab over to the output */
+static void
+mpegtsmux_slab_finish (MpegTsMux * mux)
+{
+  GstBuffer *slab = mux->slab;
+
+  if (!slab)
+    return;
+
+  gst_buffer_unmap (slab, &mux->slab_map);
+  mux->slab = NULL;
+
+  if (mux->slab_fill == 0) {
+    gst_buffer_unref (slab);
+    return;
+  }
+
+  gst_buffer_resize (slab, 0, mux->slab_fill * NORMAL_TS_PACKET_LENGTH);
+  mpegtsmux_collect_packet (mux, slab);
+}
+
+/* Account for a packet that was written in place into the current slab */
+static void
+mpegtsmux_slab_add_packet (MpegTsMux * mux, GstBuffer * buf)
+{
+  if (mux->slab_fill == 0) {
+    GST_BUFFER_PTS (mux->slab) = GST_BUFFER_PTS (buf);
+    GST_BUFFER_FLAGS (mux->slab) = GST_BUFFER_FLAGS (buf);
+  } else if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    GST_BUFFER_FLAG_UNSET (mux->slab, GST_BUFFER_FLAG_DELTA_UNIT);
+  }
+
+  /* the data is in the slab already, drop the view */
+  gst_buffer_unref (buf);
+
+  if (++mux->slab_fill == mux->slab_packets)
+    mpegtsmux_slab_finish (mux);
+}
+
 static GstFlowReturn
 mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
 {
@@ -1644,6 +1775,10 @@ mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
       align = 0;
   }
 
+  /* Incomplete slabs only have to be kept if the output is aligned */
+  if (mux->slab && (align == 0 || force))
+    mpegtsmux_slab_finish (mux);
+
   av = gst_adapter_available (mux->out_adapter);
   GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
 
@@ -1889,6 +2024,8 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
   /* all is meant for downstream, including any prefix */
   if (offset)
     return new_packet_m2ts (mux, buf, new_pcr);
+  else if (mux->slab)
+    mpegtsmux_slab_add_packet (mux, buf);
   else
     mpegtsmux_collect_packet (mux, buf);
 
@@ -1903,6 +2040,28 @@ alloc_packet_cb (GstBuffer ** _buf, void *user_data)
   GstBuffer *buf;
   gint offset = 0;
 
+  if (mpegtsmux_slab_packets (mux) > 0) {
+    /* Without alignment, let key units start a new buffer */
+    if (mux->slab && mux->slab_fill > 0 && !mux->is_delta
+        && mux->alignment <= 0)
+      mpegtsmux_slab_finish (mux);
+
+    if (!mux->slab && !mpegtsmux_slab_start (mux)) {
+      *_buf = NULL;
+      return;
+    }
+
+    /* Let TsMux write the packet directly into the slab */
+    *_buf = gst_buffer_new_wrapped_full (0,
+        mux->slab_map.data + mux->slab_fill * NORMAL_TS_PACKET_LENGTH,
+        NORMAL_TS_PACKET_LENGTH, 0, NORMAL_TS_PACKET_LENGTH, NULL, NULL);
+    return;
+  }
+
+  /* batching was disabled in the meantime */
+  if (mux->slab)
+    mpegtsmux_slab_finish (mux);
+
   if (mux->m2ts_mode == TRUE)
     offset = 4;
 
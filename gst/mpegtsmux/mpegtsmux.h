@@ -139,6 +139,7 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  gint batch_packets;
 
   /* state */
   gboolean first;
@@ -164,6 +165,13 @@ struct MpegTsMux {
   GstAdapter *out_adapter;
   GstBuffer *out_buffer;
 
+  /* packets are written in place into slabs from this pool when batching */
+  GstBufferPool *slab_pool;
+  guint slab_packets;
+  GstBuffer *slab;
+  GstMapInfo slab_map;
+  guint slab_fill;
+
 #if 0
   /* SPN/PTS index handling */
   GstIndex *element_index;
@@ -888,15 +888,12 @@ static gboolean
 tsmux_section_write_packet (GstMpegtsSectionType * type,
     TsMuxSection * section, TsMux * mux)
 {
-  GstBuffer *section_buffer;
   GstBuffer *packet_buffer = NULL;
-  GstMemory *mem;
-  guint8 *packet;
+  GstMapInfo map;
   guint8 *data;
   gsize data_size = 0;
   gsize payload_written;
   guint len = 0, offset = 0, payload_len = 0;
-  guint extra_alloc_bytes = 0;
 
   g_return_val_if_fail (section != NULL, FALSE);
   g_return_val_if_fail (mux != NULL, FALSE);
@@ -904,6 +901,7 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   /* Mark the start of new PES unit */
   section->pi.packet_start_unit_indicator = TRUE;
 
+  /* The data will be freed when the GstMpegtsSection is destroyed. */
   data = gst_mpegts_section_packetize (section->section, &data_size);
 
   if (!data) {
@@ -915,70 +913,39 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   section->pi.stream_avail = data_size;
   payload_written = 0;
 
-  /* Wrap section data in a buffer without free function.
-     The data will be freed when the GstMpegtsSection is destroyed. */
-  section_buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      data, data_size, 0, data_size, NULL, NULL);
-
-  TS_DEBUG ("Section buffer with size %" G_GSIZE_FORMAT " created",
-      gst_buffer_get_size (section_buffer));
+  TS_DEBUG ("Section of size %" G_GSIZE_FORMAT " packetized", data_size);
 
   while (section->pi.stream_avail > 0) {
+    /* Section packets come from the same allocator as the PES packets, so
+     * they are written in place into whatever the muxer hands out */
+    if (!tsmux_get_buffer (mux, &packet_buffer))
+      return FALSE;
 
-    packet = g_malloc (TSMUX_PACKET_LENGTH);
+    if (!gst_buffer_map (packet_buffer, &map, GST_MAP_WRITE))
+      goto fail;
 
     if (section->pi.packet_start_unit_indicator) {
       /* Wee need room for a pointer byte */
       section->pi.stream_avail++;
 
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
+      if (!tsmux_write_ts_header (map.data, &section->pi, &len, &offset))
+        goto fail_unmap;
 
       /* Write the pointer byte */
-      packet[offset++] = 0x00;
+      map.data[offset++] = 0x00;
       payload_len = len - 1;
 
     } else {
-      if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
+      if (!tsmux_write_ts_header (map.data, &section->pi, &len, &offset))
+        goto fail_unmap;
       payload_len = len;
     }
 
-    /* Wrap the TS header and adaption field in a GstMemory */
-    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
-        packet, TSMUX_PACKET_LENGTH, 0, offset, packet, g_free);
-
     TS_DEBUG ("Creating packet buffer at offset "
         "%" G_GSIZE_FORMAT " with length %u", payload_written, payload_len);
 
-    /* If in M2TS mode, we will need to resize to 4 bytes after the end
-       of the buffer. For performance reasons, we will now try to include
-       4 extra bytes from the source buffer, then resize down, to avoid
-       having an extra 4 byte GstMemory appended. If the source buffer
-       does not have enough data for this, a new GstMemory will be used */
-    if (gst_buffer_get_size (section_buffer) - (payload_written +
-            payload_len) >= 4) {
-      /* enough space */
-      extra_alloc_bytes = 4;
-    }
-    packet_buffer = gst_buffer_copy_region (section_buffer, GST_BUFFER_COPY_ALL,
-        payload_written, payload_len + extra_alloc_bytes);
-
-    /* Prepend the header to the section data */
-    gst_buffer_prepend_memory (packet_buffer, mem);
-
-    /* add an extra 4 bytes if it could not be reserved already */
-    if (extra_alloc_bytes == 4) {
-      /* we allocated those already, resize */
-      gst_buffer_set_size (packet_buffer,
-          gst_buffer_get_size (packet_buffer) - extra_alloc_bytes);
-    } else {
-      void *ptr = g_malloc (4);
-      GstMemory *extra =
-          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ptr, 4, 0, 0, ptr,
-          g_free);
-      gst_buffer_append_memory (packet_buffer, extra);
-    }
+    memcpy (map.data + offset, data + payload_written, payload_len);
+    gst_buffer_unmap (packet_buffer, &map);
 
     TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
         len, section->pi.stream_avail - len);
@@ -986,8 +953,7 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
     /* Push the packet without PCR */
     if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1))) {
       /* Buffer given away */
-      packet_buffer = NULL;
-      goto fail;
+      return FALSE;
     }
 
     packet_buffer = NULL;
@@ -996,14 +962,12 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
     section->pi.packet_start_unit_indicator = FALSE;
   }
 
-  gst_buffer_unref (section_buffer);
-
   return TRUE;
 
+fail_unmap:
+  gst_buffer_unmap (packet_buffer, &map);
 fail:
-  g_free (packet);
-  if (section_buffer)
-    gst_buffer_unref (section_buffer);
+  gst_buffer_unref (packet_buffer);
   return FALSE;
 }
 
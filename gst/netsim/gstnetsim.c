@@ -94,148 +94,184 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 G_DEFINE_TYPE (GstNetSim, gst_net_sim, GST_TYPE_ELEMENT);
 
-static gboolean
-gst_net_sim_source_dispatch (GSource * source,
-    GSourceFunc callback, gpointer user_data)
+/* Delayed buffers are kept in a binary min-heap ordered by the time they are
+ * due, ties broken by arrival so that equal delays keep their order. The
+ * array is preallocated and reused, so delaying a buffer doesn't allocate */
+typedef struct
 {
-  callback (user_data);
-  return FALSE;
-}
+  gint64 ready_time;
+  guint64 seqnum;
+  GstBuffer *buf;
+} GstNetSimDelayedBuffer;
 
-GSourceFuncs gst_net_sim_source_funcs = {
-  NULL,                         /* prepare */
-  NULL,                         /* check */
-  gst_net_sim_source_dispatch,
-  NULL                          /* finalize */
-};
+#define DELAY_QUEUE_PREALLOC 1024
+
+static inline gboolean
+delayed_buffer_before (const GstNetSimDelayedBuffer * a,
+    const GstNetSimDelayedBuffer * b)
+{
+  if (a->ready_time != b->ready_time)
+    return a->ready_time < b->ready_time;
+  return a->seqnum < b->seqnum;
+}
 
 static void
-gst_net_sim_loop (GstNetSim * netsim)
+delay_queue_push (GArray * queue, const GstNetSimDelayedBuffer * item)
 {
-  GMainLoop *loop;
+  GstNetSimDelayedBuffer *heap;
+  guint i;
 
-  GST_TRACE_OBJECT (netsim, "TASK: begin");
+  g_array_append_vals (queue, item, 1);
+  heap = (GstNetSimDelayedBuffer *) queue->data;
 
-  g_mutex_lock (&netsim->loop_mutex);
-  loop = g_main_loop_ref (netsim->main_loop);
-  netsim->running = TRUE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal start");
-  g_cond_signal (&netsim->start_cond);
-  g_mutex_unlock (&netsim->loop_mutex);
+  for (i = queue->len - 1; i > 0;) {
+    guint parent = (i - 1) / 2;
+    GstNetSimDelayedBuffer tmp;
 
-  GST_TRACE_OBJECT (netsim, "TASK: run");
-  g_main_loop_run (loop);
-  g_main_loop_unref (loop);
+    if (!delayed_buffer_before (&heap[i], &heap[parent]))
+      break;
 
-  g_mutex_lock (&netsim->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: pause");
-  gst_pad_pause_task (netsim->srcpad);
-  netsim->running = FALSE;
-  GST_TRACE_OBJECT (netsim, "TASK: signal end");
-  g_cond_signal (&netsim->start_cond);
-  g_mutex_unlock (&netsim->loop_mutex);
-  GST_TRACE_OBJECT (netsim, "TASK: end");
+    tmp = heap[parent];
+    heap[parent] = heap[i];
+    heap[i] = tmp;
+    i = parent;
+  }
 }
 
-static gboolean
-_main_loop_quit_and_remove_source (gpointer user_data)
+static GstBuffer *
+delay_queue_pop (GArray * queue)
+{
+  GstNetSimDelayedBuffer *heap = (GstNetSimDelayedBuffer *) queue->data;
+  GstBuffer *buf = heap[0].buf;
+  guint i = 0, len;
+
+  heap[0] = heap[queue->len - 1];
+  g_array_set_size (queue, queue->len - 1);
+  len = queue->len;
+
+  while (TRUE) {
+    guint left = 2 * i + 1, right = left + 1, smallest = i;
+    GstNetSimDelayedBuffer tmp;
+
+    if (left < len && delayed_buffer_before (&heap[left], &heap[smallest]))
+      smallest = left;
+    if (right < len && delayed_buffer_before (&heap[right], &heap[smallest]))
+      smallest = right;
+    if (smallest == i)
+      break;
+
+    tmp = heap[smallest];
+    heap[smallest] = heap[i];
+    heap[i] = tmp;
+    i = smallest;
+  }
+
+  return buf;
+}
+
+static void
+delay_queue_clear (GArray * queue)
 {
-  GMainLoop *main_loop = user_data;
-  GST_DEBUG ("MAINLOOP: Quit %p", main_loop);
-  g_main_loop_quit (main_loop);
-  g_assert (!g_main_loop_is_running (main_loop));
-  return FALSE;                 /* Remove source */
+  guint i;
+
+  for (i = 0; i < queue->len; i++)
+    gst_buffer_unref (g_array_index (queue, GstNetSimDelayedBuffer, i).buf);
+  g_array_set_size (queue, 0);
 }
 
-static gboolean
-gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
-    GstPadMode mode, gboolean active)
+static void
+gst_net_sim_loop (GstNetSim * netsim)
 {
-  GstNetSim *netsim = GST_NET_SIM (parent);
-  gboolean result = FALSE;
+  GstBufferList *list = NULL;
+  GstBuffer *buf = NULL;
+  gint64 now;
 
   g_mutex_lock (&netsim->loop_mutex);
-  if (active) {
-    if (netsim->main_loop == NULL) {
-      GMainContext *main_context = g_main_context_new ();
-      netsim->main_loop = g_main_loop_new (main_context, FALSE);
-      g_main_context_unref (main_context);
-
-      GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
-      result = gst_pad_start_task (netsim->srcpad,
-          (GstTaskFunction) gst_net_sim_loop, netsim, NULL);
-
-      GST_TRACE_OBJECT (netsim, "ACT: Wait for task to start");
-      g_assert (!netsim->running);
-      while (!netsim->running)
-        g_cond_wait (&netsim->start_cond, &netsim->loop_mutex);
-      GST_TRACE_OBJECT (netsim, "ACT: Task on srcpad started");
+  while (netsim->running) {
+    GstNetSimDelayedBuffer *head;
+
+    if (netsim->delay_queue->len == 0) {
+      g_cond_wait (&netsim->delay_cond, &netsim->loop_mutex);
+      continue;
     }
-  } else {
-    if (netsim->main_loop != NULL) {
-      GSource *source;
-      guint id;
-
-      /* Adds an Idle Source which quits the main loop from within.
-       * This removes the possibility for run/quit race conditions. */
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping main loop on deactivate");
-      source = g_idle_source_new ();
-      g_source_set_callback (source, _main_loop_quit_and_remove_source,
-          g_main_loop_ref (netsim->main_loop),
-          (GDestroyNotify) g_main_loop_unref);
-      id = g_source_attach (source,
-          g_main_loop_get_context (netsim->main_loop));
-      g_source_unref (source);
-      g_assert_cmpuint (id, >, 0);
-      g_main_loop_unref (netsim->main_loop);
-      netsim->main_loop = NULL;
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Wait for mainloop and task to pause");
-      g_assert (netsim->running);
-      while (netsim->running)
-        g_cond_wait (&netsim->start_cond, &netsim->loop_mutex);
-
-      GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
-      result = gst_pad_stop_task (netsim->srcpad);
-      GST_TRACE_OBJECT (netsim, "DEACT: Mainloop and GstTask stopped");
+
+    head = &g_array_index (netsim->delay_queue, GstNetSimDelayedBuffer, 0);
+    if (head->ready_time > g_get_monotonic_time ()) {
+      g_cond_wait_until (&netsim->delay_cond, &netsim->loop_mutex,
+          head->ready_time);
+      continue;
     }
+
+    break;
   }
-  g_mutex_unlock (&netsim->loop_mutex);
 
-  return result;
-}
+  if (!netsim->running) {
+    GST_TRACE_OBJECT (netsim, "TASK: pause");
+    g_mutex_unlock (&netsim->loop_mutex);
+    gst_pad_pause_task (netsim->srcpad);
+    return;
+  }
 
-typedef struct
-{
-  GstPad *pad;
-  GstBuffer *buf;
-} PushBufferCtx;
+  /* Take everything that is due, and push it in one go */
+  now = g_get_monotonic_time ();
+  while (netsim->delay_queue->len > 0 &&
+      g_array_index (netsim->delay_queue, GstNetSimDelayedBuffer,
+          0).ready_time <= now) {
+    GstBuffer *due = delay_queue_pop (netsim->delay_queue);
 
-G_INLINE_FUNC PushBufferCtx *
-push_buffer_ctx_new (GstPad * pad, GstBuffer * buf)
-{
-  PushBufferCtx *ctx = g_slice_new (PushBufferCtx);
-  ctx->pad = gst_object_ref (pad);
-  ctx->buf = gst_buffer_ref (buf);
-  return ctx;
-}
+    if (buf == NULL) {
+      buf = due;
+    } else {
+      if (list == NULL) {
+        list = gst_buffer_list_new ();
+        gst_buffer_list_add (list, buf);
+      }
+      gst_buffer_list_add (list, due);
+    }
+  }
+  g_mutex_unlock (&netsim->loop_mutex);
 
-G_INLINE_FUNC void
-push_buffer_ctx_free (PushBufferCtx * ctx)
-{
-  if (G_LIKELY (ctx != NULL)) {
-    gst_buffer_unref (ctx->buf);
-    gst_object_unref (ctx->pad);
-    g_slice_free (PushBufferCtx, ctx);
+  if (list) {
+    GST_DEBUG_OBJECT (netsim, "Pushing %u delayed buffers now",
+        gst_buffer_list_length (list));
+    gst_pad_push_list (netsim->srcpad, list);
+  } else {
+    GST_DEBUG_OBJECT (netsim, "Pushing buffer now");
+    gst_pad_push (netsim->srcpad, buf);
   }
 }
 
 static gboolean
-push_buffer_ctx_push (PushBufferCtx * ctx)
+gst_net_sim_src_activatemode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
 {
-  GST_DEBUG_OBJECT (ctx->pad, "Pushing buffer now");
-  gst_pad_push (ctx->pad, gst_buffer_ref (ctx->buf));
-  return FALSE;
+  GstNetSim *netsim = GST_NET_SIM (parent);
+  gboolean result;
+
+  if (active) {
+    g_mutex_lock (&netsim->loop_mutex);
+    netsim->running = TRUE;
+    g_mutex_unlock (&netsim->loop_mutex);
+
+    GST_TRACE_OBJECT (netsim, "ACT: Starting task on srcpad");
+    result = gst_pad_start_task (netsim->srcpad,
+        (GstTaskFunction) gst_net_sim_loop, netsim, NULL);
+  } else {
+    g_mutex_lock (&netsim->loop_mutex);
+    netsim->running = FALSE;
+    g_cond_signal (&netsim->delay_cond);
+    g_mutex_unlock (&netsim->loop_mutex);
+
+    GST_TRACE_OBJECT (netsim, "DEACT: Stopping task on srcpad");
+    result = gst_pad_stop_task (netsim->srcpad);
+
+    g_mutex_lock (&netsim->loop_mutex);
+    delay_queue_clear (netsim->delay_queue);
+    g_mutex_unlock (&netsim->loop_mutex);
+    GST_TRACE_OBJECT (netsim, "DEACT: Task stopped");
+  }
+
+  return result;
 }
 
 static gint
@@ -326,87 +362,101 @@ get_random_value_gamma (GRand * rand_seed, gint32 low, gint32 high,
   return round (x + low);
 }
 
-static GstFlowReturn
+/* Returns TRUE if @buf was queued to be pushed later */
+static gboolean
 gst_net_sim_delay_buffer (GstNetSim * netsim, GstBuffer * buf)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
+  GstNetSimDelayedBuffer item;
+  gint delay;
+  gint64 now_time;
+
+  if (netsim->delay_probability <= 0 ||
+      g_rand_double (netsim->rand_seed) >= netsim->delay_probability)
+    return FALSE;
+
+  switch (netsim->delay_distribution) {
+    case DISTRIBUTION_UNIFORM:
+      delay = get_random_value_uniform (netsim->rand_seed, netsim->min_delay,
+          netsim->max_delay);
+      break;
+    case DISTRIBUTION_NORMAL:
+      delay = get_random_value_normal (netsim->rand_seed, netsim->min_delay,
+          netsim->max_delay, &netsim->delay_state);
+      break;
+    case DISTRIBUTION_GAMMA:
+      delay = get_random_value_gamma (netsim->rand_seed, netsim->min_delay,
+          netsim->max_delay, &netsim->delay_state);
+      break;
+    default:
+      g_assert_not_reached ();
+      break;
+  }
+
+  if (delay < 0)
+    delay = 0;
 
   g_mutex_lock (&netsim->loop_mutex);
-  if (netsim->main_loop != NULL && netsim->delay_probability > 0 &&
-      g_rand_double (netsim->rand_seed) < netsim->delay_probability) {
-    gint delay;
-    PushBufferCtx *ctx;
-    GSource *source;
-    gint64 ready_time, now_time;
-
-    switch (netsim->delay_distribution) {
-      case DISTRIBUTION_UNIFORM:
-        delay = get_random_value_uniform (netsim->rand_seed, netsim->min_delay,
-            netsim->max_delay);
-        break;
-      case DISTRIBUTION_NORMAL:
-        delay = get_random_value_normal (netsim->rand_seed, netsim->min_delay,
-            netsim->max_delay, &netsim->delay_state);
-        break;
-      case DISTRIBUTION_GAMMA:
-        delay = get_random_value_gamma (netsim->rand_seed, netsim->min_delay,
-            netsim->max_delay, &netsim->delay_state);
-        break;
-      default:
-        g_assert_not_reached ();
-        break;
-    }
+  if (!netsim->running) {
+    g_mutex_unlock (&netsim->loop_mutex);
+    return FALSE;
+  }
 
-    if (delay < 0)
-      delay = 0;
+  now_time = g_get_monotonic_time ();
+  item.ready_time = now_time + delay * 1000;
+  if (!netsim->allow_reordering && item.ready_time < netsim->last_ready_time)
+    item.ready_time = netsim->last_ready_time + 1;
+  item.seqnum = netsim->delay_seqnum++;
+  item.buf = gst_buffer_ref (buf);
 
-    ctx = push_buffer_ctx_new (netsim->srcpad, buf);
+  netsim->last_ready_time = item.ready_time;
+  GST_DEBUG_OBJECT (netsim, "Delaying packet by %" G_GINT64_FORMAT "ms",
+      (item.ready_time - now_time) / 1000);
 
-    source = g_source_new (&gst_net_sim_source_funcs, sizeof (GSource));
-    now_time = g_get_monotonic_time ();
-    ready_time = now_time + delay * 1000;
-    if (!netsim->allow_reordering && ready_time < netsim->last_ready_time)
-      ready_time = netsim->last_ready_time + 1;
+  delay_queue_push (netsim->delay_queue, &item);
+
+  /* Only wake up the task if this is its new deadline */
+  if (g_array_index (netsim->delay_queue, GstNetSimDelayedBuffer,
+          0).seqnum == item.seqnum)
+    g_cond_signal (&netsim->delay_cond);
+  g_mutex_unlock (&netsim->loop_mutex);
 
-    netsim->last_ready_time = ready_time;
-    GST_DEBUG_OBJECT (netsim, "Delaying packet by %" G_GINT64_FORMAT "ms",
-        (ready_time - now_time) / 1000);
+  return TRUE;
+}
 
-    g_source_set_ready_time (source, ready_time);
-    g_source_set_callback (source, (GSourceFunc) push_buffer_ctx_push,
-        ctx, (GDestroyNotify) push_buffer_ctx_free);
-    g_source_attach (source, g_main_loop_get_context (netsim->main_loop));
-    g_source_unref (source);
+/* The token bucket needs the clock time, it's read once per buffer or
+ * buffer list */
+static GstClockTime
+gst_net_sim_get_bucket_time (GstNetSim * netsim)
+{
+  GstClockTime current_time = 0;
+  GstClock *clock;
+
+  if (netsim->max_bucket_size == -1 || netsim->max_kbps == -1)
+    return 0;
+
+  clock = gst_element_get_clock (GST_ELEMENT_CAST (netsim));
+  if (clock == NULL) {
+    GST_WARNING_OBJECT (netsim, "No clock, can't get the time");
   } else {
-    ret = gst_pad_push (netsim->srcpad, gst_buffer_ref (buf));
+    current_time = gst_clock_get_time (clock);
+    gst_object_unref (clock);
   }
-  g_mutex_unlock (&netsim->loop_mutex);
 
-  return ret;
+  return current_time;
 }
 
 static gint
-gst_net_sim_get_tokens (GstNetSim * netsim)
+gst_net_sim_get_tokens (GstNetSim * netsim, GstClockTime current_time)
 {
   gint tokens = 0;
   GstClockTimeDiff elapsed_time = 0;
-  GstClockTime current_time = 0;
   GstClockTimeDiff token_time;
-  GstClock *clock;
 
   /* check for umlimited kbps and fill up the bucket if that is the case,
    * if not, calculate the number of tokens to add based on the elapsed time */
   if (netsim->max_kbps == -1)
     return netsim->max_bucket_size * 1000 - netsim->bucket_size;
 
-  /* get the current time */
-  clock = gst_element_get_clock (GST_ELEMENT_CAST (netsim));
-  if (clock == NULL) {
-    GST_WARNING_OBJECT (netsim, "No clock, can't get the time");
-  } else {
-    current_time = gst_clock_get_time (clock);
-  }
-
   /* get the elapsed time */
   if (GST_CLOCK_TIME_IS_VALID (netsim->prev_time)) {
     if (current_time < netsim->prev_time) {
@@ -427,12 +477,12 @@ gst_net_sim_get_tokens (GstNetSim * netsim)
 
   /* increment the time with how much we spent in terms of whole tokens */
   netsim->prev_time += token_time;
-  gst_object_unref (clock);
   return tokens;
 }
 
 static gboolean
-gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf)
+gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf,
+    GstClockTime current_time)
 {
   gsize buffer_size;
   gint tokens;
@@ -443,7 +493,7 @@ gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf)
 
   /* get buffer size in bits */
   buffer_size = gst_buffer_get_size (buf) * 8;
-  tokens = gst_net_sim_get_tokens (netsim);
+  tokens = gst_net_sim_get_tokens (netsim, current_time);
 
   netsim->bucket_size = MIN (G_MAXINT, netsim->bucket_size + tokens);
   GST_LOG_OBJECT (netsim,
@@ -468,38 +518,88 @@ gst_net_sim_token_bucket (GstNetSim * netsim, GstBuffer * buf)
   return TRUE;
 }
 
-static GstFlowReturn
-gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+/* Applies the token bucket, drops, duplicates and delays to @buf. Returns
+ * how many copies of it must be pushed right away */
+static guint
+gst_net_sim_process_buffer (GstNetSim * netsim, GstBuffer * buf,
+    GstClockTime current_time)
 {
-  GstNetSim *netsim = GST_NET_SIM (parent);
-  GstFlowReturn ret = GST_FLOW_OK;
+  guint copies = 1, n_push = 0;
 
-  if (!gst_net_sim_token_bucket (netsim, buf))
-    goto done;
+  if (!gst_net_sim_token_bucket (netsim, buf, current_time))
+    return 0;
 
   if (netsim->drop_packets > 0) {
     netsim->drop_packets--;
     GST_DEBUG_OBJECT (netsim, "Dropping packet (%d left)",
         netsim->drop_packets);
+    return 0;
   } else if (netsim->drop_probability > 0
       && g_rand_double (netsim->rand_seed) <
       (gdouble) netsim->drop_probability) {
     GST_DEBUG_OBJECT (netsim, "Dropping packet");
+    return 0;
   } else if (netsim->duplicate_probability > 0 &&
       g_rand_double (netsim->rand_seed) <
       (gdouble) netsim->duplicate_probability) {
     GST_DEBUG_OBJECT (netsim, "Duplicating packet");
-    gst_net_sim_delay_buffer (netsim, buf);
-    ret = gst_net_sim_delay_buffer (netsim, buf);
-  } else {
-    ret = gst_net_sim_delay_buffer (netsim, buf);
+    copies = 2;
   }
 
-done:
+  while (copies--) {
+    if (!gst_net_sim_delay_buffer (netsim, buf))
+      n_push++;
+  }
+
+  return n_push;
+}
+
+static GstFlowReturn
+gst_net_sim_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstNetSim *netsim = GST_NET_SIM (parent);
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint n_push;
+
+  n_push = gst_net_sim_process_buffer (netsim, buf,
+      gst_net_sim_get_bucket_time (netsim));
+
+  while (n_push--)
+    ret = gst_pad_push (netsim->srcpad, gst_buffer_ref (buf));
+
   gst_buffer_unref (buf);
   return ret;
 }
 
+static GstFlowReturn
+gst_net_sim_chain_list (GstPad * pad, GstObject * parent, GstBufferList * list)
+{
+  GstNetSim *netsim = GST_NET_SIM (parent);
+  GstClockTime current_time = gst_net_sim_get_bucket_time (netsim);
+  GstBufferList *out;
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint i, len;
+
+  len = gst_buffer_list_length (list);
+  out = gst_buffer_list_new_sized (len);
+
+  for (i = 0; i < len; i++) {
+    GstBuffer *buf = gst_buffer_list_get (list, i);
+    guint n_push = gst_net_sim_process_buffer (netsim, buf, current_time);
+
+    while (n_push--)
+      gst_buffer_list_add (out, gst_buffer_ref (buf));
+  }
+  gst_buffer_list_unref (list);
+
+  /* Whatever isn't dropped or delayed goes out as a list again */
+  if (gst_buffer_list_length (out) > 0)
+    ret = gst_pad_push_list (netsim->srcpad, out);
+  else
+    gst_buffer_list_unref (out);
+
+  return ret;
+}
 
 static void
 gst_net_sim_set_property (GObject * object,
@@ -602,9 +702,10 @@ gst_net_sim_init (GstNetSim * netsim)
   gst_element_add_pad (GST_ELEMENT (netsim), netsim->sinkpad);
 
   g_mutex_init (&netsim->loop_mutex);
-  g_cond_init (&netsim->start_cond);
+  g_cond_init (&netsim->delay_cond);
+  netsim->delay_queue = g_array_sized_new (FALSE, FALSE,
+      sizeof (GstNetSimDelayedBuffer), DELAY_QUEUE_PREALLOC);
   netsim->rand_seed = g_rand_new ();
-  netsim->main_loop = NULL;
   netsim->prev_time = GST_CLOCK_TIME_NONE;
 
   GST_OBJECT_FLAG_SET (netsim->sinkpad,
@@ -612,6 +713,8 @@ gst_net_sim_init (GstNetSim * netsim)
 
   gst_pad_set_chain_function (netsim->sinkpad,
       GST_DEBUG_FUNCPTR (gst_net_sim_chain));
+  gst_pad_set_chain_list_function (netsim->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_net_sim_chain_list));
   gst_pad_set_activatemode_function (netsim->srcpad,
       GST_DEBUG_FUNCPTR (gst_net_sim_src_activatemode));
 }
@@ -622,8 +725,9 @@ gst_net_sim_finalize (GObject * object)
   GstNetSim *netsim = GST_NET_SIM (object);
 
   g_rand_free (netsim->rand_seed);
+  g_array_free (netsim->delay_queue, TRUE);
   g_mutex_clear (&netsim->loop_mutex);
-  g_cond_clear (&netsim->start_cond);
+  g_cond_clear (&netsim->delay_cond);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->finalize (object);
 }
@@ -633,7 +737,7 @@ gst_net_sim_dispose (GObject * object)
 {
   GstNetSim *netsim = GST_NET_SIM (object);
 
-  g_assert (netsim->main_loop == NULL);
+  g_assert (!netsim->running);
 
   G_OBJECT_CLASS (gst_net_sim_parent_class)->dispose (object);
 }
@@ -67,9 +67,11 @@ struct _GstNetSim
   GstPad *sinkpad;
   GstPad *srcpad;
 
+  /* protects the delay queue, which is drained by the srcpad task */
   GMutex loop_mutex;
-  GCond start_cond;
-  GMainLoop *main_loop;
+  GCond delay_cond;
+  GArray *delay_queue;
+  guint64 delay_seqnum;
   gboolean running;
   GRand *rand_seed;
   gsize bucket_size;
@@ -236,6 +236,7 @@ gst_h264_parse_reset_stream_info (GstH264Parse * h264parse)
     gst_buffer_replace (&h264parse->sps_nals[i], NULL);
   for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++)
     gst_buffer_replace (&h264parse->pps_nals[i], NULL);
+  memset (h264parse->pps_cached, 0, sizeof (h264parse->pps_cached));
 }
 
 static void
@@ -483,6 +484,35 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
   store[id] = buf;
 }
 
+/* Returns the id of the stored SPS/PPS with the same bytes as @nalu, or -1.
+ * Encoders typically repeat identical parameter sets in front of every
+ * keyframe, which then need no parsing and no caps update */
+static gint
+gst_h264_parser_find_stored_nal (GstH264Parse * h264parse,
+    GstH264NalUnitType naltype, GstH264NalUnit * nalu)
+{
+  GstBuffer **store;
+  guint store_size, i;
+
+  if (naltype == GST_H264_NAL_SPS) {
+    store_size = GST_H264_MAX_SPS_COUNT;
+    store = h264parse->sps_nals;
+  } else if (naltype == GST_H264_NAL_PPS) {
+    store_size = GST_H264_MAX_PPS_COUNT;
+    store = h264parse->pps_nals;
+  } else
+    return -1;
+
+  for (i = 0; i < store_size; i++) {
+    if (store[i] && gst_buffer_get_size (store[i]) == nalu->size &&
+        gst_buffer_memcmp (store[i], 0, nalu->data + nalu->offset,
+            nalu->size) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
 #ifndef GST_DISABLE_GST_DEBUG
 static const gchar *nal_names[] = {
   "Unknown",
@@ -708,6 +738,7 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
   GstH264SPS sps = { 0, };
   GstH264NalParser *nalparser = h264parse->nalparser;
   GstH264ParserResult pres;
+  gint id;
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -731,6 +762,18 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     case GST_H264_NAL_SPS:
       /* reset state, everything else is obsolete */
       h264parse->state = 0;
+
+      id = gst_h264_parser_find_stored_nal (h264parse, nal_type, nalu);
+      if (id >= 0 && nalparser->sps[id].valid) {
+        GST_LOG_OBJECT (h264parse, "sps %d repeated", id);
+        if (nalparser->last_sps != &nalparser->sps[id]) {
+          GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
+          nalparser->last_sps = &nalparser->sps[id];
+          h264parse->update_caps = TRUE;
+        }
+        goto have_sps;
+      }
+
       pres = gst_h264_parser_parse_sps (nalparser, nalu, &sps, TRUE);
 
     process_sps:
@@ -742,6 +785,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
 
       GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
       h264parse->update_caps = TRUE;
+
+      gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
+      gst_h264_sps_clear (&sps);
+      /* PPS depend on the SPS they refer to, parse them again */
+      memset (h264parse->pps_cached, 0, sizeof (h264parse->pps_cached));
+
+    have_sps:
       h264parse->have_sps = TRUE;
       if (h264parse->push_codec && h264parse->have_pps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -752,8 +802,6 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
-      gst_h264_sps_clear (&sps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_SPS;
       h264parse->header |= TRUE;
       break;
@@ -763,6 +811,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       if (!GST_H264_PARSE_STATE_VALID (h264parse, GST_H264_PARSE_STATE_GOT_SPS))
         return FALSE;
 
+      id = gst_h264_parser_find_stored_nal (h264parse, nal_type, nalu);
+      if (id >= 0 && h264parse->pps_cached[id] && nalparser->pps[id].valid) {
+        GST_LOG_OBJECT (h264parse, "pps %d repeated", id);
+        nalparser->last_pps = &nalparser->pps[id];
+        goto have_pps;
+      }
+
       pres = gst_h264_parser_parse_pps (nalparser, nalu, &pps);
       /* arranged for a fallback pps.id, so use that one and only warn */
       if (pres != GST_H264_PARSER_OK) {
@@ -776,6 +831,13 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
         h264parse->update_caps = TRUE;
       }
+
+      gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
+      if (pres == GST_H264_PARSER_OK && pps.id < GST_H264_MAX_PPS_COUNT)
+        h264parse->pps_cached[pps.id] = TRUE;
+      gst_h264_pps_clear (&pps);
+
+    have_pps:
       h264parse->have_pps = TRUE;
       if (h264parse->push_codec && h264parse->have_sps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -786,8 +848,6 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
         h264parse->have_pps = FALSE;
       }
 
-      gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
-      gst_h264_pps_clear (&pps);
       h264parse->state |= GST_H264_PARSE_STATE_GOT_PPS;
       h264parse->header |= TRUE;
       break;
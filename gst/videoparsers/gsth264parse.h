@@ -90,6 +90,9 @@ struct _GstH264Parse
   /* collected SPS and PPS NALUs */
   GstBuffer *sps_nals[GST_H264_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H264_MAX_PPS_COUNT];
+  /* whether the stored PPS was parsed against the current SPS, so that
+   * an identical repeat needs no parsing */
+  guint8 pps_cached[GST_H264_MAX_PPS_COUNT];
 
   /* Infos we need to keep track of */
   guint32 sei_cpb_removal_delay;
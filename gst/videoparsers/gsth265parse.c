@@ -223,6 +223,8 @@ gst_h265_parse_reset_stream_info (GstH265Parse * h265parse)
     gst_buffer_replace (&h265parse->sps_nals[i], NULL);
   for (i = 0; i < GST_H265_MAX_PPS_COUNT; i++)
     gst_buffer_replace (&h265parse->pps_nals[i], NULL);
+  memset (h265parse->sps_cached, 0, sizeof (h265parse->sps_cached));
+  memset (h265parse->pps_cached, 0, sizeof (h265parse->pps_cached));
 }
 
 static void
@@ -461,6 +463,38 @@ gst_h265_parser_store_nal (GstH265Parse * h265parse, guint id,
   store[id] = buf;
 }
 
+/* Returns the id of the stored VPS/SPS/PPS with the same bytes as @nalu, or
+ * -1. Encoders typically repeat identical parameter sets in front of every
+ * keyframe, which then need no parsing and no caps update */
+static gint
+gst_h265_parser_find_stored_nal (GstH265Parse * h265parse,
+    GstH265NalUnitType naltype, GstH265NalUnit * nalu)
+{
+  GstBuffer **store;
+  guint store_size, i;
+
+  if (naltype == GST_H265_NAL_VPS) {
+    store_size = GST_H265_MAX_VPS_COUNT;
+    store = h265parse->vps_nals;
+  } else if (naltype == GST_H265_NAL_SPS) {
+    store_size = GST_H265_MAX_SPS_COUNT;
+    store = h265parse->sps_nals;
+  } else if (naltype == GST_H265_NAL_PPS) {
+    store_size = GST_H265_MAX_PPS_COUNT;
+    store = h265parse->pps_nals;
+  } else
+    return -1;
+
+  for (i = 0; i < store_size; i++) {
+    if (store[i] && gst_buffer_get_size (store[i]) == nalu->size &&
+        gst_buffer_memcmp (store[i], 0, nalu->data + nalu->offset,
+            nalu->size) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
 #ifndef GST_DISABLE_GST_DEBUG
 static const gchar *nal_names[] = {
   "Slice_TRAIL_N",
@@ -526,6 +560,7 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
   guint nal_type;
   GstH265Parser *nalparser = h265parse->nalparser;
   GstH265ParserResult pres = GST_H265_PARSER_ERROR;
+  gint id;
 
   /* nothing to do for broken input */
   if (G_UNLIKELY (nalu->size < 2)) {
@@ -542,6 +577,13 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
     case GST_H265_NAL_VPS:
       /* It is not mandatory to have VPS in the stream. But it might
        * be needed for other extensions like svc */
+      id = gst_h265_parser_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && nalparser->vps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "vps %d repeated", id);
+        nalparser->last_vps = &nalparser->vps[id];
+        goto have_vps;
+      }
+
       pres = gst_h265_parser_parse_vps (nalparser, nalu, &vps);
       if (pres != GST_H265_PARSER_OK) {
         GST_WARNING_OBJECT (h265parse, "failed to parse VPS");
@@ -550,6 +592,13 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
 
       GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
       h265parse->update_caps = TRUE;
+
+      gst_h265_parser_store_nal (h265parse, vps.id, nal_type, nalu);
+      /* SPS and PPS depend on the VPS, parse them again */
+      memset (h265parse->sps_cached, 0, sizeof (h265parse->sps_cached));
+      memset (h265parse->pps_cached, 0, sizeof (h265parse->pps_cached));
+
+    have_vps:
       h265parse->have_vps = TRUE;
       if (h265parse->push_codec && h265parse->have_pps) {
         /* VPS/SPS/PPS found in stream before the first pre_push_frame, no need
@@ -561,13 +610,23 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, vps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       break;
     case GST_H265_NAL_SPS:
       /* reset state, everything else is obsolete */
       h265parse->state = 0;
 
+      id = gst_h265_parser_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && h265parse->sps_cached[id] && nalparser->sps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "sps %d repeated", id);
+        if (nalparser->last_sps != &nalparser->sps[id]) {
+          GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
+          nalparser->last_sps = &nalparser->sps[id];
+          h265parse->update_caps = TRUE;
+        }
+        goto have_sps;
+      }
+
       pres = gst_h265_parser_parse_sps (nalparser, nalu, &sps, TRUE);
 
 
@@ -579,6 +638,14 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
 
       GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
       h265parse->update_caps = TRUE;
+
+      gst_h265_parser_store_nal (h265parse, sps.id, nal_type, nalu);
+      if (sps.id < GST_H265_MAX_SPS_COUNT)
+        h265parse->sps_cached[sps.id] = TRUE;
+      /* PPS depend on the SPS they refer to, parse them again */
+      memset (h265parse->pps_cached, 0, sizeof (h265parse->pps_cached));
+
+    have_sps:
       h265parse->have_sps = TRUE;
       if (h265parse->push_codec && h265parse->have_pps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -589,7 +656,6 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, sps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       h265parse->state |= GST_H265_PARSE_STATE_GOT_SPS;
       break;
@@ -599,6 +665,13 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
       if (!GST_H265_PARSE_STATE_VALID (h265parse, GST_H265_PARSE_STATE_GOT_SPS))
         return FALSE;
 
+      id = gst_h265_parser_find_stored_nal (h265parse, nal_type, nalu);
+      if (id >= 0 && h265parse->pps_cached[id] && nalparser->pps[id].valid) {
+        GST_LOG_OBJECT (h265parse, "pps %d repeated", id);
+        nalparser->last_pps = &nalparser->pps[id];
+        goto have_pps;
+      }
+
       pres = gst_h265_parser_parse_pps (nalparser, nalu, &pps);
 
 
@@ -614,6 +687,12 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         GST_DEBUG_OBJECT (h265parse, "triggering src caps check");
         h265parse->update_caps = TRUE;
       }
+
+      gst_h265_parser_store_nal (h265parse, pps.id, nal_type, nalu);
+      if (pres == GST_H265_PARSER_OK && pps.id < GST_H265_MAX_PPS_COUNT)
+        h265parse->pps_cached[pps.id] = TRUE;
+
+    have_pps:
       h265parse->have_pps = TRUE;
       if (h265parse->push_codec && h265parse->have_sps) {
         /* SPS and PPS found in stream before the first pre_push_frame, no need
@@ -624,7 +703,6 @@ gst_h265_parse_process_nal (GstH265Parse * h265parse, GstH265NalUnit * nalu)
         h265parse->have_pps = FALSE;
       }
 
-      gst_h265_parser_store_nal (h265parse, pps.id, nal_type, nalu);
       h265parse->header |= TRUE;
       h265parse->state |= GST_H265_PARSE_STATE_GOT_PPS;
       break;
@@ -80,6 +80,10 @@ struct _GstH265Parse
   GstBuffer *vps_nals[GST_H265_MAX_VPS_COUNT];
   GstBuffer *sps_nals[GST_H265_MAX_SPS_COUNT];
   GstBuffer *pps_nals[GST_H265_MAX_PPS_COUNT];
+  /* whether the stored SPS/PPS were parsed against the current VPS/SPS, so
+   * that an identical repeat needs no parsing */
+  guint8 sps_cached[GST_H265_MAX_SPS_COUNT];
+  guint8 pps_cached[GST_H265_MAX_PPS_COUNT];
 
   gboolean discont;
 
@@ -27,10 +27,27 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/allocators.h>
 #include "gstipcpipelinecomm.h"
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#if defined(__NR_memfd_create)
+#define HAVE_MEMFD 1
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+#endif
+
+/* maximum number of fds collected by a single read */
+#define MAX_FDS_PER_READ 16
+
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 #define GST_CAT_DEFAULT gst_ipc_pipeline_comm_debug
 
@@ -62,6 +79,7 @@ typedef struct
   guint32 ret;
   GstQuery *query;
   CommRequestType type;
+  gboolean async;
   GCond cond;
 } CommRequest;
 
@@ -69,6 +87,168 @@ static const gchar *comm_request_ret_get_name (CommRequestType type,
     guint32 ret);
 static guint32 comm_request_ret_get_failure_value (CommRequestType type);
 
+#ifdef HAVE_MEMFD
+/* Allocates each memory in its own memfd, so that it can be passed to the
+ * peer process as a file descriptor. The memfds of freed memory are kept in
+ * a small pool, as creating and mapping new ones for every buffer costs
+ * more than the copy it saves for small buffers */
+#define MEMFD_POOL_SIZE 8
+
+/* set while the peer may still use the memory, it is not recycled then */
+#define MEMFD_MEMORY_FLAG_SHARED (GST_MEMORY_FLAG_LAST << 0)
+
+typedef struct
+{
+  gint fd;
+  gsize size;
+} MemfdPoolEntry;
+
+typedef struct
+{
+  GstFdAllocator parent;
+
+  GMutex lock;
+  GArray *pool;
+} GstIpcPipelineMemfdAllocator;
+
+typedef GstFdAllocatorClass GstIpcPipelineMemfdAllocatorClass;
+
+static GType gst_ipc_pipeline_memfd_allocator_get_type (void);
+G_DEFINE_TYPE (GstIpcPipelineMemfdAllocator, gst_ipc_pipeline_memfd_allocator,
+    GST_TYPE_FD_ALLOCATOR);
+
+static GstMemory *
+gst_ipc_pipeline_memfd_allocator_alloc (GstAllocator * allocator, gsize size,
+    GstAllocationParams * params)
+{
+  GstIpcPipelineMemfdAllocator *self =
+      (GstIpcPipelineMemfdAllocator *) allocator;
+  GstMemory *mem;
+  gsize maxsize = size + params->prefix + params->padding;
+  gint fd = -1;
+  guint i;
+
+  g_mutex_lock (&self->lock);
+  for (i = 0; i < self->pool->len; i++) {
+    MemfdPoolEntry *entry = &g_array_index (self->pool, MemfdPoolEntry, i);
+
+    if (entry->size == maxsize) {
+      fd = entry->fd;
+      g_array_remove_index_fast (self->pool, i);
+      break;
+    }
+  }
+  g_mutex_unlock (&self->lock);
+
+  if (fd < 0) {
+    fd = syscall (__NR_memfd_create, "ipcpipeline", MFD_CLOEXEC);
+    if (fd < 0) {
+      GST_ERROR_OBJECT (allocator, "memfd_create failed: %s",
+          strerror (errno));
+      return NULL;
+    }
+    if (ftruncate (fd, maxsize) < 0) {
+      GST_ERROR_OBJECT (allocator, "ftruncate failed: %s", strerror (errno));
+      close (fd);
+      return NULL;
+    }
+  } else {
+    GST_TRACE_OBJECT (allocator, "Reusing memfd %d of %" G_GSIZE_FORMAT
+        " bytes", fd, maxsize);
+  }
+
+  /* the fd is closed or recycled in our free function */
+  mem = gst_fd_allocator_alloc (allocator, fd, maxsize,
+      GST_FD_MEMORY_FLAG_DONT_CLOSE);
+  gst_memory_resize (mem, params->prefix, size);
+
+  return mem;
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_free (GstAllocator * allocator,
+    GstMemory * mem)
+{
+  GstIpcPipelineMemfdAllocator *self =
+      (GstIpcPipelineMemfdAllocator *) allocator;
+  gint fd = gst_fd_memory_get_fd (mem);
+  gsize size = mem->maxsize;
+  gboolean shared = GST_MEMORY_FLAG_IS_SET (mem, MEMFD_MEMORY_FLAG_SHARED);
+
+  GST_ALLOCATOR_CLASS (gst_ipc_pipeline_memfd_allocator_parent_class)->free
+      (allocator, mem);
+
+  /* memory the peer did not release may still be mapped on its side, it
+   * must not be handed out again */
+  if (!shared) {
+    g_mutex_lock (&self->lock);
+    if (self->pool->len < MEMFD_POOL_SIZE) {
+      MemfdPoolEntry entry = { fd, size };
+
+      g_array_append_val (self->pool, entry);
+      fd = -1;
+    }
+    g_mutex_unlock (&self->lock);
+  }
+
+  if (fd >= 0)
+    close (fd);
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_finalize (GObject * object)
+{
+  GstIpcPipelineMemfdAllocator *self = (GstIpcPipelineMemfdAllocator *) object;
+  guint i;
+
+  for (i = 0; i < self->pool->len; i++)
+    close (g_array_index (self->pool, MemfdPoolEntry, i).fd);
+  g_array_free (self->pool, TRUE);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (gst_ipc_pipeline_memfd_allocator_parent_class)->finalize
+      (object);
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_class_init (GstIpcPipelineMemfdAllocatorClass
+    * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstAllocatorClass *allocator_class = (GstAllocatorClass *) klass;
+
+  gobject_class->finalize = gst_ipc_pipeline_memfd_allocator_finalize;
+  allocator_class->alloc = gst_ipc_pipeline_memfd_allocator_alloc;
+  allocator_class->free = gst_ipc_pipeline_memfd_allocator_free;
+}
+
+static void
+gst_ipc_pipeline_memfd_allocator_init (GstIpcPipelineMemfdAllocator * self)
+{
+  GST_OBJECT_FLAG_UNSET (self, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+  g_mutex_init (&self->lock);
+  self->pool = g_array_sized_new (FALSE, FALSE, sizeof (MemfdPoolEntry),
+      MEMFD_POOL_SIZE);
+}
+#endif
+
+/* Marks @mem, if it comes from our memfd allocator, as used by the peer or
+ * not. Must be called with the comm mutex */
+static void
+memfd_memory_set_shared (GstMemory * mem, gboolean shared)
+{
+#ifdef HAVE_MEMFD
+  if (!G_TYPE_CHECK_INSTANCE_TYPE (mem->allocator,
+          gst_ipc_pipeline_memfd_allocator_get_type ()))
+    return;
+
+  if (shared)
+    GST_MINI_OBJECT_FLAG_SET (mem, MEMFD_MEMORY_FLAG_SHARED);
+  else
+    GST_MINI_OBJECT_FLAG_UNSET (mem, MEMFD_MEMORY_FLAG_SHARED);
+#endif
+}
+
 static CommRequest *
 comm_request_new (guint32 id, CommRequestType type, GstQuery * query)
 {
@@ -82,6 +262,7 @@ comm_request_new (guint32 id, CommRequestType type, GstQuery * query)
   req->query = query;
   req->ret = comm_request_ret_get_failure_value (type);
   req->type = type;
+  req->async = FALSE;
 
   return req;
 }
@@ -186,6 +367,10 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+      return "FD_BUFFER";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE:
+      return "RELEASE";
     default:
       return "UNKNOWN";
   }
@@ -212,6 +397,91 @@ gst_ipc_pipeline_comm_sync_fd (GstIpcPipelineComm * comm, guint32 id,
   return !comm_error;
 }
 
+static gboolean
+remove_pending_buffer (gpointer key, gpointer value, gpointer user_data)
+{
+  CommRequest *req = (CommRequest *) value;
+
+  return req->async;
+}
+
+/* Forgets about the buffers still waiting for their ACK, along with the
+ * result they may have got. Must be called with the comm mutex */
+static void
+gst_ipc_pipeline_comm_reset_pending_buffers (GstIpcPipelineComm * comm)
+{
+  if (comm->pending_buffers > 0) {
+    GST_DEBUG_OBJECT (comm->element, "Dropping %u unacked buffers",
+        comm->pending_buffers);
+    g_hash_table_foreach_remove (comm->waiting_ids, remove_pending_buffer,
+        NULL);
+    comm->pending_buffers = 0;
+    g_cond_broadcast (&comm->pending_cond);
+  }
+  comm->pending_flow_ret = GST_FLOW_OK;
+}
+
+/* Waits until at most @max buffers are waiting for their ACK. Like for the
+ * requests waiting with a timeout, the peer is considered gone if it does not
+ * acknowledge any buffer within ack_time, in which case the pending buffers
+ * are forgotten and FALSE is returned. Must be called with the comm mutex */
+static gboolean
+gst_ipc_pipeline_comm_wait_pending_buffers (GstIpcPipelineComm * comm,
+    guint max)
+{
+  guint pending = comm->pending_buffers;
+  gint64 end_time = g_get_monotonic_time () + comm->ack_time;
+
+  while (comm->pending_buffers > max) {
+    GST_TRACE_OBJECT (comm->element, "Waiting for %u buffers to be acked",
+        comm->pending_buffers - max);
+    if (!g_cond_wait_until (&comm->pending_cond, &comm->mutex, end_time)) {
+      if (comm->pending_buffers <= max)
+        break;
+      GST_ERROR_OBJECT (comm->element, "Timeout waiting for %u buffers to be "
+          "acked", comm->pending_buffers - max);
+      gst_ipc_pipeline_comm_reset_pending_buffers (comm);
+      return FALSE;
+    }
+    /* the deadline applies to each ACK, not to the whole window */
+    if (comm->pending_buffers < pending) {
+      pending = comm->pending_buffers;
+      end_time = g_get_monotonic_time () + comm->ack_time;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Waits for fdout to have room again after a write would have blocked, for
+ * at most ack_time */
+static gboolean
+wait_fdout_writable (GstIpcPipelineComm * comm)
+{
+  struct pollfd pfd;
+  gint timeout_ms = MIN (comm->ack_time / 1000, G_MAXINT);
+  gint res;
+
+  pfd.fd = comm->fdout;
+  pfd.events = POLLOUT;
+  do {
+    pfd.revents = 0;
+    res = poll (&pfd, 1, timeout_ms);
+  } while (res < 0 && errno == EINTR);
+
+  if (res < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to poll fd: %s",
+        strerror (errno));
+    return FALSE;
+  } else if (res == 0) {
+    GST_ERROR_OBJECT (comm->element, "Timed out waiting to write to fd");
+    return FALSE;
+  }
+
+  /* errors and hangups are reported by the next write */
+  return TRUE;
+}
+
 static gboolean
 write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
 {
@@ -224,8 +494,14 @@ write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
     ssize_t written =
         write (comm->fdout, (const unsigned char *) data + offset, size);
     if (written < 0) {
-      if (errno == EAGAIN || errno == EINTR)
+      if (errno == EINTR)
         continue;
+      if (errno == EAGAIN) {
+        if (wait_fdout_writable (comm))
+          continue;
+        ret = FALSE;
+        goto done;
+      }
       GST_ERROR_OBJECT (comm->element, "Failed to write to fd: %s",
           strerror (errno));
       ret = FALSE;
@@ -255,6 +531,149 @@ write_byte_writer_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw)
   return ret;
 }
 
+/* Whether fds can be passed to the peer, which needs fdout to be a Unix
+ * socket. Must be called with the comm mutex */
+static gboolean
+gst_ipc_pipeline_comm_can_pass_fds (GstIpcPipelineComm * comm)
+{
+  struct sockaddr_storage addr;
+  socklen_t len = sizeof (addr);
+
+  if (comm->fdout < 0)
+    return FALSE;
+  if (comm->fd_passing_fd == comm->fdout)
+    return comm->fd_passing;
+
+  comm->fd_passing_fd = comm->fdout;
+  comm->fd_passing =
+      getsockname (comm->fdout, (struct sockaddr *) &addr, &len) == 0
+      && addr.ss_family == AF_UNIX;
+  GST_DEBUG_OBJECT (comm->element, "fd %d can %spass file descriptors",
+      comm->fdout, comm->fd_passing ? "" : "not ");
+
+  return comm->fd_passing;
+}
+
+/* Writes the contents of @bw, with @fd attached to the first byte */
+static gboolean
+write_byte_writer_with_fd_to_fd (GstIpcPipelineComm * comm, GstByteWriter * bw,
+    gint fd)
+{
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  guint8 *data;
+  ssize_t written;
+  gboolean ret;
+  guint size;
+
+  size = gst_byte_writer_get_size (bw);
+  data = gst_byte_writer_reset_and_get_data (bw);
+  if (!data)
+    return FALSE;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&control, 0, sizeof (control));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+
+  GST_TRACE_OBJECT (comm->element, "Writing %u bytes and fd %d to fdout", size,
+      fd);
+  while ((written = sendmsg (comm->fdout, &msg, 0)) < 0) {
+    if (errno == EINTR)
+      continue;
+    if (errno != EAGAIN || !wait_fdout_writable (comm))
+      break;
+  }
+
+  if (written < 0) {
+    GST_ERROR_OBJECT (comm->element, "Failed to send fd: %s",
+        strerror (errno));
+    ret = FALSE;
+  } else {
+    /* the fd went with the first chunk, the rest is plain data */
+    ret = write_to_fd_raw (comm, data + written, size - written);
+  }
+
+  g_free (data);
+  return ret;
+}
+
+/* Reads from @fd like read(), collecting the fds passed along the data */
+static ssize_t
+read_from_fd (GstIpcPipelineComm * comm, gint fd, guint8 * data, gsize size)
+{
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int) * MAX_FDS_PER_READ)];
+  } control;
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  ssize_t sz;
+  gint flags = 0;
+
+  memset (&msg, 0, sizeof (msg));
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  sz = recvmsg (fd, &msg, flags);
+  if (sz < 0 && errno == ENOTSOCK)
+    return read (fd, data, size);
+  if (sz <= 0)
+    return sz;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      guint n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+      guint i;
+
+      for (i = 0; i < n_fds; i++) {
+        gint received_fd;
+
+        memcpy (&received_fd, CMSG_DATA (cmsg) + i * sizeof (int),
+            sizeof (int));
+        GST_TRACE_OBJECT (comm->element, "Received fd %d", received_fd);
+        g_queue_push_tail (&comm->received_fds, GINT_TO_POINTER (received_fd));
+      }
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC)
+    GST_WARNING_OBJECT (comm->element, "Some file descriptors were dropped");
+
+  return sz;
+}
+
+static void
+close_received_fds (GstIpcPipelineComm * comm)
+{
+  while (!g_queue_is_empty (&comm->received_fds))
+    close (GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds)));
+}
+
 static void
 gst_ipc_pipeline_comm_write_ack_to_fd (GstIpcPipelineComm * comm, guint32 id,
     guint32 ret, CommRequestType type)
@@ -496,11 +915,95 @@ typedef struct
   guint64 flags;
 } CommBufferMetadata;
 
+static gboolean
+put_meta_list (GstByteWriter * bw, const MetaListRepresentation * repr)
+{
+  guint32 n;
+
+  if (!gst_byte_writer_put_uint32_le (bw, repr->n_meta))
+    return FALSE;
+  for (n = 0; n < repr->n_meta; ++n) {
+    const MetaBuildInfo *info = repr->info + n;
+    guint32 len;
+    const char *s;
+
+    if (!gst_byte_writer_put_uint32_le (bw, info->bytes))
+      return FALSE;
+
+    if (!gst_byte_writer_put_uint32_le (bw, info->flags))
+      return FALSE;
+
+    s = g_type_name (info->api);
+    len = strlen (s) + 1;
+    if (!gst_byte_writer_put_uint32_le (bw, len))
+      return FALSE;
+    if (!gst_byte_writer_put_data (bw, (const guint8 *) s, len))
+      return FALSE;
+
+    if (!gst_byte_writer_put_uint64_le (bw, info->size))
+      return FALSE;
+
+    s = info->str;
+    len = s ? (strlen (s) + 1) : 0;
+    if (!gst_byte_writer_put_uint32_le (bw, len))
+      return FALSE;
+    if (len)
+      if (!gst_byte_writer_put_data (bw, (const guint8 *) s, len))
+        return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * gst_ipc_pipeline_comm_get_memfd_allocator:
+ * @comm: a #GstIpcPipelineComm
+ *
+ * Returns: (transfer full) (nullable): an allocator whose memory can be
+ * passed to the peer without copying, or %NULL if zero-copy is disabled or
+ * not possible on this fd
+ */
+GstAllocator *
+gst_ipc_pipeline_comm_get_memfd_allocator (GstIpcPipelineComm * comm)
+{
+  GstAllocator *allocator = NULL;
+
+  g_mutex_lock (&comm->mutex);
+#ifdef HAVE_MEMFD
+  if (comm->zero_copy && gst_ipc_pipeline_comm_can_pass_fds (comm)) {
+    if (!comm->memfd_allocator)
+      comm->memfd_allocator =
+          g_object_new (gst_ipc_pipeline_memfd_allocator_get_type (), NULL);
+    allocator = gst_object_ref (comm->memfd_allocator);
+  }
+#endif
+  g_mutex_unlock (&comm->mutex);
+
+  return allocator;
+}
+
+/* Returns the memory of @buffer if it can be passed as an fd. Must be called
+ * with the comm mutex */
+static GstMemory *
+get_passable_memory (GstIpcPipelineComm * comm, GstBuffer * buffer)
+{
+  GstMemory *mem;
+
+  if (!comm->zero_copy || gst_buffer_n_memory (buffer) != 1)
+    return NULL;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_is_fd_memory (mem) || !gst_ipc_pipeline_comm_can_pass_fds (comm))
+    return NULL;
+
+  return mem;
+}
+
 GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
   GstMapInfo map;
   guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
@@ -508,12 +1011,39 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
   GstByteWriter bw;
+  GstMemory *fd_mem;
+  gboolean windowed;
 
   g_mutex_lock (&comm->mutex);
+
+  /* with a window, only wait for an ACK once the window is full, and return
+   * what the previous buffers got */
+  windowed = comm->max_pending_buffers > 1;
+  if (windowed) {
+    if (!gst_ipc_pipeline_comm_wait_pending_buffers (comm,
+            comm->max_pending_buffers - 1)) {
+      g_mutex_unlock (&comm->mutex);
+      GST_ELEMENT_ERROR (comm->element, RESOURCE, WRITE, (NULL),
+          ("Failed to wait for reply on socket"));
+      return GST_FLOW_COMM_ERROR;
+    }
+    if (comm->pending_flow_ret != GST_FLOW_OK) {
+      ret = comm->pending_flow_ret;
+      GST_DEBUG_OBJECT (comm->element, "Previous buffer returned %s",
+          gst_flow_get_name (ret));
+      g_mutex_unlock (&comm->mutex);
+      return ret;
+    }
+  }
+
   ++comm->send_id;
 
-  GST_TRACE_OBJECT (comm->element, "Writing buffer %u: %" GST_PTR_FORMAT,
-      comm->send_id, buffer);
+  fd_mem = get_passable_memory (comm, buffer);
+  if (fd_mem)
+    payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER;
+
+  GST_TRACE_OBJECT (comm->element, "Writing %sbuffer %u: %" GST_PTR_FORMAT,
+      fd_mem ? "fd " : "", comm->send_id, buffer);
 
   gst_byte_writer_init (&bw);
 
@@ -531,62 +1061,72 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
-    goto write_failed;
-  size = gst_buffer_get_size (buffer);
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
-
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
 
-  /* meta */
-  gst_byte_writer_init (&bw);
-  if (!gst_byte_writer_put_uint32_le (&bw, repr.n_meta))
-    goto write_failed;
-  for (n = 0; n < repr.n_meta; ++n) {
-    const MetaBuildInfo *info = repr.info + n;
-    guint32 len;
-    const char *s;
-
-    if (!gst_byte_writer_put_uint32_le (&bw, info->bytes))
+  if (fd_mem) {
+    /* only the location of the data in the fd goes over the socket */
+    size = sizeof (CommBufferMetadata) + 2 * sizeof (guint64) +
+        sizeof (guint32) + repr.total_bytes;
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
       goto write_failed;
-
-    if (!gst_byte_writer_put_uint32_le (&bw, info->flags))
+    if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, fd_mem->maxsize))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, fd_mem->offset))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint32_le (&bw, fd_mem->size))
+      goto write_failed;
+    if (!put_meta_list (&bw, &repr))
+      goto write_failed;
+    if (!write_byte_writer_with_fd_to_fd (comm, &bw,
+            gst_fd_memory_get_fd (fd_mem)))
       goto write_failed;
 
-    s = g_type_name (info->api);
-    len = strlen (s) + 1;
-    if (!gst_byte_writer_put_uint32_le (&bw, len))
+    /* keep the memory until the peer is done with it, so that a buffer pool
+     * does not reuse it in the meantime */
+    memfd_memory_set_shared (fd_mem, TRUE);
+    g_hash_table_insert (comm->shared_memories,
+        GINT_TO_POINTER (comm->send_id), gst_memory_ref (fd_mem));
+  } else {
+    size =
+        gst_buffer_get_size (buffer) + sizeof (guint32) +
+        sizeof (CommBufferMetadata) + repr.total_bytes;
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
+      goto write_failed;
+    size = gst_buffer_get_size (buffer);
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
       goto write_failed;
-    if (!gst_byte_writer_put_data (&bw, (const guint8 *) s, len))
+    if (!write_byte_writer_to_fd (comm, &bw))
       goto write_failed;
 
-    if (!gst_byte_writer_put_uint64_le (&bw, info->size))
+    if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+      goto map_failed;
+    ret = write_to_fd_raw (comm, map.data, map.size);
+    gst_buffer_unmap (buffer, &map);
+    if (!ret)
       goto write_failed;
 
-    s = info->str;
-    len = s ? (strlen (s) + 1) : 0;
-    if (!gst_byte_writer_put_uint32_le (&bw, len))
+    /* meta */
+    gst_byte_writer_init (&bw);
+    if (!put_meta_list (&bw, &repr))
+      goto write_failed;
+    if (!write_byte_writer_to_fd (comm, &bw))
       goto write_failed;
-    if (len)
-      if (!gst_byte_writer_put_data (&bw, (const guint8 *) s, len))
-        goto write_failed;
   }
 
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
+  if (windowed) {
+    CommRequest *req;
+
+    req = comm_request_new (comm->send_id, COMM_REQUEST_TYPE_BUFFER, NULL);
+    req->async = TRUE;
+    g_hash_table_insert (comm->waiting_ids, GINT_TO_POINTER (comm->send_id),
+        req);
+    comm->pending_buffers++;
+    ret = GST_FLOW_OK;
+    goto done;
+  }
 
   if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
           ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
@@ -620,44 +1160,64 @@ map_failed:
   goto done;
 }
 
-static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+static void
+gst_ipc_pipeline_comm_write_release_to_fd (GstIpcPipelineComm * comm,
+    guint32 id)
 {
-  GstBuffer *buffer;
-  CommBufferMetadata meta;
-  guint32 n_meta, n;
-  const guint8 *payload = NULL;
-  guint32 mapped_size, buffer_data_size;
+  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE;
+  GstByteWriter bw;
 
-  /* this should not be called if we don't have enough yet */
-  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
-  g_return_val_if_fail (size >= sizeof (CommBufferMetadata), NULL);
+  g_mutex_lock (&comm->mutex);
 
-  mapped_size = sizeof (CommBufferMetadata) + sizeof (buffer_data_size);
-  payload = gst_adapter_map (comm->adapter, mapped_size);
-  if (!payload)
-    return NULL;
-  memcpy (&meta, payload, sizeof (CommBufferMetadata));
-  payload += sizeof (CommBufferMetadata);
-  memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
-  size -= mapped_size;
-  gst_adapter_unmap (comm->adapter);
-  gst_adapter_flush (comm->adapter, mapped_size);
+  /* the peer is gone, it does not wait for this anymore */
+  if (comm->fdout < 0)
+    goto done;
 
-  if (buffer_data_size == 0) {
-    buffer = gst_buffer_new ();
-  } else {
-    buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
-    gst_adapter_flush (comm->adapter, buffer_data_size);
-  }
-  size -= buffer_data_size;
+  GST_TRACE_OBJECT (comm->element, "Writing release of buffer %u", id);
+  gst_byte_writer_init (&bw);
+  if (!gst_byte_writer_put_uint8 (&bw, payload_type))
+    goto write_failed;
+  if (!gst_byte_writer_put_uint32_le (&bw, id))
+    goto write_failed;
+  if (!gst_byte_writer_put_uint32_le (&bw, 0))
+    goto write_failed;
+  if (!write_byte_writer_to_fd (comm, &bw))
+    goto write_failed;
 
-  GST_BUFFER_PTS (buffer) = meta.pts;
-  GST_BUFFER_DTS (buffer) = meta.dts;
-  GST_BUFFER_DURATION (buffer) = meta.duration;
-  GST_BUFFER_OFFSET (buffer) = meta.offset;
-  GST_BUFFER_OFFSET_END (buffer) = meta.offset_end;
-  GST_BUFFER_FLAGS (buffer) = meta.flags;
+done:
+  g_mutex_unlock (&comm->mutex);
+  return;
+
+write_failed:
+  gst_byte_writer_reset (&bw);
+  GST_WARNING_OBJECT (comm->element, "Failed to release buffer %u", id);
+  goto done;
+}
+
+typedef struct
+{
+  GstElement *element;
+  GstIpcPipelineComm *comm;
+  guint32 id;
+} SharedMemoryInfo;
+
+static void
+shared_memory_freed (gpointer user_data, GstMiniObject * obj)
+{
+  SharedMemoryInfo *info = user_data;
+
+  gst_ipc_pipeline_comm_write_release_to_fd (info->comm, info->id);
+  gst_object_unref (info->element);
+  g_free (info);
+}
+
+static gboolean
+gst_ipc_pipeline_comm_read_buffer_meta (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, guint32 size)
+{
+  guint32 n_meta, n;
+  const guint8 *payload = NULL;
+  guint32 mapped_size;
 
   /* If you don't call that, the GType isn't yet known at the
      g_type_from_name below */
@@ -665,10 +1225,8 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
 
   mapped_size = size;
   payload = gst_adapter_map (comm->adapter, mapped_size);
-  if (!payload) {
-    gst_buffer_unref (buffer);
-    return NULL;
-  }
+  if (!payload)
+    return FALSE;
   memcpy (&n_meta, payload, sizeof (n_meta));
   payload += sizeof (n_meta);
 
@@ -717,6 +1275,134 @@ gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
+  return TRUE;
+}
+
+static GstBuffer *
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+{
+  GstBuffer *buffer;
+  CommBufferMetadata meta;
+  const guint8 *payload = NULL;
+  guint32 mapped_size, buffer_data_size;
+
+  /* this should not be called if we don't have enough yet */
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
+  g_return_val_if_fail (size >= sizeof (CommBufferMetadata), NULL);
+
+  mapped_size = sizeof (CommBufferMetadata) + sizeof (buffer_data_size);
+  payload = gst_adapter_map (comm->adapter, mapped_size);
+  if (!payload)
+    return NULL;
+  memcpy (&meta, payload, sizeof (CommBufferMetadata));
+  payload += sizeof (CommBufferMetadata);
+  memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
+  size -= mapped_size;
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+
+  if (buffer_data_size == 0) {
+    buffer = gst_buffer_new ();
+  } else {
+    buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
+    gst_adapter_flush (comm->adapter, buffer_data_size);
+  }
+  size -= buffer_data_size;
+
+  GST_BUFFER_PTS (buffer) = meta.pts;
+  GST_BUFFER_DTS (buffer) = meta.dts;
+  GST_BUFFER_DURATION (buffer) = meta.duration;
+  GST_BUFFER_OFFSET (buffer) = meta.offset;
+  GST_BUFFER_OFFSET_END (buffer) = meta.offset_end;
+  GST_BUFFER_FLAGS (buffer) = meta.flags;
+
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+static GstBuffer *
+gst_ipc_pipeline_comm_read_fd_buffer (GstIpcPipelineComm * comm, guint32 size)
+{
+  GstBuffer *buffer;
+  GstMemory *mem;
+  CommBufferMetadata meta;
+  SharedMemoryInfo *info;
+  const guint8 *payload = NULL;
+  guint32 mapped_size, mem_size;
+  guint64 maxsize, offset;
+  gint fd;
+
+  /* this should not be called if we don't have enough yet */
+  g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
+
+  mapped_size = sizeof (CommBufferMetadata) + 2 * sizeof (guint64) +
+      sizeof (guint32);
+  if (size < mapped_size)
+    return NULL;
+
+  if (g_queue_is_empty (&comm->received_fds)) {
+    GST_ERROR_OBJECT (comm->element, "No fd received for buffer %u", comm->id);
+    return NULL;
+  }
+  fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->received_fds));
+
+  payload = gst_adapter_map (comm->adapter, mapped_size);
+  if (!payload) {
+    close (fd);
+    return NULL;
+  }
+  memcpy (&meta, payload, sizeof (CommBufferMetadata));
+  payload += sizeof (CommBufferMetadata);
+  maxsize = GST_READ_UINT64_LE (payload);
+  offset = GST_READ_UINT64_LE (payload + 8);
+  mem_size = GST_READ_UINT32_LE (payload + 16);
+  size -= mapped_size;
+  gst_adapter_unmap (comm->adapter);
+  gst_adapter_flush (comm->adapter, mapped_size);
+
+  if (offset + mem_size > maxsize) {
+    GST_ERROR_OBJECT (comm->element, "Invalid memory layout for buffer %u: "
+        "offset %" G_GUINT64_FORMAT ", size %u, maxsize %" G_GUINT64_FORMAT,
+        comm->id, offset, mem_size, maxsize);
+    close (fd);
+    return NULL;
+  }
+
+  mem = gst_fd_allocator_alloc (comm->fd_allocator, fd, maxsize,
+      GST_FD_MEMORY_FLAG_NONE);
+  if (!mem) {
+    close (fd);
+    return NULL;
+  }
+  gst_memory_resize (mem, offset, mem_size);
+
+  /* tell the peer when the memory is not used anymore on our side */
+  info = g_new (SharedMemoryInfo, 1);
+  info->element = gst_object_ref (comm->element);
+  info->comm = comm;
+  info->id = comm->id;
+  gst_mini_object_weak_ref (GST_MINI_OBJECT_CAST (mem), shared_memory_freed,
+      info);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, mem);
+
+  GST_BUFFER_PTS (buffer) = meta.pts;
+  GST_BUFFER_DTS (buffer) = meta.dts;
+  GST_BUFFER_DURATION (buffer) = meta.duration;
+  GST_BUFFER_OFFSET (buffer) = meta.offset;
+  GST_BUFFER_OFFSET_END (buffer) = meta.offset_end;
+  GST_BUFFER_FLAGS (buffer) = meta.flags;
+
+  if (!gst_ipc_pipeline_comm_read_buffer_meta (comm, buffer, size)) {
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
   return buffer;
 }
 
@@ -908,6 +1594,36 @@ gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
     return gst_ipc_pipeline_comm_write_sink_message_event_to_fd (comm, event);
 
   g_mutex_lock (&comm->mutex);
+
+  /* the ACKs of the buffers sent before the flush are FLUSHING, make sure
+   * they are all in before forgetting about them. Other serialized events
+   * also wait for the window to drain: a flow return other than OK is then
+   * kept for the next buffer, or reported now if this is the EOS after
+   * which no buffer comes */
+  if (!upstream && GST_EVENT_IS_SERIALIZED (event)) {
+    if (!gst_ipc_pipeline_comm_wait_pending_buffers (comm, 0)) {
+      g_mutex_unlock (&comm->mutex);
+      GST_ELEMENT_ERROR (comm->element, RESOURCE, WRITE, (NULL),
+          ("Failed to wait for reply on socket"));
+      return FALSE;
+    }
+    if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      comm->pending_flow_ret = GST_FLOW_OK;
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_EOS &&
+        comm->pending_flow_ret != GST_FLOW_OK) {
+      GstFlowReturn flow_ret = comm->pending_flow_ret;
+
+      comm->pending_flow_ret = GST_FLOW_OK;
+      GST_DEBUG_OBJECT (comm->element, "Buffer before EOS returned %s",
+          gst_flow_get_name (flow_ret));
+      if (flow_ret == GST_FLOW_NOT_LINKED || flow_ret < GST_FLOW_EOS) {
+        g_mutex_unlock (&comm->mutex);
+        GST_ELEMENT_FLOW_ERROR (comm->element, flow_ret);
+        return FALSE;
+      }
+    }
+  }
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing event %u: %" GST_PTR_FORMAT,
@@ -1184,6 +1900,10 @@ gst_ipc_pipeline_comm_write_state_change_to_fd (GstIpcPipelineComm * comm,
   GstByteWriter bw;
 
   g_mutex_lock (&comm->mutex);
+
+  if (transition == GST_STATE_CHANGE_READY_TO_PAUSED)
+    gst_ipc_pipeline_comm_reset_pending_buffers (comm);
+
   ++comm->send_id;
 
   GST_TRACE_OBJECT (comm->element, "Writing state change %u: %s -> %s",
@@ -1601,20 +2321,39 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
   comm->element = element;
   comm->fdin = comm->fdout = -1;
   comm->ack_time = DEFAULT_ACK_TIME;
+  comm->max_pending_buffers = 1;
+  comm->pending_buffers = 0;
+  comm->pending_flow_ret = GST_FLOW_OK;
+  g_cond_init (&comm->pending_cond);
   comm->waiting_ids =
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       (GDestroyNotify) comm_request_free);
   comm->adapter = gst_adapter_new ();
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+  comm->zero_copy = FALSE;
+  comm->memfd_allocator = NULL;
+  comm->shared_memories =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) gst_memory_unref);
+  comm->fd_passing_fd = -1;
+  comm->fd_passing = FALSE;
+  comm->fd_allocator = gst_fd_allocator_new ();
+  g_queue_init (&comm->received_fds);
 }
 
 void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
   g_hash_table_destroy (comm->waiting_ids);
+  g_hash_table_destroy (comm->shared_memories);
+  if (comm->memfd_allocator)
+    gst_object_unref (comm->memfd_allocator);
+  gst_object_unref (comm->fd_allocator);
+  close_received_fds (comm);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
+  g_cond_clear (&comm->pending_cond);
   g_mutex_clear (&comm->mutex);
 }
 
@@ -1646,6 +2385,7 @@ void
 gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm, gboolean cleanup)
 {
   g_mutex_lock (&comm->mutex);
+  gst_ipc_pipeline_comm_reset_pending_buffers (comm);
   g_hash_table_foreach (comm->waiting_ids, cancel_request_error, comm);
   if (cleanup) {
     g_hash_table_unref (comm->waiting_ids);
@@ -1680,6 +2420,20 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
 
   GST_TRACE_OBJECT (comm->element, "Got reply %d (%s) for request %u", ret,
       comm_request_ret_get_name (req->type, ret), req->id);
+
+  /* nobody waits for this one, only the window needs updating */
+  if (req->async) {
+    if (ret != GST_FLOW_OK && comm->pending_flow_ret == GST_FLOW_OK) {
+      GST_DEBUG_OBJECT (comm->element, "Buffer %u returned %s", id,
+          gst_flow_get_name (ret));
+      comm->pending_flow_ret = ret;
+    }
+    g_hash_table_remove (comm->waiting_ids, GINT_TO_POINTER (id));
+    comm->pending_buffers--;
+    g_cond_broadcast (&comm->pending_cond);
+    return TRUE;
+  }
+
   req->replied = TRUE;
   req->ret = ret;
   if (query) {
@@ -1745,7 +2499,7 @@ again:
       mem = gst_allocator_alloc (NULL, comm->read_chunk_size, NULL);
 
     gst_memory_map (mem, &map, GST_MAP_WRITE);
-    sz = read (comm->pollFDin.fd, map.data, map.size);
+    sz = read_from_fd (comm, comm->pollFDin.fd, map.data, map.size);
     gst_memory_unmap (mem, &map);
 
     if (sz <= 0) {
@@ -1810,6 +2564,8 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1874,6 +2630,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1881,7 +2638,11 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        if (comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER)
+          buf = gst_ipc_pipeline_comm_read_fd_buffer (comm,
+              comm->payload_length);
+        else
+          buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
         if (!buf)
           goto buffer_failed;
 
@@ -1905,6 +2666,35 @@ read_many (GstIpcPipelineComm * comm)
         comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
         break;
       }
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE:
+      {
+        GstMemory *mem;
+
+        available = gst_adapter_available (comm->adapter);
+        if (available < comm->payload_length)
+          goto done;
+
+        gst_adapter_flush (comm->adapter, comm->payload_length);
+
+        GST_TRACE_OBJECT (comm->element, "Peer released buffer %u", comm->id);
+        g_mutex_lock (&comm->mutex);
+        mem = g_hash_table_lookup (comm->shared_memories,
+            GINT_TO_POINTER (comm->id));
+        if (mem) {
+          /* the memfd can be recycled once nobody uses it anymore */
+          memfd_memory_set_shared (mem, FALSE);
+          g_hash_table_remove (comm->shared_memories,
+              GINT_TO_POINTER (comm->id));
+        } else {
+          GST_WARNING_OBJECT (comm->element,
+              "Got release for unknown buffer %u", comm->id);
+        }
+        g_mutex_unlock (&comm->mutex);
+
+        GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
+        comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
+        break;
+      }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_EVENT:
       {
         GstEvent *event;
@@ -2196,6 +2986,13 @@ gst_ipc_pipeline_comm_stop_reader_thread (GstIpcPipelineComm * comm)
   gst_poll_set_flushing (comm->poll, TRUE);
   g_thread_join (comm->reader_thread);
   comm->reader_thread = NULL;
+
+  /* nobody is left to release the memory we passed, or to claim the fds we
+   * received */
+  g_mutex_lock (&comm->mutex);
+  g_hash_table_remove_all (comm->shared_memories);
+  g_mutex_unlock (&comm->mutex);
+  close_received_fds (comm);
 }
 
 static gchar *
@@ -51,6 +51,8 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_FD_BUFFER,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_RELEASE,
 } GstIpcPipelineCommDataType;
 
 typedef struct
@@ -76,6 +78,26 @@ typedef struct
   guint read_chunk_size;
   GstClockTime ack_time;
 
+  /* buffers sent without waiting for their ACK: at most max_pending_buffers
+   * are in flight, and the first non-OK result any of them got back is
+   * returned for the next buffer */
+  guint max_pending_buffers;
+  guint pending_buffers;
+  GstFlowReturn pending_flow_ret;
+  GCond pending_cond;
+
+  /* sending side of the zero-copy transport: memory passed to the peer
+   * by fd is kept here until the peer releases it */
+  gboolean zero_copy;
+  GstAllocator *memfd_allocator;
+  GHashTable *shared_memories;
+  gint fd_passing_fd;
+  gboolean fd_passing;
+
+  /* receiving side: fds that arrived ahead of the data of their chunk */
+  GstAllocator *fd_allocator;
+  GQueue received_fds;
+
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
   void (*on_query) (guint32, GstQuery *, gboolean, gpointer);
@@ -103,6 +125,9 @@ void gst_ipc_pipeline_comm_write_state_change_ack_to_fd (
 void gst_ipc_pipeline_comm_write_query_result_to_fd (GstIpcPipelineComm * comm,
     guint32 id, gboolean result, GstQuery *query);
 
+GstAllocator * gst_ipc_pipeline_comm_get_memfd_allocator (
+    GstIpcPipelineComm * comm);
+
 GstFlowReturn gst_ipc_pipeline_comm_write_buffer_to_fd (
     GstIpcPipelineComm * comm, GstBuffer * buffer);
 gboolean gst_ipc_pipeline_comm_write_event_to_fd (GstIpcPipelineComm * comm,
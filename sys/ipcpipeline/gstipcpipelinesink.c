@@ -56,6 +56,9 @@
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
  * performs a blocking wait for a reply, if a return code is needed.
+ * Buffers are an exception when #GstIpcPipelineSink:max-pending-buffers is
+ * larger than 1: up to that many of them can be sent before waiting for the
+ * first reply, which hides the round trip to the slave process.
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -66,7 +69,11 @@
  * GError are serialized differently).
  *
  * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * If #GstIpcPipelineSink:zero-copy is enabled and fdout is a Unix socket,
+ * memfd backed memory is offered upstream in the ALLOCATION query and buffers
+ * made of a single fd memory are passed as a file descriptor instead. The
+ * memory is then kept alive until the slave side does not use it anymore,
+ * and the memfds released by the slave are reused for new memory.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -98,11 +105,15 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_ZERO_COPY,
+  PROP_MAX_PENDING_BUFFERS,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_ZERO_COPY FALSE
+#define DEFAULT_MAX_PENDING_BUFFERS 1
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -175,6 +186,42 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstIpcPipelineSink:zero-copy:
+   *
+   * Offer memfd backed memory upstream and pass buffers allocated from it,
+   * or any other fd memory, as file descriptors instead of copying their
+   * content through the socket. This requires fdout to be a Unix socket,
+   * other buffers are still copied.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero copy",
+          "Pass buffer memory to the peer as file descriptors when possible",
+          DEFAULT_ZERO_COPY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstIpcPipelineSink:max-pending-buffers:
+   *
+   * Maximum number of buffers sent to the slave and not acknowledged yet.
+   * With the default of 1, each buffer waits for the slave to return its
+   * #GstFlowReturn. With a larger window, buffers are sent without waiting
+   * and a flow return other than %GST_FLOW_OK is only returned upstream for
+   * one of the following buffers. Serialized events wait for all the buffers
+   * sent before them to be acknowledged, and an error returned for the
+   * buffers preceding EOS is posted as an error message. If the slave does
+   * not acknowledge any buffer for #GstIpcPipelineSink:ack-time, the
+   * connection is considered broken.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING_BUFFERS,
+      g_param_spec_uint ("max-pending-buffers", "Max pending buffers",
+          "Maximum number of buffers waiting for the peer's acknowledgement",
+          1, G_MAXUINT, DEFAULT_MAX_PENDING_BUFFERS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
       G_TYPE_FROM_CLASS (klass),
@@ -210,6 +257,8 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.zero_copy = DEFAULT_ZERO_COPY;
+  sink->comm.max_pending_buffers = DEFAULT_MAX_PENDING_BUFFERS;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -271,6 +320,14 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_ZERO_COPY:
+      sink->comm.zero_copy = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_PENDING_BUFFERS:
+      g_mutex_lock (&sink->comm.mutex);
+      sink->comm.max_pending_buffers = g_value_get_uint (value);
+      g_mutex_unlock (&sink->comm.mutex);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +353,12 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, sink->comm.zero_copy);
+      break;
+    case PROP_MAX_PENDING_BUFFERS:
+      g_value_set_uint (value, sink->comm.max_pending_buffers);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -344,8 +407,19 @@ gst_ipc_pipeline_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
 
   switch (GST_QUERY_TYPE (query)) {
     case GST_QUERY_ALLOCATION:
-      GST_DEBUG_OBJECT (sink, "Rejecting ALLOCATION query");
-      return FALSE;
+    {
+      GstAllocator *allocator;
+
+      allocator = gst_ipc_pipeline_comm_get_memfd_allocator (&sink->comm);
+      if (!allocator) {
+        GST_DEBUG_OBJECT (sink, "Rejecting ALLOCATION query");
+        return FALSE;
+      }
+      GST_DEBUG_OBJECT (sink, "Offering memfd allocator");
+      gst_query_add_allocation_param (query, allocator, NULL);
+      gst_object_unref (allocator);
+      return TRUE;
+    }
     case GST_QUERY_CAPS:
     {
       /* caps queries occur even while linking the pipeline.
@@ -31,6 +31,10 @@
  * ! shmsink socket-path=/tmp/blah shm-size=2000000
  * ]| Send video to shm buffers.
  *
+ * With #GstShmSink:ring-slots set, the buffers are copied into a ring of
+ * slots shared by all the shmsrc elements instead, and no message is sent
+ * on the socket for each buffer. This scales better with many readers of
+ * the same stream.
  */
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -58,7 +62,8 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_RING_SLOTS
 };
 
 struct GstShmClient
@@ -69,6 +74,10 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SLOTS 0
+/* In ring mode buffers are only ever copied into the ring, the regular
+ * area is still announced to the clients but never written to */
+#define RING_MODE_AREA_SIZE 4096
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -355,6 +364,7 @@ gst_shm_sink_init (GstShmSink * self)
   self->unlock = FALSE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_slots = DEFAULT_RING_SLOTS;
 
   gst_allocation_params_init (&self->params);
 }
@@ -417,6 +427,25 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:ring-slots:
+   *
+   * Number of slots of the ring buffers are copied into, 0 to send each
+   * buffer to the clients over the control socket instead. The shm-size
+   * is split between the slots, and the buffer-time is not taken into
+   * account with a ring. The clients need write permission on the shared
+   * memory to follow the ring. This may only be modified during the
+   * NULL->READY transition.
+   *
+   * Since: 1.16
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SLOTS,
+      g_param_spec_uint ("ring-slots",
+          "Number of ring slots",
+          "Number of slots of the shared ring buffer (0 = no ring)",
+          0, G_MAXINT / 2, DEFAULT_RING_SLOTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -476,7 +505,10 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_SHM_SIZE:
       GST_OBJECT_LOCK (object);
-      if (self->pipe) {
+      if (self->pipe && sp_get_ring (self->pipe)) {
+        GST_DEBUG_OBJECT (self, "Ring already created, new size of %u bytes "
+            "will be used on the next start", g_value_get_uint (value));
+      } else if (self->pipe) {
         if (sp_writer_resize (self->pipe, g_value_get_uint (value)) < 0) {
           /* Swap allocators, so we can know immediately if the memory is
            * ours */
@@ -505,6 +537,11 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_RING_SLOTS:
+      GST_OBJECT_LOCK (object);
+      self->ring_slots = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -534,6 +571,9 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_RING_SLOTS:
+      g_value_set_uint (value, self->ring_slots);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -549,6 +589,7 @@ gst_shm_sink_start (GstBaseSink * bsink)
 {
   GstShmSink *self = GST_SHM_SINK (bsink);
   GError *err = NULL;
+  guint area_size;
 
   self->stop = FALSE;
 
@@ -558,10 +599,16 @@ gst_shm_sink_start (GstBaseSink * bsink)
     return FALSE;
   }
 
+  /* the whole shm-size goes to the ring if there is one */
+  if (self->ring_slots > 0)
+    area_size = RING_MODE_AREA_SIZE;
+  else
+    area_size = self->size;
+
   GST_DEBUG_OBJECT (self, "Creating new socket at %s"
-      " with shared memory of %d bytes", self->socket_path, self->size);
+      " with shared memory of %u bytes", self->socket_path, area_size);
 
-  self->pipe = sp_writer_create (self->socket_path, self->size, self->perms);
+  self->pipe = sp_writer_create (self->socket_path, area_size, self->perms);
 
   if (!self->pipe) {
     GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
@@ -569,6 +616,20 @@ gst_shm_sink_start (GstBaseSink * bsink)
     return FALSE;
   }
 
+  if (self->ring_slots > 0) {
+    if (self->size / self->ring_slots == 0 ||
+        sp_writer_enable_ring (self->pipe, self->ring_slots,
+            self->size / self->ring_slots) < 0) {
+      sp_writer_close (self->pipe, NULL, NULL);
+      self->pipe = NULL;
+      GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
+          ("Could not create ring of %u slots.", self->ring_slots), (NULL));
+      return FALSE;
+    }
+    GST_DEBUG_OBJECT (self, "Created ring of %u slots of %u bytes",
+        self->ring_slots, self->size / self->ring_slots);
+  }
+
   sp_set_data (self->pipe, self);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
@@ -587,7 +648,10 @@ gst_shm_sink_start (GstBaseSink * bsink)
   if (!self->pollthread)
     goto thread_error;
 
-  self->allocator = gst_shm_sink_allocator_new (self);
+  /* nothing is ever allocated from the regular area in ring mode, so don't
+   * offer it upstream either */
+  if (!sp_get_ring (self->pipe))
+    self->allocator = gst_shm_sink_allocator_new (self);
 
   return TRUE;
 
@@ -658,6 +722,54 @@ gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
   return TRUE;
 }
 
+/* Called with the object lock, which it releases */
+static GstFlowReturn
+gst_shm_sink_render_ring (GstShmSink * self, ShmRing * ring, GstBuffer * buf)
+{
+  gsize size = gst_buffer_get_size (buf);
+  GstFlowReturn ret;
+  char *slot;
+
+  if (size > sr_get_slot_size (ring)) {
+    GST_OBJECT_UNLOCK (self);
+    GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT, (NULL),
+        ("Ring slots of size %" G_GSIZE_FORMAT " are smaller than"
+            " buffer of size %" G_GSIZE_FORMAT, sr_get_slot_size (ring), size));
+    return GST_FLOW_ERROR;
+  }
+
+  for (;;) {
+    guint32 token = sr_writer_prepare_wait (ring);
+
+    slot = sr_writer_get_slot (ring);
+    if (slot)
+      break;
+
+    if (self->unlock) {
+      GST_OBJECT_UNLOCK (self);
+      ret = gst_base_sink_wait_preroll (GST_BASE_SINK (self));
+      if (ret != GST_FLOW_OK)
+        return ret;
+      GST_OBJECT_LOCK (self);
+      continue;
+    }
+
+    GST_LOG_OBJECT (self, "Ring is full, waiting for the readers");
+    GST_OBJECT_UNLOCK (self);
+    sr_writer_wait (ring, token);
+    GST_OBJECT_LOCK (self);
+  }
+
+  gst_buffer_extract (buf, 0, slot, size);
+  sr_writer_publish (ring, size);
+  GST_OBJECT_UNLOCK (self);
+
+  GST_LOG_OBJECT (self, "Published %" G_GSIZE_FORMAT " bytes in the ring",
+      size);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
@@ -688,6 +800,9 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
   }
 
+  if (sp_get_ring (self->pipe))
+    return gst_shm_sink_render_ring (self, sp_get_ring (self->pipe), buf);
+
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
     g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
     if (self->unlock) {
@@ -960,9 +1075,24 @@ gst_shm_sink_event (GstBaseSink * bsink, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_EOS:
       GST_OBJECT_LOCK (self);
-      while (self->wait_for_connection && sp_writer_pending_writes (self->pipe)
-          && !self->unlock)
-        g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      if (sp_get_ring (self->pipe)) {
+        /* the readers don't tell us over the socket when they are done */
+        ShmRing *ring = sp_get_ring (self->pipe);
+
+        while (self->wait_for_connection && !self->unlock) {
+          guint32 token = sr_writer_prepare_wait (ring);
+
+          if (!sp_writer_pending_writes (self->pipe))
+            break;
+          GST_OBJECT_UNLOCK (self);
+          sr_writer_wait (ring, token);
+          GST_OBJECT_LOCK (self);
+        }
+      } else {
+        while (self->wait_for_connection
+            && sp_writer_pending_writes (self->pipe) && !self->unlock)
+          g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      }
       GST_OBJECT_UNLOCK (self);
       break;
     default:
@@ -980,6 +1110,8 @@ gst_shm_sink_unlock (GstBaseSink * bsink)
 
   GST_OBJECT_LOCK (self);
   self->unlock = TRUE;
+  if (self->pipe && sp_get_ring (self->pipe))
+    sr_writer_interrupt (sp_get_ring (self->pipe));
   GST_OBJECT_UNLOCK (self);
 
   g_cond_broadcast (&self->cond);
@@ -1003,6 +1135,10 @@ gst_shm_sink_propose_allocation (GstBaseSink * sink, GstQuery * query)
 {
   GstShmSink *self = GST_SHM_SINK (sink);
 
+  /* buffers are copied into the ring anyway */
+  if (self->pipe && sp_get_ring (self->pipe))
+    return TRUE;
+
   if (self->allocator)
     gst_query_add_allocation_param (query, GST_ALLOCATOR (self->allocator),
         NULL);
@@ -63,6 +63,7 @@ struct _GstShmSink
   gboolean stop;
   gboolean unlock;
   GstClockTimeDiff buffer_time;
+  guint ring_slots;
 
   GCond cond;
 
@@ -63,6 +63,8 @@ struct GstShmBuffer
 {
   char *buf;
   GstShmPipe *pipe;
+  ShmRing *ring;
+  guint32 seq;
 };
 
 
@@ -310,7 +312,10 @@ free_buffer (gpointer data)
   GST_LOG ("Freeing buffer %p", gsb->buf);
 
   GST_OBJECT_LOCK (gsb->pipe->src);
-  sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
+  if (gsb->ring)
+    sr_reader_release (gsb->ring, gsb->seq);
+  else
+    sp_client_recv_finish (gsb->pipe->pipe, gsb->buf);
   GST_OBJECT_UNLOCK (gsb->pipe->src);
 
   gst_shm_pipe_dec (gsb->pipe);
@@ -318,6 +323,46 @@ free_buffer (gpointer data)
   g_slice_free (struct GstShmBuffer, gsb);
 }
 
+/* Waits for the next buffer of the ring */
+static GstFlowReturn
+gst_shm_src_read_ring (GstShmSrc * self, ShmRing * ring, gchar ** buf,
+    int *size, guint32 * seq)
+{
+  for (;;) {
+    guint32 token = sr_reader_prepare_wait (ring);
+    size_t bufsize;
+    int rv;
+
+    GST_OBJECT_LOCK (self);
+    rv = sr_reader_next (ring, buf, &bufsize, seq);
+    GST_OBJECT_UNLOCK (self);
+
+    if (rv > 0) {
+      *size = bufsize;
+      return GST_FLOW_OK;
+    }
+
+    if (rv < 0) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+          ("The ring has been closed"));
+      return GST_FLOW_ERROR;
+    }
+
+    if (self->unlocked)
+      return GST_FLOW_FLUSHING;
+
+    if (!sr_reader_wait (ring, token, 1000)) {
+      /* nothing for a while, make sure the writer is still there */
+      if (gst_poll_wait (self->poll, 0) > 0 &&
+          gst_poll_fd_has_closed (self->poll, &self->pollfd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, READ,
+            ("Failed to read from shmsrc"), ("Control socket has closed"));
+        return GST_FLOW_ERROR;
+      }
+    }
+  }
+}
+
 static GstFlowReturn
 gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -326,6 +371,9 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   gchar *buf = NULL;
   int rv = 0;
   struct GstShmBuffer *gsb;
+  ShmRing *ring;
+  guint32 seq = 0;
+  GstFlowReturn ret;
 
   GST_DEBUG_OBJECT (self, "Stopping %p", self);
 
@@ -340,6 +388,16 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   GST_OBJECT_UNLOCK (self);
 
   do {
+    ring = sp_get_ring (pipe->pipe);
+    if (ring) {
+      ret = gst_shm_src_read_ring (self, ring, &buf, &rv, &seq);
+      if (ret == GST_FLOW_FLUSHING)
+        goto flushing;
+      else if (ret != GST_FLOW_OK)
+        goto error;
+      break;
+    }
+
     if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
       if (errno == EBUSY)
         goto flushing;
@@ -382,6 +440,8 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   gsb = g_slice_new0 (struct GstShmBuffer);
   gsb->buf = buf;
   gsb->pipe = pipe;
+  gsb->ring = ring;
+  gsb->seq = seq;
 
   *outbuf = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
       buf, rv, 0, rv, gsb, free_buffer);
@@ -437,6 +497,11 @@ gst_shm_src_unlock (GstBaseSrc * bsrc)
   self->unlocked = TRUE;
   gst_poll_set_flushing (self->poll, TRUE);
 
+  GST_OBJECT_LOCK (self);
+  if (self->pipe && sp_get_ring (self->pipe->pipe))
+    sr_reader_interrupt (sp_get_ring (self->pipe->pipe));
+  GST_OBJECT_UNLOCK (self);
+
   return TRUE;
 }
 
@@ -48,6 +48,7 @@
 #include <assert.h>
 
 #include "shmalloc.h"
+#include "shmring.h"
 
 /*
  * The protocol over the pipe is in packets
@@ -67,9 +68,19 @@
  * type 4: ack buffer
  * offset
  *
+ * type 5: new ring
+ * Ring length
+ * Size of path (followed by path)
+ * Index of the client's cursor in the ring
+ *
  * Type 4 goes from the client to the server
  * The rest are from the server to the client
- * The client should never write in the SHM
+ * The client should never write in the SHM, except for its cursor in the
+ * ring
+ *
+ * When the writer has a ring (see shmring.h), it sends type 5 right after
+ * type 1 to each new client, and buffers go through the ring instead of
+ * types 3 and 4.
  */
 
 
@@ -80,7 +91,8 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5
 };
 
 typedef struct _ShmArea ShmArea;
@@ -141,11 +153,14 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  ShmRing *ring;
 };
 
 struct _ShmClient
 {
   int fd;
+  int ring_reader;
 
   ShmClient *next;
 };
@@ -179,6 +194,13 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      size_t size;
+      unsigned int path_size;
+      int reader;
+      /* Followed by path */
+    } new_ring;
   } payload;
 };
 
@@ -446,6 +468,11 @@ sp_writer_close (ShmPipe * self, sp_buffer_free_callback callback,
   while (self->clients)
     sp_writer_close_client (self, self->clients, callback, user_data);
 
+  if (self->ring) {
+    sr_close (self->ring);
+    self->ring = NULL;
+  }
+
   sp_dec (self);
 }
 
@@ -466,6 +493,9 @@ sp_writer_setperms_shm (ShmPipe * self, mode_t perms)
   for (area = self->shm_area; area; area = area->next)
     ret |= fchmod (area->shm_fd, perms);
 
+  if (self->ring)
+    ret |= sr_writer_setperms (self->ring, perms);
+
   ret |= chmod (self->socket_path, perms);
 
   return ret;
@@ -658,6 +688,7 @@ sp_client_recv (ShmPipe * self, char **buf)
   char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
+  ShmRing *ring;
   struct CommandBuffer cb;
   int retval;
 
@@ -689,6 +720,30 @@ sp_client_recv (ShmPipe * self, char **buf)
       self->shm_area = newarea;
       break;
 
+    case COMMAND_NEW_RING:
+      assert (cb.payload.new_ring.path_size > 0);
+      assert (cb.payload.new_ring.size > 0);
+
+      area_name = malloc (cb.payload.new_ring.path_size + 1);
+      retval = recv (self->main_socket, area_name,
+          cb.payload.new_ring.path_size, 0);
+      if (retval != cb.payload.new_ring.path_size) {
+        free (area_name);
+        return -3;
+      }
+      area_name[retval] = 0;
+
+      ring = sr_reader_open (area_name, cb.payload.new_ring.size,
+          cb.payload.new_ring.reader);
+      free (area_name);
+      if (!ring)
+        return -5;
+
+      if (self->ring)
+        sr_close (self->ring);
+      self->ring = ring;
+      break;
+
     case COMMAND_CLOSE_SHM_AREA:
       for (area = self->shm_area; area; area = area->next) {
         if (area->id == cb.area_id) {
@@ -812,6 +867,7 @@ sp_writer_accept_client (ShmPipe * self)
   int fd;
   struct CommandBuffer cb = { 0 };
   int pathlen = strlen (self->shm_area->shm_area_name) + 1;
+  int reader = -1;
 
 
   fd = accept (self->main_socket, NULL, NULL);
@@ -834,8 +890,32 @@ sp_writer_accept_client (ShmPipe * self)
     goto error;
   }
 
+  if (self->ring) {
+    reader = sr_writer_add_reader (self->ring);
+    if (reader < 0) {
+      fprintf (stderr, "Too many clients for the ring");
+      goto error;
+    }
+
+    pathlen = strlen (sr_get_name (self->ring)) + 1;
+    cb.payload.new_ring.size = sr_get_size (self->ring);
+    cb.payload.new_ring.path_size = pathlen;
+    cb.payload.new_ring.reader = reader;
+    if (!send_command (fd, &cb, COMMAND_NEW_RING, 0)) {
+      fprintf (stderr, "Sending new ring failed: %s", strerror (errno));
+      goto error;
+    }
+
+    if (send (fd, sr_get_name (self->ring), pathlen, MSG_NOSIGNAL) !=
+        pathlen) {
+      fprintf (stderr, "Sending new ring path failed: %s", strerror (errno));
+      goto error;
+    }
+  }
+
   client = spalloc_new (ShmClient);
   client->fd = fd;
+  client->ring_reader = reader;
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -845,6 +925,8 @@ sp_writer_accept_client (ShmPipe * self)
   return client;
 
 error:
+  if (reader >= 0)
+    sr_writer_remove_reader (self->ring, reader);
   shutdown (fd, SHUT_RDWR);
   close (fd);
   return NULL;
@@ -901,6 +983,9 @@ sp_writer_close_client (ShmPipe * self, ShmClient * client,
   shutdown (client->fd, SHUT_RDWR);
   close (client->fd);
 
+  if (self->ring)
+    sr_writer_remove_reader (self->ring, client->ring_reader);
+
 again:
   for (buffer = self->buffers; buffer; buffer = buffer->next) {
     int i;
@@ -960,6 +1045,9 @@ sp_writer_get_client_fd (ShmClient * client)
 int
 sp_writer_pending_writes (ShmPipe * self)
 {
+  if (self->ring && sr_writer_pending_reads (self->ring))
+    return 1;
+
   return (self->buffers != NULL);
 }
 
@@ -995,3 +1083,25 @@ sp_writer_get_max_buf_size (ShmPipe * self)
 
   return self->shm_area->shm_area_len;
 }
+
+/* Creates a ring of n_slots slots of slot_size bytes, buffers are then
+ * sent through it with the functions from shmring.h. This must be done
+ * before any client connects */
+int
+sp_writer_enable_ring (ShmPipe * self, unsigned int n_slots, size_t slot_size)
+{
+  if (self->ring || self->clients)
+    return -1;
+
+  self->ring = sr_writer_create (n_slots, slot_size, self->perms);
+  if (!self->ring)
+    return -1;
+
+  return 0;
+}
+
+ShmRing *
+sp_get_ring (ShmPipe * self)
+{
+  return self->ring;
+}
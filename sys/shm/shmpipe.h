@@ -56,6 +56,12 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * Alternatively, the writer can call sp_writer_enable_ring() right after
+ * creating the pipe. Buffers are then passed through the ring returned by
+ * sp_get_ring() (see shmring.h) instead of sp_writer_send_buf(), and the
+ * socket is only used to tell the clients about the shm areas. The client
+ * gets the ring from sp_get_ring() once sp_client_recv() has received it.
  */
 
 
@@ -68,6 +74,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include "shmring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -112,6 +119,10 @@ ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
 ShmBuffer *sp_writer_get_next_buffer (ShmBuffer * buffer);
 void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 
+int sp_writer_enable_ring (ShmPipe * self, unsigned int n_slots,
+    size_t slot_size);
+ShmRing *sp_get_ring (ShmPipe * self);
+
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
@@ -0,0 +1,528 @@
+/* GStreamer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "shmring.h"
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shmalloc.h"
+
+/*
+ * Layout of the shared area:
+ *
+ * ShmRingHeader
+ * n_slots sizes (uint64_t), the size of the buffer in each slot
+ * padding up to SHM_RING_DATA_ALIGN
+ * n_slots slots of slot_size bytes
+ *
+ * Sequence numbers are 32 bits so that they can be used as futex words,
+ * they wrap around and are always compared by difference.
+ *
+ * write_seq is the number of buffers published by the writer, each
+ * reader's read_seq is the number of buffers it has released. A slot
+ * can be written when no active reader is n_slots buffers behind. The
+ * writer waits on release_seq, which readers bump whenever they release
+ * something, and readers wait on wake_seq, which the writer bumps when
+ * it publishes a buffer while a reader is waiting.
+ */
+
+#define SHM_RING_MAGIC 0x53524e47       /* "SRNG" */
+#define SHM_RING_SLOT_ALIGN 64
+#define SHM_RING_DATA_ALIGN 4096
+
+typedef struct
+{
+  uint32_t active;
+  uint32_t read_seq;
+} ShmRingCursor;
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t n_slots;
+  uint64_t slot_size;
+  uint64_t data_offset;
+
+  uint32_t write_seq;
+  uint32_t wake_seq;
+  uint32_t release_seq;
+  uint32_t readers_waiting;
+  uint32_t writer_waiting;
+  uint32_t closed;
+
+  ShmRingCursor readers[SHM_RING_MAX_READERS];
+} ShmRingHeader;
+
+struct _ShmRing
+{
+  int is_writer;
+
+  int shm_fd;
+  char *name;
+  char *area;
+  size_t size;
+
+  ShmRingHeader *header;
+  uint64_t *sizes;
+  char *data;
+  uint32_t n_slots;
+  size_t slot_size;
+
+  /* reader only */
+  int reader;
+  uint32_t next_seq;
+  uint32_t read_seq;
+  unsigned char *released;
+};
+
+#define LOAD(p) __atomic_load_n ((p), __ATOMIC_SEQ_CST)
+#define STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
+#define INC(p) __atomic_fetch_add ((p), 1, __ATOMIC_SEQ_CST)
+#define DEC(p) __atomic_fetch_sub ((p), 1, __ATOMIC_SEQ_CST)
+
+#ifdef __linux__
+/* Returns 0 if the wait timed out */
+static int
+sr_futex_wait (uint32_t * addr, uint32_t val, int timeout_ms)
+{
+  struct timespec ts, *tsp = NULL;
+
+  if (timeout_ms >= 0) {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+    tsp = &ts;
+  }
+
+  /* the area is shared between processes, so no FUTEX_PRIVATE_FLAG */
+  if (syscall (SYS_futex, addr, FUTEX_WAIT, val, tsp, NULL, 0) < 0 &&
+      errno == ETIMEDOUT)
+    return 0;
+
+  return 1;
+}
+
+static void
+sr_futex_wake (uint32_t * addr)
+{
+  syscall (SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+#else
+/* No futexes, poll the sequence number instead */
+static int
+sr_futex_wait (uint32_t * addr, uint32_t val, int timeout_ms)
+{
+  int waited = 0;
+
+  while (LOAD (addr) == val) {
+    if (timeout_ms >= 0 && waited >= timeout_ms)
+      return 0;
+    usleep (1000);
+    waited++;
+  }
+
+  return 1;
+}
+
+static void
+sr_futex_wake (uint32_t * addr)
+{
+}
+#endif
+
+static int
+sr_map (ShmRing * self)
+{
+  self->area = mmap (NULL, self->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      self->shm_fd, 0);
+
+  if (self->area == MAP_FAILED) {
+    self->area = NULL;
+    fprintf (stderr, "mmap failed (%d): %s\n", errno, strerror (errno));
+    return 0;
+  }
+
+  self->header = (ShmRingHeader *) self->area;
+  self->sizes = (uint64_t *) (self->area + sizeof (ShmRingHeader));
+
+  return 1;
+}
+
+static size_t
+sr_get_data_offset (unsigned int n_slots)
+{
+  size_t offset = sizeof (ShmRingHeader) + n_slots * sizeof (uint64_t);
+
+  return (offset + SHM_RING_DATA_ALIGN - 1) & ~(SHM_RING_DATA_ALIGN - 1);
+}
+
+ShmRing *
+sr_writer_create (unsigned int n_slots, size_t slot_size, mode_t perms)
+{
+  ShmRing *self;
+  char tmppath[32];
+  int i = 0;
+
+  if (n_slots == 0 || n_slots > INT_MAX / 2 || slot_size == 0)
+    return NULL;
+
+  self = spalloc_new (ShmRing);
+  memset (self, 0, sizeof (ShmRing));
+  self->is_writer = 1;
+  self->reader = -1;
+
+  slot_size = (slot_size + SHM_RING_SLOT_ALIGN - 1) &
+      ~(SHM_RING_SLOT_ALIGN - 1);
+  self->n_slots = n_slots;
+  self->slot_size = slot_size;
+  self->size = sr_get_data_offset (n_slots) + n_slots * slot_size;
+
+  do {
+    snprintf (tmppath, sizeof (tmppath), "/shmring.%5d.%5d", getpid (), i++);
+    self->shm_fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL, perms);
+  } while (self->shm_fd < 0 && errno == EEXIST);
+
+  if (self->shm_fd < 0) {
+    fprintf (stderr, "shm_open failed on %s (%d): %s\n", tmppath, errno,
+        strerror (errno));
+    goto error;
+  }
+
+  self->name = strdup (tmppath);
+
+  if (ftruncate (self->shm_fd, self->size)) {
+    fprintf (stderr, "Could not resize ring to %lu bytes, ftruncate failed"
+        " (%d): %s\n", (unsigned long) self->size, errno, strerror (errno));
+    goto error;
+  }
+
+  if (!sr_map (self))
+    goto error;
+
+  /* the area is zeroed by ftruncate() */
+  self->header->n_slots = n_slots;
+  self->header->slot_size = slot_size;
+  self->header->data_offset = sr_get_data_offset (n_slots);
+  self->data = self->area + self->header->data_offset;
+  STORE (&self->header->magic, SHM_RING_MAGIC);
+
+  return self;
+
+error:
+  sr_close (self);
+  return NULL;
+}
+
+int
+sr_writer_add_reader (ShmRing * self)
+{
+  ShmRingHeader *header = self->header;
+  int i;
+
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    if (!LOAD (&header->readers[i].active)) {
+      /* a new reader starts with the next buffer */
+      STORE (&header->readers[i].read_seq, header->write_seq);
+      STORE (&header->readers[i].active, 1);
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void
+sr_writer_remove_reader (ShmRing * self, int reader)
+{
+  if (reader < 0 || reader >= SHM_RING_MAX_READERS)
+    return;
+
+  STORE (&self->header->readers[reader].active, 0);
+
+  /* the writer may be waiting for this reader */
+  sr_writer_interrupt (self);
+}
+
+int
+sr_writer_setperms (ShmRing * self, mode_t perms)
+{
+  return fchmod (self->shm_fd, perms);
+}
+
+char *
+sr_writer_get_slot (ShmRing * self)
+{
+  ShmRingHeader *header = self->header;
+  uint32_t seq = header->write_seq;
+  int i;
+
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    if (LOAD (&header->readers[i].active) &&
+        seq - LOAD (&header->readers[i].read_seq) >= self->n_slots)
+      return NULL;
+  }
+
+  return self->data + (size_t) (seq % self->n_slots) * self->slot_size;
+}
+
+void
+sr_writer_publish (ShmRing * self, size_t size)
+{
+  ShmRingHeader *header = self->header;
+  uint32_t seq = header->write_seq;
+
+  if (size > self->slot_size)
+    size = self->slot_size;
+
+  self->sizes[seq % self->n_slots] = size;
+  STORE (&header->write_seq, seq + 1);
+
+  if (LOAD (&header->readers_waiting)) {
+    INC (&header->wake_seq);
+    sr_futex_wake (&header->wake_seq);
+  }
+}
+
+int
+sr_writer_pending_reads (ShmRing * self)
+{
+  ShmRingHeader *header = self->header;
+  int i;
+
+  for (i = 0; i < SHM_RING_MAX_READERS; i++) {
+    if (LOAD (&header->readers[i].active) &&
+        LOAD (&header->readers[i].read_seq) != header->write_seq)
+      return 1;
+  }
+
+  return 0;
+}
+
+uint32_t
+sr_writer_prepare_wait (ShmRing * self)
+{
+  return LOAD (&self->header->release_seq);
+}
+
+void
+sr_writer_wait (ShmRing * self, uint32_t token)
+{
+  ShmRingHeader *header = self->header;
+
+  INC (&header->writer_waiting);
+  sr_futex_wait (&header->release_seq, token, -1);
+  DEC (&header->writer_waiting);
+}
+
+void
+sr_writer_interrupt (ShmRing * self)
+{
+  INC (&self->header->release_seq);
+  sr_futex_wake (&self->header->release_seq);
+}
+
+ShmRing *
+sr_reader_open (const char *name, size_t size, int reader)
+{
+  ShmRing *self;
+  ShmRingHeader *header;
+
+  if (reader < 0 || reader >= SHM_RING_MAX_READERS ||
+      size < sizeof (ShmRingHeader))
+    return NULL;
+
+  self = spalloc_new (ShmRing);
+  memset (self, 0, sizeof (ShmRing));
+  self->reader = reader;
+  self->size = size;
+
+  /* readers need write access to publish their cursor */
+  self->shm_fd = shm_open (name, O_RDWR, 0);
+  if (self->shm_fd < 0) {
+    fprintf (stderr, "shm_open failed on %s (%d): %s\n", name, errno,
+        strerror (errno));
+    goto error;
+  }
+
+  self->name = strdup (name);
+
+  if (!sr_map (self))
+    goto error;
+
+  header = self->header;
+  if (LOAD (&header->magic) != SHM_RING_MAGIC || header->n_slots == 0 ||
+      header->slot_size == 0 ||
+      header->data_offset != sr_get_data_offset (header->n_slots) ||
+      header->slot_size > (size - header->data_offset) / header->n_slots) {
+    fprintf (stderr, "Invalid ring header in %s\n", name);
+    goto error;
+  }
+
+  self->n_slots = header->n_slots;
+  self->slot_size = header->slot_size;
+  self->data = self->area + header->data_offset;
+  self->released = calloc (self->n_slots, 1);
+  if (!self->released)
+    goto error;
+
+  self->read_seq = self->next_seq = LOAD (&header->readers[reader].read_seq);
+
+  return self;
+
+error:
+  sr_close (self);
+  return NULL;
+}
+
+/* Returns 1 if there was a buffer, 0 if there is nothing to read yet and
+ * -1 if the writer has closed the ring */
+int
+sr_reader_next (ShmRing * self, char **buf, size_t * size, uint32_t * seq)
+{
+  ShmRingHeader *header = self->header;
+  uint32_t slot;
+
+  if (self->next_seq == LOAD (&header->write_seq))
+    return LOAD (&header->closed) ? -1 : 0;
+
+  slot = self->next_seq % self->n_slots;
+  *buf = self->data + (size_t) slot * self->slot_size;
+  *size = self->sizes[slot];
+  if (*size > self->slot_size)
+    *size = self->slot_size;
+  *seq = self->next_seq++;
+
+  return 1;
+}
+
+void
+sr_reader_release (ShmRing * self, uint32_t seq)
+{
+  ShmRingHeader *header = self->header;
+  uint32_t read_seq = self->read_seq;
+
+  self->released[seq % self->n_slots] = 1;
+
+  /* buffers may be released out of order, the cursor only moves over
+   * the ones that are all released */
+  while (read_seq != self->next_seq && self->released[read_seq % self->n_slots]) {
+    self->released[read_seq % self->n_slots] = 0;
+    read_seq++;
+  }
+
+  if (read_seq == self->read_seq)
+    return;
+
+  self->read_seq = read_seq;
+  STORE (&header->readers[self->reader].read_seq, read_seq);
+  INC (&header->release_seq);
+
+  if (LOAD (&header->writer_waiting))
+    sr_futex_wake (&header->release_seq);
+}
+
+uint32_t
+sr_reader_prepare_wait (ShmRing * self)
+{
+  return LOAD (&self->header->wake_seq);
+}
+
+/* Returns 0 if nothing happened for timeout_ms milliseconds */
+int
+sr_reader_wait (ShmRing * self, uint32_t token, int timeout_ms)
+{
+  ShmRingHeader *header = self->header;
+  int ret = 1;
+
+  INC (&header->readers_waiting);
+  if (self->next_seq == LOAD (&header->write_seq) && !LOAD (&header->closed))
+    ret = sr_futex_wait (&header->wake_seq, token, timeout_ms);
+  DEC (&header->readers_waiting);
+
+  return ret;
+}
+
+void
+sr_reader_interrupt (ShmRing * self)
+{
+  INC (&self->header->wake_seq);
+  sr_futex_wake (&self->header->wake_seq);
+}
+
+const char *
+sr_get_name (ShmRing * self)
+{
+  return self->name;
+}
+
+size_t
+sr_get_size (ShmRing * self)
+{
+  return self->size;
+}
+
+size_t
+sr_get_slot_size (ShmRing * self)
+{
+  return self->slot_size;
+}
+
+void
+sr_close (ShmRing * self)
+{
+  if (self->is_writer && self->header) {
+    /* let the readers know that nothing else is coming */
+    STORE (&self->header->closed, 1);
+    sr_reader_interrupt (self);
+  }
+
+  if (self->area)
+    munmap (self->area, self->size);
+
+  if (self->shm_fd >= 0)
+    close (self->shm_fd);
+
+  if (self->name) {
+    if (self->is_writer)
+      shm_unlink (self->name);
+    free (self->name);
+  }
+
+  free (self->released);
+  spalloc_free (ShmRing, self);
+}
@@ -0,0 +1,97 @@
+/* GStreamer
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * A single writer, multiple readers ring of fixed size slots in a shared
+ * memory area. Unlike the ShmPipe protocol, no message goes over the
+ * socket for each buffer: the writer publishes buffers by bumping a
+ * sequence number in the shared area, and each reader advances its own
+ * cursor in the shared area when it is done with a slot. The writer never
+ * overwrites a slot that an active reader has not released yet.
+ *
+ * Sleeping is done with futexes on the sequence numbers, so a wake up
+ * syscall only happens when the other side is actually waiting.
+ *
+ * As for ShmPipe, none of this is thread safe, except for the _interrupt()
+ * functions which may be called from any thread.
+ *
+ * The writer creates the ring with sr_writer_create(), registers each
+ * reader with sr_writer_add_reader() and passes the name of the area
+ * and the reader index to it (the ShmPipe does that over its socket).
+ * To send a buffer, it gets the next slot with sr_writer_get_slot(),
+ * fills it and calls sr_writer_publish(). If there is no free slot, it
+ * waits with sr_writer_prepare_wait() and sr_writer_wait().
+ *
+ * The reader opens the ring with sr_reader_open() and gets the buffers
+ * with sr_reader_next(), in order. Each buffer must be released with
+ * sr_reader_release(), in any order. If there is nothing to read, it
+ * waits with sr_reader_prepare_wait() and sr_reader_wait().
+ *
+ * The token returned by the _prepare_wait() functions must be taken
+ * before checking whether there is something to do, so that a wake up
+ * happening between that check and the wait is not lost.
+ */
+
+#ifndef __SHMRING_H__
+#define __SHMRING_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_RING_MAX_READERS 64
+
+typedef struct _ShmRing ShmRing;
+
+ShmRing *sr_writer_create (unsigned int n_slots, size_t slot_size,
+    mode_t perms);
+int sr_writer_add_reader (ShmRing * self);
+void sr_writer_remove_reader (ShmRing * self, int reader);
+int sr_writer_setperms (ShmRing * self, mode_t perms);
+char *sr_writer_get_slot (ShmRing * self);
+void sr_writer_publish (ShmRing * self, size_t size);
+int sr_writer_pending_reads (ShmRing * self);
+uint32_t sr_writer_prepare_wait (ShmRing * self);
+void sr_writer_wait (ShmRing * self, uint32_t token);
+void sr_writer_interrupt (ShmRing * self);
+
+ShmRing *sr_reader_open (const char *name, size_t size, int reader);
+int sr_reader_next (ShmRing * self, char **buf, size_t * size,
+    uint32_t * seq);
+void sr_reader_release (ShmRing * self, uint32_t seq);
+uint32_t sr_reader_prepare_wait (ShmRing * self);
+int sr_reader_wait (ShmRing * self, uint32_t token, int timeout_ms);
+void sr_reader_interrupt (ShmRing * self);
+
+const char *sr_get_name (ShmRing * self);
+size_t sr_get_size (ShmRing * self);
+size_t sr_get_slot_size (ShmRing * self);
+void sr_close (ShmRing * self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHMRING_H__ */
@@ -0,0 +1,383 @@
+/* GStreamer
+ *
+ * unit test for audiomixmatrix
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+#define N_SAMPLES 256
+
+/* All coefficients used below are multiples of 1/8, so that the fixed point
+ * conversion of the integer paths is exact and the output only differs from
+ * the reference by the rounding towards minus infinity of the final shift */
+
+static void
+set_matrix (GstElement * element, guint in_channels, guint out_channels,
+    const gdouble * matrix)
+{
+  GValue value = G_VALUE_INIT;
+  guint in, out;
+
+  g_value_init (&value, GST_TYPE_ARRAY);
+  for (out = 0; out < out_channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < in_channels; in++) {
+      GValue itm = G_VALUE_INIT;
+
+      g_value_init (&itm, G_TYPE_DOUBLE);
+      g_value_set_double (&itm, matrix[out * in_channels + in]);
+      gst_value_array_append_value (&row, &itm);
+      g_value_unset (&itm);
+    }
+    gst_value_array_append_value (&value, &row);
+    g_value_unset (&row);
+  }
+  g_object_set_property (G_OBJECT (element), "matrix", &value);
+  g_value_unset (&value);
+}
+
+static GstHarness *
+setup_harness (GstAudioFormat format, guint in_channels, guint out_channels,
+    const gdouble * matrix)
+{
+  GstHarness *h;
+  const gchar *format_str = gst_audio_format_to_string (format);
+  gchar *caps_str;
+
+  h = gst_harness_new ("audiomixmatrix");
+  g_object_set (h->element, "in-channels", in_channels, "out-channels",
+      out_channels, "channel-mask", (guint64) 0, NULL);
+  set_matrix (h->element, in_channels, out_channels, matrix);
+
+  caps_str = g_strdup_printf ("audio/x-raw, format=%s, rate=48000, "
+      "channels=%u, channel-mask=(bitmask)0x0, layout=interleaved",
+      format_str, in_channels);
+  gst_harness_set_src_caps_str (h, caps_str);
+  g_free (caps_str);
+
+  caps_str = g_strdup_printf ("audio/x-raw, format=%s, rate=48000, "
+      "channels=%u, channel-mask=(bitmask)0x0, layout=interleaved",
+      format_str, out_channels);
+  gst_harness_set_sink_caps_str (h, caps_str);
+  g_free (caps_str);
+
+  return h;
+}
+
+static gdouble
+random_sample (GRand * rand, GstAudioFormat format)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return g_rand_int_range (rand, G_MININT16, G_MAXINT16 + 1);
+    case GST_AUDIO_FORMAT_S32:
+      return (gint32) g_rand_int (rand);
+    default:
+      return g_rand_double_range (rand, -1.0, 1.0);
+  }
+}
+
+static void
+write_sample (gpointer data, guint idx, GstAudioFormat format, gdouble v)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_F32:
+      ((gfloat *) data)[idx] = v;
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      ((gdouble *) data)[idx] = v;
+      break;
+    case GST_AUDIO_FORMAT_S16:
+      ((gint16 *) data)[idx] = v;
+      break;
+    case GST_AUDIO_FORMAT_S32:
+      ((gint32 *) data)[idx] = v;
+      break;
+    default:
+      g_assert_not_reached ();
+  }
+}
+
+static gdouble
+read_sample (gconstpointer data, guint idx, GstAudioFormat format)
+{
+  switch (format) {
+    case GST_AUDIO_FORMAT_F32:
+      return ((const gfloat *) data)[idx];
+    case GST_AUDIO_FORMAT_F64:
+      return ((const gdouble *) data)[idx];
+    case GST_AUDIO_FORMAT_S16:
+      return ((const gint16 *) data)[idx];
+    case GST_AUDIO_FORMAT_S32:
+      return ((const gint32 *) data)[idx];
+    default:
+      g_assert_not_reached ();
+      return 0;
+  }
+}
+
+/* Naive matrix multiplication, one output sample at a time */
+static gdouble
+reference_sample (const gdouble * input, guint in_channels,
+    const gdouble * matrix, guint out, GstAudioFormat format)
+{
+  gdouble sum = 0;
+  guint in;
+
+  for (in = 0; in < in_channels; in++)
+    sum += input[in] * matrix[out * in_channels + in];
+
+  switch (format) {
+    case GST_AUDIO_FORMAT_S16:
+      return CLAMP (floor (sum), G_MININT16, G_MAXINT16);
+    case GST_AUDIO_FORMAT_S32:
+      return CLAMP (floor (sum), G_MININT32, G_MAXINT32);
+    default:
+      return sum;
+  }
+}
+
+static void
+push_and_check (GstHarness * h, GstAudioFormat format, guint in_channels,
+    guint out_channels, const gdouble * matrix, GRand * rand)
+{
+  const GstAudioFormatInfo *finfo = gst_audio_format_get_info (format);
+  guint bps = GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8;
+  gdouble *input = g_new (gdouble, N_SAMPLES * in_channels);
+  gdouble tolerance;
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i, out;
+
+  switch (format) {
+    case GST_AUDIO_FORMAT_F32:
+      tolerance = 1e-6;
+      break;
+    case GST_AUDIO_FORMAT_F64:
+      tolerance = 1e-12;
+      break;
+    default:
+      tolerance = 0;
+      break;
+  }
+
+  buf = gst_harness_create_buffer (h, N_SAMPLES * in_channels * bps);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < N_SAMPLES * in_channels; i++) {
+    /* put full scale samples at the start to exercise clipping */
+    if (i < 4 * in_channels && format == GST_AUDIO_FORMAT_S16)
+      input[i] = (i / in_channels) % 2 ? G_MININT16 : G_MAXINT16;
+    else if (i < 4 * in_channels && format == GST_AUDIO_FORMAT_S32)
+      input[i] = (i / in_channels) % 2 ? G_MININT32 : G_MAXINT32;
+    else
+      input[i] = random_sample (rand, format);
+    write_sample (map.data, i, format, input[i]);
+    /* compare against what was actually stored for the float formats */
+    input[i] = read_sample (map.data, i, format);
+  }
+  gst_buffer_unmap (buf, &map);
+
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      N_SAMPLES * out_channels * bps);
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (i = 0; i < N_SAMPLES; i++) {
+    for (out = 0; out < out_channels; out++) {
+      gdouble expected = reference_sample (&input[i * in_channels],
+          in_channels, matrix, out, format);
+      gdouble actual = read_sample (map.data, i * out_channels + out, format);
+
+      if (fabs (expected - actual) > tolerance * MAX (1.0, fabs (expected)))
+        fail ("%s sample %u channel %u: expected %f, got %f",
+            gst_audio_format_to_string (format), i, out, expected, actual);
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+  g_free (input);
+}
+
+static void
+check_matrix (guint in_channels, guint out_channels, const gdouble * matrix)
+{
+  static const GstAudioFormat formats[] = {
+    GST_AUDIO_FORMAT_F32, GST_AUDIO_FORMAT_F64,
+    GST_AUDIO_FORMAT_S16, GST_AUDIO_FORMAT_S32
+  };
+  GRand *rand = g_rand_new_with_seed (in_channels * 16 + out_channels);
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstHarness *h = setup_harness (formats[i], in_channels, out_channels,
+        matrix);
+
+    push_and_check (h, formats[i], in_channels, out_channels, matrix, rand);
+    push_and_check (h, formats[i], in_channels, out_channels, matrix, rand);
+    gst_harness_teardown (h);
+  }
+
+  g_rand_free (rand);
+}
+
+GST_START_TEST (test_identity)
+{
+  static const gdouble matrix[] = {
+    1, 0, 0,
+    0, 1, 0,
+    0, 0, 1,
+  };
+
+  check_matrix (3, 3, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_routing)
+{
+  /* every output copies one input or is silent */
+  static const gdouble matrix[] = {
+    0, 0, 1, 0,
+    0, 0, 0, 0,
+    1, 0, 0, 0,
+  };
+
+  check_matrix (4, 3, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sparse)
+{
+  /* 3 non-zero coefficients out of 12 */
+  static const gdouble matrix[] = {
+    0.5, 0, 0, 0.25, 0, 0,
+    0, 0, 0, 0, 0, 0.75,
+  };
+
+  check_matrix (6, 2, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_dense)
+{
+  static const gdouble matrix[] = {
+    0.5, 0.25, 0.125,
+    -0.5, 0.75, 0.25,
+  };
+
+  check_matrix (3, 2, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_zero_matrix)
+{
+  static const gdouble matrix[] = {
+    0, 0,
+    0, 0,
+    0, 0,
+  };
+
+  check_matrix (2, 3, matrix);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_clipping)
+{
+  /* sums of two full scale inputs, once through the dense and once through
+   * the sparse path */
+  static const gdouble dense[] = {
+    1, 1,
+  };
+  static const gdouble sparse[] = {
+    1, 1, 0, 0,
+  };
+
+  check_matrix (2, 1, dense);
+  check_matrix (4, 1, sparse);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_matrix_change)
+{
+  static const GstAudioFormat formats[] = {
+    GST_AUDIO_FORMAT_F32, GST_AUDIO_FORMAT_F64,
+    GST_AUDIO_FORMAT_S16, GST_AUDIO_FORMAT_S32
+  };
+  /* switch from dense to routing to sparse and back */
+  static const gdouble matrices[][6] = {
+    {0.5, 0.25, 0.125, -0.5, 0.75, 0.25},
+    {0, 1, 0, 0, 0, 1},
+    {0.5, 0, 0, 0, 0, 0},
+    {0.5, 0.25, 0.125, -0.5, 0.75, 0.25},
+  };
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstHarness *h = setup_harness (formats[i], 3, 2, matrices[0]);
+
+    for (j = 0; j < G_N_ELEMENTS (matrices); j++) {
+      if (j > 0)
+        set_matrix (h->element, 3, 2, matrices[j]);
+      push_and_check (h, formats[i], 3, 2, matrices[j], rand);
+    }
+    gst_harness_teardown (h);
+  }
+
+  g_rand_free (rand);
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_identity);
+  tcase_add_test (tc_chain, test_routing);
+  tcase_add_test (tc_chain, test_sparse);
+  tcase_add_test (tc_chain, test_dense);
+  tcase_add_test (tc_chain, test_zero_matrix);
+  tcase_add_test (tc_chain, test_clipping);
+  tcase_add_test (tc_chain, test_matrix_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix)
@@ -1740,6 +1740,54 @@ GST_START_TEST (test_obscured_skipped)
 
 GST_END_TEST;
 
+/* sink_0 is covered by the union of sink_1 (left half) and sink_2 (right
+ * half) and should not get mapped */
+GST_START_TEST (test_obscured_by_combination)
+{
+  GstElement *pipeline, *sink, *cfilter;
+  GstSample *sample;
+  GstPad *srcpad;
+  const gchar *desc =
+      "videotestsrc num-buffers=5 ! video/x-raw,width=40,height=40 ! "
+      "capsfilter name=cf0 ! comp.sink_0 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=20,height=40 ! "
+      "comp.sink_1 "
+      "videotestsrc num-buffers=5 ! video/x-raw,width=20,height=40 ! "
+      "comp.sink_2 "
+      "compositor name=comp sink_2::xpos=20 ! "
+      "video/x-raw,width=40,height=40 ! appsink name=sink sync=false";
+
+  buffer_mapped = FALSE;
+
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  cfilter = gst_bin_get_by_name (GST_BIN (pipeline), "cf0");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  srcpad = gst_element_get_static_pad (cfilter, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_obscured_pad_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  do {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    if (sample == NULL)
+      break;
+    gst_sample_unref (sample);
+  } while (TRUE);
+
+  fail_unless (buffer_mapped == FALSE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (cfilter);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 static void
 _pipeline_eos (GstBus * bus, GstMessage * message, GstPipeline * bin)
 {
@@ -2075,6 +2123,297 @@ GST_START_TEST (test_start_time_first_live_drop_3_unlinked_1)
 
 GST_END_TEST;
 
+static GstMemory *passthrough_input_memory;
+
+static GstPadProbeReturn
+test_passthrough_input_probe_cb (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  passthrough_input_memory = gst_buffer_peek_memory (buf, 0);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* A single full-frame input in the output format is forwarded without
+ * copying, an input that does not cover the output is not */
+static void
+_test_passthrough (const gchar * pad_props, gboolean expect_passthrough)
+{
+  GstElement *pipeline, *src, *sink;
+  GstSample *sample;
+  GstBuffer *buf;
+  GstPad *srcpad;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc name=src num-buffers=1 ! "
+      "video/x-raw,format=I420,width=64,height=48,framerate=25/1 ! "
+      "compositor name=comp %s ! "
+      "video/x-raw,format=I420,width=64,height=48 ! "
+      "appsink name=sink sync=false", pad_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  srcpad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      test_passthrough_input_probe_cb, NULL, NULL);
+  gst_object_unref (srcpad);
+
+  passthrough_input_memory = NULL;
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_signal_emit_by_name (sink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  buf = gst_sample_get_buffer (sample);
+  fail_unless (passthrough_input_memory != NULL);
+  if (expect_passthrough)
+    fail_unless (gst_buffer_peek_memory (buf, 0) == passthrough_input_memory);
+  else
+    fail_unless (gst_buffer_peek_memory (buf, 0) != passthrough_input_memory);
+  fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), 0);
+  gst_sample_unref (sample);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_START_TEST (test_passthrough)
+{
+  _test_passthrough ("", TRUE);
+  _test_passthrough ("sink_0::alpha=0.5", FALSE);
+  _test_passthrough ("sink_0::xpos=2", FALSE);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+_run_max_threads_pipeline (const gchar * in_format, const gchar * format,
+    const gchar * props)
+{
+  GstElement *pipeline, *sink;
+  GstSample *sample;
+  GstBuffer *buf;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=190,height=150 ! comp.sink_0 "
+      "videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=%s,width=77,height=61 ! comp.sink_1 "
+      "compositor name=comp %s sink_1::xpos=33 "
+      "sink_1::ypos=-7 sink_1::alpha=0.6 sink_0::ypos=37 ! "
+      "video/x-raw,format=%s,width=190,height=150 ! "
+      "appsink name=sink sync=false", in_format, in_format, props, format);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (sink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  buf = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  return buf;
+}
+
+/* Blending in parallel stripes must produce exactly the same output as
+ * blending the whole frame from a single thread */
+GST_START_TEST (test_max_threads_bit_exact)
+{
+  static const gchar *formats[] = { "AYUV", "BGRA", "I420", "Y42B", "Y41B",
+    "NV12", "YUY2", "RGB", "BGRx"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstBuffer *single, *multi;
+    GstMapInfo single_map, multi_map;
+
+    GST_INFO ("testing format %s", formats[i]);
+
+    single = _run_max_threads_pipeline (formats[i], formats[i],
+        "max-threads=1");
+    multi = _run_max_threads_pipeline (formats[i], formats[i],
+        "max-threads=4");
+
+    fail_unless (gst_buffer_map (single, &single_map, GST_MAP_READ));
+    fail_unless (gst_buffer_map (multi, &multi_map, GST_MAP_READ));
+    fail_unless_equals_int (single_map.size, multi_map.size);
+    fail_unless (memcmp (single_map.data, multi_map.data,
+            single_map.size) == 0, "%s output differs", formats[i]);
+    gst_buffer_unmap (single, &single_map);
+    gst_buffer_unmap (multi, &multi_map);
+
+    gst_buffer_unref (single);
+    gst_buffer_unref (multi);
+  }
+}
+
+GST_END_TEST;
+
+/* Converting the pads concurrently must not change the output either */
+GST_START_TEST (test_max_prepare_threads)
+{
+  GstBuffer *single, *multi;
+  GstMapInfo single_map, multi_map;
+
+  single = _run_max_threads_pipeline ("I420", "AYUV",
+      "max-prepare-threads=1");
+  multi = _run_max_threads_pipeline ("I420", "AYUV",
+      "max-prepare-threads=4 sink_0::converter-threads=2");
+
+  fail_unless (gst_buffer_map (single, &single_map, GST_MAP_READ));
+  fail_unless (gst_buffer_map (multi, &multi_map, GST_MAP_READ));
+  fail_unless_equals_int (single_map.size, multi_map.size);
+  fail_unless (memcmp (single_map.data, multi_map.data,
+          single_map.size) == 0);
+  gst_buffer_unmap (single, &single_map);
+  gst_buffer_unmap (multi, &multi_map);
+
+  gst_buffer_unref (single);
+  gst_buffer_unref (multi);
+}
+
+GST_END_TEST;
+
+static GstBuffer *
+_create_filled_buffer (gsize size, guint8 seed)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  for (i = 0; i < size; i++)
+    map.data[i] = (guint8) (i * 7 + seed);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+#define INCREMENTAL_N_FRAMES 5
+
+static void
+_run_incremental_pipeline (gboolean incremental, GstBuffer ** outbufs)
+{
+  GstElement *pipeline, *src0, *src1, *comp, *sink;
+  GstBuffer *static_buf, *moving_buf = NULL;
+  GstPad *sinkpad;
+  GstSample *sample;
+  gchar *desc;
+  guint i;
+
+  desc = g_strdup_printf ("appsrc name=src0 format=time caps="
+      "video/x-raw,format=I420,width=160,height=120,framerate=10/1 ! "
+      "comp.sink_0 appsrc name=src1 format=time caps="
+      "video/x-raw,format=I420,width=32,height=32,framerate=10/1 ! "
+      "comp.sink_1 compositor name=comp incremental=%d "
+      "sink_0::xpos=8 sink_1::alpha=0.7 ! "
+      "video/x-raw,format=I420,width=176,height=144 ! "
+      "appsink name=sink sync=false", incremental);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  src0 = gst_bin_get_by_name (GST_BIN (pipeline), "src0");
+  src1 = gst_bin_get_by_name (GST_BIN (pipeline), "src1");
+  comp = gst_bin_get_by_name (GST_BIN (pipeline), "comp");
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  sinkpad = gst_element_get_static_pad (comp, "sink_1");
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  static_buf = _create_filled_buffer (160 * 120 * 3 / 2, 0);
+
+  for (i = 0; i < INCREMENTAL_N_FRAMES; i++) {
+    GstBuffer *buf;
+    GstFlowReturn ret;
+
+    /* The overlay keeps its content for two frames, then changes, and
+     * moves from frame 3 on */
+    if (i % 2 == 0)
+      gst_buffer_replace (&moving_buf, NULL);
+    if (moving_buf == NULL)
+      moving_buf = _create_filled_buffer (32 * 32 * 3 / 2, i * 50);
+    if (i >= 3)
+      g_object_set (sinkpad, "xpos", 17 * i, "ypos", 13 * i, NULL);
+
+    /* Shallow copies, sharing the memory like imagefreeze */
+    buf = gst_buffer_copy (static_buf);
+    GST_BUFFER_PTS (buf) = i * 100 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 100 * GST_MSECOND;
+    g_signal_emit_by_name (src0, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+
+    buf = gst_buffer_copy (moving_buf);
+    GST_BUFFER_PTS (buf) = i * 100 * GST_MSECOND;
+    GST_BUFFER_DURATION (buf) = 100 * GST_MSECOND;
+    g_signal_emit_by_name (src1, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (ret, GST_FLOW_OK);
+
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    fail_unless (sample != NULL);
+    outbufs[i] = gst_buffer_ref (gst_sample_get_buffer (sample));
+    gst_sample_unref (sample);
+  }
+
+  gst_buffer_unref (moving_buf);
+  gst_buffer_unref (static_buf);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (sinkpad);
+  gst_object_unref (src0);
+  gst_object_unref (src1);
+  gst_object_unref (comp);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+/* Compositing only the changed parts of the output must give the same
+ * result as compositing every frame completely */
+GST_START_TEST (test_incremental)
+{
+  GstBuffer *full[INCREMENTAL_N_FRAMES], *incremental[INCREMENTAL_N_FRAMES];
+  guint i;
+
+  _run_incremental_pipeline (FALSE, full);
+  _run_incremental_pipeline (TRUE, incremental);
+
+  for (i = 0; i < INCREMENTAL_N_FRAMES; i++) {
+    GstMapInfo full_map, incremental_map;
+
+    fail_unless (gst_buffer_map (full[i], &full_map, GST_MAP_READ));
+    fail_unless (gst_buffer_map (incremental[i], &incremental_map,
+            GST_MAP_READ));
+    fail_unless_equals_int (full_map.size, incremental_map.size);
+    fail_unless (memcmp (full_map.data, incremental_map.data,
+            full_map.size) == 0, "frame %u differs", i);
+    gst_buffer_unmap (full[i], &full_map);
+    gst_buffer_unmap (incremental[i], &incremental_map);
+
+    gst_buffer_unref (full[i]);
+    gst_buffer_unref (incremental[i]);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -2099,6 +2438,7 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_flush_start_flush_stop);
   tcase_add_test (tc_chain, test_segment_base_handling);
   tcase_add_test (tc_chain, test_obscured_skipped);
+  tcase_add_test (tc_chain, test_obscured_by_combination);
   tcase_add_test (tc_chain, test_repeat_after_eos);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
@@ -2108,6 +2448,10 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_start_time_first_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_first_live_drop_3_unlinked_1);
+  tcase_add_test (tc_chain, test_max_threads_bit_exact);
+  tcase_add_test (tc_chain, test_max_prepare_threads);
+  tcase_add_test (tc_chain, test_passthrough);
+  tcase_add_test (tc_chain, test_incremental);
 
   return s;
 }
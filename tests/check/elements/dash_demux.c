@@ -464,6 +464,8 @@ setAndTestDashParams (GstAdaptiveDemuxTestEngine * engine, gpointer user_data)
   test_float_prop (dashdemux, "bitrate-limit", 1);
   test_invalid_float_prop (dashdemux, "bitrate-limit", 2.1);
 
+  test_int_prop (dashdemux, "abr-algorithm", 2);
+
   test_int_prop (dashdemux, "max-buffering-time", 15);
   test_invalid_int_prop (dashdemux, "max-buffering-time", 1);
 
@@ -1520,6 +1522,236 @@ GST_START_TEST (testContentProtection)
 
 GST_END_TEST;
 
+/* moof with a mfhd and a traf with only a tfhd, followed by its mdat */
+#define CMAF_MOOF_SIZE 48
+#define CMAF_MDAT_HEADER_SIZE 8
+
+/* Creates a low latency segment made of @n_chunks moof/mdat chunks */
+static guint8 *
+create_cmaf_segment (guint n_chunks, guint payload_size, guint64 * size)
+{
+  guint chunk_size = CMAF_MOOF_SIZE + CMAF_MDAT_HEADER_SIZE + payload_size;
+  guint8 *segment, *data;
+  guint i;
+
+  *size = (guint64) n_chunks * chunk_size;
+  segment = data = g_malloc (*size);
+
+  for (i = 0; i < n_chunks; i++) {
+    GST_WRITE_UINT32_BE (data, CMAF_MOOF_SIZE);
+    GST_WRITE_UINT32_LE (data + 4, GST_MAKE_FOURCC ('m', 'o', 'o', 'f'));
+    GST_WRITE_UINT32_BE (data + 8, 16);
+    GST_WRITE_UINT32_LE (data + 12, GST_MAKE_FOURCC ('m', 'f', 'h', 'd'));
+    /* version and flags, then the sequence number */
+    GST_WRITE_UINT32_BE (data + 16, 0);
+    GST_WRITE_UINT32_BE (data + 20, i + 1);
+    GST_WRITE_UINT32_BE (data + 24, 24);
+    GST_WRITE_UINT32_LE (data + 28, GST_MAKE_FOURCC ('t', 'r', 'a', 'f'));
+    GST_WRITE_UINT32_BE (data + 32, 16);
+    GST_WRITE_UINT32_LE (data + 36, GST_MAKE_FOURCC ('t', 'f', 'h', 'd'));
+    /* default-base-is-moof, then the track ID */
+    GST_WRITE_UINT32_BE (data + 40, 0x020000);
+    GST_WRITE_UINT32_BE (data + 44, 1);
+    data += CMAF_MOOF_SIZE;
+
+    GST_WRITE_UINT32_BE (data, CMAF_MDAT_HEADER_SIZE + payload_size);
+    GST_WRITE_UINT32_LE (data + 4, GST_MAKE_FOURCC ('m', 'd', 'a', 't'));
+    data += CMAF_MDAT_HEADER_SIZE;
+    memset (data, i + 1, payload_size);
+    data += payload_size;
+  }
+
+  return segment;
+}
+
+/*
+ * Test a low latency segment made of several moof/mdat chunks.
+ * The demuxer has to go back to parsing boxes after each mdat, and must
+ * output the whole segment unmodified. The small blocksize splits boxes
+ * and box headers over several buffers.
+ */
+GST_START_TEST (testCmafChunks)
+{
+  const gchar *mpd =
+      "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"static\""
+      "     minBufferTime=\"PT1.500S\""
+      "     mediaPresentationDuration=\"PT2S\">"
+      "  <Period>"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\""
+      "                      codecs=\"avc1.4d401e\""
+      "                      width=\"320\""
+      "                      height=\"240\""
+      "                      bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"chunk$Number$.m4s\" duration=\"2\"/>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+  guint8 *segment;
+  guint64 segment_size;
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstTestHTTPSrcTestData http_src_test_data = { 0 };
+  GstAdaptiveDemuxTestCallbacks test_callbacks = { 0 };
+  GstDashDemuxTestCase *testData;
+
+  segment = create_cmaf_segment (4, 100, &segment_size);
+  {
+    GstDashDemuxTestInputData inputTestData[] = {
+      {"http://unit.test/test.mpd", (guint8 *) mpd, 0},
+      {"http://unit.test/chunk1.m4s", segment, segment_size},
+      {NULL, NULL, 0},
+    };
+    GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+      {"video_00", segment_size, segment},
+    };
+
+    http_src_callbacks.src_start = gst_dashdemux_http_src_start;
+    http_src_callbacks.src_create = gst_dashdemux_http_src_create;
+    http_src_test_data.input = inputTestData;
+    gst_test_http_src_install_callbacks (&http_src_callbacks,
+        &http_src_test_data);
+
+    test_callbacks.appsink_received_data =
+        gst_adaptive_demux_test_check_received_data;
+    test_callbacks.appsink_eos =
+        gst_adaptive_demux_test_check_size_of_received_data;
+
+    testData = gst_dash_demux_test_case_new ();
+    COPY_OUTPUT_TEST_DATA (outputTestData, testData);
+
+    gst_test_http_src_set_default_blocksize (37);
+    gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+        "http://unit.test/test.mpd", &test_callbacks, testData);
+    gst_test_http_src_set_default_blocksize (0);
+
+    g_object_unref (testData);
+  }
+
+  if (http_src_test_data.data)
+    gst_structure_free (http_src_test_data.data);
+  g_free (segment);
+}
+
+GST_END_TEST;
+
+static gint64 live_cmaf_received_time;
+
+static gboolean
+testLiveCmafCheckReceivedData (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, GstBuffer * buffer,
+    gpointer user_data)
+{
+  GstAdaptiveDemuxTestCase *testData = GST_ADAPTIVE_DEMUX_TEST_CASE (user_data);
+  GstAdaptiveDemuxTestExpectedOutput *testOutputStreamData;
+  guint64 offset, size;
+
+  testOutputStreamData =
+      gst_adaptive_demux_test_find_test_data_by_stream (testData, stream, NULL);
+  fail_unless (testOutputStreamData != NULL);
+
+  /* the segment start is a live timestamp, count the bytes ourselves */
+  offset = stream->total_received_size + stream->segment_received_size;
+  size = gst_buffer_get_size (buffer);
+  fail_unless (offset + size <= testOutputStreamData->expected_size);
+  fail_unless (gst_buffer_memcmp (buffer, 0,
+          &testOutputStreamData->expected_data[offset], size) == 0);
+
+  if (offset + size == testOutputStreamData->expected_size) {
+    live_cmaf_received_time = g_get_monotonic_time ();
+    g_main_loop_quit (engine->loop);
+  }
+
+  return TRUE;
+}
+
+/*
+ * Test that a live segment is requested as soon as the
+ * SegmentTemplate@availabilityTimeOffset allows it.
+ * The current segment only ends 30s from now, but its availability time
+ * offset is the whole segment duration so it can be downloaded right away.
+ */
+GST_START_TEST (testLiveAvailabilityTimeOffset)
+{
+  GDateTime *now, *start;
+  gchar *start_str, *mpd;
+  guint8 *segment;
+  guint64 segment_size;
+  gint64 run_time;
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+  GstTestHTTPSrcTestData http_src_test_data = { 0 };
+  GstAdaptiveDemuxTestCallbacks test_callbacks = { 0 };
+  GstDashDemuxTestCase *testData;
+
+  now = g_date_time_new_now_utc ();
+  start = g_date_time_add_seconds (now, -30);
+  start_str = g_date_time_format (start, "%Y-%m-%dT%H:%M:%SZ");
+  g_date_time_unref (start);
+  g_date_time_unref (now);
+
+  mpd = g_strdup_printf ("<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      "     type=\"dynamic\""
+      "     availabilityStartTime=\"%s\""
+      "     minimumUpdatePeriod=\"PT600S\""
+      "     suggestedPresentationDelay=\"PT0S\""
+      "     minBufferTime=\"PT1.500S\">"
+      "  <Period start=\"PT0S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <Representation id=\"1\""
+      "                      codecs=\"avc1.4d401e\""
+      "                      width=\"320\""
+      "                      height=\"240\""
+      "                      bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"chunk$Number$.m4s\" duration=\"60\""
+      "                         startNumber=\"1\""
+      "                         availabilityTimeOffset=\"60\"/>"
+      "      </Representation></AdaptationSet></Period></MPD>", start_str);
+  g_free (start_str);
+
+  segment = create_cmaf_segment (3, 1000, &segment_size);
+  {
+    GstDashDemuxTestInputData inputTestData[] = {
+      {"http://unit.test/test.mpd", (guint8 *) mpd, 0},
+      {"http://unit.test/chunk1.m4s", segment, segment_size},
+      {NULL, NULL, 0},
+    };
+    GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+      {"video_00", segment_size, segment},
+    };
+
+    http_src_callbacks.src_start = gst_dashdemux_http_src_start;
+    http_src_callbacks.src_create = gst_dashdemux_http_src_create;
+    http_src_test_data.input = inputTestData;
+    gst_test_http_src_install_callbacks (&http_src_callbacks,
+        &http_src_test_data);
+
+    test_callbacks.appsink_received_data = testLiveCmafCheckReceivedData;
+
+    testData = gst_dash_demux_test_case_new ();
+    COPY_OUTPUT_TEST_DATA (outputTestData, testData);
+
+    live_cmaf_received_time = 0;
+    run_time = g_get_monotonic_time ();
+    gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+        "http://unit.test/test.mpd", &test_callbacks, testData);
+
+    /* without the offset, the demuxer would wait for 30s */
+    fail_unless (live_cmaf_received_time != 0);
+    fail_unless (live_cmaf_received_time - run_time < 10 * G_USEC_PER_SEC);
+
+    g_object_unref (testData);
+  }
+
+  if (http_src_test_data.data)
+    gst_structure_free (http_src_test_data.data);
+  g_free (segment);
+  g_free (mpd);
+}
+
+GST_END_TEST;
+
 static Suite *
 dash_demux_suite (void)
 {
@@ -1545,6 +1777,8 @@ dash_demux_suite (void)
   tcase_add_test (tc_basicTest, testMediaDownloadErrorMiddleFragment);
   tcase_add_test (tc_basicTest, testQuery);
   tcase_add_test (tc_basicTest, testContentProtection);
+  tcase_add_test (tc_basicTest, testCmafChunks);
+  tcase_add_test (tc_basicTest, testLiveAvailabilityTimeOffset);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
@@ -2115,6 +2115,57 @@ GST_START_TEST (dash_mpdparser_adapt_repr_segmentTemplate_inherit)
 }
 
 GST_END_TEST;
+/*
+ * Test parsing and inheriting availabilityTimeOffset of SegmentTemplate
+ *
+ */
+GST_START_TEST (dash_mpdparser_segmentTemplate_availabilityTimeOffset)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstRepresentationNode *representation;
+  GstSegmentBaseType *segBaseType;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\">"
+      "  <Period>"
+      "    <AdaptationSet>"
+      "      <SegmentTemplate media=\"TestMedia\" duration=\"2\""
+      "                       availabilityTimeOffset=\"1.5\"/>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate startNumber=\"3\"/>"
+      "      </Representation>"
+      "      <Representation id=\"2\" bandwidth=\"500000\">"
+      "        <SegmentTemplate availabilityTimeOffset=\"INF\"/>"
+      "  </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  segBaseType = adaptationSet->SegmentTemplate->MultSegBaseType->SegBaseType;
+  assert_equals_float (segBaseType->availabilityTimeOffset, 1.5);
+
+  representation = (GstRepresentationNode *)
+      adaptationSet->Representations->data;
+  segBaseType = representation->SegmentTemplate->MultSegBaseType->SegBaseType;
+  assert_equals_float (segBaseType->availabilityTimeOffset, 1.5);
+
+  representation = (GstRepresentationNode *)
+      adaptationSet->Representations->next->data;
+  segBaseType = representation->SegmentTemplate->MultSegBaseType->SegBaseType;
+  fail_unless (segBaseType->availabilityTimeOffset > G_MAXDOUBLE);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test parsing Period AdaptationSet SegmentTemplate attributes with
  * inheritance
@@ -4843,6 +4894,65 @@ GST_START_TEST (dash_mpdparser_segment_timeline)
 
 GST_END_TEST;
 
+/*
+ * Test that a SegmentTimeline inherited from the AdaptationSet is shared by
+ * all Representations instead of being copied for each of them
+ */
+GST_START_TEST (dash_mpdparser_shared_segment_timeline)
+{
+  GstPeriodNode *periodNode;
+  GstAdaptationSetNode *adaptationSet;
+  GstSegmentTimelineNode *segmentTimeline;
+  GstSNode *sNode;
+  GList *list;
+  const gchar *xml =
+      "<?xml version=\"1.0\"?>"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      "     profiles=\"urn:mpeg:dash:profile:isoff-live:2011\">"
+      "  <Period start=\"P0Y0M0DT0H0M0.000S\">"
+      "    <AdaptationSet mimeType=\"video/mp4\">"
+      "      <SegmentTemplate timescale=\"10\">"
+      "        <SegmentTimeline>"
+      "          <S t=\"10\" d=\"20\" r=\"30\"></S>"
+      "        </SegmentTimeline>"
+      "      </SegmentTemplate>"
+      "      <Representation id=\"1\" bandwidth=\"250000\">"
+      "        <SegmentTemplate media=\"low_$Number$.m4s\"/>"
+      "      </Representation>"
+      "      <Representation id=\"2\" bandwidth=\"500000\">"
+      "        <SegmentTemplate media=\"high_$Number$.m4s\"/>"
+      "      </Representation></AdaptationSet></Period></MPD>";
+
+  gboolean ret;
+  GstMpdClient *mpdclient = gst_mpd_client_new ();
+
+  ret = gst_mpd_parse (mpdclient, xml, (gint) strlen (xml));
+  assert_equals_int (ret, TRUE);
+
+  periodNode = (GstPeriodNode *) mpdclient->mpd_node->Periods->data;
+  adaptationSet = (GstAdaptationSetNode *) periodNode->AdaptationSets->data;
+  segmentTimeline =
+      adaptationSet->SegmentTemplate->MultSegBaseType->SegmentTimeline;
+  fail_if (segmentTimeline == NULL);
+  assert_equals_int (segmentTimeline->ref_count, 3);
+
+  for (list = adaptationSet->Representations; list; list = list->next) {
+    GstRepresentationNode *representation = list->data;
+
+    fail_unless (representation->SegmentTemplate->MultSegBaseType->
+        SegmentTimeline == segmentTimeline);
+  }
+
+  sNode = (GstSNode *) g_queue_peek_head (&segmentTimeline->S);
+  assert_equals_uint64 (sNode->t, 10);
+  assert_equals_uint64 (sNode->d, 20);
+  assert_equals_int (sNode->r, 30);
+
+  gst_mpd_client_free (mpdclient);
+}
+
+GST_END_TEST;
+
 /*
  * Test SegmentList with multiple inherited segmentURLs
  *
@@ -5934,6 +6044,8 @@ dash_suite (void)
       dash_mpdparser_period_adaptationSet_segmentTemplate);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_adaptationSet_segmentTemplate_inherit);
+  tcase_add_test (tc_simpleMPD,
+      dash_mpdparser_segmentTemplate_availabilityTimeOffset);
   tcase_add_test (tc_simpleMPD,
       dash_mpdparser_period_adaptationSet_representation);
   tcase_add_test (tc_simpleMPD,
@@ -6001,6 +6113,7 @@ dash_suite (void)
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_list);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_template);
   tcase_add_test (tc_complexMPD, dash_mpdparser_segment_timeline);
+  tcase_add_test (tc_complexMPD, dash_mpdparser_shared_segment_timeline);
   tcase_add_test (tc_complexMPD, dash_mpdparser_multiple_inherited_segmentURL);
 
   /* tests checking the parsing of missing/incomplete attributes of xml */
@@ -24,6 +24,7 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include "parser.h"
 
 #define SRC_CAPS_TMPL   "video/x-h264, parsed=(boolean)false"
@@ -397,6 +398,98 @@ GST_START_TEST (test_sink_caps_reordering)
 
 GST_END_TEST;
 
+#ifndef GST_DISABLE_GST_DEBUG
+typedef struct
+{
+  guint n_sps;
+  guint n_pps;
+} RepeatedNals;
+
+/* h264parse logs "sps %d repeated" / "pps %d repeated" whenever it finds a
+ * parameter set in its cache and skips parsing it again */
+static void
+count_repeated_nals (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  RepeatedNals *repeated = user_data;
+  const gchar *msg;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "h264parse") != 0)
+    return;
+
+  msg = gst_debug_message_get (message);
+  if (!g_str_has_suffix (msg, " repeated"))
+    return;
+
+  if (g_str_has_prefix (msg, "sps "))
+    repeated->n_sps++;
+  else if (g_str_has_prefix (msg, "pps "))
+    repeated->n_pps++;
+}
+#endif
+
+GST_START_TEST (test_parse_repeated_parameter_sets)
+{
+  GstHarness *h = gst_harness_new ("h264parse");
+  GstEvent *event;
+  guint i, n_caps = 0;
+  gsize size = sizeof (h264_sps) + sizeof (h264_pps) + sizeof (h264_idrframe);
+#ifndef GST_DISABLE_GST_DEBUG
+  RepeatedNals repeated = { 0, };
+
+  gst_debug_set_threshold_for_name ("h264parse", GST_LEVEL_LOG);
+  gst_debug_add_log_function (count_repeated_nals, &repeated, NULL);
+#endif
+
+  gst_harness_set_caps_str (h,
+      "video/x-h264, stream-format=byte-stream, alignment=au",
+      "video/x-h264, stream-format=byte-stream, alignment=au");
+
+  /* Identical SPS/PPS in front of every keyframe are passed through but
+   * must not cause any renegotiation */
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+    gst_buffer_fill (buf, 0, h264_sps, sizeof (h264_sps));
+    gst_buffer_fill (buf, sizeof (h264_sps), h264_pps, sizeof (h264_pps));
+    gst_buffer_fill (buf, sizeof (h264_sps) + sizeof (h264_pps),
+        h264_idrframe, sizeof (h264_idrframe));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+
+    fail_unless (buf != NULL);
+    fail_unless_equals_int (gst_buffer_memcmp (buf, 0, h264_sps,
+            sizeof (h264_sps)), 0);
+    gst_buffer_unref (buf);
+  }
+
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      n_caps++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (n_caps, 1);
+
+#ifndef GST_DISABLE_GST_DEBUG
+  gst_debug_remove_log_function (count_repeated_nals);
+  gst_debug_unset_threshold_for_name ("h264parse");
+
+  /* only the parameter sets in front of the first keyframe get parsed, the
+   * two identical copies after it must be served from the cache */
+  fail_unless_equals_int (repeated.n_sps, 2);
+  fail_unless_equals_int (repeated.n_pps, 2);
+#endif
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 h264parse_suite (void)
@@ -412,6 +505,7 @@ h264parse_suite (void)
   tcase_add_test (tc_chain, test_parse_skip_garbage);
   tcase_add_test (tc_chain, test_parse_detect_stream);
   tcase_add_test (tc_chain, test_sink_caps_reordering);
+  tcase_add_test (tc_chain, test_parse_repeated_parameter_sets);
 
   return s;
 }
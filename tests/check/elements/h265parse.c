@@ -0,0 +1,167 @@
+/*
+ * GStreamer
+ *
+ * unit test for h265parse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* some data: a 64x64 Main profile stream made of a single IDR slice */
+
+/* VPS */
+static guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01,
+  0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00,
+  0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x3c, 0xf0, 0x24
+};
+
+/* SPS */
+static guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01,
+  0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00,
+  0x03, 0x00, 0x00, 0x03, 0x00, 0x3c, 0xa0, 0x20,
+  0x81, 0x05, 0x97, 0xe4, 0x93, 0x08, 0x20
+};
+
+/* PPS */
+static guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc0, 0x71,
+  0x80, 0x12
+};
+
+/* IDR_W_RADL slice, I slice header followed by a few payload bytes */
+static guint8 h265_idr[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0xaf,
+  0x37, 0x82, 0x20
+};
+
+#ifndef GST_DISABLE_GST_DEBUG
+typedef struct
+{
+  guint n_vps;
+  guint n_sps;
+  guint n_pps;
+} RepeatedNals;
+
+/* h265parse logs "vps/sps/pps %d repeated" whenever it finds a parameter
+ * set in its cache and skips parsing it again */
+static void
+count_repeated_nals (GstDebugCategory * category, GstDebugLevel level,
+    const gchar * file, const gchar * function, gint line, GObject * object,
+    GstDebugMessage * message, gpointer user_data)
+{
+  RepeatedNals *repeated = user_data;
+  const gchar *msg;
+
+  if (g_strcmp0 (gst_debug_category_get_name (category), "h265parse") != 0)
+    return;
+
+  msg = gst_debug_message_get (message);
+  if (!g_str_has_suffix (msg, " repeated"))
+    return;
+
+  if (g_str_has_prefix (msg, "vps "))
+    repeated->n_vps++;
+  else if (g_str_has_prefix (msg, "sps "))
+    repeated->n_sps++;
+  else if (g_str_has_prefix (msg, "pps "))
+    repeated->n_pps++;
+}
+#endif
+
+GST_START_TEST (test_parse_repeated_parameter_sets)
+{
+  GstHarness *h = gst_harness_new ("h265parse");
+  GstEvent *event;
+  guint i, n_caps = 0;
+  gsize offset, size = sizeof (h265_vps) + sizeof (h265_sps) +
+      sizeof (h265_pps) + sizeof (h265_idr);
+#ifndef GST_DISABLE_GST_DEBUG
+  RepeatedNals repeated = { 0, };
+
+  gst_debug_set_threshold_for_name ("h265parse", GST_LEVEL_LOG);
+  gst_debug_add_log_function (count_repeated_nals, &repeated, NULL);
+#endif
+
+  gst_harness_set_caps_str (h,
+      "video/x-h265, stream-format=byte-stream, alignment=au",
+      "video/x-h265, stream-format=byte-stream, alignment=au");
+
+  /* Identical VPS/SPS/PPS in front of every keyframe are passed through but
+   * must not cause any renegotiation */
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+
+    offset = 0;
+    offset += gst_buffer_fill (buf, offset, h265_vps, sizeof (h265_vps));
+    offset += gst_buffer_fill (buf, offset, h265_sps, sizeof (h265_sps));
+    offset += gst_buffer_fill (buf, offset, h265_pps, sizeof (h265_pps));
+    gst_buffer_fill (buf, offset, h265_idr, sizeof (h265_idr));
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < 3; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+
+    fail_unless (buf != NULL);
+    fail_unless (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT) ==
+        FALSE);
+    fail_unless_equals_int (gst_buffer_memcmp (buf, 0, h265_vps,
+            sizeof (h265_vps)), 0);
+    gst_buffer_unref (buf);
+  }
+
+  while ((event = gst_harness_try_pull_event (h))) {
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS)
+      n_caps++;
+    gst_event_unref (event);
+  }
+  fail_unless_equals_int (n_caps, 1);
+
+#ifndef GST_DISABLE_GST_DEBUG
+  gst_debug_remove_log_function (count_repeated_nals);
+  gst_debug_unset_threshold_for_name ("h265parse");
+
+  /* only the parameter sets in front of the first keyframe get parsed, the
+   * two identical copies after it must be served from the cache */
+  fail_unless_equals_int (repeated.n_vps, 2);
+  fail_unless_equals_int (repeated.n_sps, 2);
+  fail_unless_equals_int (repeated.n_pps, 2);
+#endif
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parse_suite (void)
+{
+  Suite *s = suite_create ("h265parse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_repeated_parameter_sets);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parse);
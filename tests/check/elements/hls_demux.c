@@ -726,6 +726,518 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+/*
+ * Prefetch tests. Each fragment is filled with its own marker byte, so that
+ * the output tells which fragments it comes from. The download of the first
+ * fragment is held back after its first block until the next fragment has
+ * been prefetched, and the test action (a seek or a bitrate switch) has
+ * been done.
+ */
+#define PREFETCH_SEGMENT_SIZE (30 * TS_PACKET_LEN)
+/* a block is enough for typefinding */
+#define PREFETCH_BLOCK_SIZE (15 * TS_PACKET_LEN)
+/* the payload of a segment, after the 4 bytes header of each packet */
+#define PREFETCH_MARKER_BYTES \
+    (PREFETCH_SEGMENT_SIZE / TS_PACKET_LEN * (TS_PACKET_LEN - 4))
+
+typedef struct _GstHlsDemuxPrefetchTest
+{
+  GstHlsDemuxTestCase hls;
+  GstAdaptiveDemuxTestEngine *engine;
+
+  GMutex lock;
+  GCond cond;
+
+  /* the fragment to hold back and the one to wait for meanwhile */
+  const gchar *hold_uri;
+  const gchar *prefetch_uri;
+  gboolean held;
+  gboolean prefetched_early;
+
+  /* done from the main loop once data comes out, releases hold_uri */
+  GSourceFunc action;
+  gboolean action_scheduled;
+  gboolean released;
+
+  /* URIs downloaded completely */
+  GHashTable *completed;
+  /* number of bytes received for each marker, and the markers in the order
+   * they were first received */
+  guint64 marker_bytes[256];
+  GByteArray *markers;
+  /* the marker of the last fragment expected */
+  guint8 final_marker;
+} GstHlsDemuxPrefetchTest;
+
+static GByteArray *
+generate_marked_transport_stream (guint length, guint8 marker)
+{
+  GByteArray *mpeg_ts;
+  guint pos;
+
+  mpeg_ts = generate_transport_stream (length);
+  fail_unless (mpeg_ts != NULL);
+  for (pos = 0; pos < length; pos += TS_PACKET_LEN)
+    memset (mpeg_ts->data + pos + 4, marker, TS_PACKET_LEN - 4);
+
+  return mpeg_ts;
+}
+
+static void
+gst_hlsdemux_prefetch_test_init (GstHlsDemuxPrefetchTest * test,
+    const GstHlsDemuxTestInputData * input, const gchar * funcname)
+{
+  memset (test, 0, sizeof (GstHlsDemuxPrefetchTest));
+  test->hls.input = input;
+  test->hls.state = gst_structure_new_empty (funcname);
+  g_mutex_init (&test->lock);
+  g_cond_init (&test->cond);
+  test->completed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      NULL);
+  test->markers = g_byte_array_new ();
+}
+
+static void
+gst_hlsdemux_prefetch_test_clear (GstHlsDemuxPrefetchTest * test)
+{
+  gst_structure_free (test->hls.state);
+  g_mutex_clear (&test->lock);
+  g_cond_clear (&test->cond);
+  g_hash_table_unref (test->completed);
+  g_byte_array_free (test->markers, TRUE);
+}
+
+static guint
+gst_hlsdemux_prefetch_test_count_requests (GstHlsDemuxPrefetchTest * test,
+    const gchar * uri)
+{
+  const GValue *requests;
+  guint i, count = 0;
+
+  requests = gst_structure_get_value (test->hls.state, "requests");
+  if (requests == NULL)
+    return 0;
+
+  for (i = 0; i < gst_value_array_get_size (requests); ++i) {
+    if (strcmp (g_value_get_string (gst_value_array_get_value (requests, i)),
+            uri) == 0)
+      count++;
+  }
+
+  return count;
+}
+
+/* Waits for prefetch_uri to be downloaded, must be called with the lock */
+static gboolean
+gst_hlsdemux_prefetch_test_wait_prefetched (GstHlsDemuxPrefetchTest * test)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+  while (!g_hash_table_contains (test->completed, test->prefetch_uri)) {
+    if (!g_cond_wait_until (&test->cond, &test->lock, end_time))
+      break;
+  }
+
+  return g_hash_table_contains (test->completed, test->prefetch_uri);
+}
+
+static void
+gst_hlsdemux_prefetch_test_hold (GstHlsDemuxPrefetchTest * test)
+{
+  gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&test->lock);
+  if (!test->held) {
+    test->held = TRUE;
+    test->prefetched_early = gst_hlsdemux_prefetch_test_wait_prefetched (test);
+
+    while (test->action && !test->released) {
+      if (!g_cond_wait_until (&test->cond, &test->lock, end_time))
+        break;
+    }
+  }
+  g_mutex_unlock (&test->lock);
+}
+
+static gboolean
+gst_hlsdemux_prefetch_test_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+  gboolean ret;
+
+  /* prefetched fragments are requested from other threads */
+  g_mutex_lock (&test->lock);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, &test->hls);
+  g_mutex_unlock (&test->lock);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hlsdemux_prefetch_test_src_create (GstTestHTTPSrc * src,
+    guint64 offset,
+    guint length, GstBuffer ** retbuf, gpointer context, gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+  GstFlowReturn ret;
+
+  if (offset > 0 && strcmp (input->uri, test->hold_uri) == 0)
+    gst_hlsdemux_prefetch_test_hold (test);
+
+  ret = gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      &test->hls);
+
+  if (ret == GST_FLOW_OK && input->size > 0 && offset + length >= input->size) {
+    g_mutex_lock (&test->lock);
+    g_hash_table_add (test->completed, g_strdup (input->uri));
+    g_cond_broadcast (&test->cond);
+    g_mutex_unlock (&test->lock);
+  }
+
+  return ret;
+}
+
+static void
+gst_hlsdemux_prefetch_test_pre_test (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+
+  test->engine = engine;
+  g_object_set (engine->demux, "prefetch-fragments", 2, NULL);
+}
+
+static gboolean
+gst_hlsdemux_prefetch_test_received_data (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, GstBuffer * buffer,
+    gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+  GstMapInfo info;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buffer, &info, GST_MAP_READ));
+  g_mutex_lock (&test->lock);
+  for (i = 0; i < info.size; i++) {
+    guint8 marker = info.data[i];
+
+    /* the markers don't clash with the bytes of the packet headers */
+    if (marker < 0xA0 || marker == 0xFF)
+      continue;
+    if (test->marker_bytes[marker]++ == 0)
+      g_byte_array_append (test->markers, &marker, 1);
+  }
+
+  /* the action needs the pads to be exposed */
+  if (test->action && !test->action_scheduled) {
+    test->action_scheduled = TRUE;
+    g_idle_add (test->action, test);
+  }
+  g_mutex_unlock (&test->lock);
+  gst_buffer_unmap (buffer, &info);
+
+  return TRUE;
+}
+
+static void
+gst_hlsdemux_prefetch_test_eos (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+  gboolean done;
+
+  /* pads are replaced on bitrate switches, wait for the last one */
+  g_mutex_lock (&test->lock);
+  done = test->marker_bytes[test->final_marker] == PREFETCH_MARKER_BYTES;
+  g_mutex_unlock (&test->lock);
+
+  if (done)
+    g_main_loop_quit (engine->loop);
+}
+
+/* @engine_callbacks may have pre_test and demux_sent_event set already */
+static void
+gst_hlsdemux_prefetch_test_run (GstHlsDemuxPrefetchTest * test,
+    GstAdaptiveDemuxTestCallbacks * engine_callbacks)
+{
+  GstTestHTTPSrcCallbacks http_src_callbacks = { 0 };
+
+  gst_test_http_src_set_default_blocksize (PREFETCH_BLOCK_SIZE);
+  http_src_callbacks.src_start = gst_hlsdemux_prefetch_test_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_prefetch_test_src_create;
+  if (engine_callbacks->pre_test == NULL)
+    engine_callbacks->pre_test = gst_hlsdemux_prefetch_test_pre_test;
+  engine_callbacks->appsink_received_data =
+      gst_hlsdemux_prefetch_test_received_data;
+  engine_callbacks->appsink_eos = gst_hlsdemux_prefetch_test_eos;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, test);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME, test->hls.input[0].uri,
+      engine_callbacks, test);
+}
+
+/*
+ * Test that with prefetch-fragments set, the next fragment is downloaded
+ * before the current one is done, and that the fragments still come out
+ * whole, once each and in order
+ */
+GST_START_TEST (testPrefetchFragments)
+{
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/002.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/003.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/004.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {NULL, NULL, 0},
+  };
+  const guint8 expected_markers[] = { 0xA1, 0xA2, 0xA3, 0xA4 };
+  GstAdaptiveDemuxTestCallbacks engine_callbacks = { 0 };
+  GByteArray *segments[4];
+  GstHlsDemuxPrefetchTest test;
+  guint i;
+
+  for (i = 0; i < 4; i++) {
+    segments[i] = generate_marked_transport_stream (PREFETCH_SEGMENT_SIZE,
+        expected_markers[i]);
+    inputTestData[i + 1].payload = segments[i]->data;
+  }
+  gst_hlsdemux_prefetch_test_init (&test, inputTestData, __FUNCTION__);
+  test.hold_uri = "http://unit.test/001.ts";
+  test.prefetch_uri = "http://unit.test/002.ts";
+  test.final_marker = 0xA4;
+
+  gst_hlsdemux_prefetch_test_run (&test, &engine_callbacks);
+
+  fail_unless (test.prefetched_early,
+      "002.ts was not prefetched while 001.ts was downloaded");
+  for (i = 1; inputTestData[i].uri; i++) {
+    assert_equals_int (gst_hlsdemux_prefetch_test_count_requests (&test,
+            inputTestData[i].uri), 1);
+  }
+  fail_unless_equals_int (test.markers->len, 4);
+  for (i = 0; i < 4; i++) {
+    assert_equals_int (test.markers->data[i], expected_markers[i]);
+    assert_equals_uint64 (test.marker_bytes[expected_markers[i]],
+        PREFETCH_MARKER_BYTES);
+  }
+
+  gst_hlsdemux_prefetch_test_clear (&test);
+  for (i = 0; i < 4; i++)
+    g_byte_array_free (segments[i], TRUE);
+}
+
+GST_END_TEST;
+
+static gboolean
+gst_hlsdemux_prefetch_test_seek (gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+  gboolean prefetched;
+
+  g_mutex_lock (&test->lock);
+  prefetched = gst_hlsdemux_prefetch_test_wait_prefetched (test);
+  g_mutex_unlock (&test->lock);
+  fail_unless (prefetched);
+
+  /* to the last fragment, while the first one is still held back */
+  fail_unless (gst_element_send_event (test->engine->pipeline,
+          gst_event_new_seek (1.0, GST_FORMAT_TIME,
+              GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, GST_SEEK_TYPE_SET,
+              3 * GST_SECOND, GST_SEEK_TYPE_NONE, 0)));
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gst_hlsdemux_prefetch_test_flush_start (GstAdaptiveDemuxTestEngine * engine,
+    GstAdaptiveDemuxTestOutputStream * stream, GstEvent * event,
+    gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+
+  /* the held download has to be let go for the seek to stop it */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START) {
+    g_mutex_lock (&test->lock);
+    test->released = TRUE;
+    g_cond_broadcast (&test->cond);
+    g_mutex_unlock (&test->lock);
+  }
+
+  return TRUE;
+}
+
+/*
+ * Test that prefetched fragments are dropped by a seek: nothing of the
+ * fragments between the seek and the position it was done from comes out
+ */
+GST_START_TEST (testPrefetchSeek)
+{
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/002.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/003.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/004.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestCallbacks engine_callbacks = { 0 };
+  GByteArray *segments[4];
+  GstHlsDemuxPrefetchTest test;
+  guint i;
+
+  for (i = 0; i < 4; i++) {
+    segments[i] = generate_marked_transport_stream (PREFETCH_SEGMENT_SIZE,
+        0xA1 + i);
+    inputTestData[i + 1].payload = segments[i]->data;
+  }
+  gst_hlsdemux_prefetch_test_init (&test, inputTestData, __FUNCTION__);
+  test.hold_uri = "http://unit.test/001.ts";
+  test.prefetch_uri = "http://unit.test/002.ts";
+  test.action = gst_hlsdemux_prefetch_test_seek;
+  test.final_marker = 0xA4;
+
+  engine_callbacks.demux_sent_event = gst_hlsdemux_prefetch_test_flush_start;
+  gst_hlsdemux_prefetch_test_run (&test, &engine_callbacks);
+
+  fail_unless (test.prefetched_early);
+  assert_equals_uint64 (test.marker_bytes[0xA2], 0);
+  assert_equals_uint64 (test.marker_bytes[0xA3], 0);
+  assert_equals_uint64 (test.marker_bytes[0xA4], PREFETCH_MARKER_BYTES);
+  /* the prefetched data is not downloaded a second time either */
+  assert_equals_int (gst_hlsdemux_prefetch_test_count_requests (&test,
+          "http://unit.test/002.ts"), 1);
+  assert_equals_int (gst_hlsdemux_prefetch_test_count_requests (&test,
+          "http://unit.test/004.ts"), 1);
+
+  gst_hlsdemux_prefetch_test_clear (&test);
+  for (i = 0; i < 4; i++)
+    g_byte_array_free (segments[i], TRUE);
+}
+
+GST_END_TEST;
+
+static gboolean
+gst_hlsdemux_prefetch_test_switch (gpointer user_data)
+{
+  GstHlsDemuxPrefetchTest *test = (GstHlsDemuxPrefetchTest *) user_data;
+
+  /* the next bitrate selection picks the high variant */
+  g_object_set (test->engine->demux, "connection-speed", 10000, NULL);
+
+  g_mutex_lock (&test->lock);
+  test->released = TRUE;
+  g_cond_broadcast (&test->cond);
+  g_mutex_unlock (&test->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gst_hlsdemux_prefetch_test_switch_pre_test (GstAdaptiveDemuxTestEngine *
+    engine, gpointer user_data)
+{
+  gst_hlsdemux_prefetch_test_pre_test (engine, user_data);
+  /* start with the low variant */
+  g_object_set (engine->demux, "connection-speed", 1500, NULL);
+}
+
+/*
+ * Test that prefetched fragments are dropped on a bitrate switch: after the
+ * first fragment, only the fragments of the new variant come out
+ */
+GST_START_TEST (testPrefetchBitrateSwitch)
+{
+  const gchar *master_playlist =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:4\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=1000000\n"
+      "low.m3u8\n"
+      "#EXT-X-STREAM-INF:PROGRAM-ID=1, BANDWIDTH=5000000\n" "high.m3u8\n";
+  const gchar *low_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "low001.ts\n"
+      "#EXTINF:1,Test\n" "low002.ts\n"
+      "#EXTINF:1,Test\n" "low003.ts\n"
+      "#EXTINF:1,Test\n" "low004.ts\n" "#EXT-X-ENDLIST\n";
+  const gchar *high_playlist =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "high001.ts\n"
+      "#EXTINF:1,Test\n" "high002.ts\n"
+      "#EXTINF:1,Test\n" "high003.ts\n"
+      "#EXTINF:1,Test\n" "high004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/master.m3u8", (guint8 *) master_playlist, 0},
+    {"http://unit.test/low.m3u8", (guint8 *) low_playlist, 0},
+    {"http://unit.test/high.m3u8", (guint8 *) high_playlist, 0},
+    {"http://unit.test/low001.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/low002.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/low003.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/low004.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/high001.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/high002.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/high003.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {"http://unit.test/high004.ts", NULL, PREFETCH_SEGMENT_SIZE},
+    {NULL, NULL, 0},
+  };
+  /* 0xAn for the low variant, 0xBn for the high one */
+  const guint8 expected_markers[] = { 0xA1, 0xB2, 0xB3, 0xB4 };
+  GstAdaptiveDemuxTestCallbacks engine_callbacks = { 0 };
+  GByteArray *segments[8];
+  GstHlsDemuxPrefetchTest test;
+  guint i;
+
+  for (i = 0; i < 8; i++) {
+    segments[i] = generate_marked_transport_stream (PREFETCH_SEGMENT_SIZE,
+        (i < 4 ? 0xA1 : 0xB1) + i % 4);
+    inputTestData[i + 3].payload = segments[i]->data;
+  }
+  gst_hlsdemux_prefetch_test_init (&test, inputTestData, __FUNCTION__);
+  test.hold_uri = "http://unit.test/low001.ts";
+  test.prefetch_uri = "http://unit.test/low002.ts";
+  test.action = gst_hlsdemux_prefetch_test_switch;
+  test.final_marker = 0xB4;
+
+  engine_callbacks.pre_test = gst_hlsdemux_prefetch_test_switch_pre_test;
+  gst_hlsdemux_prefetch_test_run (&test, &engine_callbacks);
+
+  fail_unless (test.prefetched_early);
+  fail_unless_equals_int (test.markers->len, 4);
+  for (i = 0; i < 4; i++) {
+    assert_equals_int (test.markers->data[i], expected_markers[i]);
+    assert_equals_uint64 (test.marker_bytes[expected_markers[i]],
+        PREFETCH_MARKER_BYTES);
+  }
+  for (i = 8; i < 11; i++) {
+    assert_equals_int (gst_hlsdemux_prefetch_test_count_requests (&test,
+            inputTestData[i].uri), 1);
+  }
+
+  gst_hlsdemux_prefetch_test_clear (&test);
+  for (i = 0; i < 8; i++)
+    g_byte_array_free (segments[i], TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -745,6 +1257,9 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testSeekSnapAfterPosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapBeforePosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapAfterPosition);
+  tcase_add_test (tc_basicTest, testPrefetchFragments);
+  tcase_add_test (tc_basicTest, testPrefetchSeek);
+  tcase_add_test (tc_basicTest, testPrefetchBitrateSwitch);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
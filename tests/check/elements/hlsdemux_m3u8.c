@@ -574,6 +574,132 @@ GST_START_TEST (test_live_playlist_rotated)
 
 GST_END_TEST;
 
+static gchar *
+generate_live_playlist (guint first, guint n_files, const gchar * prefix)
+{
+  GString *data = g_string_new ("#EXTM3U\n#EXT-X-TARGETDURATION:8\n");
+  guint i;
+
+  g_string_append_printf (data, "#EXT-X-MEDIA-SEQUENCE:%u\n", first);
+  for (i = first; i < first + n_files; i++)
+    g_string_append_printf (data, "#EXTINF:8,\n%s%u.ts\n", prefix, i);
+
+  return g_string_free (data, FALSE);
+}
+
+/* Refreshing a live playlist must keep the fragments that are still listed
+ * and only add the new ones */
+GST_START_TEST (test_live_playlist_incremental_update)
+{
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file, *kept;
+  gint64 first = -1, last = -1;
+  gboolean ret;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live/test.m3u8", NULL, "test.m3u8");
+
+  ret = gst_m3u8_update (pl, generate_live_playlist (100, 1000, "segment"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 1000);
+  kept = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 500));
+  assert_equals_int (kept->sequence, 600);
+
+  /* Window moved by 10 fragments */
+  ret = gst_m3u8_update (pl, generate_live_playlist (110, 1000, "segment"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 1000);
+  fail_unless (g_list_nth_data (pl->files, 490) == kept);
+  fail_unless (gst_m3u8_get_sequence_range (pl, &first, &last));
+  assert_equals_int64 (first, 110);
+  assert_equals_int64 (last, 1109);
+  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  assert_equals_string (file->uri, "http://localhost/live/segment1109.ts");
+  assert_equals_uint64 (pl->duration, 1000 * 8 * GST_SECOND);
+
+  /* Fragments are looked up by their sequence number */
+  pl->sequence = 600;
+  pl->current_file = NULL;
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file == kept);
+  gst_m3u8_media_file_unref (file);
+  gst_m3u8_advance_fragment (pl, TRUE);
+  assert_equals_int64 (pl->sequence, 601);
+
+  /* Same sequence numbers with different URIs are rejected */
+  ret = gst_m3u8_update (pl, generate_live_playlist (120, 1000, "other"));
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (g_list_length (pl->files), 1000);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
+/* Fragment URIs that are written relative to the playlist in a different
+ * form on refresh still refer to the same fragments */
+GST_START_TEST (test_live_playlist_relative_uri_update)
+{
+  GstM3U8 *pl;
+  GstM3U8MediaFile *file, *kept;
+  GList *current_file;
+  gboolean ret;
+
+  pl = gst_m3u8_new ();
+  gst_m3u8_set_uri (pl, "http://localhost/live/test.m3u8", NULL, "test.m3u8");
+
+  ret = gst_m3u8_update (pl, generate_live_playlist (100, 10, "./segment"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 10);
+  assert_equals_uint64 (pl->duration, 10 * 8 * GST_SECOND);
+  kept = GST_M3U8_MEDIA_FILE (g_list_nth_data (pl->files, 2));
+  assert_equals_int (kept->sequence, 102);
+
+  ret = gst_m3u8_update (pl,
+      generate_live_playlist (102, 10, "../live/segment"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 10);
+  fail_unless (pl->files->data == kept);
+  assert_equals_uint64 (pl->duration, 10 * 8 * GST_SECOND);
+  file = GST_M3U8_MEDIA_FILE (g_list_last (pl->files)->data);
+  assert_equals_int (file->sequence, 111);
+  assert_equals_string (file->uri,
+      "http://localhost/live/../live/segment111.ts");
+
+  /* The current fragment is found again in the merged list */
+  fail_unless (pl->current_file == NULL);
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (file != NULL);
+  assert_equals_int64 (file->sequence, pl->sequence);
+  gst_m3u8_media_file_unref (file);
+  current_file = pl->current_file;
+  fail_unless (current_file != NULL);
+
+  ret = gst_m3u8_update (pl, generate_live_playlist (104, 10, "segment"));
+  assert_equals_int (ret, TRUE);
+  assert_equals_int (g_list_length (pl->files), 10);
+  file = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  gst_m3u8_media_file_unref (file);
+  current_file = pl->current_file;
+
+  /* A real mismatch is still rejected and leaves the state untouched */
+  ret = gst_m3u8_update (pl, generate_live_playlist (106, 10, "../other/seg"));
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (g_list_length (pl->files), 10);
+  assert_equals_uint64 (pl->duration, 10 * 8 * GST_SECOND);
+  fail_unless (pl->current_file == current_file);
+
+  /* A path that only shares the file name is a mismatch too */
+  ret = gst_m3u8_update (pl, generate_live_playlist (106, 10, "/segment"));
+  assert_equals_int (ret, FALSE);
+  assert_equals_int (g_list_length (pl->files), 10);
+  fail_unless (pl->current_file == current_file);
+
+  gst_m3u8_unref (pl);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_playlist_with_doubles_duration)
 {
   GstHLSMasterPlaylist *master;
@@ -832,6 +958,51 @@ GST_START_TEST (test_get_next_fragment)
 
 GST_END_TEST;
 
+GST_START_TEST (test_peek_fragment)
+{
+  GstHLSMasterPlaylist *master;
+  GstM3U8 *pl;
+  GstM3U8MediaFile *mf;
+
+  master = load_playlist (BYTE_RANGES_PLAYLIST);
+  pl = master->default_variant->m3u8;
+
+  /* Nothing selected yet */
+  fail_unless (gst_m3u8_peek_fragment (pl, 1) == NULL);
+
+  mf = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (mf != NULL);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_peek_fragment (pl, 0);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  mf = gst_m3u8_peek_fragment (pl, 2);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 2000);
+  gst_m3u8_media_file_unref (mf);
+
+  fail_unless (gst_m3u8_peek_fragment (pl, 4) == NULL);
+
+  /* Peeking doesn't move the current fragment */
+  mf = gst_m3u8_get_next_fragment (pl, TRUE, NULL, NULL);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 100);
+  gst_m3u8_media_file_unref (mf);
+
+  gst_m3u8_advance_fragment (pl, TRUE);
+  mf = gst_m3u8_peek_fragment (pl, 1);
+  fail_unless (mf != NULL);
+  assert_equals_uint64 (mf->offset, 2000);
+  gst_m3u8_media_file_unref (mf);
+
+  gst_hls_master_playlist_unref (master);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_get_duration)
 {
   GstHLSMasterPlaylist *master;
@@ -1417,6 +1588,8 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_empty_lines_playlist);
   tcase_add_test (tc_m3u8, test_live_playlist);
   tcase_add_test (tc_m3u8, test_live_playlist_rotated);
+  tcase_add_test (tc_m3u8, test_live_playlist_incremental_update);
+  tcase_add_test (tc_m3u8, test_live_playlist_relative_uri_update);
   tcase_add_test (tc_m3u8, test_playlist_with_doubles_duration);
   tcase_add_test (tc_m3u8, test_playlist_with_encryption);
   tcase_add_test (tc_m3u8, test_update_invalid_playlist);
@@ -1424,6 +1597,7 @@ hlsdemux_suite (void)
   tcase_add_test (tc_m3u8, test_playlist_media_files);
   tcase_add_test (tc_m3u8, test_playlist_byte_range_media_files);
   tcase_add_test (tc_m3u8, test_get_next_fragment);
+  tcase_add_test (tc_m3u8, test_peek_fragment);
   tcase_add_test (tc_m3u8, test_get_duration);
   tcase_add_test (tc_m3u8, test_get_target_duration);
   tcase_add_test (tc_m3u8, test_get_stream_for_bitrate);
@@ -0,0 +1,325 @@
+/* GStreamer
+ *
+ * unit test for the inter elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+/* 30 fps */
+#define FRAME_DURATION (GST_SECOND / 30)
+
+#define VIDEO_CAPS(width, height) \
+    "video/x-raw, format=(string)GRAY8, width=(int)" G_STRINGIFY (width) \
+    ", height=(int)" G_STRINGIFY (height) ", framerate=(fraction)30/1"
+
+#define AUDIO_CAPS "audio/x-raw, format=(string)S16LE, rate=(int)48000, " \
+    "channels=(int)1, layout=(string)interleaved"
+
+/* Sets up intervideosrc and brings it to PAUSED, so that the surface knows
+ * the queue depth before anything is rendered, but no frame is selected
+ * yet since it is a live source */
+static GstHarness *
+setup_video_src (const gchar * channel, guint queue_depth)
+{
+  GstHarness *h;
+
+  h = gst_harness_new_with_padnames ("intervideosrc", NULL, "src");
+  g_object_set (h->element, "channel", channel, "queue-depth", queue_depth,
+      NULL);
+  gst_harness_use_testclock (h);
+  gst_harness_set_sink_caps_str (h, "video/x-raw, format=(string)GRAY8");
+  gst_element_set_base_time (h->element, 0);
+  gst_element_set_state (h->element, GST_STATE_PAUSED);
+
+  return h;
+}
+
+static GstHarness *
+setup_video_sink (const gchar * channel)
+{
+  GstHarness *h;
+  gchar *desc;
+
+  /* the channel has to be set before the sink is started */
+  desc = g_strdup_printf ("intervideosink channel=%s sync=false", channel);
+  h = gst_harness_new_parse (desc);
+  g_free (desc);
+  gst_element_set_base_time (h->element, 0);
+
+  return h;
+}
+
+static void
+push_video_frame (GstHarness * h, gsize size, guint8 marker, guint index)
+{
+  GstBuffer *buf = gst_harness_create_buffer (h, size);
+
+  gst_buffer_memset (buf, 0, marker, size);
+  GST_BUFFER_PTS (buf) = index * FRAME_DURATION;
+  GST_BUFFER_DURATION (buf) = FRAME_DURATION;
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+static GstBuffer *
+pull_video_frame (GstHarness * h)
+{
+  fail_unless (gst_harness_crank_single_clock_wait (h));
+  return gst_harness_pull (h);
+}
+
+static guint8
+get_marker (GstBuffer * buf)
+{
+  guint8 marker;
+
+  fail_unless_equals_int (gst_buffer_extract (buf, 0, &marker, 1), 1);
+  return marker;
+}
+
+GST_START_TEST (test_video_queue_frame_selection)
+{
+  GstHarness *src, *sink;
+  /* with 3 queued frames, the source stays 2 frames behind the sink and
+   * repeats the first frame until then */
+  static const guint8 expected[] = { 100, 100, 100, 101, 102, 102 };
+  guint i;
+
+  src = setup_video_src ("selection", 3);
+  sink = setup_video_sink ("selection");
+  gst_harness_set_src_caps_str (sink, VIDEO_CAPS (16, 16));
+
+  for (i = 0; i < 3; i++)
+    push_video_frame (sink, 16 * 16, 100 + i, i);
+
+  gst_harness_play (src);
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    GstBuffer *buf = pull_video_frame (src);
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf),
+        gst_util_uint64_scale (i, GST_SECOND, 30));
+    fail_unless_equals_int (get_marker (buf), expected[i]);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (sink);
+  gst_harness_teardown (src);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_video_queue_caps_change)
+{
+  GstHarness *src, *sink;
+  gboolean got_new_frame = FALSE;
+  guint i;
+
+  src = setup_video_src ("caps-change", 3);
+  sink = setup_video_sink ("caps-change");
+
+  /* the frames queued with the previous caps must not be sent with the
+   * new ones */
+  gst_harness_set_src_caps_str (sink, VIDEO_CAPS (16, 16));
+  push_video_frame (sink, 16 * 16, 100, 0);
+  push_video_frame (sink, 16 * 16, 101, 1);
+  gst_harness_set_src_caps_str (sink, VIDEO_CAPS (8, 8));
+  push_video_frame (sink, 8 * 8, 102, 2);
+
+  gst_harness_play (src);
+  for (i = 0; i < 6; i++) {
+    GstBuffer *buf = pull_video_frame (src);
+    guint8 marker = get_marker (buf);
+
+    fail_unless_equals_int (gst_buffer_get_size (buf), 8 * 8);
+    fail_if (marker == 100 || marker == 101);
+    if (marker == 102)
+      got_new_frame = TRUE;
+    gst_buffer_unref (buf);
+  }
+  fail_unless (got_new_frame);
+
+  gst_harness_teardown (sink);
+  gst_harness_teardown (src);
+}
+
+GST_END_TEST;
+
+static GstClockTime
+query_min_latency (GstHarness * h)
+{
+  GstQuery *query = gst_query_new_latency ();
+  GstClockTime min_latency, max_latency;
+  gboolean live;
+
+  fail_unless (gst_pad_peer_query (h->sinkpad, query));
+  gst_query_parse_latency (query, &live, &min_latency, &max_latency);
+  fail_unless (live);
+  gst_query_unref (query);
+
+  return min_latency;
+}
+
+GST_START_TEST (test_video_queue_latency)
+{
+  GstHarness *shallow, *deep;
+  GstBuffer *buf;
+
+  shallow = setup_video_src ("latency-1", 1);
+  deep = setup_video_src ("latency-4", 4);
+
+  /* the framerate is only known once the sources negotiated */
+  gst_harness_play (shallow);
+  buf = pull_video_frame (shallow);
+  gst_buffer_unref (buf);
+  gst_harness_play (deep);
+  buf = pull_video_frame (deep);
+  gst_buffer_unref (buf);
+
+  /* 3 more frames of 1/30 s */
+  fail_unless_equals_uint64 (query_min_latency (deep),
+      query_min_latency (shallow) + gst_util_uint64_scale (3, GST_SECOND,
+          30));
+
+  gst_harness_teardown (deep);
+  gst_harness_teardown (shallow);
+}
+
+GST_END_TEST;
+
+static void
+check_silence (GstBuffer * buf, gsize offset, gsize size)
+{
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = offset; i < offset + size; i++)
+    fail_unless_equals_int (map.data[i], 0);
+  gst_buffer_unmap (buf, &map);
+}
+
+static gconstpointer
+get_memory_data (GstBuffer * buf, guint idx)
+{
+  GstMemory *mem = gst_buffer_peek_memory (buf, idx);
+  GstMapInfo map;
+  gconstpointer data;
+
+  fail_unless (gst_memory_map (mem, &map, GST_MAP_READ));
+  data = map.data;
+  gst_memory_unmap (mem, &map);
+
+  return data;
+}
+
+GST_START_TEST (test_audio_underrun_silence)
+{
+  GstHarness *src, *sink;
+  GstBuffer *buf, *silence1, *silence2;
+  GstMapInfo map;
+  /* 10 ms at 48 kHz, 2 bytes per sample */
+  const gsize period_size = 480 * 2;
+  guint i;
+
+  src = gst_harness_new_with_padnames ("interaudiosrc", NULL, "src");
+  g_object_set (src->element, "channel", "underrun", "period-time",
+      (guint64) 10 * GST_MSECOND, NULL);
+  gst_harness_use_testclock (src);
+  gst_harness_set_sink_caps_str (src, AUDIO_CAPS);
+  gst_element_set_base_time (src->element, 0);
+  gst_element_set_state (src->element, GST_STATE_PAUSED);
+
+  sink = gst_harness_new_parse ("interaudiosink channel=underrun sync=false");
+  gst_harness_set_src_caps_str (sink, AUDIO_CAPS);
+
+  /* one and a half period of data */
+  buf = gst_harness_create_buffer (sink, period_size * 3 / 2);
+  gst_buffer_memset (buf, 0, 0x55, period_size * 3 / 2);
+  GST_BUFFER_PTS (buf) = 0;
+  GST_BUFFER_DURATION (buf) = 15 * GST_MSECOND;
+  fail_unless_equals_int (gst_harness_push (sink, buf), GST_FLOW_OK);
+
+  gst_harness_play (src);
+
+  /* a full period of data */
+  fail_unless (gst_harness_crank_single_clock_wait (src));
+  buf = gst_harness_pull (src);
+  fail_unless_equals_int (gst_buffer_get_size (buf), period_size);
+  fail_if (GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_GAP));
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = 0; i < period_size; i++)
+    fail_unless_equals_int (map.data[i], 0x55);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  /* half a period of silence followed by the rest of the data */
+  fail_unless (gst_harness_crank_single_clock_wait (src));
+  buf = gst_harness_pull (src);
+  fail_unless_equals_int (gst_buffer_get_size (buf), period_size);
+  check_silence (buf, 0, period_size / 2);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  for (i = period_size / 2; i < period_size; i++)
+    fail_unless_equals_int (map.data[i], 0x55);
+  gst_buffer_unmap (buf, &map);
+
+  /* then only silence, flagged as gap */
+  fail_unless (gst_harness_crank_single_clock_wait (src));
+  silence1 = gst_harness_pull (src);
+  fail_unless (gst_harness_crank_single_clock_wait (src));
+  silence2 = gst_harness_pull (src);
+
+  fail_unless_equals_int (gst_buffer_get_size (silence1), period_size);
+  fail_unless_equals_int (gst_buffer_get_size (silence2), period_size);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (silence1, GST_BUFFER_FLAG_GAP));
+  fail_unless (GST_BUFFER_FLAG_IS_SET (silence2, GST_BUFFER_FLAG_GAP));
+  check_silence (silence1, 0, period_size);
+  check_silence (silence2, 0, period_size);
+
+  /* the silence is allocated once and shared into every buffer */
+  fail_unless_equals_int (gst_buffer_n_memory (silence1), 1);
+  fail_unless_equals_int (gst_buffer_n_memory (silence2), 1);
+  fail_unless (get_memory_data (silence1, 0) == get_memory_data (silence2,
+          0));
+  fail_unless (get_memory_data (buf, 0) == get_memory_data (silence1, 0));
+
+  gst_buffer_unref (buf);
+  gst_buffer_unref (silence1);
+  gst_buffer_unref (silence2);
+
+  gst_harness_teardown (sink);
+  gst_harness_teardown (src);
+}
+
+GST_END_TEST;
+
+static Suite *
+inter_suite (void)
+{
+  Suite *s = suite_create ("inter");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_video_queue_frame_selection);
+  tcase_add_test (tc_chain, test_video_queue_caps_change);
+  tcase_add_test (tc_chain, test_video_queue_latency);
+  tcase_add_test (tc_chain, test_audio_underrun_silence);
+
+  return s;
+}
+
+GST_CHECK_MAIN (inter)
@@ -151,7 +151,7 @@ static void
 check_tsmux_pad (GstStaticPadTemplate * srctemplate,
     const gchar * src_caps_string, gint pes_id, gint pmt_id,
     const gchar * sinkname, CheckOutputBuffersFunc check_func, guint n_bufs,
-    gssize input_buf_size, guint alignment)
+    gssize input_buf_size, guint alignment, gint batch_packets)
 {
   GstClockTime ts;
   GstElement *mux;
@@ -166,6 +166,8 @@ check_tsmux_pad (GstStaticPadTemplate * srctemplate,
 
   if (alignment != 0)
     g_object_set (mux, "alignment", alignment, NULL);
+  if (batch_packets != 0)
+    g_object_set (mux, "batch-packets", batch_packets, NULL);
 
   fail_unless (gst_element_set_state (mux,
           GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
@@ -352,7 +354,7 @@ check_tsmux_pad (GstStaticPadTemplate * srctemplate,
 GST_START_TEST (test_video)
 {
   check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
-      "sink_%d", NULL, 1, 1, 0);
+      "sink_%d", NULL, 1, 1, 0, 0);
 }
 
 GST_END_TEST;
@@ -361,7 +363,7 @@ GST_END_TEST;
 GST_START_TEST (test_audio)
 {
   check_tsmux_pad (&audio_src_template, AUDIO_CAPS_STRING, 0xC0, 0x03,
-      "sink_%d", NULL, 1, 1, 0);
+      "sink_%d", NULL, 1, 1, 0, 0);
 }
 
 GST_END_TEST;
@@ -769,7 +771,7 @@ test_align_check_output (GList * bufs)
 GST_START_TEST (test_align)
 {
   check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
-      "sink_%d", test_align_check_output, 817, -1, 7);
+      "sink_%d", test_align_check_output, 817, -1, 7, 0);
 }
 
 GST_END_TEST;
@@ -798,7 +800,46 @@ test_keyframe_propagation_check_output (GList * bufs)
 GST_START_TEST (test_keyframe_flag_propagation)
 {
   check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
-      "sink_%d", test_keyframe_propagation_check_output, 50, -1, 0);
+      "sink_%d", test_keyframe_propagation_check_output, 50, -1, 0, 0);
+}
+
+GST_END_TEST;
+
+static void
+test_batch_check_output (GList * bufs)
+{
+  guint keyframe_count = 0;
+
+  GST_LOG ("%u buffers", g_list_length (bufs));
+  while (bufs != NULL) {
+    GstBuffer *buf = bufs->data;
+    gsize size;
+
+    size = gst_buffer_get_size (buf);
+    GST_LOG ("buffer, size = %5u", (guint) size);
+    fail_unless (size > 0 && size <= 7 * 188);
+    fail_unless (size % 188 == 0);
+
+    if (!GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT))
+      ++keyframe_count;
+    bufs = bufs->next;
+  }
+  /* key units start a new batch */
+  fail_unless_equals_int (keyframe_count, 50 / KEYFRAME_DISTANCE);
+}
+
+GST_START_TEST (test_batch)
+{
+  check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
+      "sink_%d", test_batch_check_output, 50, -1, 0, 7);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_batch_align)
+{
+  check_tsmux_pad (&video_src_template, VIDEO_CAPS_STRING, 0xE0, 0x1b,
+      "sink_%d", test_align_check_output, 817, -1, 7, 5);
 }
 
 GST_END_TEST;
@@ -819,6 +860,8 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_batch);
+  tcase_add_test (tc_chain, test_batch_align);
 
   return s;
 }
@@ -0,0 +1,262 @@
+/* GStreamer
+ *
+ * unit test for the mpegtsdemux packetizer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../gst/mpegtsdemux/mpegtspacketizer.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+#define PAT_PID 0x0000
+#define PMT_PID 0x0100
+#define PCR_PID 0x0101
+#define OTHER_PID 0x0200
+
+/* Payload only packet carrying @index in its first payload byte so it can be
+ * recognized on the other side. No byte but the first one is a sync byte. */
+static void
+fill_packet (guint8 * data, guint16 pid, guint8 index)
+{
+  data[0] = 0x47;
+  data[1] = (pid >> 8) & 0x1f;
+  data[2] = pid & 0xff;
+  data[3] = 0x10 | (index & 0x0f);
+  data[4] = index;
+  memset (data + 5, 0xff, MPEGTS_NORMAL_PACKETSIZE - 5);
+}
+
+static GstBuffer *
+make_packets (const guint16 * pids, guint n_pids)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  guint i;
+
+  buf = gst_buffer_new_allocate (NULL, n_pids * MPEGTS_NORMAL_PACKETSIZE, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < n_pids; i++)
+    fill_packet (map.data + i * MPEGTS_NORMAL_PACKETSIZE, pids[i], i);
+  gst_buffer_unmap (buf, &map);
+
+  GST_BUFFER_OFFSET (buf) = 0;
+
+  return buf;
+}
+
+/* Garbage that contains a couple of stray sync bytes which are not followed
+ * by other sync bytes at any packet size distance */
+static GstBuffer *
+make_garbage (gsize size)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize i;
+
+  buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = (i % 97 == 13) ? 0x47 : 0xa5;
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+/* Pulls all complete packets out of @packetizer, returning the index stored
+ * in each of them */
+static GArray *
+pull_packets (MpegTSPacketizer2 * packetizer, GArray * pids)
+{
+  GArray *indices = g_array_new (FALSE, FALSE, sizeof (guint8));
+  MpegTSPacketizerPacket packet;
+  MpegTSPacketizerPacketReturn ret;
+
+  while ((ret = mpegts_packetizer_next_packet (packetizer,
+              &packet)) != PACKET_NEED_MORE) {
+    fail_unless_equals_int (ret, PACKET_OK);
+    fail_unless (packet.payload != NULL);
+    g_array_append_val (indices, packet.payload[0]);
+    if (pids) {
+      guint16 pid = packet.pid;
+      g_array_append_val (pids, pid);
+    }
+    mpegts_packetizer_clear_packet (packetizer, &packet);
+  }
+
+  return indices;
+}
+
+GST_START_TEST (test_pid_filter)
+{
+  static const guint16 pids[] = {
+    PAT_PID, PMT_PID, OTHER_PID, PCR_PID, OTHER_PID, OTHER_PID, 0x1fff,
+    PCR_PID, OTHER_PID, PAT_PID, OTHER_PID, OTHER_PID
+  };
+  static const guint8 expected[] = { 0, 1, 3, 7, 9 };
+  MpegTSPacketizer2 *packetizer;
+  guint8 *pes_pids, *psi_pids;
+  MpegTSPacketizerPacket packet;
+  GArray *indices, *out_pids;
+  guint i;
+
+  pes_pids = g_new0 (guint8, 1024);
+  psi_pids = g_new0 (guint8, 1024);
+  MPEGTS_BIT_SET (pes_pids, PCR_PID);
+  MPEGTS_BIT_SET (psi_pids, PAT_PID);
+  MPEGTS_BIT_SET (psi_pids, PMT_PID);
+
+  packetizer = mpegts_packetizer_new ();
+  mpegts_packetizer_set_pid_filter (packetizer, pes_pids, psi_pids);
+  mpegts_packetizer_push (packetizer, make_packets (pids, G_N_ELEMENTS (pids)));
+
+  /* Only the PAT, PMT and PCR packets come out */
+  out_pids = g_array_new (FALSE, FALSE, sizeof (guint16));
+  indices = pull_packets (packetizer, out_pids);
+  fail_unless_equals_int (indices->len, G_N_ELEMENTS (expected));
+  for (i = 0; i < indices->len; i++) {
+    fail_unless_equals_int (g_array_index (indices, guint8, i), expected[i]);
+    fail_unless_equals_int (g_array_index (out_pids, guint16, i),
+        pids[expected[i]]);
+  }
+  g_array_unref (indices);
+  g_array_unref (out_pids);
+
+  /* the filtered packets at the end were consumed as well */
+  fail_unless_equals_int (gst_adapter_available (packetizer->adapter), 0);
+  fail_unless_equals_int (packetizer->offset,
+      G_N_ELEMENTS (pids) * MPEGTS_NORMAL_PACKETSIZE);
+
+  /* Offsets are kept right across skipped packets */
+  mpegts_packetizer_push (packetizer, make_packets (pids, 4));
+  fail_unless_equals_int (mpegts_packetizer_next_packet (packetizer, &packet),
+      PACKET_OK);
+  fail_unless_equals_int (packet.pid, PAT_PID);
+  mpegts_packetizer_clear_packet (packetizer, &packet);
+  fail_unless_equals_int (mpegts_packetizer_next_packet (packetizer, &packet),
+      PACKET_OK);
+  fail_unless_equals_int (packet.pid, PMT_PID);
+  mpegts_packetizer_clear_packet (packetizer, &packet);
+  fail_unless_equals_int (mpegts_packetizer_next_packet (packetizer, &packet),
+      PACKET_OK);
+  fail_unless_equals_int (packet.pid, PCR_PID);
+  fail_unless_equals_int (packet.offset,
+      (G_N_ELEMENTS (pids) + 3) * MPEGTS_NORMAL_PACKETSIZE);
+  mpegts_packetizer_clear_packet (packetizer, &packet);
+
+  /* Without a filter every packet is returned again */
+  mpegts_packetizer_set_pid_filter (packetizer, NULL, NULL);
+  mpegts_packetizer_push (packetizer, make_packets (pids, G_N_ELEMENTS (pids)));
+  indices = pull_packets (packetizer, NULL);
+  fail_unless_equals_int (indices->len, G_N_ELEMENTS (pids));
+  for (i = 0; i < indices->len; i++)
+    fail_unless_equals_int (g_array_index (indices, guint8, i), i);
+  g_array_unref (indices);
+
+  g_object_unref (packetizer);
+  g_free (pes_pids);
+  g_free (psi_pids);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sync_after_garbage)
+{
+  static const guint16 pids[] = {
+    PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID
+  };
+  MpegTSPacketizer2 *packetizer;
+  GArray *indices;
+  guint i;
+
+  packetizer = mpegts_packetizer_new ();
+
+  /* Nothing to sync on, all of it but the tail that could still be the
+   * start of a packet gets dropped */
+  mpegts_packetizer_push (packetizer, make_garbage (4000));
+  indices = pull_packets (packetizer, NULL);
+  fail_unless_equals_int (indices->len, 0);
+  g_array_unref (indices);
+  fail_unless (gst_adapter_available (packetizer->adapter) <
+      4 * MPEGTS_MAX_PACKETSIZE);
+  fail_unless_equals_int (packetizer->packet_size, 0);
+
+  /* The packet size is found right behind more garbage */
+  mpegts_packetizer_push (packetizer, make_garbage (123));
+  mpegts_packetizer_push (packetizer, make_packets (pids, G_N_ELEMENTS (pids)));
+  indices = pull_packets (packetizer, NULL);
+  fail_unless_equals_int (packetizer->packet_size, MPEGTS_NORMAL_PACKETSIZE);
+  fail_unless_equals_int (indices->len, G_N_ELEMENTS (pids));
+  for (i = 0; i < indices->len; i++)
+    fail_unless_equals_int (g_array_index (indices, guint8, i), i);
+  g_array_unref (indices);
+
+  g_object_unref (packetizer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sync_after_lost_sync_byte)
+{
+  static const guint16 pids[] = {
+    PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID, PCR_PID,
+    PCR_PID, PCR_PID
+  };
+  static const guint8 expected[] = { 0, 1, 2, 3, 4, 6, 7, 8, 9, 0, 1, 2, 3, 4 };
+  MpegTSPacketizer2 *packetizer;
+  GstBuffer *buf;
+  GArray *indices;
+  guint i;
+
+  packetizer = mpegts_packetizer_new ();
+
+  /* A corrupted sync byte drops the packet it belongs to and sync is
+   * picked up again on the next packet */
+  buf = make_packets (pids, G_N_ELEMENTS (pids));
+  gst_buffer_memset (buf, 5 * MPEGTS_NORMAL_PACKETSIZE, 0x00, 1);
+  mpegts_packetizer_push (packetizer, buf);
+
+  /* Garbage in between packets is skipped as well */
+  mpegts_packetizer_push (packetizer, make_garbage (1000));
+  mpegts_packetizer_push (packetizer, make_packets (pids, 5));
+
+  indices = pull_packets (packetizer, NULL);
+  fail_unless_equals_int (indices->len, G_N_ELEMENTS (expected));
+  for (i = 0; i < indices->len; i++)
+    fail_unless_equals_int (g_array_index (indices, guint8, i), expected[i]);
+  g_array_unref (indices);
+
+  g_object_unref (packetizer);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegtspacketizer_suite (void)
+{
+  Suite *s = suite_create ("mpegtspacketizer");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_pid_filter);
+  tcase_add_test (tc, test_sync_after_garbage);
+  tcase_add_test (tc, test_sync_after_lost_sync_byte);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegtspacketizer);
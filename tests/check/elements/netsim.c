@@ -49,6 +49,130 @@ GST_START_TEST (netsim_stress_delayed)
 
 GST_END_TEST;
 
+GST_START_TEST (netsim_delay_keeps_order)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "min-delay=1 max-delay=20 allow-reordering=false");
+  GstBufferList *list;
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = gst_harness_create_buffer (h, 100);
+    GST_BUFFER_OFFSET (buf) = i;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  list = gst_buffer_list_new ();
+  for (i = 10; i < 20; i++) {
+    GstBuffer *buf = gst_harness_create_buffer (h, 100);
+    GST_BUFFER_OFFSET (buf) = i;
+    gst_buffer_list_add (list, buf);
+  }
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  for (i = 0; i < 20; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), i);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (netsim_delay_reordering)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim delay-probability=1.0 "
+      "allow-reordering=true");
+  /* delay of each buffer, and the order they are due in */
+  static const gint delays[] = { 400, 200, 0, 200, 200, 200 };
+  static const guint64 expected[] = { 2, 1, 3, 4, 5, 0 };
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  for (i = 0; i < G_N_ELEMENTS (delays); i++) {
+    GstBuffer *buf = gst_harness_create_buffer (h, 100);
+
+    g_object_set (h->element, "min-delay", delays[i], "max-delay", delays[i],
+        NULL);
+    GST_BUFFER_OFFSET (buf) = i;
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  /* Shorter delays overtake longer ones, equal delays keep their order */
+  for (i = 0; i < G_N_ELEMENTS (expected); i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    fail_unless (buf != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buf), expected[i]);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+typedef struct
+{
+  guint buffers;
+  guint lists;
+  guint list_buffers;
+} PushCounts;
+
+static GstPadProbeReturn
+count_pushes (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  PushCounts *counts = user_data;
+
+  if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    counts->lists++;
+    counts->list_buffers +=
+        gst_buffer_list_length (GST_PAD_PROBE_INFO_BUFFER_LIST (info));
+  } else {
+    counts->buffers++;
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+GST_START_TEST (netsim_buffer_list)
+{
+  GstHarness *h = gst_harness_new_parse ("netsim drop-packets=2");
+  GstBufferList *list;
+  GstPad *srcpad;
+  PushCounts counts = { 0, };
+  guint i;
+
+  gst_harness_set_src_caps_str (h, "mycaps");
+
+  srcpad = gst_element_get_static_pad (h->element, "src");
+  gst_pad_add_probe (srcpad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      count_pushes, &counts, NULL);
+  gst_object_unref (srcpad);
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 5; i++)
+    gst_buffer_list_add (list, gst_harness_create_buffer (h, 100));
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+
+  /* the first two were dropped, the rest went through undelayed and in a
+   * single list rather than one push per buffer */
+  fail_unless_equals_int (gst_harness_buffers_received (h), 3);
+  fail_unless_equals_int (counts.buffers, 0);
+  fail_unless_equals_int (counts.lists, 1);
+  fail_unless_equals_int (counts.list_buffers, 3);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 netsim_suite (void)
 {
@@ -58,6 +182,9 @@ netsim_suite (void)
   suite_add_tcase (s, (tc_chain = tcase_create ("general")));
   tcase_add_test (tc_chain, netsim_stress);
   tcase_add_test (tc_chain, netsim_stress_delayed);
+  tcase_add_test (tc_chain, netsim_delay_keeps_order);
+  tcase_add_test (tc_chain, netsim_delay_reordering);
+  tcase_add_test (tc_chain, netsim_buffer_list);
 
   return s;
 }
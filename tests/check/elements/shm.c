@@ -229,6 +229,299 @@ GST_START_TEST (test_shm_live)
 
 GST_END_TEST;
 
+GST_START_TEST (test_shm_ring)
+{
+  GstElement *producer, *consumer;
+  GstElement *src, *sink;
+  gchar *socket_path = NULL;
+  GstStateChangeReturn state_res;
+  GstSample *sample = NULL;
+  guint i;
+
+  src = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (src, "sizetype", 2, "sizemax", 1000, NULL);
+
+  /* a small ring, so that the writer has to wait for the reader */
+  sink = gst_element_factory_make ("shmsink", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "ring-slots", 4,
+      "shm-size", 4 * 1024, NULL);
+
+  producer = gst_pipeline_new ("producer-pipeline");
+  gst_bin_add_many (GST_BIN (producer), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  state_res = gst_element_set_state (producer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  g_object_get (sink, "socket-path", &socket_path, NULL);
+  fail_unless (socket_path != NULL);
+
+  src = gst_element_factory_make ("shmsrc", NULL);
+  sink = gst_element_factory_make ("appsink", NULL);
+  g_object_set (sink, "async", FALSE, "enable-last-sample", FALSE,
+      "max-buffers", 2, NULL);
+
+  consumer = gst_pipeline_new ("consumer-pipeline");
+  gst_bin_add_many (GST_BIN (consumer), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+
+  g_object_set (src, "socket-path", socket_path, NULL);
+
+  state_res = gst_element_set_state (consumer, GST_STATE_PLAYING);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 20; i++) {
+    g_signal_emit_by_name (sink, "pull-sample", &sample);
+    fail_unless (sample != NULL);
+    fail_unless_equals_int (gst_buffer_get_size (gst_sample_get_buffer
+            (sample)), 1000);
+    gst_sample_unref (sample);
+  }
+
+  state_res = gst_element_set_state (consumer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  state_res = gst_element_set_state (producer, GST_STATE_NULL);
+  fail_unless (state_res != GST_STATE_CHANGE_FAILURE);
+
+  gst_object_unref (consumer);
+  gst_object_unref (producer);
+
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
+/* Helpers for the ring tests with several readers: a producer fed by an
+ * appsrc, and consumers ending in an appsink. The n-th buffer pushed is
+ * filled with n & 0xff, so that each reader can check what it got */
+
+#define RING_BUFFER_SIZE 1000
+
+static GMutex ring_lock;
+static GCond ring_cond;
+static guint ring_clients;
+
+static void
+ring_client_connected (GstElement * sink, gint fd, gpointer user_data)
+{
+  g_mutex_lock (&ring_lock);
+  ring_clients++;
+  g_cond_broadcast (&ring_cond);
+  g_mutex_unlock (&ring_lock);
+}
+
+static GstElement *
+setup_ring_producer (guint n_slots, GstElement ** appsrc, gchar ** socket_path)
+{
+  GstElement *producer, *sink;
+
+  ring_clients = 0;
+
+  *appsrc = gst_element_factory_make ("appsrc", NULL);
+  sink = gst_element_factory_make ("shmsink", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "ring-slots", n_slots,
+      "shm-size", n_slots * 1024, "sync", FALSE, NULL);
+  g_signal_connect (sink, "client-connected",
+      G_CALLBACK (ring_client_connected), NULL);
+
+  producer = gst_pipeline_new ("producer-pipeline");
+  gst_bin_add_many (GST_BIN (producer), *appsrc, sink, NULL);
+  fail_unless (gst_element_link (*appsrc, sink));
+
+  fail_unless (gst_element_set_state (producer, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_object_get (sink, "socket-path", socket_path, NULL);
+  fail_unless (*socket_path != NULL);
+
+  return producer;
+}
+
+/* Returns the consumer pipeline once the sink accepted it, its appsink
+ * doesn't take more than one buffer ahead of the test */
+static GstElement *
+setup_ring_consumer (const gchar * socket_path, GstElement ** appsink)
+{
+  GstElement *consumer, *src;
+  guint n_clients;
+
+  g_mutex_lock (&ring_lock);
+  n_clients = ring_clients;
+  g_mutex_unlock (&ring_lock);
+
+  src = gst_element_factory_make ("shmsrc", NULL);
+  *appsink = gst_element_factory_make ("appsink", NULL);
+  g_object_set (src, "socket-path", socket_path, NULL);
+  g_object_set (*appsink, "async", FALSE, "enable-last-sample", FALSE,
+      "max-buffers", 1, NULL);
+
+  consumer = gst_pipeline_new (NULL);
+  gst_bin_add_many (GST_BIN (consumer), src, *appsink, NULL);
+  fail_unless (gst_element_link (src, *appsink));
+
+  fail_unless (gst_element_set_state (consumer, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_mutex_lock (&ring_lock);
+  while (ring_clients == n_clients)
+    g_cond_wait (&ring_cond, &ring_lock);
+  g_mutex_unlock (&ring_lock);
+
+  return consumer;
+}
+
+static void
+push_ring_buffers (GstElement * appsrc, guint first, guint n)
+{
+  GstFlowReturn flow;
+  guint i;
+
+  for (i = first; i < first + n; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, RING_BUFFER_SIZE, NULL);
+
+    gst_buffer_memset (buf, 0, i & 0xff, RING_BUFFER_SIZE);
+    g_signal_emit_by_name (appsrc, "push-buffer", buf, &flow);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (flow, GST_FLOW_OK);
+  }
+}
+
+/* Pulls the next buffer from @appsink and checks that it is the @index-th
+ * one pushed */
+static void
+pull_ring_buffer (GstElement * appsink, guint index)
+{
+  GstSample *sample = NULL;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gsize i;
+
+  g_signal_emit_by_name (appsink, "try-pull-sample", 5 * GST_SECOND, &sample);
+  fail_unless (sample != NULL, "No buffer %u", index);
+
+  buf = gst_sample_get_buffer (sample);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, RING_BUFFER_SIZE);
+  for (i = 0; i < map.size; i++)
+    fail_unless_equals_int (map.data[i], index & 0xff);
+  gst_buffer_unmap (buf, &map);
+  gst_sample_unref (sample);
+}
+
+static void
+teardown_ring_pipeline (GstElement * pipeline)
+{
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_NULL) !=
+      GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (pipeline);
+}
+
+static gpointer
+pull_slowly (GstElement * appsink)
+{
+  guint i;
+
+  for (i = 0; i < 40; i++) {
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+    pull_ring_buffer (appsink, i);
+  }
+
+  return NULL;
+}
+
+GST_START_TEST (test_shm_ring_slow_reader)
+{
+  GstElement *producer, *fast, *slow;
+  GstElement *appsrc, *fast_sink, *slow_sink;
+  gchar *socket_path = NULL;
+  GThread *thread;
+  guint i;
+
+  producer = setup_ring_producer (4, &appsrc, &socket_path);
+  fast = setup_ring_consumer (socket_path, &fast_sink);
+  slow = setup_ring_consumer (socket_path, &slow_sink);
+
+  /* many times the size of the ring, which is held back by the slow
+   * reader: no slot may be overwritten before both released it */
+  push_ring_buffers (appsrc, 0, 40);
+
+  thread = g_thread_new ("slow-reader", (GThreadFunc) pull_slowly, slow_sink);
+  for (i = 0; i < 40; i++)
+    pull_ring_buffer (fast_sink, i);
+  g_thread_join (thread);
+
+  teardown_ring_pipeline (slow);
+  teardown_ring_pipeline (fast);
+  teardown_ring_pipeline (producer);
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_ring_join)
+{
+  GstElement *producer, *first, *late;
+  GstElement *appsrc, *first_sink, *late_sink;
+  gchar *socket_path = NULL;
+  guint i;
+
+  producer = setup_ring_producer (4, &appsrc, &socket_path);
+  first = setup_ring_consumer (socket_path, &first_sink);
+
+  push_ring_buffers (appsrc, 0, 10);
+  for (i = 0; i < 10; i++)
+    pull_ring_buffer (first_sink, i);
+
+  /* a reader joining mid-stream starts with the next buffer published */
+  late = setup_ring_consumer (socket_path, &late_sink);
+  push_ring_buffers (appsrc, 10, 10);
+  for (i = 10; i < 20; i++) {
+    pull_ring_buffer (first_sink, i);
+    pull_ring_buffer (late_sink, i);
+  }
+
+  teardown_ring_pipeline (late);
+  teardown_ring_pipeline (first);
+  teardown_ring_pipeline (producer);
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_ring_reader_leaves)
+{
+  GstElement *producer, *active, *stalled;
+  GstElement *appsrc, *active_sink, *stalled_sink;
+  GstSample *sample = NULL;
+  gchar *socket_path = NULL;
+  guint i;
+
+  producer = setup_ring_producer (4, &appsrc, &socket_path);
+  active = setup_ring_consumer (socket_path, &active_sink);
+  stalled = setup_ring_consumer (socket_path, &stalled_sink);
+
+  /* the stalled reader never pulls, so the writer has to wait for free
+   * slots once the ring is full */
+  push_ring_buffers (appsrc, 0, 10);
+  for (i = 0; i < 4; i++)
+    pull_ring_buffer (active_sink, i);
+  g_signal_emit_by_name (active_sink, "try-pull-sample", 200 * GST_MSECOND,
+      &sample);
+  fail_unless (sample == NULL);
+
+  /* its slots are given back when it disconnects, and the writer goes on */
+  teardown_ring_pipeline (stalled);
+  for (i = 4; i < 10; i++)
+    pull_ring_buffer (active_sink, i);
+
+  teardown_ring_pipeline (active);
+  teardown_ring_pipeline (producer);
+  g_free (socket_path);
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -243,6 +536,10 @@ shm_suite (void)
 
   tc = tcase_create ("shm2");
   tcase_add_test (tc, test_shm_live);
+  tcase_add_test (tc, test_shm_ring);
+  tcase_add_test (tc, test_shm_ring_slow_reader);
+  tcase_add_test (tc, test_shm_ring_join);
+  tcase_add_test (tc, test_shm_ring_reader_leaves);
   suite_add_tcase (s, tc);
 
   return s;
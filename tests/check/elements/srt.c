@@ -0,0 +1,384 @@
+/* GStreamer
+ *
+ * unit test for the SRT elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#define STATS_NAME "application/x-srt-statistics"
+
+/* A server that never gets any data to send, and a client that connects
+ * to it */
+static void
+setup_pipelines (guint port, guint stats_interval, GstElement ** server,
+    GstElement ** client)
+{
+  gchar *desc;
+
+  desc = g_strdup_printf ("appsrc is-live=true format=time ! "
+      "srtserversink name=sink uri=srt://:%u stats-interval=%u",
+      port, stats_interval);
+  *server = gst_parse_launch (desc, NULL);
+  fail_unless (*server != NULL);
+  g_free (desc);
+
+  desc = g_strdup_printf ("srtclientsrc name=src uri=srt://127.0.0.1:%u "
+      "stats-interval=%u ! fakesink", port, stats_interval);
+  *client = gst_parse_launch (desc, NULL);
+  fail_unless (*client != NULL);
+  g_free (desc);
+
+  /* the server has to listen before the client connects */
+  fail_unless (gst_element_set_state (*server, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (*client, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+}
+
+static void
+teardown_pipeline (GstElement * pipeline)
+{
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+/* Returns the next statistics message of @pipeline, or NULL if none is
+ * posted within @timeout */
+static GstMessage *
+pop_stats (GstElement * pipeline, GstClockTime timeout)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+
+  while ((msg = gst_bus_timed_pop_filtered (bus, timeout,
+              GST_MESSAGE_ELEMENT | GST_MESSAGE_ERROR))) {
+    fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR,
+        "Unexpected error from %s", GST_MESSAGE_SRC_NAME (msg));
+    if (gst_message_has_name (msg, STATS_NAME))
+      break;
+    gst_message_unref (msg);
+  }
+  gst_object_unref (bus);
+
+  return msg;
+}
+
+static void
+check_stats (GstElement * pipeline, const gchar * name)
+{
+  GstMessage *msg;
+  const GstStructure *s;
+
+  msg = pop_stats (pipeline, 5 * GST_SECOND);
+  fail_unless (msg != NULL, "No statistics posted by %s", name);
+  fail_unless_equals_string (GST_MESSAGE_SRC_NAME (msg), name);
+
+  s = gst_message_get_structure (msg);
+  fail_unless (gst_structure_has_field_typed (s, "sockaddr-str",
+          G_TYPE_STRING));
+  fail_unless (gst_structure_has_field_typed (s, "rtt-ms", G_TYPE_DOUBLE));
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_stats_without_data)
+{
+  GstElement *server, *client;
+
+  /* No buffer is ever sent or received, the statistics are posted
+   * periodically nonetheless */
+  setup_pipelines (17001, 20, &server, &client);
+
+  check_stats (server, "sink");
+  check_stats (server, "sink");
+  check_stats (client, "src");
+  check_stats (client, "src");
+
+  teardown_pipeline (client);
+  teardown_pipeline (server);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stats_interval_change)
+{
+  GstElement *server, *client, *sink;
+  GstMessage *msg;
+
+  setup_pipelines (17002, 0, &server, &client);
+  sink = gst_bin_get_by_name (GST_BIN (server), "sink");
+
+  fail_if (pop_stats (server, 200 * GST_MSECOND) != NULL);
+
+  /* enabled while playing */
+  g_object_set (sink, "stats-interval", 20, NULL);
+  check_stats (server, "sink");
+
+  /* and disabled again, after the messages already posted */
+  g_object_set (sink, "stats-interval", 0, NULL);
+  while ((msg = pop_stats (server, 0)))
+    gst_message_unref (msg);
+  fail_if (pop_stats (server, 200 * GST_MSECOND) != NULL);
+
+  gst_object_unref (sink);
+  teardown_pipeline (client);
+  teardown_pipeline (server);
+}
+
+GST_END_TEST;
+
+/* 1316 bytes is 7 MPEG-TS packets, one SRT payload */
+#define PACKET_SIZE 1316
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gsize clients_added;
+  gsize clients_removed;
+  gsize received;
+  gboolean corrupted;
+} TransferData;
+
+static void
+client_added_cb (GstElement * sink, gint sock, GSocketAddress * addr,
+    TransferData * data)
+{
+  g_mutex_lock (&data->lock);
+  data->clients_added++;
+  g_cond_broadcast (&data->cond);
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+client_removed_cb (GstElement * sink, gint sock, GSocketAddress * addr,
+    TransferData * data)
+{
+  g_mutex_lock (&data->lock);
+  data->clients_removed++;
+  g_cond_broadcast (&data->cond);
+  g_mutex_unlock (&data->lock);
+}
+
+/* Every byte of the n-th packet pushed is n & 0xff, the received data has
+ * to follow that whatever the buffer boundaries on the client side */
+static void
+handoff_cb (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    TransferData * data)
+{
+  GstMapInfo map;
+  gsize i;
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  g_mutex_lock (&data->lock);
+  for (i = 0; i < map.size; i++) {
+    if (map.data[i] != ((data->received + i) / PACKET_SIZE & 0xff))
+      data->corrupted = TRUE;
+  }
+  data->received += map.size;
+  g_cond_broadcast (&data->cond);
+  g_mutex_unlock (&data->lock);
+  gst_buffer_unmap (buf, &map);
+}
+
+/* Waits until @count, one of the counters of @data, reaches @value.
+ * Returns %FALSE if it didn't within @timeout */
+static gboolean
+wait_for_count (TransferData * data, gsize * count, gsize value,
+    GstClockTime timeout)
+{
+  gint64 end_time = g_get_monotonic_time () + timeout / GST_USECOND;
+  gboolean ret = TRUE;
+
+  g_mutex_lock (&data->lock);
+  while (*count < value && ret)
+    ret = g_cond_wait_until (&data->cond, &data->lock, end_time);
+  ret = *count >= value;
+  g_mutex_unlock (&data->lock);
+
+  return ret;
+}
+
+static void
+setup_transfer (guint port, TransferData * data, GstElement ** server,
+    GstElement ** client, GstElement ** appsrc)
+{
+  GstElement *sink, *fakesink;
+  gchar *desc;
+
+  memset (data, 0, sizeof (TransferData));
+  g_mutex_init (&data->lock);
+  g_cond_init (&data->cond);
+
+  desc = g_strdup_printf ("appsrc name=src ! srtserversink name=sink "
+      "uri=srt://:%u", port);
+  *server = gst_parse_launch (desc, NULL);
+  fail_unless (*server != NULL);
+  g_free (desc);
+
+  desc = g_strdup_printf ("srtclientsrc uri=srt://127.0.0.1:%u ! "
+      "fakesink name=sink signal-handoffs=true", port);
+  *client = gst_parse_launch (desc, NULL);
+  fail_unless (*client != NULL);
+  g_free (desc);
+
+  *appsrc = gst_bin_get_by_name (GST_BIN (*server), "src");
+  sink = gst_bin_get_by_name (GST_BIN (*server), "sink");
+  g_signal_connect (sink, "client-added", G_CALLBACK (client_added_cb), data);
+  g_signal_connect (sink, "client-removed", G_CALLBACK (client_removed_cb),
+      data);
+  gst_object_unref (sink);
+
+  fakesink = gst_bin_get_by_name (GST_BIN (*client), "sink");
+  g_signal_connect (fakesink, "handoff", G_CALLBACK (handoff_cb), data);
+  gst_object_unref (fakesink);
+
+  fail_unless (gst_element_set_state (*server, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_set_state (*client, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  /* nothing pushed before the client is there would be sent to it */
+  fail_unless (wait_for_count (data, &data->clients_added, 1,
+          5 * GST_SECOND));
+}
+
+static void
+clear_transfer (TransferData * data)
+{
+  g_mutex_clear (&data->lock);
+  g_cond_clear (&data->cond);
+}
+
+static void
+push_packets (GstElement * appsrc, guint first, guint n)
+{
+  GstFlowReturn flow;
+  guint i;
+
+  for (i = first; i < first + n; i++) {
+    GstBuffer *buf = gst_buffer_new_allocate (NULL, PACKET_SIZE, NULL);
+
+    gst_buffer_memset (buf, 0, i & 0xff, PACKET_SIZE);
+    g_signal_emit_by_name (appsrc, "push-buffer", buf, &flow);
+    gst_buffer_unref (buf);
+    fail_unless_equals_int (flow, GST_FLOW_OK);
+  }
+}
+
+static gboolean
+wait_for_eos (GstElement * pipeline, GstClockTime timeout)
+{
+  GstBus *bus = gst_element_get_bus (pipeline);
+  GstMessage *msg;
+  gboolean ret;
+
+  msg = gst_bus_timed_pop_filtered (bus, timeout,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  gst_object_unref (bus);
+  if (msg == NULL)
+    return FALSE;
+
+  fail_if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR,
+      "Unexpected error from %s", GST_MESSAGE_SRC_NAME (msg));
+  ret = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  gst_message_unref (msg);
+
+  return ret;
+}
+
+GST_START_TEST (test_eos_delivers_queued)
+{
+  GstElement *server, *client, *appsrc;
+  GstFlowReturn flow;
+  TransferData data;
+  /* a lot more than what the send buffer of a socket takes at once, so
+   * that some of it is queued in the sink at EOS */
+  const guint n_packets = 4000;
+
+  setup_transfer (17003, &data, &server, &client, &appsrc);
+
+  push_packets (appsrc, 0, n_packets);
+  g_signal_emit_by_name (appsrc, "end-of-stream", &flow);
+  fail_unless_equals_int (flow, GST_FLOW_OK);
+
+  /* EOS waits for the queue to be handed to the socket, and the socket
+   * still delivers what it was given */
+  fail_unless (wait_for_eos (server, 20 * GST_SECOND));
+  fail_unless (wait_for_count (&data, &data.received,
+          n_packets * PACKET_SIZE, 5 * GST_SECOND), "Only received %" G_GSIZE_FORMAT " bytes",
+      data.received);
+  fail_if (data.corrupted);
+
+  gst_object_unref (appsrc);
+  teardown_pipeline (client);
+  teardown_pipeline (server);
+  clear_transfer (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_eos_after_client_left)
+{
+  GstElement *server, *client, *appsrc;
+  GstFlowReturn flow;
+  TransferData data;
+  guint n_pushed = 0;
+
+  setup_transfer (17004, &data, &server, &client, &appsrc);
+
+  push_packets (appsrc, n_pushed, 10);
+  n_pushed += 10;
+  teardown_pipeline (client);
+
+  /* the client is only noticed to be gone when sending to it fails */
+  while (!wait_for_count (&data, &data.clients_removed, 1,
+          10 * GST_MSECOND)) {
+    fail_unless (n_pushed < 100000, "Client never removed");
+    push_packets (appsrc, n_pushed, 100);
+    n_pushed += 100;
+  }
+
+  /* nothing left to wait for */
+  g_signal_emit_by_name (appsrc, "end-of-stream", &flow);
+  fail_unless_equals_int (flow, GST_FLOW_OK);
+  fail_unless (wait_for_eos (server, 5 * GST_SECOND));
+
+  gst_object_unref (appsrc);
+  teardown_pipeline (server);
+  clear_transfer (&data);
+}
+
+GST_END_TEST;
+
+static Suite *
+srt_suite (void)
+{
+  Suite *s = suite_create ("srt");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_stats_without_data);
+  tcase_add_test (tc_chain, test_stats_interval_change);
+  tcase_add_test (tc_chain, test_eos_delivers_queued);
+  tcase_add_test (tc_chain, test_eos_after_client_left);
+
+  return s;
+}
+
+GST_CHECK_MAIN (srt)
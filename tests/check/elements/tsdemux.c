@@ -0,0 +1,535 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/app/gstappsrc.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#define N_STREAMS 2
+#define N_BUFFERS 200
+#define BUFFER_SIZE 256
+#define BUFFER_DURATION (20 * GST_MSECOND)
+
+/* Muxes N_STREAMS streams of N_BUFFERS buffers each into a temporary
+ * file. Every buffer starts with its big endian index within the stream,
+ * followed by the stream number */
+static gchar *
+create_ts_file (void)
+{
+  GstElement *pipeline;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *location, *desc;
+  gint fd, i, j;
+
+  fd = g_file_open_tmp ("tsdemux-test-XXXXXX.ts", &location, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  g_close (fd, NULL);
+
+  desc = g_strdup_printf ("mpegtsmux name=mux ! filesink location=\"%s\" "
+      "appsrc name=src0 format=time ! mux.  "
+      "appsrc name=src1 format=time ! mux.", location);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  caps = gst_caps_from_string ("audio/mpeg, mpegversion=(int)1, "
+      "parsed=(boolean)true");
+  for (j = 0; j < N_STREAMS; j++) {
+    gchar *name = g_strdup_printf ("src%d", j);
+    GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), name);
+
+    gst_app_src_set_caps (GST_APP_SRC (src), caps);
+    gst_object_unref (src);
+    g_free (name);
+  }
+  gst_caps_unref (caps);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  for (j = 0; j < N_STREAMS; j++) {
+    gchar *name = g_strdup_printf ("src%d", j);
+    GstElement *src = gst_bin_get_by_name (GST_BIN (pipeline), name);
+
+    for (i = 0; i < N_BUFFERS; i++) {
+      GstBuffer *buf = gst_buffer_new_and_alloc (BUFFER_SIZE);
+      GstMapInfo map;
+
+      gst_buffer_map (buf, &map, GST_MAP_WRITE);
+      memset (map.data, j, map.size);
+      GST_WRITE_UINT32_BE (map.data, i);
+      gst_buffer_unmap (buf, &map);
+
+      GST_BUFFER_PTS (buf) = i * BUFFER_DURATION;
+      GST_BUFFER_DURATION (buf) = BUFFER_DURATION;
+      fail_unless_equals_int (gst_app_src_push_buffer (GST_APP_SRC (src),
+              buf), GST_FLOW_OK);
+    }
+    gst_app_src_end_of_stream (GST_APP_SRC (src));
+    gst_object_unref (src);
+    g_free (name);
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL && GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return location;
+}
+
+typedef struct
+{
+  gint stream;
+  gint next;
+  guint n_buffers;
+  gboolean in_order;
+  gboolean flushed;
+  gboolean eos;
+} OutputState;
+
+static GMutex output_lock;
+static GList *outputs;
+
+static GstPadProbeReturn
+output_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  OutputState *state = user_data;
+
+  g_mutex_lock (&output_lock);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+    guint8 data[5];
+    gint counter;
+
+    if (gst_buffer_extract (buf, 0, data, 5) != 5) {
+      state->in_order = FALSE;
+    } else {
+      counter = GST_READ_UINT32_BE (data);
+      if (state->stream == -1)
+        state->stream = data[4];
+      if (data[4] != state->stream)
+        state->in_order = FALSE;
+      if (state->next >= 0 && counter != state->next)
+        state->in_order = FALSE;
+      state->next = counter + 1;
+    }
+    state->n_buffers++;
+  } else if (info->type & (GST_PAD_PROBE_TYPE_EVENT_BOTH |
+          GST_PAD_PROBE_TYPE_EVENT_FLUSH)) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      /* Ordering is checked again from the first buffer after the flush */
+      state->flushed = TRUE;
+      state->next = -1;
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+      state->eos = TRUE;
+    }
+  }
+  g_mutex_unlock (&output_lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+  OutputState *state;
+
+  state = g_new0 (OutputState, 1);
+  state->stream = -1;
+  state->next = -1;
+  state->in_order = TRUE;
+
+  g_mutex_lock (&output_lock);
+  outputs = g_list_append (outputs, state);
+  g_mutex_unlock (&output_lock);
+
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+      output_probe, state, NULL);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+static GstElement *
+create_demux_pipeline (const gchar * location, const gchar * demux_props)
+{
+  GstElement *pipeline, *demux;
+  gchar *desc;
+
+  desc = g_strdup_printf ("filesrc location=\"%s\" ! tsdemux name=demux %s",
+      location, demux_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  demux = gst_bin_get_by_name (GST_BIN (pipeline), "demux");
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), pipeline);
+  gst_object_unref (demux);
+
+  return pipeline;
+}
+
+static void
+run_until_eos (GstElement * pipeline)
+{
+  GstBus *bus;
+  GstMessage *msg;
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL, "Timeout waiting for EOS");
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS,
+      "Got error instead of EOS");
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+}
+
+static void
+check_outputs (gboolean expect_flush)
+{
+  GList *l;
+  gint seen_streams = 0;
+
+  g_mutex_lock (&output_lock);
+  fail_unless_equals_int (g_list_length (outputs), N_STREAMS);
+  for (l = outputs; l; l = l->next) {
+    OutputState *state = l->data;
+
+    fail_unless (state->stream >= 0 && state->stream < N_STREAMS);
+    seen_streams |= 1 << state->stream;
+    fail_unless (state->in_order, "Buffers of stream %d out of order",
+        state->stream);
+    fail_unless (state->eos);
+    fail_unless_equals_int (state->flushed, expect_flush);
+    /* The last buffer of the stream was output */
+    fail_unless_equals_int (state->next, N_BUFFERS);
+    if (!expect_flush)
+      fail_unless_equals_int (state->n_buffers, N_BUFFERS);
+  }
+  fail_unless_equals_int (seen_streams, (1 << N_STREAMS) - 1);
+  g_mutex_unlock (&output_lock);
+}
+
+static void
+clear_outputs (void)
+{
+  g_mutex_lock (&output_lock);
+  g_list_free_full (outputs, g_free);
+  outputs = NULL;
+  g_mutex_unlock (&output_lock);
+}
+
+GST_START_TEST (test_streams_order)
+{
+  GstElement *pipeline;
+  gchar *location;
+
+  location = create_ts_file ();
+  pipeline = create_demux_pipeline (location, "");
+
+  run_until_eos (pipeline);
+  check_outputs (FALSE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  clear_outputs ();
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_flushing_seek)
+{
+  GstElement *pipeline;
+  gchar *location;
+
+  location = create_ts_file ();
+  pipeline = create_demux_pipeline (location, "");
+
+  /* The streaming thread blocks in the prerolled sinks, the flushing seek
+   * has to get it out of there and restart from the beginning */
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PAUSED) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          10 * GST_SECOND), GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, 0));
+
+  run_until_eos (pipeline);
+  check_outputs (TRUE);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  clear_outputs ();
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+#define INDEX_HEADER_SIZE 32
+#define INDEX_ENTRY_SIZE 20
+
+static gchar *
+create_index_location (void)
+{
+  GError *err = NULL;
+  gchar *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("tsdemux-test-XXXXXX.tsix", &location, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  g_close (fd, NULL);
+  /* tsdemux creates it */
+  g_unlink (location);
+
+  return location;
+}
+
+static void
+run_with_index (const gchar * location, const gchar * index_location)
+{
+  GstElement *pipeline;
+  gchar *props;
+
+  props = g_strdup_printf ("index-location=\"%s\"", index_location);
+  pipeline = create_demux_pipeline (location, props);
+  g_free (props);
+
+  run_until_eos (pipeline);
+  check_outputs (FALSE);
+
+  /* the index is written when stopping */
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  clear_outputs ();
+}
+
+static gchar *
+read_index (const gchar * index_location, gsize * length)
+{
+  gchar *contents;
+
+  fail_unless (g_file_get_contents (index_location, &contents, length, NULL),
+      "No index written to %s", index_location);
+  return contents;
+}
+
+static void
+write_index (const gchar * index_location, const gchar * contents,
+    gsize length)
+{
+  fail_unless (g_file_set_contents (index_location, contents, length, NULL));
+}
+
+/* Builds the index of a new file and checks its contents */
+static gchar *
+build_index (gchar ** location, gchar ** index_location, gsize * length)
+{
+  GStatBuf st;
+  gchar *contents;
+  guint32 n_entries, i;
+  guint64 prev_ts = 0;
+
+  *location = create_ts_file ();
+  *index_location = create_index_location ();
+  fail_unless (g_stat (*location, &st) == 0);
+
+  run_with_index (*location, *index_location);
+  contents = read_index (*index_location, length);
+
+  fail_unless (*length >= INDEX_HEADER_SIZE);
+  fail_unless_equals_int (GST_READ_UINT32_LE (contents),
+      GST_MAKE_FOURCC ('T', 'S', 'I', 'X'));
+  fail_unless_equals_int (GST_READ_UINT32_LE (contents + 4), 3);
+  fail_unless_equals_uint64 (GST_READ_UINT64_LE (contents + 12),
+      (guint64) st.st_size);
+  n_entries = GST_READ_UINT32_LE (contents + 28);
+  fail_unless (n_entries > 0);
+  fail_unless_equals_int (*length,
+      INDEX_HEADER_SIZE + n_entries * INDEX_ENTRY_SIZE);
+
+  for (i = 0; i < n_entries; i++) {
+    const gchar *entry = contents + INDEX_HEADER_SIZE + i * INDEX_ENTRY_SIZE;
+    guint64 ts = GST_READ_UINT64_LE (entry);
+    guint64 offset = GST_READ_UINT64_LE (entry + 8);
+
+    fail_unless (ts >= prev_ts);
+    fail_unless (offset < (guint64) st.st_size);
+    prev_ts = ts;
+  }
+
+  return contents;
+}
+
+GST_START_TEST (test_index_save_load)
+{
+  gchar *location, *index_location, *contents, *reloaded, *marked;
+  gsize length, reloaded_length;
+
+  contents = build_index (&location, &index_location, &length);
+
+  /* Append some garbage after the entries: if the index is loaded, playing
+   * the same file again adds nothing to it and the file is not rewritten */
+  marked = g_malloc (length + 4);
+  memcpy (marked, contents, length);
+  memcpy (marked + length, "KEEP", 4);
+  write_index (index_location, marked, length + 4);
+
+  run_with_index (location, index_location);
+  reloaded = read_index (index_location, &reloaded_length);
+  fail_unless_equals_int (reloaded_length, length + 4);
+  fail_unless (memcmp (reloaded, marked, length + 4) == 0);
+
+  g_free (reloaded);
+  g_free (marked);
+  g_free (contents);
+  g_unlink (index_location);
+  g_free (index_location);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_index_reject_stale)
+{
+  gchar *location, *index_location, *contents, *stale, *rewritten;
+  gsize length, rewritten_length;
+  guint i;
+
+  contents = build_index (&location, &index_location, &length);
+
+  /* An index for a file of another size, then one for a file of the same
+   * size but other content, as when it was rewritten in place. Both must be
+   * ignored, and replaced by the index of the actual file */
+  for (i = 0; i < 2; i++) {
+    stale = g_memdup (contents, length);
+    if (i == 0)
+      GST_WRITE_UINT64_LE (stale + 12, GST_READ_UINT64_LE (stale + 12) + 188);
+    else
+      GST_WRITE_UINT64_LE (stale + 20, ~GST_READ_UINT64_LE (stale + 20));
+    /* and some garbage so that a kept file can be told apart */
+    GST_WRITE_UINT64_LE (stale + INDEX_HEADER_SIZE + 8, 0);
+    write_index (index_location, stale, length);
+
+    run_with_index (location, index_location);
+    rewritten = read_index (index_location, &rewritten_length);
+    fail_unless_equals_int (rewritten_length, length);
+    fail_unless (memcmp (rewritten, contents, length) == 0,
+        "Stale index %u was not replaced", i);
+
+    g_free (rewritten);
+    g_free (stale);
+  }
+
+  g_free (contents);
+  g_unlink (index_location);
+  g_free (index_location);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_index_reject_rewritten)
+{
+  gchar *location, *index_location, *contents, *data, *rewritten;
+  gsize length, data_length, rewritten_length;
+
+  contents = build_index (&location, &index_location, &length);
+
+  /* Rewrite the file in place, with the same size and a change in the
+   * stuffing of the PAT packet at its start. The demuxed output is the same,
+   * but the index written for the old content must not be trusted */
+  fail_unless (g_file_get_contents (location, &data, &data_length, NULL));
+  fail_unless (data_length > 188);
+  fail_unless_equals_int (data[0], 0x47);
+  fail_unless_equals_int ((guint8) data[187], 0xff);
+  data[187] = 0xfe;
+  fail_unless (g_file_set_contents (location, data, data_length, NULL));
+
+  run_with_index (location, index_location);
+  rewritten = read_index (index_location, &rewritten_length);
+  fail_unless_equals_int (rewritten_length, length);
+  /* Same size and entries, other fingerprint */
+  fail_unless (memcmp (rewritten, contents, 20) == 0);
+  fail_unless (GST_READ_UINT64_LE (rewritten + 20) !=
+      GST_READ_UINT64_LE (contents + 20));
+  fail_unless (memcmp (rewritten + 28, contents + 28, length - 28) == 0);
+
+  g_free (rewritten);
+  g_free (data);
+  g_free (contents);
+  g_unlink (index_location);
+  g_free (index_location);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_streams_order);
+  tcase_add_test (tc_chain, test_flushing_seek);
+  tcase_add_test (tc_chain, test_index_save_load);
+  tcase_add_test (tc_chain, test_index_reject_stale);
+  tcase_add_test (tc_chain, test_index_reject_rewritten);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux)
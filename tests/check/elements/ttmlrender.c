@@ -0,0 +1,169 @@
+/* GStreamer
+ *
+ * unit test for ttmlrender
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "../../ext/ttml/subtitle.c"
+#include "../../ext/ttml/subtitlemeta.c"
+#include "../../ext/ttml/gstttmlrender.c"
+#undef GST_CAT_DEFAULT
+
+#include <gst/check/gstcheck.h>
+
+GST_DEBUG_CATEGORY (ttmlrender_debug);
+
+static void
+append_text (GstBuffer * buf, const gchar * text)
+{
+  gchar *data = g_strdup (text);
+  gsize len = strlen (data);
+
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (0, data, len, 0, len, data, g_free));
+}
+
+/* A region with an opaque background showing the text in memory @text_index
+ * of the text buffer */
+static GstSubtitleRegion *
+make_region (gdouble origin_y, guint text_index)
+{
+  GstSubtitleColor black = { 0, 0, 0, 255 };
+  GstSubtitleStyleSet *style_set;
+  GstSubtitleRegion *region;
+  GstSubtitleBlock *block;
+
+  style_set = gst_subtitle_style_set_new ();
+  style_set->origin_x = 0.1;
+  style_set->origin_y = origin_y;
+  style_set->extent_w = 0.8;
+  style_set->extent_h = 0.2;
+  style_set->background_color = black;
+  region = gst_subtitle_region_new (style_set);
+
+  block = gst_subtitle_block_new (gst_subtitle_style_set_new ());
+  gst_subtitle_block_add_element (block,
+      gst_subtitle_element_new (gst_subtitle_style_set_new (), text_index,
+          FALSE));
+  gst_subtitle_region_add_block (region, block);
+
+  return region;
+}
+
+/* A scene of two regions, the first one always showing the same text and the
+ * second one showing @text */
+static GstBuffer *
+make_scene (const gchar * text)
+{
+  GstBuffer *buf = gst_buffer_new ();
+  GPtrArray *regions;
+
+  append_text (buf, "Unchanged line");
+  append_text (buf, text);
+
+  regions = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_subtitle_region_unref);
+  g_ptr_array_add (regions, make_region (0.1, 0));
+  g_ptr_array_add (regions, make_region (0.7, 1));
+  gst_buffer_add_subtitle_meta (buf, regions);
+
+  return buf;
+}
+
+static void
+set_frame_size (GstTtmlRender * render, gint width, gint height)
+{
+  GstCaps *caps;
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "BGRA",
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 25, 1, NULL);
+  gst_ttml_render_setcaps (render, caps);
+  gst_caps_unref (caps);
+}
+
+static GstVideoOverlayComposition *
+get_composition (GstTtmlRender * render, guint index)
+{
+  fail_unless_equals_int (g_list_length (render->compositions), 2);
+  return g_list_nth_data (render->compositions, index);
+}
+
+GST_START_TEST (test_region_cache)
+{
+  GstTtmlRender *render;
+  GstBuffer *scene1, *scene2;
+  GstVideoOverlayComposition *unchanged, *changed;
+
+  render = gst_object_ref_sink (g_object_new (GST_TYPE_TTML_RENDER, NULL));
+  set_frame_size (render, 320, 240);
+
+  scene1 = make_scene ("First line");
+  scene2 = make_scene ("Second line");
+
+  gst_ttml_render_render_scene (render, scene1);
+  unchanged = gst_video_overlay_composition_ref (get_composition (render, 0));
+  changed = gst_video_overlay_composition_ref (get_composition (render, 1));
+
+  /* The region that looks the same in the next scene is reused as is, the
+   * other one is rendered again */
+  gst_ttml_render_render_scene (render, scene2);
+  fail_unless (get_composition (render, 0) == unchanged);
+  fail_unless (gst_video_overlay_composition_get_rectangle (get_composition
+          (render, 0), 0) == gst_video_overlay_composition_get_rectangle
+      (unchanged, 0));
+  fail_unless (get_composition (render, 1) != changed);
+  gst_video_overlay_composition_unref (changed);
+
+  /* Rendering the same scene again reuses everything */
+  changed = gst_video_overlay_composition_ref (get_composition (render, 1));
+  gst_ttml_render_render_scene (render, scene2);
+  fail_unless (get_composition (render, 0) == unchanged);
+  fail_unless (get_composition (render, 1) == changed);
+  gst_video_overlay_composition_unref (changed);
+
+  /* The regions were rendered for the previous frame size, new caps must
+   * drop them */
+  set_frame_size (render, 640, 480);
+  fail_unless (render->region_cache == NULL);
+  gst_ttml_render_render_scene (render, scene2);
+  fail_unless (get_composition (render, 0) != unchanged);
+  gst_video_overlay_composition_unref (unchanged);
+
+  gst_buffer_unref (scene1);
+  gst_buffer_unref (scene2);
+  gst_object_unref (render);
+}
+
+GST_END_TEST;
+
+static Suite *
+ttmlrender_suite (void)
+{
+  Suite *s = suite_create ("ttmlrender");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (ttmlrender_debug, "ttmlrender", 0,
+      "TTML renderer");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_region_cache);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ttmlrender);
@@ -0,0 +1,231 @@
+/* GStreamer
+ *
+ * unit test for the adaptive demux bitrate adaptation helpers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/adaptivedemux/gstadaptivedemuxabr.h>
+
+/* the estimate is computed with doubles, allow for rounding */
+#define assert_estimate(throughput, expected) G_STMT_START { \
+  guint64 _estimate = gst_adaptive_demux_throughput_get_estimate (throughput); \
+  fail_unless (_estimate + 1 >= (expected) && _estimate <= (expected) + 1, \
+      "Estimate is %" G_GUINT64_FORMAT ", expected %" G_GUINT64_FORMAT, \
+      _estimate, (guint64) (expected)); \
+} G_STMT_END
+
+static void
+add_samples (GstAdaptiveDemuxThroughput * throughput, guint n, guint64 bytes,
+    GstClockTime duration)
+{
+  guint i;
+
+  for (i = 0; i < n; i++)
+    gst_adaptive_demux_throughput_add_sample (throughput, bytes, duration);
+}
+
+GST_START_TEST (test_throughput_constant)
+{
+  GstAdaptiveDemuxThroughput throughput;
+
+  gst_adaptive_demux_throughput_init (&throughput);
+  fail_unless_equals_uint64 (gst_adaptive_demux_throughput_get_estimate
+      (&throughput), 0);
+
+  /* 64 kB are not enough to trust the estimate */
+  gst_adaptive_demux_throughput_add_sample (&throughput, 64 * 1024,
+      GST_SECOND / 16);
+  fail_unless_equals_uint64 (gst_adaptive_demux_throughput_get_estimate
+      (&throughput), 0);
+
+  /* the averages are corrected for starting at 0, so a constant rate is
+   * estimated exactly whatever the number of samples */
+  gst_adaptive_demux_throughput_add_sample (&throughput, 64 * 1024,
+      GST_SECOND / 16);
+  assert_estimate (&throughput, 8 * 1024 * 1024);
+  add_samples (&throughput, 10, 1024 * 1024, GST_SECOND);
+  assert_estimate (&throughput, 8 * 1024 * 1024);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_throughput_invalid_samples)
+{
+  GstAdaptiveDemuxThroughput throughput;
+
+  gst_adaptive_demux_throughput_init (&throughput);
+  add_samples (&throughput, 4, 1000000, GST_SECOND);
+  assert_estimate (&throughput, 8000000);
+
+  /* none of those is a measurement */
+  gst_adaptive_demux_throughput_add_sample (&throughput, 0, GST_SECOND);
+  gst_adaptive_demux_throughput_add_sample (&throughput, 1000000, 0);
+  gst_adaptive_demux_throughput_add_sample (&throughput, 1000000,
+      GST_CLOCK_TIME_NONE);
+  assert_estimate (&throughput, 8000000);
+  fail_unless_equals_uint64 (throughput.total_bytes, 4000000);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_throughput_drop)
+{
+  GstAdaptiveDemuxThroughput throughput;
+
+  /* 10 s at 8 Mbps then 1 s at 1 Mbps: the fast average (2 s half-life)
+   * reacts more and is used */
+  gst_adaptive_demux_throughput_init (&throughput);
+  add_samples (&throughput, 10, 1000000, GST_SECOND);
+  gst_adaptive_demux_throughput_add_sample (&throughput, 125000, GST_SECOND);
+  assert_estimate (&throughput, 5903419);
+  fail_unless (gst_adaptive_demux_throughput_get_estimate (&throughput) <
+      8000000);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_throughput_rise)
+{
+  GstAdaptiveDemuxThroughput throughput;
+
+  /* 10 s at 1 Mbps then 1 s at 8 Mbps: the slow average (5 s half-life)
+   * follows less and is used */
+  gst_adaptive_demux_throughput_init (&throughput);
+  add_samples (&throughput, 10, 125000, GST_SECOND);
+  gst_adaptive_demux_throughput_add_sample (&throughput, 1000000, GST_SECOND);
+  assert_estimate (&throughput, 2158217);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_throughput_weighting)
+{
+  GstAdaptiveDemuxThroughput a, b;
+
+  /* samples are weighted by their duration, one sample of 2 s counts as
+   * two samples of 1 s at the same rate */
+  gst_adaptive_demux_throughput_init (&a);
+  gst_adaptive_demux_throughput_init (&b);
+  add_samples (&a, 5, 250000, GST_SECOND);
+  add_samples (&b, 5, 250000, GST_SECOND);
+
+  gst_adaptive_demux_throughput_add_sample (&a, 1000000, 2 * GST_SECOND);
+  add_samples (&b, 2, 500000, GST_SECOND);
+
+  assert_estimate (&a, gst_adaptive_demux_throughput_get_estimate (&b));
+  assert_estimate (&a, 2779755);
+}
+
+GST_END_TEST;
+
+static void
+check_bola_choices (const guint64 * bitrates, guint n_bitrates,
+    const gdouble * levels, const guint * expected, guint n_levels)
+{
+  guint i;
+
+  for (i = 0; i < n_levels; i++) {
+    guint choice = gst_adaptive_demux_abr_bola_select (bitrates, n_bitrates,
+        levels[i] * GST_SECOND);
+
+    fail_unless_equals_int (choice, expected[i]);
+  }
+}
+
+GST_START_TEST (test_bola_ladder_4)
+{
+  /* buffer target is 10 s + 4 * 2 s, the highest bitrate is reached well
+   * before it */
+  static const guint64 bitrates[] = { 1000000, 2000000, 4000000, 8000000 };
+  static const gdouble levels[] =
+      { 0, 5, 10, 11, 11.5, 13, 14.5, 16, 17, 18, 30 };
+  static const guint expected[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 3 };
+
+  check_bola_choices (bitrates, G_N_ELEMENTS (bitrates), levels, expected,
+      G_N_ELEMENTS (levels));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bola_ladder_5)
+{
+  static const guint64 bitrates[] =
+      { 250000, 500000, 1000000, 2500000, 5000000 };
+  static const gdouble levels[] =
+      { 0, 10.5, 11.5, 13, 14, 15.5, 16.5, 18, 19.5, 60 };
+  static const guint expected[] = { 0, 0, 1, 1, 2, 2, 3, 3, 4, 4 };
+
+  check_bola_choices (bitrates, G_N_ELEMENTS (bitrates), levels, expected,
+      G_N_ELEMENTS (levels));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bola_monotonic)
+{
+  static const guint64 bitrates[] =
+      { 250000, 500000, 1000000, 2500000, 5000000 };
+  GstClockTime level;
+  guint choice, previous = 0;
+
+  /* more buffered data never picks a lower bitrate */
+  for (level = 0; level <= 40 * GST_SECOND; level += 100 * GST_MSECOND) {
+    choice = gst_adaptive_demux_abr_bola_select (bitrates,
+        G_N_ELEMENTS (bitrates), level);
+    fail_unless (choice >= previous);
+    previous = choice;
+  }
+  fail_unless_equals_int (previous, G_N_ELEMENTS (bitrates) - 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bola_degenerate_ladder)
+{
+  static const guint64 single[] = { 1000000 };
+  static const guint64 flat[] = { 1000000, 1000000, 1000000 };
+
+  fail_unless_equals_int (gst_adaptive_demux_abr_bola_select (single, 1,
+          30 * GST_SECOND), 0);
+  fail_unless_equals_int (gst_adaptive_demux_abr_bola_select (flat,
+          G_N_ELEMENTS (flat), 30 * GST_SECOND), 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+adaptivedemuxabr_suite (void)
+{
+  Suite *s = suite_create ("adaptivedemuxabr");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_throughput_constant);
+  tcase_add_test (tc_chain, test_throughput_invalid_samples);
+  tcase_add_test (tc_chain, test_throughput_drop);
+  tcase_add_test (tc_chain, test_throughput_rise);
+  tcase_add_test (tc_chain, test_throughput_weighting);
+  tcase_add_test (tc_chain, test_bola_ladder_4);
+  tcase_add_test (tc_chain, test_bola_ladder_5);
+  tcase_add_test (tc_chain, test_bola_monotonic);
+  tcase_add_test (tc_chain, test_bola_degenerate_ladder);
+
+  return s;
+}
+
+GST_CHECK_MAIN (adaptivedemuxabr)
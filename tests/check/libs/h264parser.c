@@ -211,6 +211,56 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+GST_START_TEST (test_h264_parse_start_code_alignments)
+{
+  static const guint8 payload[] = {
+    0x88, 0x84, 0x00, 0x10, 0xff, 0x00, 0x00, 0x03, 0x01, 0xfe, 0xf6,
+    0x00, 0x02, 0x00, 0x00, 0x03, 0x00, 0x36, 0x56, 0x04, 0x01, 0x01
+  };
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+  guint8 buf[64];
+  guint shift;
+
+  /* The start code search looks at several bytes at once, check that it
+   * finds start codes and NAL ends at every position */
+  for (shift = 0; shift < 16; shift++) {
+    GstH264ParserResult res;
+    GstH264NalUnit nalu;
+    guint size = 0;
+
+    memset (buf, 0x01, shift);
+    size += shift;
+    buf[size++] = 0x00;
+    buf[size++] = 0x00;
+    buf[size++] = 0x01;
+    buf[size++] = 0x65;
+    memcpy (buf + size, payload, sizeof (payload));
+    size += sizeof (payload);
+    buf[size++] = 0x00;
+    buf[size++] = 0x00;
+    buf[size++] = 0x01;
+    buf[size++] = 0x0b;
+
+    res = gst_h264_parser_identify_nalu (parser, buf, 0, size, &nalu);
+
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    assert_equals_int (nalu.type, GST_H264_NAL_SLICE_IDR);
+    assert_equals_int (nalu.offset, shift + 3);
+    assert_equals_int (nalu.size, 1 + sizeof (payload));
+
+    res = gst_h264_parser_identify_nalu (parser, buf, nalu.offset + nalu.size,
+        size, &nalu);
+
+    assert_equals_int (res, GST_H264_PARSER_OK);
+    assert_equals_int (nalu.type, GST_H264_NAL_STREAM_END);
+    assert_equals_int (nalu.offset, size - 1);
+  }
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +271,7 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_start_code_alignments);
 
   return s;
 }
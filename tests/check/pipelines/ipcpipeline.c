@@ -33,8 +33,10 @@
 #include <sys/wait.h>
 #include <sys/file.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
 #include <string.h>
 
 #ifndef HAVE_PIPE2
@@ -5804,6 +5806,411 @@ GST_START_TEST (test_wavparse_master_process_crash)
 
 GST_END_TEST;
 
+/* window of unacknowledged buffers; both pipelines live in this process and
+ * talk over a socket pair */
+
+typedef struct
+{
+  GstElement *master, *fakesrc, *ipcpipelinesink;
+  GstElement *slave, *ipcpipelinesrc;
+  int sockets[2];
+  gint sent;
+  gint received;
+  gboolean out_of_order;
+} WindowTestData;
+
+static void
+window_handoff (GstElement * fakesrc, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  WindowTestData *d = user_data;
+  guint32 index = GUINT32_TO_LE (d->sent);
+
+  gst_buffer_fill (buf, 0, &index, sizeof (index));
+  g_atomic_int_inc (&d->sent);
+}
+
+static GstPadProbeReturn
+window_received_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  WindowTestData *d = user_data;
+  guint32 index;
+
+  gst_buffer_extract (GST_PAD_PROBE_INFO_BUFFER (info), 0, &index,
+      sizeof (index));
+  if (GUINT32_FROM_LE (index) != d->received)
+    d->out_of_order = TRUE;
+  g_atomic_int_inc (&d->received);
+  return GST_PAD_PROBE_OK;
+}
+
+/* @slave_desc is linked after ipcpipelinesrc, whose pad is left unlinked if
+ * it is NULL */
+static void
+window_test_setup (WindowTestData * d, guint max_pending_buffers,
+    gint num_buffers, const gchar * slave_desc)
+{
+  GstPad *pad;
+
+  memset (d, 0, sizeof (*d));
+  FAIL_IF (socketpair (AF_UNIX, SOCK_STREAM, 0, d->sockets) < 0);
+
+  d->master = gst_pipeline_new (NULL);
+  d->fakesrc = gst_element_factory_make ("fakesrc", NULL);
+  g_object_set (d->fakesrc, "num-buffers", num_buffers, "sizemax", 188,
+      "signal-handoffs", TRUE, NULL);
+  gst_util_set_object_arg (G_OBJECT (d->fakesrc), "sizetype", "fixed");
+  g_signal_connect (d->fakesrc, "handoff", G_CALLBACK (window_handoff), d);
+  d->ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (d->ipcpipelinesink, "fdin", d->sockets[0], "fdout",
+      d->sockets[0], "max-pending-buffers", max_pending_buffers, NULL);
+  gst_bin_add_many (GST_BIN (d->master), d->fakesrc, d->ipcpipelinesink,
+      NULL);
+  FAIL_UNLESS (gst_element_link (d->fakesrc, d->ipcpipelinesink));
+
+  d->slave = gst_element_factory_make ("ipcslavepipeline", NULL);
+  d->ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  g_object_set (d->ipcpipelinesrc, "fdin", d->sockets[1], "fdout",
+      d->sockets[1], NULL);
+  gst_bin_add (GST_BIN (d->slave), d->ipcpipelinesrc);
+  if (slave_desc) {
+    GstElement *bin = gst_parse_bin_from_description (slave_desc, TRUE, NULL);
+
+    FAIL_UNLESS (bin != NULL);
+    gst_bin_add (GST_BIN (d->slave), bin);
+    FAIL_UNLESS (gst_element_link (d->ipcpipelinesrc, bin));
+  }
+
+  pad = gst_element_get_static_pad (d->ipcpipelinesrc, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, window_received_probe,
+      d, NULL);
+  gst_object_unref (pad);
+
+  FAIL_IF (gst_element_set_state (d->master, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+}
+
+static void
+window_test_teardown (WindowTestData * d)
+{
+  gst_element_set_state (d->master, GST_STATE_NULL);
+  gst_element_set_state (d->slave, GST_STATE_NULL);
+  gst_object_unref (d->master);
+  gst_object_unref (d->slave);
+  close (d->sockets[0]);
+  close (d->sockets[1]);
+}
+
+/* Waits for an error posted by @src in @domain, skipping the errors
+ * forwarded from the slave */
+static void
+window_test_wait_error (WindowTestData * d, GstElement * src, GQuark domain)
+{
+  GstMessage *msg;
+  gboolean found = FALSE;
+
+  while (!found) {
+    GError *err = NULL;
+
+    msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (d->master),
+        30 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    FAIL_UNLESS (msg != NULL);
+    FAIL_UNLESS_EQUALS_INT (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ERROR);
+    gst_message_parse_error (msg, &err, NULL);
+    found = GST_MESSAGE_SRC (msg) == GST_OBJECT (src) &&
+        err->domain == domain;
+    g_error_free (err);
+    gst_message_unref (msg);
+  }
+}
+
+GST_START_TEST (test_buffer_window_order)
+{
+  WindowTestData d;
+  GstMessage *msg;
+
+  window_test_setup (&d, 16, 2000, "fakesink sync=false");
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (d.master),
+      30 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  FAIL_UNLESS (msg != NULL);
+  FAIL_UNLESS_EQUALS_INT (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  FAIL_UNLESS_EQUALS_INT (g_atomic_int_get (&d.received), 2000);
+  FAIL_IF (d.out_of_order);
+
+  window_test_teardown (&d);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_buffer_window_error)
+{
+  WindowTestData d;
+  gint sent;
+
+  /* buffer 50 fails on the slave while the master keeps sending, the error
+   * has to be returned by one of the next 8 chain calls */
+  window_test_setup (&d, 8, 1000,
+      "identity error-after=50 ! fakesink sync=false");
+  window_test_wait_error (&d, d.fakesrc, GST_STREAM_ERROR);
+
+  sent = g_atomic_int_get (&d.sent);
+  FAIL_UNLESS (sent > 50);
+  FAIL_UNLESS (sent <= 50 + 8);
+  FAIL_IF (d.out_of_order);
+
+  window_test_teardown (&d);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_buffer_window_not_linked)
+{
+  WindowTestData d;
+  gint sent;
+
+  window_test_setup (&d, 8, 1000, NULL);
+  window_test_wait_error (&d, d.fakesrc, GST_STREAM_ERROR);
+
+  sent = g_atomic_int_get (&d.sent);
+  FAIL_UNLESS (sent > 1);
+  FAIL_UNLESS (sent <= 1 + 8);
+
+  window_test_teardown (&d);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_buffer_window_error_before_eos)
+{
+  WindowTestData d;
+
+  /* the last buffer fails, no chain call is left to return it so the EOS
+   * has to report it */
+  window_test_setup (&d, 8, 20,
+      "identity error-after=20 ! fakesink sync=false");
+  window_test_wait_error (&d, d.ipcpipelinesink, GST_STREAM_ERROR);
+
+  FAIL_UNLESS_EQUALS_INT (g_atomic_int_get (&d.sent), 20);
+
+  window_test_teardown (&d);
+}
+
+GST_END_TEST;
+
+/* buffer throughput benchmark: only the cost of the protocol itself is
+ * measured, the slave drops the buffers right away */
+
+#define THROUGHPUT_NUM_BUFFERS 20000
+
+static gdouble
+measure_buffer_throughput (guint max_pending_buffers)
+{
+  WindowTestData d;
+  GstMessage *msg;
+  gint64 start, elapsed;
+
+  start = g_get_monotonic_time ();
+  window_test_setup (&d, max_pending_buffers, THROUGHPUT_NUM_BUFFERS,
+      "fakesink sync=false");
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (d.master),
+      60 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  FAIL_UNLESS (msg != NULL);
+  FAIL_UNLESS_EQUALS_INT (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  FAIL_UNLESS_EQUALS_INT (g_atomic_int_get (&d.received),
+      THROUGHPUT_NUM_BUFFERS);
+  FAIL_IF (d.out_of_order);
+
+  window_test_teardown (&d);
+
+  return THROUGHPUT_NUM_BUFFERS * (gdouble) G_USEC_PER_SEC / elapsed;
+}
+
+GST_START_TEST (test_buffer_throughput)
+{
+  static const guint windows[] = { 1, 4, 32 };
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (windows); n++) {
+    gdouble rate = measure_buffer_throughput (windows[n]);
+
+    GST_INFO ("max-pending-buffers %u: %.0f buffers/s", windows[n], rate);
+    g_print ("ipcpipeline: max-pending-buffers %u: %.0f buffers/s\n",
+        windows[n], rate);
+  }
+}
+
+GST_END_TEST;
+
+/* zero-copy transport of memfd backed buffers, over a socket pair in this
+ * process too */
+
+#define FD_BUFFER_SIZE 4096
+
+typedef struct
+{
+  ino_t inode;
+  gint received;
+  gboolean zero_copy;
+  gboolean content_ok;
+  gint freed;
+} FdBufferTestData;
+
+static GstPadProbeReturn
+fd_buffer_received_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  FdBufferTestData *d = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstMapInfo map;
+  gsize i;
+
+  /* the very memfd the master filled, not a copy of it */
+  if (gst_buffer_n_memory (buf) == 1) {
+    GstMemory *mem = gst_buffer_peek_memory (buf, 0);
+    struct stat st;
+
+    d->zero_copy = gst_is_fd_memory (mem)
+        && fstat (gst_fd_memory_get_fd (mem), &st) == 0
+        && st.st_ino == d->inode;
+  }
+
+  if (gst_buffer_map (buf, &map, GST_MAP_READ)) {
+    d->content_ok = map.size == FD_BUFFER_SIZE;
+    for (i = 0; i < map.size && d->content_ok; i++)
+      d->content_ok = map.data[i] == (i & 0xff);
+    gst_buffer_unmap (buf, &map);
+  }
+
+  g_atomic_int_inc (&d->received);
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+fd_memory_freed (gpointer user_data, GstMiniObject * obj)
+{
+  g_atomic_int_set ((gint *) user_data, 1);
+}
+
+GST_START_TEST (test_fd_buffer_zero_copy)
+{
+  GstElement *master, *appsrc, *ipcpipelinesink;
+  GstElement *slave, *ipcpipelinesrc, *fakesink;
+  FdBufferTestData d = { 0, };
+  GstAllocator *allocator;
+  GstMemory *mem;
+  GstBuffer *buf;
+  GstQuery *query;
+  GstCaps *caps;
+  GstMapInfo map;
+  GstMessage *msg;
+  GstFlowReturn flow;
+  GstPad *pad;
+  struct stat st;
+  int sockets[2];
+  gint i;
+
+  FAIL_IF (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) < 0);
+
+  master = gst_pipeline_new (NULL);
+  appsrc = gst_element_factory_make ("appsrc", NULL);
+  ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (ipcpipelinesink, "fdin", sockets[0], "fdout", sockets[0],
+      "zero-copy", TRUE, NULL);
+  gst_bin_add_many (GST_BIN (master), appsrc, ipcpipelinesink, NULL);
+  FAIL_UNLESS (gst_element_link (appsrc, ipcpipelinesink));
+
+  slave = gst_element_factory_make ("ipcslavepipeline", NULL);
+  ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  g_object_set (ipcpipelinesrc, "fdin", sockets[1], "fdout", sockets[1], NULL);
+  /* nothing may keep the buffer around on the slave side */
+  fakesink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (fakesink, "sync", FALSE, "enable-last-sample", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (slave), ipcpipelinesrc, fakesink, NULL);
+  FAIL_UNLESS (gst_element_link (ipcpipelinesrc, fakesink));
+
+  pad = gst_element_get_static_pad (ipcpipelinesrc, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, fd_buffer_received_probe,
+      &d, NULL);
+  gst_object_unref (pad);
+
+  FAIL_IF (gst_element_set_state (master, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  /* the sink offers its memfd allocator */
+  caps = gst_caps_new_empty_simple ("application/x-test");
+  query = gst_query_new_allocation (caps, TRUE);
+  pad = gst_element_get_static_pad (ipcpipelinesink, "sink");
+  FAIL_UNLESS (gst_pad_query (pad, query));
+  gst_object_unref (pad);
+  FAIL_UNLESS_EQUALS_INT (gst_query_get_n_allocation_params (query), 1);
+  gst_query_parse_nth_allocation_param (query, 0, &allocator, NULL);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+  FAIL_UNLESS (allocator != NULL);
+
+  mem = gst_allocator_alloc (allocator, FD_BUFFER_SIZE, NULL);
+  FAIL_UNLESS (mem != NULL);
+  FAIL_UNLESS (gst_is_fd_memory (mem));
+  FAIL_UNLESS (fstat (gst_fd_memory_get_fd (mem), &st) == 0);
+  d.inode = st.st_ino;
+  FAIL_UNLESS (gst_memory_map (mem, &map, GST_MAP_WRITE));
+  for (i = 0; i < FD_BUFFER_SIZE; i++)
+    map.data[i] = i & 0xff;
+  gst_memory_unmap (mem, &map);
+  gst_mini_object_weak_ref (GST_MINI_OBJECT_CAST (mem), fd_memory_freed,
+      &d.freed);
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+  g_signal_emit_by_name (appsrc, "push-buffer", buf, &flow);
+  gst_buffer_unref (buf);
+  FAIL_UNLESS_EQUALS_INT (flow, GST_FLOW_OK);
+  g_signal_emit_by_name (appsrc, "end-of-stream", &flow);
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (master),
+      30 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  FAIL_UNLESS (msg != NULL);
+  FAIL_UNLESS_EQUALS_INT (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  FAIL_UNLESS_EQUALS_INT (g_atomic_int_get (&d.received), 1);
+  FAIL_UNLESS (d.zero_copy);
+  FAIL_UNLESS (d.content_ok);
+
+  /* the master holds the memory until the slave releases it, which it does
+   * as soon as fakesink dropped the buffer */
+  for (i = 0; i < 500 && !g_atomic_int_get (&d.freed); i++)
+    g_usleep (10 * 1000);
+  FAIL_UNLESS (g_atomic_int_get (&d.freed));
+
+  /* stopping joins the reader thread that freed the memory, whose memfd
+   * then went back to the allocator to be reused */
+  gst_element_set_state (master, GST_STATE_NULL);
+  gst_element_set_state (slave, GST_STATE_NULL);
+
+  mem = gst_allocator_alloc (allocator, FD_BUFFER_SIZE, NULL);
+  FAIL_UNLESS (mem != NULL);
+  FAIL_UNLESS (fstat (gst_fd_memory_get_fd (mem), &st) == 0);
+  FAIL_UNLESS (st.st_ino == d.inode);
+  gst_memory_unref (mem);
+  gst_object_unref (allocator);
+
+  gst_object_unref (master);
+  gst_object_unref (slave);
+  close (sockets[0]);
+  close (sockets[1]);
+}
+
+GST_END_TEST;
+
 static Suite *
 ipcpipeline_suite (void)
 {
@@ -6061,6 +6468,25 @@ ipcpipeline_suite (void)
      with the master pipeline. */
   tcase_add_test (tc_chain, test_wavparse_master_process_crash);
 
+  /* buffer_window tests send buffers with max-pending-buffers > 1 and check
+     that they arrive in order, and that a flow return other than OK from
+     the slave reaches the master on a later chain call or at EOS. */
+  tcase_add_test (tc_chain, test_buffer_window_order);
+  tcase_add_test (tc_chain, test_buffer_window_error);
+  tcase_add_test (tc_chain, test_buffer_window_not_linked);
+  tcase_add_test (tc_chain, test_buffer_window_error_before_eos);
+
+  /* buffer_throughput measures how many buffers per second go from the
+     master to the slave, waiting for each buffer's flow return or
+     keeping a window of buffers in flight. It does not fail if the window
+     does not help, it only reports the numbers. */
+  tcase_add_test (tc_chain, test_buffer_throughput);
+
+  /* fd_buffer_zero_copy checks that a memfd backed buffer reaches the slave
+     as the same memfd, and that the slave releasing it lets the master
+     free and reuse it. */
+  tcase_add_test (tc_chain, test_fd_buffer_zero_copy);
+
   return s;
 }
 
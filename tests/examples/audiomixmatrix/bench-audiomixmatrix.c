@@ -0,0 +1,209 @@
+/* GStreamer audiomixmatrix benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how fast audiomixmatrix processes the same input with a pure
+ * routing matrix, a sparse matrix where each output mixes two inputs and a
+ * dense matrix. The pipeline is audiotestsrc ! audiomixmatrix ! fakesink,
+ * so the time spent in the source is included in every mode. */
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+  MATRIX_ROUTING,
+  MATRIX_SPARSE,
+  MATRIX_DENSE
+} MatrixType;
+
+static const gchar *matrix_names[] = { "routing", "sparse", "dense" };
+
+static gdouble
+get_coefficient (MatrixType type, gint in, gint out, gint in_channels)
+{
+  switch (type) {
+    case MATRIX_ROUTING:
+      return in == out % in_channels;
+    case MATRIX_SPARSE:
+      return (in == out % in_channels
+          || in == (out + 1) % in_channels) ? 0.5 : 0.0;
+    case MATRIX_DENSE:
+    default:
+      return 1.0 / in_channels;
+  }
+}
+
+static void
+set_matrix (GstElement * mixmatrix, MatrixType type, gint in_channels,
+    gint out_channels)
+{
+  GValue matrix = G_VALUE_INIT;
+  gint in, out;
+
+  g_value_init (&matrix, GST_TYPE_ARRAY);
+  for (out = 0; out < out_channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < in_channels; in++) {
+      GValue itm = G_VALUE_INIT;
+
+      g_value_init (&itm, G_TYPE_DOUBLE);
+      g_value_set_double (&itm, get_coefficient (type, in, out, in_channels));
+      gst_value_array_append_value (&row, &itm);
+      g_value_unset (&itm);
+    }
+    gst_value_array_append_value (&matrix, &row);
+    g_value_unset (&row);
+  }
+
+  g_object_set_property (G_OBJECT (mixmatrix), "matrix", &matrix);
+  g_value_unset (&matrix);
+}
+
+static gboolean
+run_pipeline (MatrixType type, const gchar * format, gint in_channels,
+    gint out_channels, gint n_buffers, gint samples_per_buffer,
+    gint64 * elapsed)
+{
+  GstElement *pipeline, *src, *capsfilter, *mixmatrix, *sink;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  gint64 start;
+  gboolean ret;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("audiotestsrc", NULL);
+  capsfilter = gst_element_factory_make ("capsfilter", NULL);
+  mixmatrix = gst_element_factory_make ("audiomixmatrix", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!src || !capsfilter || !mixmatrix || !sink) {
+    g_printerr ("Missing elements\n");
+    exit (1);
+  }
+
+  g_object_set (src, "num-buffers", n_buffers, "samplesperbuffer",
+      samples_per_buffer, NULL);
+  gst_util_set_object_arg (G_OBJECT (src), "wave", "white-noise");
+  caps = gst_caps_new_simple ("audio/x-raw", "format", G_TYPE_STRING, format,
+      "channels", G_TYPE_INT, in_channels, "channel-mask", GST_TYPE_BITMASK,
+      (guint64) 0, NULL);
+  g_object_set (capsfilter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+  g_object_set (mixmatrix, "in-channels", in_channels, "out-channels",
+      out_channels, "channel-mask", (guint64) 0, NULL);
+  set_matrix (mixmatrix, type, in_channels, out_channels);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, capsfilter, mixmatrix, sink,
+      NULL);
+  gst_element_link_many (src, capsfilter, mixmatrix, sink, NULL);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  *elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  ret = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS;
+  if (!ret) {
+    GError *err = NULL;
+
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("Error: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  return ret;
+}
+
+int
+main (int argc, gchar ** argv)
+{
+  gchar *format = NULL;
+  gint in_channels = 64, out_channels = 16;
+  gint n_buffers = 2000, samples_per_buffer = 1024;
+  GOptionEntry options[] = {
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Sample format (F32LE, F64LE, S16LE, S32LE...)", NULL},
+    {"in-channels", 'i', 0, G_OPTION_ARG_INT, &in_channels,
+        "Number of input channels", NULL},
+    {"out-channels", 'o', 0, G_OPTION_ARG_INT, &out_channels,
+        "Number of output channels", NULL},
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &n_buffers,
+        "Number of buffers processed in each mode", NULL},
+    {"samples", 's', 0, G_OPTION_ARG_INT, &samples_per_buffer,
+        "Number of samples per buffer", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  MatrixType type;
+
+  gst_init (&argc, &argv);
+
+  ctx = g_option_context_new (NULL);
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Error initializing: %s\n", GST_STR_NULL (err->message));
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    exit (1);
+  }
+  g_option_context_free (ctx);
+
+  if (in_channels < 1 || in_channels > 64 || out_channels < 1
+      || out_channels > 64 || n_buffers <= 0 || samples_per_buffer <= 0) {
+    g_printerr ("Invalid settings\n");
+    exit (1);
+  }
+
+  if (format == NULL)
+    format = g_strdup (GST_AUDIO_NE (F32));
+
+  g_print ("%s, %d to %d channels, %d buffers of %d samples\n", format,
+      in_channels, out_channels, n_buffers, samples_per_buffer);
+
+  for (type = MATRIX_ROUTING; type <= MATRIX_DENSE; type++) {
+    gint64 elapsed;
+
+    if (!run_pipeline (type, format, in_channels, out_channels, n_buffers,
+            samples_per_buffer, &elapsed))
+      exit (1);
+
+    g_print ("%-8s %.3f s, %.1f Msamples/s\n", matrix_names[type],
+        elapsed / (gdouble) G_USEC_PER_SEC,
+        (gdouble) n_buffers * samples_per_buffer * in_channels / elapsed);
+  }
+
+  g_free (format);
+
+  return 0;
+}
@@ -0,0 +1,159 @@
+/* GStreamer H.264 NAL scanning benchmark
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Measures how fast gst_h264_parser_identify_nalu() splits a byte-stream
+ * into NAL units, which is dominated by the start code search. Without a
+ * file argument, a synthetic stream of large intra slices is used. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define GST_USE_UNSTABLE_API
+
+#include <gst/gst.h>
+#include <gst/codecparsers/gsth264parser.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Builds @n_nals IDR slices of @nal_size bytes of random payload, escaped
+ * like an encoder would do */
+static guint8 *
+make_stream (guint nal_size, guint n_nals, gsize * size)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  GByteArray *stream = g_byte_array_new ();
+  guint i, j;
+
+  for (i = 0; i < n_nals; i++) {
+    static const guint8 header[] = { 0x00, 0x00, 0x00, 0x01, 0x65 };
+    guint zeros = 0;
+
+    g_byte_array_append (stream, header, sizeof (header));
+    for (j = 0; j < nal_size; j++) {
+      guint8 byte = g_rand_int_range (rand, 0, 256);
+
+      if (zeros == 2 && byte <= 3) {
+        static const guint8 epb = 0x03;
+
+        g_byte_array_append (stream, &epb, 1);
+        zeros = 0;
+      }
+      /* the last byte of a NAL has the rbsp stop bit */
+      if (j == nal_size - 1 && byte == 0)
+        byte = 0x80;
+      g_byte_array_append (stream, &byte, 1);
+      zeros = byte == 0 ? zeros + 1 : 0;
+    }
+  }
+
+  g_rand_free (rand);
+
+  *size = stream->len;
+  return g_byte_array_free (stream, FALSE);
+}
+
+static guint
+scan_stream (GstH264NalParser * parser, const guint8 * data, gsize size)
+{
+  GstH264NalUnit nalu;
+  guint offset = 0, n_nals = 0;
+
+  while (gst_h264_parser_identify_nalu (parser, data, offset, size,
+          &nalu) == GST_H264_PARSER_OK) {
+    offset = nalu.offset + nalu.size;
+    n_nals++;
+  }
+
+  /* the last NAL has no following start code */
+  if (nalu.valid)
+    n_nals++;
+
+  return n_nals;
+}
+
+int
+main (int argc, gchar ** argv)
+{
+  gchar **filenames = NULL;
+  gint nal_size = 256 * 1024, n_nals = 64, iterations = 50;
+  GOptionEntry options[] = {
+    {"nal-size", 's', 0, G_OPTION_ARG_INT, &nal_size,
+        "Size of the synthetic NAL units in bytes", NULL},
+    {"nals", 'n', 0, G_OPTION_ARG_INT, &n_nals,
+        "Number of synthetic NAL units", NULL},
+    {"iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+        "Number of times the stream is scanned", NULL},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames, NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstH264NalParser *parser;
+  guint8 *data;
+  gsize size;
+  gint64 start, elapsed;
+  guint n_found = 0;
+  gint i;
+
+  gst_init (&argc, &argv);
+
+  ctx = g_option_context_new ("[FILE.H264]");
+  g_option_context_add_main_entries (ctx, options, GETTEXT_PACKAGE);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Error initializing: %s\n", GST_STR_NULL (err->message));
+    g_option_context_free (ctx);
+    g_clear_error (&err);
+    exit (1);
+  }
+  g_option_context_free (ctx);
+
+  if (filenames != NULL && *filenames != NULL) {
+    if (!g_file_get_contents (filenames[0], (gchar **) & data, &size, &err)) {
+      g_printerr ("Could not read %s: %s\n", filenames[0], err->message);
+      g_clear_error (&err);
+      exit (1);
+    }
+  } else {
+    if (nal_size <= 0 || n_nals <= 0) {
+      g_printerr ("Invalid synthetic stream size\n");
+      exit (1);
+    }
+    data = make_stream (nal_size, n_nals, &size);
+  }
+
+  parser = gst_h264_nal_parser_new ();
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    n_found = scan_stream (parser, data, size);
+  elapsed = MAX (g_get_monotonic_time () - start, 1);
+
+  g_print ("%u NAL units in %" G_GSIZE_FORMAT " bytes, %d iterations: "
+      "%.3f s, %.1f MB/s\n", n_found, size, iterations,
+      elapsed / (gdouble) G_USEC_PER_SEC,
+      (gdouble) size * iterations / elapsed);
+
+  gst_h264_nal_parser_free (parser);
+  g_free (data);
+  g_strfreev (filenames);
+
+  return 0;
+}